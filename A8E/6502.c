@@ -838,6 +838,35 @@ void _6502_SetIo(_6502_Context_t *pContext, u16 sAddress, u8 *(*IoAccessFunction
 	pContext->pAccessFunctionList[sAddress++] = IoAccessFunction;
 }
 
+void _6502_Write(_6502_Context_t *pContext, u16 sAddress, u8 cValue)
+{
+	u16 sAccessAddress = pContext->sAccessAddress;
+
+	pContext->sAccessAddress = sAddress;
+	pContext->pAccessFunctionList[sAddress](pContext, &cValue);
+	pContext->sAccessAddress = sAccessAddress;
+}
+
+u8 _6502_IsRam(_6502_Context_t *pContext, u16 sAddress, u32 lLength)
+{
+	u32 lAddress;
+
+	if(sAddress + lLength > _6502_MEMORY_SIZE)
+	{
+		return 0;
+	}
+
+	for(lAddress = sAddress; lAddress < sAddress + lLength; lAddress++)
+	{
+		if(pContext->pAccessFunctionList[lAddress] != _6502_RamAccess)
+		{
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
 u16 _6502_Disassemble(_6502_Context_t *pContext, u16 sAddress)
 {
 	char *pMnemonic;
@@ -1795,6 +1824,11 @@ void _6502_XXX(_6502_Context_t *pContext)
 {
 	int i;
 
+	if(pContext->TrapFunction && pContext->TrapFunction(pContext))
+	{
+		return;
+	}
+
 	printf("\nPC = $%04X, SP = $01%02X\n", CPU.pc - 1, CPU.sp);
 
 	for(i = CPU.sp - 10; i < CPU.sp + 10; i++)
@@ -80,6 +80,10 @@ typedef struct _6502_Context
 	u64 llIoBeamTimedEventCycle;
 	void (*IoCycleTimedEventFunction)(struct _6502_Context *);
 
+	/* Called for an undefined opcode with pc past it; returns 1 if it
+	   handled the opcode as a trap, 0 to halt as before. */
+	u8 (*TrapFunction)(struct _6502_Context *);
+
 	u8 cNmiPendingFlag;
 	u8 cNmiActiveFlag;
 	u8 cIrqPendingFlag;
@@ -95,6 +99,14 @@ void _6502_SetRom(_6502_Context_t *pContext, u16 sStart, u16 sEnd);
 void _6502_SetRam(_6502_Context_t *pContext, u16 sStart, u16 sEnd);
 void _6502_SetIo(_6502_Context_t *pContext, u16 sAddress, u8 *(*IoAccessFunction)(_6502_Context_t *, u8 *));
 
+/* Stores cValue at sAddress as a CPU write would: ROM ignores it, I/O
+   registers see it. For traps that move data on the program's behalf. */
+void _6502_Write(_6502_Context_t *pContext, u16 sAddress, u8 cValue);
+
+/* 1 if the lLength bytes from sAddress are plain RAM, without wrapping
+   past $FFFF, so a trap may fill them in place through pMemory. */
+u8 _6502_IsRam(_6502_Context_t *pContext, u16 sAddress, u32 lLength);
+
 void _6502_Status(_6502_Context_t *pContext);
 u16 _6502_Disassemble(_6502_Context_t *pContext, u16 sAddress);
 u16 _6502_DisassembleLive(_6502_Context_t *pContext, u16 sAddress);
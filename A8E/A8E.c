@@ -14,6 +14,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#ifndef _MSC_VER
+#include <strings.h>
+#endif
 #include <time.h>
 #include <SDL2/SDL.h>
 
@@ -21,9 +24,6 @@
 #include "AtariIo.h"
 #include "Pokey.h"
 
-/* Global window handle — used by Pokey.c to update the title bar. */
-SDL_Window *g_pSdlWindow = NULL;
-
 /********************************************************************
 *
 *
@@ -32,6 +32,23 @@ SDL_Window *g_pSdlWindow = NULL;
 *
 ********************************************************************/
 
+/* Shows the drive activity POKEY reports in the title bar. */
+static void A8E_SioStatus(void *pUser, u16 sSector)
+{
+	char aCaption[100];
+
+	if(sSector)
+	{
+		sprintf(aCaption, APPLICATION_CAPTION "  [%d]", sSector);
+	}
+	else
+	{
+		sprintf(aCaption, APPLICATION_CAPTION "  [-]");
+	}
+
+	SDL_SetWindowTitle((SDL_Window *)pUser, aCaption);
+}
+
 int main(int argc, char *argv[])
 {
 	_6502_Context_t *pAtariContext;
@@ -46,13 +63,31 @@ int main(int argc, char *argv[])
 	u8 cDisassembleFlag = 0;
 	u64 llCycles = CYCLES_PER_LINE * LINES_PER_SCREEN_PAL;
 	u32 lMode = 0;
-	char *pDiskFileName = "d1.atr";
+	char *apDiskFileNames[SIO_DRIVES] = {"d1.atr"};
+	u32 lDiskCount = 0;
+	char *pCassetteFileName = NULL;
+	char *pBasicFileName = NULL;
+	u8 cBasicRun = 1;
+	u8 cWriteMode = SIO_WRITE_MEMORY;
+	u8 cDrive;
+	u32 lCommitMilliseconds = DISK_JOURNAL_DEFAULT_MILLISECONDS;
 	u32 lAtariScreenWidth = 336;
 	u32 lAtariScreenHeight = 240;
 	u32 lWindowWidth = 0;
 	u32 lWindowHeight = 0;
 	u32 lWindowScale = 2;
 	u32 lFullscreen = 0;
+	u8 cBoxFilterAudio = 0;
+	u8 cAudioThread = 0;
+	u8 cAudioBackend = POKEY_AUDIO_SDL;
+	char *pAudioFileName = NULL;
+	char *pCaptureFileName = NULL;
+	char *pHostDirectory = NULL;
+	char *pBootCacheDirectory = NULL;
+	u8 cSioPatch = 1;
+	u8 cXexDirect = 1;
+	u8 cCassetteFast = 1;
+	u8 cSioDrive = POKEY_SIO_DRIVE_STOCK;
 	int lIndex;
 
 	if(SDL_Init(SDL_INIT_VIDEO | SDL_INIT_TIMER) < 0)
@@ -79,13 +114,163 @@ int main(int argc, char *argv[])
 
 				break;
 
+			case 'a':
+			case 'A':
+				cBoxFilterAudio = 1;
+
+				break;
+
+			case 't':
+			case 'T':
+				cAudioThread = 1;
+
+				break;
+
+			case 'n':
+			case 'N':
+				cAudioBackend = POKEY_AUDIO_NULL;
+
+				break;
+
+			case 'w':
+			case 'W':
+				if(lIndex + 1 < argc)
+				{
+					cAudioBackend = POKEY_AUDIO_FILE;
+					pAudioFileName = argv[++lIndex];
+				}
+
+				break;
+
+			case 'p':
+			case 'P':
+				/* Real SIO timing, for copy-protected disks. */
+				cSioPatch = 0;
+
+				break;
+
+			case 'd':
+			case 'D':
+				/* High-speed drive: ultra (US Doubler), xf551 or happy. */
+				if(lIndex + 1 < argc)
+				{
+					lIndex++;
+					if(argv[lIndex][0] == 'u' || argv[lIndex][0] == 'U')
+					{
+						cSioDrive = POKEY_SIO_DRIVE_ULTRA;
+					}
+					else if(argv[lIndex][0] == 'x' || argv[lIndex][0] == 'X')
+					{
+						cSioDrive = POKEY_SIO_DRIVE_XF551;
+					}
+					else if(argv[lIndex][0] == 'h' || argv[lIndex][0] == 'H')
+					{
+						cSioDrive = POKEY_SIO_DRIVE_HAPPY;
+					}
+				}
+
+				break;
+
+			case 'x':
+			case 'X':
+				/* Boot XEX files through the SIO boot loader. */
+				cXexDirect = 0;
+
+				break;
+
+			case 'r':
+			case 'R':
+				/* Play tapes in real time instead of serving C: records at once. */
+				cCassetteFast = 0;
+
+				break;
+
+			case 'h':
+			case 'H':
+				/* H: serves the files of <directory>. */
+				if(lIndex + 1 < argc)
+				{
+					pHostDirectory = argv[++lIndex];
+				}
+
+				break;
+
+			case 'l':
+			case 'L':
+				/* Leave a BASIC program at READY instead of running it. */
+				cBasicRun = 0;
+
+				break;
+
+			case 'k':
+			case 'K':
+				/* Cold starts from a snapshot kept in <directory>. */
+				if(lIndex + 1 < argc)
+				{
+					pBootCacheDirectory = argv[++lIndex];
+				}
+
+				break;
+
+			case 'm':
+			case 'M':
+				/* Sector writes go straight into the image files. */
+				cWriteMode = SIO_WRITE_THROUGH;
+
+				break;
+
+			case 's':
+			case 'S':
+				/* Sector writes are saved by a thread every <seconds>. */
+				if(lIndex + 1 < argc)
+				{
+					cWriteMode = SIO_WRITE_BACK;
+					lCommitMilliseconds = (u32)(atof(argv[++lIndex]) * 1000.0);
+				}
+
+				break;
+
+			case 'c':
+			case 'C':
+				if(lIndex + 1 < argc)
+				{
+					pCaptureFileName = argv[++lIndex];
+				}
+
+				break;
+
 			default:
 				break;
 			}
 		}
 		else
 		{
-			pDiskFileName = argv[lIndex];
+			const char *pExtension = strrchr(argv[lIndex], '.');
+
+			/* A CAS image goes in the cassette recorder, a BASIC program into
+			   memory, others to D1: to D8: in order. */
+#ifdef _MSC_VER
+			if(pExtension && _stricmp(pExtension, ".cas") == 0)
+#else
+			if(pExtension && strcasecmp(pExtension, ".cas") == 0)
+#endif
+			{
+				pCassetteFileName = argv[lIndex];
+			}
+#ifdef _MSC_VER
+			else if(pExtension && _stricmp(pExtension, ".bas") == 0)
+#else
+			else if(pExtension && strcasecmp(pExtension, ".bas") == 0)
+#endif
+			{
+				/* BASIC has to be on: no OPTION held at boot. */
+				pBasicFileName = argv[lIndex];
+				lMode = 1;
+			}
+			else if(lDiskCount < SIO_DRIVES)
+			{
+				apDiskFileNames[lDiskCount++] = argv[lIndex];
+			}
 		}
 	}
 
@@ -108,8 +293,6 @@ int main(int argc, char *argv[])
 		return -1;
 	}
 
-	g_pSdlWindow = pWindow;
-
 	pRenderer = SDL_CreateRenderer(pWindow, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
 	if(pRenderer == NULL)
 	{
@@ -156,10 +339,60 @@ int main(int argc, char *argv[])
 	_6502_Init();
 
 	pAtariContext = _6502_Open();
-	AtariIoOpen(pAtariContext, lMode, pDiskFileName);
+	AtariIoOpen(pAtariContext, lMode, NULL, cAudioBackend, pAudioFileName);
+	AtariIoSetDiskCommitInterval(pAtariContext, lCommitMilliseconds);
+	AtariIoSetXexDirect(pAtariContext, cXexDirect);
+	for(cDrive = 0; cDrive < SIO_DRIVES; cDrive++)
+	{
+		if(apDiskFileNames[cDrive])
+		{
+			AtariIoMountDisk(pAtariContext, cDrive, apDiskFileNames[cDrive], cWriteMode);
+		}
+	}
+
+	if(cBoxFilterAudio)
+	{
+		Pokey_SetSynthesisMode(pAtariContext, POKEY_SYNTHESIS_BOX);
+	}
+
+	if(cAudioThread)
+	{
+		Pokey_SetSynthesisThread(pAtariContext, 1);
+	}
+
+	if(pCaptureFileName)
+	{
+		Pokey_SetCapture(pAtariContext, 1);
+	}
+
+	if(pCassetteFileName && !AtariIoMountCassette(pAtariContext, pCassetteFileName))
+	{
+		fprintf(stderr, "A8E: %s is no CAS image.\n", pCassetteFileName);
+	}
+
+	if(pBasicFileName && !AtariIoLoadBasic(pAtariContext, pBasicFileName, cBasicRun))
+	{
+		fprintf(stderr, "A8E: %s is no BASIC program.\n", pBasicFileName);
+	}
+
+	if(pHostDirectory && !AtariIoSetHostDirectory(pAtariContext, pHostDirectory))
+	{
+		fprintf(stderr, "A8E: %s is no directory.\n", pHostDirectory);
+	}
+
+	AtariIoSetSioPatch(pAtariContext, cSioPatch);
+	AtariIoSetCassetteFast(pAtariContext, cCassetteFast);
+	Pokey_SetSioDrive(pAtariContext, cSioDrive);
+	Pokey_SetSioStatusCallback(pAtariContext, A8E_SioStatus, pWindow);
 
 	_6502_Reset(pAtariContext);
 
+	/* A restored machine is well into its first frames already. */
+	if(pBootCacheDirectory && AtariIoSetBootCache(pAtariContext, pBootCacheDirectory))
+	{
+		llCycles = pAtariContext->llCycleCounter + CYCLES_PER_LINE * LINES_PER_SCREEN_PAL;
+	}
+
 	while(1)
 	{
 		if(cDisassembleFlag)
@@ -239,7 +472,8 @@ int main(int argc, char *argv[])
 			}
 		}
 
-		if(!cTurboFlag)
+		/* Null and file audio backends run unpaced, faster than real time. */
+		if(!cTurboFlag && cAudioBackend == POKEY_AUDIO_SDL)
 		{
 			/* Audio-driven timing: wait while audio buffer is sufficiently full.
 			   This keeps emulation in sync with audio playback rate. */
@@ -276,6 +510,22 @@ int main(int argc, char *argv[])
 	}
 
 Exit:
+	if(pCaptureFileName)
+	{
+		size_t lLength = strlen(pCaptureFileName);
+
+		/* A .sap name gets a type R dump, anything else the raw stream. */
+		if(lLength > 4 && (!strcmp(&pCaptureFileName[lLength - 4], ".sap") ||
+						   !strcmp(&pCaptureFileName[lLength - 4], ".SAP")))
+		{
+			Pokey_SaveCaptureSap(pAtariContext, pCaptureFileName);
+		}
+		else
+		{
+			Pokey_SaveCaptureStream(pAtariContext, pCaptureFileName);
+		}
+	}
+
 	AtariIoClose(pAtariContext);
 	_6502_Close(pAtariContext);
 	SDL_FreeSurface(pScreenSurface);
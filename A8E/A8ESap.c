@@ -0,0 +1,344 @@
+/********************************************************************
+*
+*
+*
+* Atari 800 XL SAP Renderer
+*
+* (c) 2004 Sascha Springer
+*
+* a8e_sap [-s song] [-t seconds] file.sap [file.wav]
+* a8e_sap [-j threads] [-t seconds] directory
+*
+********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+#include "6502.h"
+#include "SapPlayer.h"
+
+/********************************************************************
+*
+*
+* Definitionen
+*
+*
+********************************************************************/
+
+#define SAP_MAX_PATH 1024
+#define SAP_MAX_THREADS 64
+
+typedef struct
+{
+	char **ppFileNames;
+	u32 lFileCount;
+	u32 lMilliseconds;
+	SDL_atomic_t tNextFile;
+	SDL_atomic_t tFailures;
+} SapBatch_t;
+
+/********************************************************************
+*
+*
+* Funktionen
+*
+*
+********************************************************************/
+
+static void A8ESap_Usage(void)
+{
+	fprintf(stderr,
+			"usage: a8e_sap [-s song] [-t seconds] file.sap [file.wav]\n"
+			"       a8e_sap [-j threads] [-t seconds] directory\n"
+			"  -s  song number, counted from 0 (default: DEFSONG)\n"
+			"  -t  length in seconds (default: TIME tag, else 180)\n"
+			"  -j  render threads for a directory (default: one per CPU)\n");
+}
+
+/* Replaces the extension of pSapFileName with ".wav". */
+static void A8ESap_WavFileName(char *pWavFileName, const char *pSapFileName)
+{
+	char *pDot;
+	char *pSlash;
+
+	snprintf(pWavFileName, SAP_MAX_PATH - 4, "%s", pSapFileName);
+	pDot = strrchr(pWavFileName, '.');
+	pSlash = strrchr(pWavFileName, '/');
+	if(pDot && (!pSlash || pDot > pSlash))
+	{
+		*pDot = 0;
+	}
+
+	strcat(pWavFileName, ".wav");
+}
+
+static int A8ESap_RenderFile(const char *pSapFileName, const char *pWavFileName, int lSong, u32 lMilliseconds)
+{
+	SapFile_t tSap;
+	char aWavFileName[SAP_MAX_PATH];
+	int bOk;
+
+	if(!Sap_Load(&tSap, pSapFileName))
+	{
+		return 0;
+	}
+
+	if(!pWavFileName)
+	{
+		A8ESap_WavFileName(aWavFileName, pSapFileName);
+		pWavFileName = aWavFileName;
+	}
+
+	bOk = Sap_RenderWav(&tSap, (u8)(lSong < 0 ? tSap.cDefSong : lSong), lMilliseconds, pWavFileName, NULL);
+	if(bOk)
+	{
+		printf("%s -> %s\n", pSapFileName, pWavFileName);
+	}
+
+	Sap_Free(&tSap);
+
+	return bOk;
+}
+
+static int A8ESap_IsSapFileName(const char *pFileName)
+{
+	size_t lLength = strlen(pFileName);
+
+	return lLength > 4 &&
+		   (!strcmp(&pFileName[lLength - 4], ".sap") || !strcmp(&pFileName[lLength - 4], ".SAP"));
+}
+
+static void A8ESap_AddFile(SapBatch_t *pBatch, const char *pDirectory, const char *pFileName)
+{
+	char **ppFileNames;
+	char *pPath;
+	size_t lLength = strlen(pDirectory) + strlen(pFileName) + 2;
+
+	ppFileNames = (char **)realloc(pBatch->ppFileNames, (pBatch->lFileCount + 1) * sizeof(char *));
+	pPath = (char *)malloc(lLength);
+	if(!ppFileNames || !pPath)
+	{
+		free(pPath);
+		if(ppFileNames)
+		{
+			pBatch->ppFileNames = ppFileNames;
+		}
+		return;
+	}
+
+	snprintf(pPath, lLength, "%s/%s", pDirectory, pFileName);
+	pBatch->ppFileNames = ppFileNames;
+	pBatch->ppFileNames[pBatch->lFileCount++] = pPath;
+}
+
+/* Returns 1 and fills pBatch if pPath is a directory. */
+static int A8ESap_ListDirectory(SapBatch_t *pBatch, const char *pPath)
+{
+#ifdef _WIN32
+	char aPattern[SAP_MAX_PATH];
+	WIN32_FIND_DATAA tFindData;
+	HANDLE hFind;
+	DWORD lAttributes = GetFileAttributesA(pPath);
+
+	if(lAttributes == INVALID_FILE_ATTRIBUTES || !(lAttributes & FILE_ATTRIBUTE_DIRECTORY))
+	{
+		return 0;
+	}
+
+	snprintf(aPattern, sizeof(aPattern), "%s\\*.sap", pPath);
+	hFind = FindFirstFileA(aPattern, &tFindData);
+	if(hFind != INVALID_HANDLE_VALUE)
+	{
+		do
+		{
+			A8ESap_AddFile(pBatch, pPath, tFindData.cFileName);
+		} while(FindNextFileA(hFind, &tFindData));
+
+		FindClose(hFind);
+	}
+#else
+	struct stat tStat;
+	struct dirent *pEntry;
+	DIR *pDirectory;
+
+	if(stat(pPath, &tStat) != 0 || !S_ISDIR(tStat.st_mode))
+	{
+		return 0;
+	}
+
+	pDirectory = opendir(pPath);
+	if(!pDirectory)
+	{
+		return 0;
+	}
+
+	while((pEntry = readdir(pDirectory)) != NULL)
+	{
+		if(A8ESap_IsSapFileName(pEntry->d_name))
+		{
+			A8ESap_AddFile(pBatch, pPath, pEntry->d_name);
+		}
+	}
+
+	closedir(pDirectory);
+#endif
+
+	return 1;
+}
+
+/* Each thread takes the next unrendered file until none are left. */
+static int SDLCALL A8ESap_BatchThread(void *pData)
+{
+	SapBatch_t *pBatch = (SapBatch_t *)pData;
+	u32 lFile;
+
+	while((lFile = (u32)SDL_AtomicAdd(&pBatch->tNextFile, 1)) < pBatch->lFileCount)
+	{
+		if(!A8ESap_RenderFile(pBatch->ppFileNames[lFile], NULL, -1, pBatch->lMilliseconds))
+		{
+			SDL_AtomicAdd(&pBatch->tFailures, 1);
+		}
+	}
+
+	return 0;
+}
+
+static int A8ESap_RenderBatch(SapBatch_t *pBatch, u32 lThreadCount)
+{
+	SDL_Thread *apThreads[SAP_MAX_THREADS];
+	u32 lThread;
+
+	if(lThreadCount == 0)
+	{
+		lThreadCount = (u32)SDL_GetCPUCount();
+	}
+
+	if(lThreadCount > pBatch->lFileCount)
+	{
+		lThreadCount = pBatch->lFileCount;
+	}
+
+	if(lThreadCount > SAP_MAX_THREADS)
+	{
+		lThreadCount = SAP_MAX_THREADS;
+	}
+
+	if(lThreadCount == 0)
+	{
+		lThreadCount = 1;
+	}
+
+	for(lThread = 0; lThread < lThreadCount; lThread++)
+	{
+		apThreads[lThread] = SDL_CreateThread(A8ESap_BatchThread, "a8e_sap", pBatch);
+	}
+
+	for(lThread = 0; lThread < lThreadCount; lThread++)
+	{
+		if(apThreads[lThread])
+		{
+			SDL_WaitThread(apThreads[lThread], NULL);
+		}
+		else
+		{
+			/* Could not start it: render its share here instead. */
+			A8ESap_BatchThread(pBatch);
+		}
+	}
+
+	return SDL_AtomicGet(&pBatch->tFailures) == 0;
+}
+
+int main(int argc, char *argv[])
+{
+	SapBatch_t tBatch;
+	char *pInputName = NULL;
+	char *pWavFileName = NULL;
+	int lSong = -1;
+	u32 lMilliseconds = 0;
+	u32 lThreadCount = 0;
+	u32 lFile;
+	int lIndex;
+	int bOk;
+
+	for(lIndex = 1; lIndex < argc; lIndex++)
+	{
+		if(argv[lIndex][0] == '-' && lIndex + 1 < argc)
+		{
+			switch(argv[lIndex][1])
+			{
+			case 's':
+			case 'S':
+				lSong = atoi(argv[++lIndex]);
+
+				break;
+
+			case 't':
+			case 'T':
+				lMilliseconds = (u32)(atof(argv[++lIndex]) * 1000.0);
+
+				break;
+
+			case 'j':
+			case 'J':
+				lThreadCount = (u32)atoi(argv[++lIndex]);
+
+				break;
+
+			default:
+				A8ESap_Usage();
+				return 1;
+			}
+		}
+		else if(!pInputName)
+		{
+			pInputName = argv[lIndex];
+		}
+		else if(!pWavFileName)
+		{
+			pWavFileName = argv[lIndex];
+		}
+		else
+		{
+			A8ESap_Usage();
+			return 1;
+		}
+	}
+
+	if(!pInputName)
+	{
+		A8ESap_Usage();
+		return 1;
+	}
+
+	Sap_Init();
+
+	memset(&tBatch, 0, sizeof(tBatch));
+	tBatch.lMilliseconds = lMilliseconds;
+
+	if(A8ESap_ListDirectory(&tBatch, pInputName))
+	{
+		bOk = tBatch.lFileCount ? A8ESap_RenderBatch(&tBatch, lThreadCount) : 1;
+
+		for(lFile = 0; lFile < tBatch.lFileCount; lFile++)
+		{
+			free(tBatch.ppFileNames[lFile]);
+		}
+		free(tBatch.ppFileNames);
+	}
+	else
+	{
+		bOk = A8ESap_RenderFile(pInputName, pWavFileName, lSong, lMilliseconds);
+	}
+
+	return bOk ? 0 : 1;
+}
@@ -24,6 +24,14 @@
 #include <stdio.h>
 #include <stdarg.h>
 #include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
@@ -45,6 +53,14 @@
 ********************************************************************/
 
 #define CLIP(a) MAX(0, MIN(255, a))
+#if defined(_MSC_VER)
+#define ATARIIO_FORCE_INLINE static __forceinline
+#elif defined(__GNUC__)
+#define ATARIIO_FORCE_INLINE static inline __attribute__((always_inline))
+#else
+#define ATARIIO_FORCE_INLINE static inline
+#endif
+#define HIRES_PRIOR_CLASS_GENERIC 4u
 #define DLI_HORIZONTAL_OFFSET 7u
 
 typedef struct
@@ -150,7 +166,7 @@ static void AtariIoAdvanceScanline(_6502_Context_t *pContext)
 
 	if(pIoData->tVideoData.lCurrentDisplayLine == 248)
 	{
-		pIoData->llDliCycle = CYCLE_NEVER;
+		AtariIoScheduleTimedEvent(pContext, TIMED_EVENT_DLI, CYCLE_NEVER);
 		/* NMIST DLI is cleared at the start of VBL (line 248). */
 		RAM[IO_NMIRES_NMIST] &= ~NMI_DLI;
 	}
@@ -175,7 +191,10 @@ static void AtariIoAdvanceScanline(_6502_Context_t *pContext)
 	   pIoData->tVideoData.lCurrentDisplayLine >= 8 &&
 	   pIoData->tVideoData.lCurrentDisplayLine <= 247)
 	{
-		pIoData->llDliCycle = pIoData->llDisplayListFetchCycle + DLI_HORIZONTAL_OFFSET;
+		AtariIoScheduleTimedEvent(
+			pContext,
+			TIMED_EVENT_DLI,
+			pIoData->llDisplayListFetchCycle + DLI_HORIZONTAL_OFFSET);
 	}
 
 	if(pIoData->tVideoData.lCurrentDisplayLine == 248)
@@ -184,8 +203,10 @@ static void AtariIoAdvanceScanline(_6502_Context_t *pContext)
 		 * fires at cycle 8, gated by the same NMIEN deadlines as the DLI
 		 * (AHRM 4.8). llDisplayListFetchCycle already points at line 248.
 		 */
-		pIoData->llVbiCycle =
-			pIoData->llDisplayListFetchCycle + DLI_HORIZONTAL_OFFSET;
+		AtariIoScheduleTimedEvent(
+			pContext,
+			TIMED_EVENT_VBI,
+			pIoData->llDisplayListFetchCycle + DLI_HORIZONTAL_OFFSET);
 	}
 }
 
@@ -956,7 +977,7 @@ typedef struct
 {
 	u32 lNumberOfLines;
 	u32 lPixelsPerByte;
-	void (*DrawFunction)(_6502_Context_t *);
+	void (*DrawFunction[4])(_6502_Context_t *); /* indexed by PRIOR bits 6-7 */
 } AnticModeInfo_t;
 
 typedef struct
@@ -977,8 +998,14 @@ typedef struct
 
 extern u8 m_cConsolHack;
 
-static void AtariIo_DrawLineMode2(_6502_Context_t *pContext);
-static void AtariIo_DrawLineMode3(_6502_Context_t *pContext);
+static void AtariIo_DrawLineMode2Prior0(_6502_Context_t *pContext);
+static void AtariIo_DrawLineMode2Prior1(_6502_Context_t *pContext);
+static void AtariIo_DrawLineMode2Prior2(_6502_Context_t *pContext);
+static void AtariIo_DrawLineMode2Prior3(_6502_Context_t *pContext);
+static void AtariIo_DrawLineMode3Prior0(_6502_Context_t *pContext);
+static void AtariIo_DrawLineMode3Prior1(_6502_Context_t *pContext);
+static void AtariIo_DrawLineMode3Prior2(_6502_Context_t *pContext);
+static void AtariIo_DrawLineMode3Prior3(_6502_Context_t *pContext);
 static void AtariIo_DrawLineMode4(_6502_Context_t *pContext);
 static void AtariIo_DrawLineMode5(_6502_Context_t *pContext);
 static void AtariIo_DrawLineMode6(_6502_Context_t *pContext);
@@ -990,7 +1017,10 @@ static void AtariIo_DrawLineModeB(_6502_Context_t *pContext);
 static void AtariIo_DrawLineModeC(_6502_Context_t *pContext);
 static void AtariIo_DrawLineModeD(_6502_Context_t *pContext);
 static void AtariIo_DrawLineModeE(_6502_Context_t *pContext);
-static void AtariIo_DrawLineModeF(_6502_Context_t *pContext);
+static void AtariIo_DrawLineModeFPrior0(_6502_Context_t *pContext);
+static void AtariIo_DrawLineModeFPrior1(_6502_Context_t *pContext);
+static void AtariIo_DrawLineModeFPrior2(_6502_Context_t *pContext);
+static void AtariIo_DrawLineModeFPrior3(_6502_Context_t *pContext);
 static void AtariIo_CycleTimedEvent(_6502_Context_t *pContext);
 static void AtariIo_DrawPlayerMissilesClock(_6502_Context_t *pContext);
 
@@ -1055,7 +1085,7 @@ static u8 AtariIo_ReadVirtualPlayfieldBus(_6502_Context_t *pContext, u32 lCycleO
 	return RAM[sBusAddress];
 }
 
-static void AtariIo_SchedulePlayfieldDma(_6502_Context_t *pContext, u32 lCycleOffset, u32 lCycles)
+static void AtariIo_SchedulePlayfieldDma(_6502_Context_t *pContext, u32 lCycleOffset)
 {
 	IoData_t *pIoData = (IoData_t *)pContext->pIoData;
 	u32 lCycleInLine = AtariIo_CurrentLineCycle(pIoData, lCycleOffset);
@@ -1066,10 +1096,8 @@ static void AtariIo_SchedulePlayfieldDma(_6502_Context_t *pContext, u32 lCycleOf
 		return;
 	}
 
-	pIoData->tDrawLineData.aScheduledPlayfieldDma[lCycleInLine] =
-		(u8)MIN(
-			255u,
-			(u32)pIoData->tDrawLineData.aScheduledPlayfieldDma[lCycleInLine] + lCycles);
+	/* Name and glyph fetches never share a cycle, so one bit is enough. */
+	LINE_CYCLE_MASK_SET(pIoData->tDrawLineData.aScheduledPlayfieldDma, lCycleInLine);
 }
 
 static u8 AtariIo_FetchBufferedDisplayByte(_6502_Context_t *pContext, u8 cBufferIndex, u32 lCycleOffset)
@@ -1083,7 +1111,7 @@ static u8 AtariIo_FetchBufferedDisplayByte(_6502_Context_t *pContext, u8 cBuffer
 		if(AtariIo_PlayfieldDmaAllowedAtCycle(pContext, lCycleOffset))
 		{
 			cValue = RAM[pIoData->tDrawLineData.sDisplayMemoryAddress];
-			AtariIo_SchedulePlayfieldDma(pContext, lCycleOffset, 1);
+			AtariIo_SchedulePlayfieldDma(pContext, lCycleOffset);
 		}
 		else
 		{
@@ -1106,7 +1134,7 @@ static u8 AtariIo_FetchUnbufferedDisplayByte(_6502_Context_t *pContext, u16 sAdd
 {
 	if(AtariIo_PlayfieldDmaAllowedAtCycle(pContext, lCycleOffset))
 	{
-		AtariIo_SchedulePlayfieldDma(pContext, lCycleOffset, 1);
+		AtariIo_SchedulePlayfieldDma(pContext, lCycleOffset);
 		return RAM[sAddress];
 	}
 
@@ -1179,6 +1207,67 @@ static int AtariIo_FetchPmgDmaCycle(_6502_Context_t *pContext, u32 lCycleInLine,
 	return 0;
 }
 
+/* Line cycles with fixed ANTIC work: PMG DMA (0, 2-5), display list DMA
+   (1, 6, 7), the exit-line DLI check (6), refresh (25-57, every 4th),
+   the VSCROL end latch (109) and the VCOUNT update (111-113). */
+static const u64 m_aFixedLineEventMask[LINE_CYCLE_MASK_WORDS] =
+	{
+		0x02222222220000ffULL,
+		0x0003a00000000000ULL,
+};
+
+static u32 AtariIo_CountTrailingZeros(u64 llValue)
+{
+#if defined(__GNUC__)
+	return (u32)__builtin_ctzll(llValue);
+#else
+	u32 lCount = 0;
+
+	while((llValue & 1) == 0)
+	{
+		llValue >>= 1;
+		lCount++;
+	}
+
+	return lCount;
+#endif
+}
+
+static u32 AtariIo_NextLineEventCycle(const IoData_t *pIoData, u32 lCycleInLine)
+{
+	u32 lWord;
+
+	for(lWord = lCycleInLine >> 6; lWord < LINE_CYCLE_MASK_WORDS; lWord++)
+	{
+		u64 llEvents =
+			m_aFixedLineEventMask[lWord] |
+			pIoData->tDrawLineData.aPlayfieldDmaTemplate[lWord];
+
+		if(lWord == (lCycleInLine >> 6))
+		{
+			llEvents &= ~0ULL << (lCycleInLine & 63);
+		}
+
+		if(llEvents)
+		{
+			return (lWord << 6) + AtariIo_CountTrailingZeros(llEvents);
+		}
+	}
+
+	return CYCLES_PER_LINE;
+}
+
+static int AtariIo_IsQuietClock(_6502_Context_t *pContext, u32 lCycleInLine)
+{
+	IoData_t *pIoData = (IoData_t *)pContext->pIoData;
+
+	return lCycleInLine >= pIoData->tDrawLineData.lQuietFromCycle &&
+		   lCycleInLine < pIoData->tDrawLineData.lQuietUntilCycle &&
+		   !pIoData->tDrawLineData.cRefreshDmaPending &&
+		   pContext->llIoBeamTimedEventCycle > pIoData->llCycle &&
+		   pContext->llIoMasterTimedEventCycle > pContext->llCycleCounter;
+}
+
 static void AtariIo_DrawClockAction(_6502_Context_t *pContext)
 {
 	IoData_t *pIoData = (IoData_t *)pContext->pIoData;
@@ -1186,10 +1275,28 @@ static void AtariIo_DrawClockAction(_6502_Context_t *pContext)
 	u32 lCycleInLine = (u32)(pIoData->llCycle - llLineStartCycle);
 	u8 cPlayfieldDmaStealCount =
 		(lCycleInLine < CYCLES_PER_LINE)
-			? pIoData->tDrawLineData.aScheduledPlayfieldDma[lCycleInLine]
+			? (u8)LINE_CYCLE_MASK_TEST(pIoData->tDrawLineData.aScheduledPlayfieldDma, lCycleInLine)
 			: 0;
 	u8 cDidRefreshDma = 0;
 
+	if(!cPlayfieldDmaStealCount && AtariIo_IsQuietClock(pContext, lCycleInLine))
+	{
+		pIoData->tDrawLineData.cPlayfieldDmaStealCount = 0;
+
+		if(pIoData->bInDrawLine)
+		{
+			AtariIo_DrawPlayerMissilesClock(pContext);
+		}
+		if(pContext->llCycleCounter < pIoData->llCycle)
+		{
+			_6502_Execute(pContext);
+		}
+		pIoData->llCycle++;
+		return;
+	}
+
+	pIoData->tDrawLineData.lQuietFromCycle = lCycleInLine + 1;
+	pIoData->tDrawLineData.lQuietUntilCycle = AtariIo_NextLineEventCycle(pIoData, lCycleInLine + 1);
 	pIoData->tDrawLineData.cPlayfieldDmaStealCount = cPlayfieldDmaStealCount;
 
 	if(lCycleInLine >= 111u)
@@ -1218,8 +1325,10 @@ static void AtariIo_DrawClockAction(_6502_Context_t *pContext)
 	if(lCycleInLine == 6 && pIoData->bModeLineExitDli &&
 	   pIoData->cModeLineRowCounter == (SRAM[IO_VSCROL] & 0x0f))
 	{
-		pIoData->llDliCycle = llLineStartCycle + DLI_HORIZONTAL_OFFSET;
-		AtariIoCycleTimedEventUpdate(pContext);
+		AtariIoScheduleTimedEvent(
+			pContext,
+			TIMED_EVENT_DLI,
+			llLineStartCycle + DLI_HORIZONTAL_OFFSET);
 	}
 
 	/* AHRM 4.7: the final row of a scrolled region is determined by the
@@ -1302,6 +1411,54 @@ static void AtariIo_DrawClockAction(_6502_Context_t *pContext)
 	pIoData->llCycle++;
 }
 
+/* Lines below the visible area have no playfield, no PMG DMA and no PMG
+ * output, so between the fixed line events nothing but the CPU advances.
+ * The beam is moved straight to the cycle after the CPU's next instruction
+ * start, which is the same clock the per-clock loop would execute it on.
+ */
+static void AtariIo_DrawBlankingLine(_6502_Context_t *pContext)
+{
+	IoData_t *pIoData = (IoData_t *)pContext->pIoData;
+	u64 llLineStartCycle = pIoData->llDisplayListFetchCycle;
+	u64 llLineEndCycle = pIoData->llCycle + CYCLES_PER_LINE;
+
+	while(pIoData->llCycle < llLineEndCycle)
+	{
+		u32 lCycleInLine = (u32)(pIoData->llCycle - llLineStartCycle);
+		u64 llQuietEndCycle;
+
+		if(lCycleInLine >= CYCLES_PER_LINE ||
+		   LINE_CYCLE_MASK_TEST(pIoData->tDrawLineData.aScheduledPlayfieldDma, lCycleInLine) ||
+		   !AtariIo_IsQuietClock(pContext, lCycleInLine))
+		{
+			AtariIo_DrawClockAction(pContext);
+			continue;
+		}
+
+		llQuietEndCycle = MIN(
+			llLineStartCycle + pIoData->tDrawLineData.lQuietUntilCycle,
+			llLineEndCycle);
+		pIoData->tDrawLineData.cPlayfieldDmaStealCount = 0;
+
+		while(pIoData->llCycle < llQuietEndCycle &&
+			  pContext->llIoBeamTimedEventCycle > pIoData->llCycle &&
+			  pContext->llIoMasterTimedEventCycle > pContext->llCycleCounter)
+		{
+			if(pContext->llCycleCounter < pIoData->llCycle)
+			{
+				_6502_Execute(pContext);
+				pIoData->llCycle++;
+			}
+			else
+			{
+				pIoData->llCycle = MIN(
+					MIN(pContext->llCycleCounter + 1, llQuietEndCycle),
+					pContext->llIoBeamTimedEventCycle);
+			}
+		}
+	}
+}
+
 #ifdef A8E_ENABLE_TEST_PROBES
 void AtariIoTimingProbeStepClock(_6502_Context_t *pContext)
 {
@@ -1327,22 +1484,22 @@ u8 AtariIoTimingProbeFetchUnbufferedDisplayByte(
 
 static AnticModeInfo_t m_aAnticModeInfoTable[16] =
 	{
-		{0, 0, NULL},
-		{0, 0, NULL},
-		{8, 8, AtariIo_DrawLineMode2},
-		{10, 8, AtariIo_DrawLineMode3},
-		{8, 8, AtariIo_DrawLineMode4},
-		{16, 8, AtariIo_DrawLineMode5},
-		{8, 16, AtariIo_DrawLineMode6},
-		{16, 16, AtariIo_DrawLineMode7},
-		{8, 32, AtariIo_DrawLineMode8},
-		{4, 32, AtariIo_DrawLineMode9},
-		{4, 16, AtariIo_DrawLineModeA},
-		{2, 16, AtariIo_DrawLineModeB},
-		{1, 16, AtariIo_DrawLineModeC},
-		{2, 8, AtariIo_DrawLineModeD},
-		{1, 8, AtariIo_DrawLineModeE},
-		{1, 8, AtariIo_DrawLineModeF},
+		{0, 0, {NULL, NULL, NULL, NULL}},
+		{0, 0, {NULL, NULL, NULL, NULL}},
+		{8, 8, {AtariIo_DrawLineMode2Prior0, AtariIo_DrawLineMode2Prior1, AtariIo_DrawLineMode2Prior2, AtariIo_DrawLineMode2Prior3}},
+		{10, 8, {AtariIo_DrawLineMode3Prior0, AtariIo_DrawLineMode3Prior1, AtariIo_DrawLineMode3Prior2, AtariIo_DrawLineMode3Prior3}},
+		{8, 8, {AtariIo_DrawLineMode4, AtariIo_DrawLineMode4, AtariIo_DrawLineMode4, AtariIo_DrawLineMode4}},
+		{16, 8, {AtariIo_DrawLineMode5, AtariIo_DrawLineMode5, AtariIo_DrawLineMode5, AtariIo_DrawLineMode5}},
+		{8, 16, {AtariIo_DrawLineMode6, AtariIo_DrawLineMode6, AtariIo_DrawLineMode6, AtariIo_DrawLineMode6}},
+		{16, 16, {AtariIo_DrawLineMode7, AtariIo_DrawLineMode7, AtariIo_DrawLineMode7, AtariIo_DrawLineMode7}},
+		{8, 32, {AtariIo_DrawLineMode8, AtariIo_DrawLineMode8, AtariIo_DrawLineMode8, AtariIo_DrawLineMode8}},
+		{4, 32, {AtariIo_DrawLineMode9, AtariIo_DrawLineMode9, AtariIo_DrawLineMode9, AtariIo_DrawLineMode9}},
+		{4, 16, {AtariIo_DrawLineModeA, AtariIo_DrawLineModeA, AtariIo_DrawLineModeA, AtariIo_DrawLineModeA}},
+		{2, 16, {AtariIo_DrawLineModeB, AtariIo_DrawLineModeB, AtariIo_DrawLineModeB, AtariIo_DrawLineModeB}},
+		{1, 16, {AtariIo_DrawLineModeC, AtariIo_DrawLineModeC, AtariIo_DrawLineModeC, AtariIo_DrawLineModeC}},
+		{2, 8, {AtariIo_DrawLineModeD, AtariIo_DrawLineModeD, AtariIo_DrawLineModeD, AtariIo_DrawLineModeD}},
+		{1, 8, {AtariIo_DrawLineModeE, AtariIo_DrawLineModeE, AtariIo_DrawLineModeE, AtariIo_DrawLineModeE}},
+		{1, 8, {AtariIo_DrawLineModeFPrior0, AtariIo_DrawLineModeFPrior1, AtariIo_DrawLineModeFPrior2, AtariIo_DrawLineModeFPrior3}},
 };
 
 static void AtariIoAdvanceDisplayMemoryRow(IoData_t *pIoData)
@@ -1788,6 +1945,113 @@ static u8 AtariIo_ComputeActiveLineGeometry(
 	return 1;
 }
 
+/* Line geometry and playfield DMA cycles only depend on the mode, the
+   horizontal scroll enable, the DMACTL playfield width and HSCROL, so
+   they are computed for every combination before the first machine runs
+   and only looked up at line start. */
+
+#define ANTIC_LINE_TEMPLATE_COUNT (16 * 2 * 4 * 16)
+
+typedef struct
+{
+	u8 bActive;
+	u8 bClipScrolledNonWide;
+	ActiveLineGeometry_t tGeometry;
+	ActiveLineGeometry_t tVisibleGeometry;
+	u64 aFirstRowDma[LINE_CYCLE_MASK_WORDS];
+	u64 aRepeatRowDma[LINE_CYCLE_MASK_WORDS];
+} AnticLineTemplate_t;
+
+static AnticLineTemplate_t m_aAnticLineTemplates[ANTIC_LINE_TEMPLATE_COUNT];
+static AtariIoOnce_t m_tAnticLineTemplatesOnce;
+
+static void AtariIo_BuildLineTemplate(
+	AnticLineTemplate_t *pTemplate,
+	u8 cMode,
+	u8 cHScrollEnabled,
+	u8 cPlayfieldWidth,
+	u8 cHScroll)
+{
+	u32 lPixelsPerByte = m_aAnticModeInfoTable[cMode].lPixelsPerByte;
+	u8 cCommand = cMode | cHScrollEnabled;
+	u32 lCyclesPerByte;
+	u32 lCycle;
+	u32 i;
+
+	memset(pTemplate, 0, sizeof(*pTemplate));
+
+	pTemplate->bActive = AtariIo_ComputeActiveLineGeometry(
+		cCommand,
+		cPlayfieldWidth,
+		cHScroll,
+		lPixelsPerByte,
+		&pTemplate->tGeometry);
+
+	if(!pTemplate->bActive)
+	{
+		return;
+	}
+
+	if(cHScrollEnabled && cPlayfieldWidth != 0x03)
+	{
+		pTemplate->bClipScrolledNonWide = AtariIo_ComputeActiveLineGeometry(
+			cMode,
+			cPlayfieldWidth,
+			0,
+			lPixelsPerByte,
+			&pTemplate->tVisibleGeometry);
+	}
+
+	/* Name/bitmap bytes are fetched on the first row only, character
+	   modes fetch glyph data 3 cycles later on every row. */
+	lCyclesPerByte = lPixelsPerByte / 4;
+	lCycle = ACTIVE_LINE_COLOR_BURST_CYCLES + pTemplate->tGeometry.lLeftBorderCycles;
+
+	for(i = 0; i < pTemplate->tGeometry.lBytesPerLine; i++, lCycle += lCyclesPerByte)
+	{
+		if(lCycle <= 105u)
+		{
+			LINE_CYCLE_MASK_SET(pTemplate->aFirstRowDma, lCycle);
+		}
+
+		if(cMode <= 0x07 && lCycle + 3 <= 105u)
+		{
+			LINE_CYCLE_MASK_SET(pTemplate->aFirstRowDma, lCycle + 3);
+			LINE_CYCLE_MASK_SET(pTemplate->aRepeatRowDma, lCycle + 3);
+		}
+	}
+}
+
+/* Shared by all machines, built by the first AtariIoOpen. */
+static void AtariIo_BuildLineTemplates(void)
+{
+	u32 lIndex;
+
+	for(lIndex = 0; lIndex < ANTIC_LINE_TEMPLATE_COUNT; lIndex++)
+	{
+		AtariIo_BuildLineTemplate(
+			&m_aAnticLineTemplates[lIndex],
+			(u8)(lIndex & 0x0f),
+			(u8)(lIndex & 0x10),
+			(u8)((lIndex >> 5) & 0x03),
+			(u8)(lIndex >> 7));
+	}
+}
+
+static const AnticLineTemplate_t *AtariIo_LookupLineTemplate(
+	u8 cDisplayListCommand,
+	u8 cPlayfieldWidth,
+	u8 cHScroll)
+{
+	u8 cHScrollEnabled = cDisplayListCommand & 0x10;
+
+	cPlayfieldWidth &= 0x03;
+	cHScroll = cHScrollEnabled ? (cHScroll & 0x0f) : 0;
+
+	return &m_aAnticLineTemplates[
+		(cDisplayListCommand & 0x1f) | (cPlayfieldWidth << 5) | (cHScroll << 7)];
+}
+
 static void AtariIo_FillBackgroundSpan(
 	u8 *pDestination,
 	u8 *pPriorityData,
@@ -1816,544 +2080,370 @@ static void AtariIo_FillBackgroundSpan(
 	}
 }
 
-static void AtariIo_DrawLineMode2(_6502_Context_t *pContext)
+/* Playfield pixels are produced one colour clock (4 pixels) at a time,
+   because the CPU may rewrite the colour registers between any two
+   clocks. The masks below expand the bits shown during one clock into a
+   packed 4 pixel select mask (in memory order), so a clock is written
+   with one blend and two 32 bit stores instead of per-pixel branches. */
+
+#define PIXELS_SPLAT(c) ((uint32_t)(c) * 0x01010101u)
+
+static const u8 m_aNibblePixelMask[16][4] =
+	{
+		{0x00, 0x00, 0x00, 0x00},
+		{0x00, 0x00, 0x00, 0xff},
+		{0x00, 0x00, 0xff, 0x00},
+		{0x00, 0x00, 0xff, 0xff},
+		{0x00, 0xff, 0x00, 0x00},
+		{0x00, 0xff, 0x00, 0xff},
+		{0x00, 0xff, 0xff, 0x00},
+		{0x00, 0xff, 0xff, 0xff},
+		{0xff, 0x00, 0x00, 0x00},
+		{0xff, 0x00, 0x00, 0xff},
+		{0xff, 0x00, 0xff, 0x00},
+		{0xff, 0x00, 0xff, 0xff},
+		{0xff, 0xff, 0x00, 0x00},
+		{0xff, 0xff, 0x00, 0xff},
+		{0xff, 0xff, 0xff, 0x00},
+		{0xff, 0xff, 0xff, 0xff},
+};
+
+static const u8 m_aPairPixelMask[4][4] =
+	{
+		{0x00, 0x00, 0x00, 0x00},
+		{0x00, 0x00, 0xff, 0xff},
+		{0xff, 0xff, 0x00, 0x00},
+		{0xff, 0xff, 0xff, 0xff},
+};
+
+static const u16 m_aFourColorRegister[4] =
+	{
+		IO_COLBK,
+		IO_COLPF0,
+		IO_COLPF1,
+		IO_COLPF2,
+};
+
+static const u8 m_aFourColorPriority[4] =
+	{
+		PRIO_BKG,
+		PRIO_PF0,
+		PRIO_PF1,
+		PRIO_PF2,
+};
+
+ATARIIO_FORCE_INLINE uint32_t AtariIo_LoadPixelMask(const u8 *pMask)
 {
-	IoData_t *pIoData = (IoData_t *)pContext->pIoData;
-	u8 cCharacter;
+	uint32_t lMask;
+
+	memcpy(&lMask, pMask, sizeof(lMask));
+	return lMask;
+}
+
+ATARIIO_FORCE_INLINE uint32_t AtariIo_SelectPixels(uint32_t lMask, u8 cClear, u8 cSet)
+{
+	return (PIXELS_SPLAT(cClear) & ~lMask) | (PIXELS_SPLAT(cSet) & lMask);
+}
+
+ATARIIO_FORCE_INLINE void AtariIo_PutClockPixels(
+	IoData_t *pIoData,
+	uint32_t lColors,
+	uint32_t lPriorities)
+{
+	memcpy(pIoData->tDrawLineData.pDestination, &lColors, sizeof(lColors));
+	memcpy(pIoData->tDrawLineData.pPriorityData, &lPriorities, sizeof(lPriorities));
+	pIoData->tDrawLineData.pDestination += 4;
+	pIoData->tDrawLineData.pPriorityData += 4;
+}
+
+/* Modes 2, 3 and F share one hires kernel. The GTIA mode in PRIOR bits
+   6-7 is sampled at the start of the playfield and selects a kernel
+   specialised for that class; should the CPU rewrite PRIOR while the
+   line is being drawn, the rest of the line falls back to the generic
+   kernel which re-reads PRIOR on every clock. */
+
+typedef struct
+{
+	u32 lCycle;
+	u32 lPlayfieldCycles;
+	u32 lModeLineRow;
+	u8 cChactl;
+	u8 cMask;
 	u8 cData;
 	u8 cInverse;
-	u8 cColor;
-	u8 cColor0;
-	u8 cColor1;
-	u8 cPriority0;
-	u8 cPriority1;
+	u8 cBufferIndex;
+} HiresLineState_t;
+
+static const u16 m_aGtiaMode10ColorRegister[16] =
+	{
+		IO_COLPM0_TRIG2,
+		IO_COLPM1_TRIG3,
+		IO_COLPM2_PAL,
+		IO_COLPM3,
+		IO_COLPF0,
+		IO_COLPF1,
+		IO_COLPF2,
+		IO_COLPF3,
+		IO_COLBK,
+		IO_COLBK,
+		IO_COLBK,
+		IO_COLBK,
+		IO_COLPF0,
+		IO_COLPF1,
+		IO_COLPF2,
+		IO_COLPF3,
+};
 
-	u32 lModeLineRow = pIoData->cModeLineRowCounter & 0x0f;
-	u8 cChactl = SRAM[IO_CHACTL];
+static void AtariIo_FetchHiresGlyph(
+	_6502_Context_t *pContext,
+	HiresLineState_t *pState,
+	u8 cMode,
+	u8 cRaw,
+	u16 sChbase)
+{
+	u8 cBit7 = cRaw & 0x80;
+	u8 cCharacter = cRaw & 0x7f;
+	u8 cChactl = pState->cChactl;
+	u32 lModeLineRow = pState->lModeLineRow;
+	u32 lGlyphRow;
+	u8 bFetch;
 
-	/* AHRM 4.7: mode 2 rows 10-15 repeat rows 2-7. */
-	if(lModeLineRow >= 10)
-		lModeLineRow -= 8;
+	if(lModeLineRow < 8)
+	{
+		/* AHRM 4.7: mode 3 lowercase characters leave rows 0-1 blank. */
+		bFetch = cMode == 0x02 || cCharacter < 0x60 || lModeLineRow >= 2;
+		lGlyphRow = lModeLineRow;
+	}
+	else
+	{
+		/* AHRM 4.7: rows 8-9 show descender rows 0-1 of lowercase
+		   characters and are blank for all others. */
+		bFetch = cCharacter >= 0x60;
+		lGlyphRow = lModeLineRow - 8;
+	}
 
-	u32 lPlayfieldCycles = pIoData->tDrawLineData.lBytesPerLine * 2;
-	u32 lCycle;
-	u8 cMask = 0x00;
-	u8 cBufferIndex = 0x00;
+	if(bFetch)
+	{
+		u32 lRow = (cChactl & 0x04) ? (7 - lGlyphRow) : lGlyphRow;
+		pState->cData = AtariIo_FetchUnbufferedDisplayByte(
+			pContext,
+			sChbase + cCharacter * 8 + lRow,
+			3);
+	}
+	else
+	{
+		pState->cData = 0x00;
+	}
 
-	for(lCycle = 0; lCycle < lPlayfieldCycles; lCycle++)
+	if(cBit7 && (cChactl & 0x01))
 	{
-		u16 sChbase = ((u16)AtariIo_CurrentChbaseRegister(pContext) << 8) & 0xfc00;
-		u8 cPriorMode = SRAM[IO_PRIOR] >> 6;
-		u8 cOutputData;
+		/* CHACTL bit 0: blank characters with name bit 7 set */
+		pState->cData = 0x00;
+		pState->cInverse = cChactl & 0x02 ? 0x80 : 0x00;
+	}
+	else
+	{
+		/* CHACTL bit 1: invert characters with name bit 7 set */
+		pState->cInverse = cBit7 && (cChactl & 0x02) ? 0x80 : 0x00;
+	}
+}
 
-		if(cMask == 0x00)
+ATARIIO_FORCE_INLINE void AtariIo_DrawHiresClock(
+	_6502_Context_t *pContext,
+	HiresLineState_t *pState,
+	u32 lPriorClass)
+{
+	IoData_t *pIoData = (IoData_t *)pContext->pIoData;
+	u8 cData = pState->cInverse ? (u8)~pState->cData : pState->cData;
+	u8 cNibble = pState->cMask > 0x08 ? (cData >> 4) : (cData & 0x0f);
+	u8 cColor;
+
+	if(lPriorClass == 0)
+	{
+		/* Inverse video swaps PF1/PF2, which is the same as inverting the
+		   glyph bits. */
+		u8 cColor0 = SRAM[IO_COLPF2];
+		u8 cColor1 = (cColor0 & 0xf0) | (SRAM[IO_COLPF1] & 0x0f);
+		uint32_t lMask = AtariIo_LoadPixelMask(m_aNibblePixelMask[cNibble]);
+
+		AtariIo_PutClockPixels(
+			pIoData,
+			AtariIo_SelectPixels(lMask, cColor0, cColor1),
+			AtariIo_SelectPixels(lMask, PRIO_PF2, PRIO_PF1));
+	}
+	else
+	{
+		if(lPriorClass == 1)
+		{
+			cColor = SRAM[IO_COLBK] | cNibble;
+		}
+		else if(lPriorClass == 2)
+		{
+			cColor = SRAM[m_aGtiaMode10ColorRegister[cNibble]];
+		}
+		else
 		{
-			u8 cRaw = AtariIo_FetchBufferedDisplayByte(pContext, cBufferIndex++, 0);
-			u8 cBit7 = cRaw & 0x80;
-			cCharacter = cRaw & 0x7f;
+			cColor = cNibble ? (SRAM[IO_COLBK] | (u8)(cNibble << 4)) : (SRAM[IO_COLBK] & 0xf0);
+		}
 
-			if(lModeLineRow < 8)
-			{
-				u32 lRow = (cChactl & 0x04) ? (7 - lModeLineRow) : lModeLineRow;
-				cData = AtariIo_FetchUnbufferedDisplayByte(pContext,
-					sChbase + cCharacter * 8 + lRow, 3);
-			}
-			else if(cCharacter >= 0x60)
-			{
-				/* AHRM 4.7: rows 8-9 show descender rows 0-1, as in mode 3. */
-				u32 lDescRow = lModeLineRow - 8;
-				u32 lRow = (cChactl & 0x04) ? (7 - lDescRow) : lDescRow;
-				cData = AtariIo_FetchUnbufferedDisplayByte(pContext,
-					sChbase + cCharacter * 8 + lRow, 3);
-			}
-			else
-			{
-				/* AHRM 4.7: rows 8-9 are blank for non-descender characters. */
-				cData = 0x00;
-			}
+		AtariIo_PutClockPixels(pIoData, PIXELS_SPLAT(cColor), PIXELS_SPLAT(PRIO_BKG));
+	}
 
-			if(cBit7 && (cChactl & 0x01))
-			{
-				/* CHACTL bit 0: blank characters with name bit 7 set */
-				cData = 0x00;
-				cInverse = cChactl & 0x02 ? 0x80 : 0x00;
-			}
-			else
-			{
-				/* CHACTL bit 1: invert characters with name bit 7 set */
-				cInverse = cBit7 && (cChactl & 0x02) ? 0x80 : 0x00;
-			}
+	pState->cMask >>= 4;
+}
 
-			cMask = 0x80;
-		}
+ATARIIO_FORCE_INLINE void AtariIo_DrawHiresSpan(
+	_6502_Context_t *pContext,
+	HiresLineState_t *pState,
+	u8 cMode,
+	u32 lPriorClass)
+{
+	while(pState->lCycle < pState->lPlayfieldCycles)
+	{
+		u32 lCyclePriorClass = SRAM[IO_PRIOR] >> 6;
+		u16 sChbase = 0;
 
-		cOutputData = cData;
-		if(cInverse && cPriorMode != 0)
+		if(lPriorClass != HIRES_PRIOR_CLASS_GENERIC && lCyclePriorClass != lPriorClass)
 		{
-			cOutputData ^= 0xff;
+			return;
 		}
 
-		if(cPriorMode == 0)
+		if(cMode != 0x0f)
 		{
-			if(cInverse)
-			{
-				cColor0 = (SRAM[IO_COLPF2] & 0xf0) | (SRAM[IO_COLPF1] & 0x0f);
-				cColor1 = SRAM[IO_COLPF2];
-				cPriority0 = PRIO_PF1;
-				cPriority1 = PRIO_PF2;
-			}
-			else
-			{
-				cColor0 = SRAM[IO_COLPF2];
-				cColor1 = (SRAM[IO_COLPF2] & 0xf0) | (SRAM[IO_COLPF1] & 0x0f);
-				cPriority0 = PRIO_PF2;
-				cPriority1 = PRIO_PF1;
-			}
+			sChbase = ((u16)AtariIo_CurrentChbaseRegister(pContext) << 8) & 0xfc00;
 		}
 
-		switch(cPriorMode)
+		if(pState->cMask == 0x00)
 		{
-		case 0:
-			if(cOutputData & cMask)
-			{
-				*(pIoData->tDrawLineData.pDestination)++ = cColor1;
-				*(pIoData->tDrawLineData.pPriorityData)++ = cPriority1;
-			}
-			else
-			{
-				*(pIoData->tDrawLineData.pDestination)++ = cColor0;
-				*(pIoData->tDrawLineData.pPriorityData)++ = cPriority0;
-			}
-			cMask >>= 1;
+			u8 cRaw = AtariIo_FetchBufferedDisplayByte(pContext, pState->cBufferIndex++, 0);
 
-			if(cOutputData & cMask)
+			if(cMode == 0x0f)
 			{
-				*(pIoData->tDrawLineData.pDestination)++ = cColor1;
-				*(pIoData->tDrawLineData.pPriorityData)++ = cPriority1;
+				pState->cData = cRaw;
+				pState->cInverse = 0x00;
 			}
 			else
 			{
-				*(pIoData->tDrawLineData.pDestination)++ = cColor0;
-				*(pIoData->tDrawLineData.pPriorityData)++ = cPriority0;
+				AtariIo_FetchHiresGlyph(pContext, pState, cMode, cRaw, sChbase);
 			}
-			cMask >>= 1;
 
-			if(cOutputData & cMask)
-			{
-				*(pIoData->tDrawLineData.pDestination)++ = cColor1;
-				*(pIoData->tDrawLineData.pPriorityData)++ = cPriority1;
-			}
-			else
-			{
-				*(pIoData->tDrawLineData.pDestination)++ = cColor0;
-				*(pIoData->tDrawLineData.pPriorityData)++ = cPriority0;
-			}
-			cMask >>= 1;
+			pState->cMask = 0x80;
+		}
 
-			if(cOutputData & cMask)
-			{
-				*(pIoData->tDrawLineData.pDestination)++ = cColor1;
-				*(pIoData->tDrawLineData.pPriorityData)++ = cPriority1;
-			}
-			else
-			{
-				*(pIoData->tDrawLineData.pDestination)++ = cColor0;
-				*(pIoData->tDrawLineData.pPriorityData)++ = cPriority0;
-			}
-			cMask >>= 1;
+		switch(lPriorClass == HIRES_PRIOR_CLASS_GENERIC ? lCyclePriorClass : lPriorClass)
+		{
+		case 0:
+			AtariIo_DrawHiresClock(pContext, pState, 0);
 			break;
 
 		case 1:
-			if(cMask > 0x08)
-			{
-				cColor = SRAM[IO_COLBK] | (cOutputData >> 4);
-				*(pIoData->tDrawLineData.pDestination)++ = cColor;
-				*(pIoData->tDrawLineData.pDestination)++ = cColor;
-				*(pIoData->tDrawLineData.pDestination)++ = cColor;
-				*(pIoData->tDrawLineData.pDestination)++ = cColor;
-				*(pIoData->tDrawLineData.pPriorityData)++ = PRIO_BKG;
-				*(pIoData->tDrawLineData.pPriorityData)++ = PRIO_BKG;
-				*(pIoData->tDrawLineData.pPriorityData)++ = PRIO_BKG;
-				*(pIoData->tDrawLineData.pPriorityData)++ = PRIO_BKG;
-			}
-			else
-			{
-				cColor = SRAM[IO_COLBK] | (cOutputData & 0x0f);
-				*(pIoData->tDrawLineData.pDestination)++ = cColor;
-				*(pIoData->tDrawLineData.pDestination)++ = cColor;
-				*(pIoData->tDrawLineData.pDestination)++ = cColor;
-				*(pIoData->tDrawLineData.pDestination)++ = cColor;
-				*(pIoData->tDrawLineData.pPriorityData)++ = PRIO_BKG;
-				*(pIoData->tDrawLineData.pPriorityData)++ = PRIO_BKG;
-				*(pIoData->tDrawLineData.pPriorityData)++ = PRIO_BKG;
-				*(pIoData->tDrawLineData.pPriorityData)++ = PRIO_BKG;
-			}
-			cMask >>= 4;
+			AtariIo_DrawHiresClock(pContext, pState, 1);
 			break;
 
 		case 2:
-			{
-				u8 aColorTable[16] =
-					{
-						SRAM[IO_COLPM0_TRIG2],
-						SRAM[IO_COLPM1_TRIG3],
-						SRAM[IO_COLPM2_PAL],
-						SRAM[IO_COLPM3],
-						SRAM[IO_COLPF0],
-						SRAM[IO_COLPF1],
-						SRAM[IO_COLPF2],
-						SRAM[IO_COLPF3],
-						SRAM[IO_COLBK],
-						SRAM[IO_COLBK],
-						SRAM[IO_COLBK],
-						SRAM[IO_COLBK],
-						SRAM[IO_COLPF0],
-						SRAM[IO_COLPF1],
-						SRAM[IO_COLPF2],
-						SRAM[IO_COLPF3],
-					};
-				if(cMask > 0x08)
-				{
-					cColor = aColorTable[cOutputData >> 4];
-					*(pIoData->tDrawLineData.pDestination)++ = cColor;
-					*(pIoData->tDrawLineData.pDestination)++ = cColor;
-					*(pIoData->tDrawLineData.pDestination)++ = cColor;
-					*(pIoData->tDrawLineData.pDestination)++ = cColor;
-					*(pIoData->tDrawLineData.pPriorityData)++ = PRIO_BKG;
-					*(pIoData->tDrawLineData.pPriorityData)++ = PRIO_BKG;
-					*(pIoData->tDrawLineData.pPriorityData)++ = PRIO_BKG;
-					*(pIoData->tDrawLineData.pPriorityData)++ = PRIO_BKG;
-				}
-				else
-				{
-					cColor = aColorTable[cOutputData & 0x0f];
-					*(pIoData->tDrawLineData.pDestination)++ = cColor;
-					*(pIoData->tDrawLineData.pDestination)++ = cColor;
-					*(pIoData->tDrawLineData.pDestination)++ = cColor;
-					*(pIoData->tDrawLineData.pDestination)++ = cColor;
-					*(pIoData->tDrawLineData.pPriorityData)++ = PRIO_BKG;
-					*(pIoData->tDrawLineData.pPriorityData)++ = PRIO_BKG;
-					*(pIoData->tDrawLineData.pPriorityData)++ = PRIO_BKG;
-					*(pIoData->tDrawLineData.pPriorityData)++ = PRIO_BKG;
-				}
-			}
-			cMask >>= 4;
+			AtariIo_DrawHiresClock(pContext, pState, 2);
 			break;
 
-		case 3:
-			if(cMask > 0x08)
-			{
-				cColor = (cOutputData & 0xf0) ? (SRAM[IO_COLBK] | (cOutputData & 0xf0)) : (SRAM[IO_COLBK] & 0xf0);
-				*(pIoData->tDrawLineData.pDestination)++ = cColor;
-				*(pIoData->tDrawLineData.pDestination)++ = cColor;
-				*(pIoData->tDrawLineData.pDestination)++ = cColor;
-				*(pIoData->tDrawLineData.pDestination)++ = cColor;
-				*(pIoData->tDrawLineData.pPriorityData)++ = PRIO_BKG;
-				*(pIoData->tDrawLineData.pPriorityData)++ = PRIO_BKG;
-				*(pIoData->tDrawLineData.pPriorityData)++ = PRIO_BKG;
-				*(pIoData->tDrawLineData.pPriorityData)++ = PRIO_BKG;
-			}
-			else
-			{
-				cColor = (cOutputData & 0x0f) ? (SRAM[IO_COLBK] | (cOutputData << 4)) : (SRAM[IO_COLBK] & 0xf0);
-				*(pIoData->tDrawLineData.pDestination)++ = cColor;
-				*(pIoData->tDrawLineData.pDestination)++ = cColor;
-				*(pIoData->tDrawLineData.pDestination)++ = cColor;
-				*(pIoData->tDrawLineData.pDestination)++ = cColor;
-				*(pIoData->tDrawLineData.pPriorityData)++ = PRIO_BKG;
-				*(pIoData->tDrawLineData.pPriorityData)++ = PRIO_BKG;
-				*(pIoData->tDrawLineData.pPriorityData)++ = PRIO_BKG;
-				*(pIoData->tDrawLineData.pPriorityData)++ = PRIO_BKG;
-			}
-			cMask >>= 4;
+		default:
+			AtariIo_DrawHiresClock(pContext, pState, 3);
 			break;
 		}
 
+		pState->lCycle++;
 		AtariIo_DrawClockAction(pContext);
 	}
 }
 
-static void AtariIo_DrawVisibleBlankLine(
+static void AtariIo_DrawHiresSpanGeneric(
 	_6502_Context_t *pContext,
-	u8 *pDestination,
-	u8 *pPriorityData)
+	HiresLineState_t *pState,
+	u8 cMode)
 {
-	AtariIo_StepClockActions(pContext, ACTIVE_LINE_COLOR_BURST_CYCLES);
-	AtariIo_DrawBackgroundClipped(
-		pContext,
-		pDestination,
-		pPriorityData,
-		ACTIVE_LINE_COLOR_BURST_CYCLES * 4,
-		CYCLES_PER_LINE - ACTIVE_LINE_COLOR_BURST_CYCLES);
+	AtariIo_DrawHiresSpan(pContext, pState, cMode, HIRES_PRIOR_CLASS_GENERIC);
 }
 
-static void AtariIo_DrawLineMode3(_6502_Context_t *pContext)
+ATARIIO_FORCE_INLINE void AtariIo_DrawHiresLine(
+	_6502_Context_t *pContext,
+	u8 cMode,
+	u32 lPriorClass)
 {
 	IoData_t *pIoData = (IoData_t *)pContext->pIoData;
-	u8 cCharacter;
-	u8 cData;
-	u8 cInverse;
-	u8 cColor;
-	u8 cColor0;
-	u8 cColor1;
-	u8 cPriority0;
-	u8 cPriority1;
+	HiresLineState_t tState;
 
-	u32 lVerticalScrollOffset = pIoData->cModeLineRowCounter & 0x0f;
-	u8 cChactl = SRAM[IO_CHACTL];
+	tState.lCycle = 0;
+	tState.lPlayfieldCycles = pIoData->tDrawLineData.lBytesPerLine * 2;
+	tState.lModeLineRow = pIoData->cModeLineRowCounter & 0x0f;
+	tState.cChactl = SRAM[IO_CHACTL];
+	tState.cMask = 0x00;
+	tState.cData = 0x00;
+	tState.cInverse = 0x00;
+	tState.cBufferIndex = 0x00;
 
-	/* AHRM 4.7: mode 3 rows 10-15 repeat rows 2-7. */
-	if(lVerticalScrollOffset >= 10)
-		lVerticalScrollOffset -= 8;
+	/* AHRM 4.7: modes 2 and 3 rows 10-15 repeat rows 2-7. */
+	if(tState.lModeLineRow >= 10)
+		tState.lModeLineRow -= 8;
 
-	u32 lPlayfieldCycles = pIoData->tDrawLineData.lBytesPerLine * 2;
-	u32 lCycle;
-	u8 cMask = 0x00;
-	u8 cBufferIndex = 0x00;
+	AtariIo_DrawHiresSpan(pContext, &tState, cMode, lPriorClass);
 
-	for(lCycle = 0; lCycle < lPlayfieldCycles; lCycle++)
+	if(tState.lCycle < tState.lPlayfieldCycles)
 	{
-		u16 sChbase = ((u16)AtariIo_CurrentChbaseRegister(pContext) << 8) & 0xfc00;
-		u8 cPriorMode = SRAM[IO_PRIOR] >> 6;
-		u8 cOutputData;
-
-		if(cMask == 0x00)
-		{
-			u8 cRaw = AtariIo_FetchBufferedDisplayByte(pContext, cBufferIndex++, 0);
-			u8 cBit7 = cRaw & 0x80;
-			cCharacter = cRaw & 0x7f;
-
-			if(cCharacter < 0x60)
-			{
-				if(lVerticalScrollOffset < 8)
-				{
-					u32 lRow = (cChactl & 0x04) ? (7 - lVerticalScrollOffset) : lVerticalScrollOffset;
-					cData = AtariIo_FetchUnbufferedDisplayByte(
-						pContext,
-						sChbase + cCharacter * 8 + lRow,
-						3);
-				}
-				else
-					cData = 0x00;
-			}
-			else
-			{
-				if(lVerticalScrollOffset < 2)
-				{
-					cData = 0x00;
-				}
-				else if(lVerticalScrollOffset < 8)
-				{
-					u32 lRow = (cChactl & 0x04) ? (7 - lVerticalScrollOffset) : lVerticalScrollOffset;
-					cData = AtariIo_FetchUnbufferedDisplayByte(
-						pContext,
-						sChbase + cCharacter * 8 + lRow,
-						3);
-				}
-				else
-				{
-					u32 lDescRow = lVerticalScrollOffset - 8;
-					u32 lRow = (cChactl & 0x04) ? (7 - lDescRow) : lDescRow;
-					cData = AtariIo_FetchUnbufferedDisplayByte(
-						pContext,
-						sChbase + cCharacter * 8 + lRow,
-						3);
-				}
-			}
-
-			if(cBit7 && (cChactl & 0x01))
-			{
-				/* CHACTL bit 0: blank characters with name bit 7 set */
-				cData = 0x00;
-				cInverse = cChactl & 0x02 ? 0x80 : 0x00;
-			}
-			else
-			{
-				/* CHACTL bit 1: invert characters with name bit 7 set */
-				cInverse = cBit7 && (cChactl & 0x02) ? 0x80 : 0x00;
-			}
-
-			cMask = 0x80;
-		}
-
-		cOutputData = cData;
-		if(cInverse && cPriorMode != 0)
-		{
-			cOutputData ^= 0xff;
-		}
-
-		if(cPriorMode == 0)
-		{
-			if(cInverse)
-			{
-				cColor0 = (SRAM[IO_COLPF2] & 0xf0) | (SRAM[IO_COLPF1] & 0x0f);
-				cColor1 = SRAM[IO_COLPF2];
-				cPriority0 = PRIO_PF1;
-				cPriority1 = PRIO_PF2;
-			}
-			else
-			{
-				cColor0 = SRAM[IO_COLPF2];
-				cColor1 = (SRAM[IO_COLPF2] & 0xf0) | (SRAM[IO_COLPF1] & 0x0f);
-				cPriority0 = PRIO_PF2;
-				cPriority1 = PRIO_PF1;
-			}
-		}
+		/* PRIOR changed mid-line */
+		AtariIo_DrawHiresSpanGeneric(pContext, &tState, cMode);
+	}
+}
 
-		switch(cPriorMode)
-		{
-		case 0:
-			if(cOutputData & cMask)
-			{
-				*(pIoData->tDrawLineData.pDestination)++ = cColor1;
-				*(pIoData->tDrawLineData.pPriorityData)++ = cPriority1;
-			}
-			else
-			{
-				*(pIoData->tDrawLineData.pDestination)++ = cColor0;
-				*(pIoData->tDrawLineData.pPriorityData)++ = cPriority0;
-			}
-			cMask >>= 1;
+static void AtariIo_DrawLineMode2Prior0(_6502_Context_t *pContext)
+{
+	AtariIo_DrawHiresLine(pContext, 0x02, 0);
+}
 
-			if(cOutputData & cMask)
-			{
-				*(pIoData->tDrawLineData.pDestination)++ = cColor1;
-				*(pIoData->tDrawLineData.pPriorityData)++ = cPriority1;
-			}
-			else
-			{
-				*(pIoData->tDrawLineData.pDestination)++ = cColor0;
-				*(pIoData->tDrawLineData.pPriorityData)++ = cPriority0;
-			}
-			cMask >>= 1;
+static void AtariIo_DrawLineMode2Prior1(_6502_Context_t *pContext)
+{
+	AtariIo_DrawHiresLine(pContext, 0x02, 1);
+}
 
-			if(cOutputData & cMask)
-			{
-				*(pIoData->tDrawLineData.pDestination)++ = cColor1;
-				*(pIoData->tDrawLineData.pPriorityData)++ = cPriority1;
-			}
-			else
-			{
-				*(pIoData->tDrawLineData.pDestination)++ = cColor0;
-				*(pIoData->tDrawLineData.pPriorityData)++ = cPriority0;
-			}
-			cMask >>= 1;
+static void AtariIo_DrawLineMode2Prior2(_6502_Context_t *pContext)
+{
+	AtariIo_DrawHiresLine(pContext, 0x02, 2);
+}
 
-			if(cOutputData & cMask)
-			{
-				*(pIoData->tDrawLineData.pDestination)++ = cColor1;
-				*(pIoData->tDrawLineData.pPriorityData)++ = cPriority1;
-			}
-			else
-			{
-				*(pIoData->tDrawLineData.pDestination)++ = cColor0;
-				*(pIoData->tDrawLineData.pPriorityData)++ = cPriority0;
-			}
-			cMask >>= 1;
-			break;
+static void AtariIo_DrawLineMode2Prior3(_6502_Context_t *pContext)
+{
+	AtariIo_DrawHiresLine(pContext, 0x02, 3);
+}
 
-		case 1:
-			if(cMask > 0x08)
-			{
-				cColor = SRAM[IO_COLBK] | (cOutputData >> 4);
-				*(pIoData->tDrawLineData.pDestination)++ = cColor;
-				*(pIoData->tDrawLineData.pDestination)++ = cColor;
-				*(pIoData->tDrawLineData.pDestination)++ = cColor;
-				*(pIoData->tDrawLineData.pDestination)++ = cColor;
-				*(pIoData->tDrawLineData.pPriorityData)++ = PRIO_BKG;
-				*(pIoData->tDrawLineData.pPriorityData)++ = PRIO_BKG;
-				*(pIoData->tDrawLineData.pPriorityData)++ = PRIO_BKG;
-				*(pIoData->tDrawLineData.pPriorityData)++ = PRIO_BKG;
-			}
-			else
-			{
-				cColor = SRAM[IO_COLBK] | (cOutputData & 0x0f);
-				*(pIoData->tDrawLineData.pDestination)++ = cColor;
-				*(pIoData->tDrawLineData.pDestination)++ = cColor;
-				*(pIoData->tDrawLineData.pDestination)++ = cColor;
-				*(pIoData->tDrawLineData.pDestination)++ = cColor;
-				*(pIoData->tDrawLineData.pPriorityData)++ = PRIO_BKG;
-				*(pIoData->tDrawLineData.pPriorityData)++ = PRIO_BKG;
-				*(pIoData->tDrawLineData.pPriorityData)++ = PRIO_BKG;
-				*(pIoData->tDrawLineData.pPriorityData)++ = PRIO_BKG;
-			}
-			cMask >>= 4;
-			break;
+static void AtariIo_DrawVisibleBlankLine(
+	_6502_Context_t *pContext,
+	u8 *pDestination,
+	u8 *pPriorityData)
+{
+	AtariIo_StepClockActions(pContext, ACTIVE_LINE_COLOR_BURST_CYCLES);
+	AtariIo_DrawBackgroundClipped(
+		pContext,
+		pDestination,
+		pPriorityData,
+		ACTIVE_LINE_COLOR_BURST_CYCLES * 4,
+		CYCLES_PER_LINE - ACTIVE_LINE_COLOR_BURST_CYCLES);
+}
 
-		case 2:
-			{
-				u8 aColorTable[16] =
-					{
-						SRAM[IO_COLPM0_TRIG2],
-						SRAM[IO_COLPM1_TRIG3],
-						SRAM[IO_COLPM2_PAL],
-						SRAM[IO_COLPM3],
-						SRAM[IO_COLPF0],
-						SRAM[IO_COLPF1],
-						SRAM[IO_COLPF2],
-						SRAM[IO_COLPF3],
-						SRAM[IO_COLBK],
-						SRAM[IO_COLBK],
-						SRAM[IO_COLBK],
-						SRAM[IO_COLBK],
-						SRAM[IO_COLPF0],
-						SRAM[IO_COLPF1],
-						SRAM[IO_COLPF2],
-						SRAM[IO_COLPF3],
-					};
-
-				if(cMask > 0x08)
-				{
-					cColor = aColorTable[cOutputData >> 4];
-				}
-				else
-				{
-					cColor = aColorTable[cOutputData & 0x0f];
-				}
+static void AtariIo_DrawLineMode3Prior0(_6502_Context_t *pContext)
+{
+	AtariIo_DrawHiresLine(pContext, 0x03, 0);
+}
 
-				*(pIoData->tDrawLineData.pDestination)++ = cColor;
-				*(pIoData->tDrawLineData.pDestination)++ = cColor;
-				*(pIoData->tDrawLineData.pDestination)++ = cColor;
-				*(pIoData->tDrawLineData.pDestination)++ = cColor;
-				*(pIoData->tDrawLineData.pPriorityData)++ = PRIO_BKG;
-				*(pIoData->tDrawLineData.pPriorityData)++ = PRIO_BKG;
-				*(pIoData->tDrawLineData.pPriorityData)++ = PRIO_BKG;
-				*(pIoData->tDrawLineData.pPriorityData)++ = PRIO_BKG;
-			}
-			cMask >>= 4;
-			break;
+static void AtariIo_DrawLineMode3Prior1(_6502_Context_t *pContext)
+{
+	AtariIo_DrawHiresLine(pContext, 0x03, 1);
+}
 
-		case 3:
-			if(cMask > 0x08)
-			{
-				cColor = (cOutputData & 0xf0) ? (SRAM[IO_COLBK] | (cOutputData & 0xf0)) : (SRAM[IO_COLBK] & 0xf0);
-				*(pIoData->tDrawLineData.pDestination)++ = cColor;
-				*(pIoData->tDrawLineData.pDestination)++ = cColor;
-				*(pIoData->tDrawLineData.pDestination)++ = cColor;
-				*(pIoData->tDrawLineData.pDestination)++ = cColor;
-				*(pIoData->tDrawLineData.pPriorityData)++ = PRIO_BKG;
-				*(pIoData->tDrawLineData.pPriorityData)++ = PRIO_BKG;
-				*(pIoData->tDrawLineData.pPriorityData)++ = PRIO_BKG;
-				*(pIoData->tDrawLineData.pPriorityData)++ = PRIO_BKG;
-			}
-			else
-			{
-				cColor = (cOutputData & 0x0f) ? (SRAM[IO_COLBK] | (cOutputData << 4)) : (SRAM[IO_COLBK] & 0xf0);
-				*(pIoData->tDrawLineData.pDestination)++ = cColor;
-				*(pIoData->tDrawLineData.pDestination)++ = cColor;
-				*(pIoData->tDrawLineData.pDestination)++ = cColor;
-				*(pIoData->tDrawLineData.pDestination)++ = cColor;
-				*(pIoData->tDrawLineData.pPriorityData)++ = PRIO_BKG;
-				*(pIoData->tDrawLineData.pPriorityData)++ = PRIO_BKG;
-				*(pIoData->tDrawLineData.pPriorityData)++ = PRIO_BKG;
-				*(pIoData->tDrawLineData.pPriorityData)++ = PRIO_BKG;
-			}
-			cMask >>= 4;
-			break;
-		}
+static void AtariIo_DrawLineMode3Prior2(_6502_Context_t *pContext)
+{
+	AtariIo_DrawHiresLine(pContext, 0x03, 2);
+}
 
-		AtariIo_DrawClockAction(pContext);
-	}
+static void AtariIo_DrawLineMode3Prior3(_6502_Context_t *pContext)
+{
+	AtariIo_DrawHiresLine(pContext, 0x03, 3);
 }
 
 static void AtariIo_DrawLineMode4(_6502_Context_t *pContext)
@@ -2705,8 +2795,6 @@ static void AtariIo_DrawLineMode8(_6502_Context_t *pContext)
 	IoData_t *pIoData = (IoData_t *)pContext->pIoData;
 	u8 cData = 0x00;
 	u8 cIndex;
-	u8 cColor;
-	u8 cPriority;
 
 	u32 lPlayfieldCycles = pIoData->tDrawLineData.lBytesPerLine * 8;
 	u32 lCycle;
@@ -2722,24 +2810,10 @@ static void AtariIo_DrawLineMode8(_6502_Context_t *pContext)
 		}
 
 		cIndex = (cData >> (6 - ((cPhase >> 1) * 2))) & 0x03;
-		cColor = cIndex == 0 ? SRAM[IO_COLBK] :
-				 cIndex == 1 ? SRAM[IO_COLPF0] :
-				 cIndex == 2 ? SRAM[IO_COLPF1] :
-							  SRAM[IO_COLPF2];
-		cPriority = cIndex == 0 ? PRIO_BKG :
-					 cIndex == 1 ? PRIO_PF0 :
-					 cIndex == 2 ? PRIO_PF1 :
-								  PRIO_PF2;
-
-		*(pIoData->tDrawLineData.pDestination)++ = cColor;
-		*(pIoData->tDrawLineData.pDestination)++ = cColor;
-		*(pIoData->tDrawLineData.pDestination)++ = cColor;
-		*(pIoData->tDrawLineData.pDestination)++ = cColor;
-
-		*(pIoData->tDrawLineData.pPriorityData)++ = cPriority;
-		*(pIoData->tDrawLineData.pPriorityData)++ = cPriority;
-		*(pIoData->tDrawLineData.pPriorityData)++ = cPriority;
-		*(pIoData->tDrawLineData.pPriorityData)++ = cPriority;
+		AtariIo_PutClockPixels(
+			pIoData,
+			PIXELS_SPLAT(SRAM[m_aFourColorRegister[cIndex]]),
+			PIXELS_SPLAT(m_aFourColorPriority[cIndex]));
 
 		cPhase++;
 		AtariIo_DrawClockAction(pContext);
@@ -2750,8 +2824,7 @@ static void AtariIo_DrawLineMode9(_6502_Context_t *pContext)
 {
 	IoData_t *pIoData = (IoData_t *)pContext->pIoData;
 	u8 cData = 0x00;
-	u8 cColor;
-	u8 cPriority;
+	u8 cIndex;
 
 	u32 lPlayfieldCycles = pIoData->tDrawLineData.lBytesPerLine * 8;
 	u32 lCycle;
@@ -2766,26 +2839,11 @@ static void AtariIo_DrawLineMode9(_6502_Context_t *pContext)
 			cMask = 0x80;
 		}
 
-		if(cData & cMask)
-		{
-			cColor = SRAM[IO_COLPF0];
-			cPriority = PRIO_PF0;
-		}
-		else
-		{
-			cColor = SRAM[IO_COLBK];
-			cPriority = PRIO_BKG;
-		}
-
-		*(pIoData->tDrawLineData.pDestination)++ = cColor;
-		*(pIoData->tDrawLineData.pDestination)++ = cColor;
-		*(pIoData->tDrawLineData.pDestination)++ = cColor;
-		*(pIoData->tDrawLineData.pDestination)++ = cColor;
-
-		*(pIoData->tDrawLineData.pPriorityData)++ = cPriority;
-		*(pIoData->tDrawLineData.pPriorityData)++ = cPriority;
-		*(pIoData->tDrawLineData.pPriorityData)++ = cPriority;
-		*(pIoData->tDrawLineData.pPriorityData)++ = cPriority;
+		cIndex = (cData & cMask) ? 1 : 0;
+		AtariIo_PutClockPixels(
+			pIoData,
+			PIXELS_SPLAT(SRAM[m_aFourColorRegister[cIndex]]),
+			PIXELS_SPLAT(m_aFourColorPriority[cIndex]));
 
 		cMask >>= 1;
 		AtariIo_DrawClockAction(pContext);
@@ -2797,8 +2855,6 @@ static void AtariIo_DrawLineModeA(_6502_Context_t *pContext)
 	IoData_t *pIoData = (IoData_t *)pContext->pIoData;
 	u8 cData = 0x00;
 	u8 cIndex;
-	u8 cColor;
-	u8 cPriority;
 
 	u32 lPlayfieldCycles = pIoData->tDrawLineData.lBytesPerLine * 4;
 	u32 lCycle;
@@ -2814,23 +2870,10 @@ static void AtariIo_DrawLineModeA(_6502_Context_t *pContext)
 		}
 
 		cIndex = (cData >> (6 - (cPhase * 2))) & 0x03;
-		cColor = cIndex == 0 ? SRAM[IO_COLBK] :
-				 cIndex == 1 ? SRAM[IO_COLPF0] :
-				 cIndex == 2 ? SRAM[IO_COLPF1] :
-							  SRAM[IO_COLPF2];
-		cPriority = cIndex == 0 ? PRIO_BKG :
-					 cIndex == 1 ? PRIO_PF0 :
-					 cIndex == 2 ? PRIO_PF1 :
-								  PRIO_PF2;
-		*(pIoData->tDrawLineData.pDestination)++ = cColor;
-		*(pIoData->tDrawLineData.pDestination)++ = cColor;
-		*(pIoData->tDrawLineData.pDestination)++ = cColor;
-		*(pIoData->tDrawLineData.pDestination)++ = cColor;
-
-		*(pIoData->tDrawLineData.pPriorityData)++ = cPriority;
-		*(pIoData->tDrawLineData.pPriorityData)++ = cPriority;
-		*(pIoData->tDrawLineData.pPriorityData)++ = cPriority;
-		*(pIoData->tDrawLineData.pPriorityData)++ = cPriority;
+		AtariIo_PutClockPixels(
+			pIoData,
+			PIXELS_SPLAT(SRAM[m_aFourColorRegister[cIndex]]),
+			PIXELS_SPLAT(m_aFourColorPriority[cIndex]));
 
 		cPhase++;
 		AtariIo_DrawClockAction(pContext);
@@ -2841,59 +2884,30 @@ static void AtariIo_DrawLineModeB(_6502_Context_t *pContext)
 {
 	IoData_t *pIoData = (IoData_t *)pContext->pIoData;
 	u8 cData = 0x00;
-	u8 cColor;
-	u8 cPriority;
+	uint32_t lMask;
 
 	u32 lPlayfieldCycles = pIoData->tDrawLineData.lBytesPerLine * 4;
 	u32 lCycle;
-	u8 cMask = 0x00;
+	u8 cPhase = 0x04;
 	u8 cBufferIndex = 0x00;
 
 	for(lCycle = 0; lCycle < lPlayfieldCycles; lCycle++)
 	{
-		if(cMask == 0x00)
+		if(cPhase == 0x04)
 		{
 			cData = AtariIo_FetchBufferedDisplayByte(pContext, cBufferIndex++, 0);
-			cMask = 0x80;
-		}
-
-		if(cData & cMask)
-		{
-			cColor = SRAM[IO_COLPF0];
-			cPriority = PRIO_PF0;
-		}
-		else
-		{
-			cColor = SRAM[IO_COLBK];
-			cPriority = PRIO_BKG;
-		}
-
-		*(pIoData->tDrawLineData.pDestination)++ = cColor;
-		*(pIoData->tDrawLineData.pDestination)++ = cColor;
-
-		*(pIoData->tDrawLineData.pPriorityData)++ = cPriority;
-		*(pIoData->tDrawLineData.pPriorityData)++ = cPriority;
-
-		cMask >>= 1;
-
-		if(cData & cMask)
-		{
-			cColor = SRAM[IO_COLPF0];
-			cPriority = PRIO_PF0;
-		}
-		else
-		{
-			cColor = SRAM[IO_COLBK];
-			cPriority = PRIO_BKG;
+			cPhase = 0x00;
 		}
 
-		*(pIoData->tDrawLineData.pDestination)++ = cColor;
-		*(pIoData->tDrawLineData.pDestination)++ = cColor;
-
-		*(pIoData->tDrawLineData.pPriorityData)++ = cPriority;
-		*(pIoData->tDrawLineData.pPriorityData)++ = cPriority;
+		/* two 2 pixel wide PF0/background pixels per clock */
+		lMask = AtariIo_LoadPixelMask(m_aPairPixelMask[cData >> 6]);
+		AtariIo_PutClockPixels(
+			pIoData,
+			AtariIo_SelectPixels(lMask, SRAM[IO_COLBK], SRAM[IO_COLPF0]),
+			AtariIo_SelectPixels(lMask, PRIO_BKG, PRIO_PF0));
 
-		cMask >>= 1;
+		cData <<= 2;
+		cPhase++;
 		AtariIo_DrawClockAction(pContext);
 	}
 }
@@ -2907,8 +2921,9 @@ static void AtariIo_DrawLineModeD(_6502_Context_t *pContext)
 {
 	IoData_t *pIoData = (IoData_t *)pContext->pIoData;
 	u8 cData = 0x00;
-	u8 cColor;
-	u8 cPriority;
+	u8 cIndex0;
+	u8 cIndex1;
+	uint32_t lMask = AtariIo_LoadPixelMask(m_aPairPixelMask[1]);
 
 	u32 lPlayfieldCycles = pIoData->tDrawLineData.lBytesPerLine * 2;
 	u32 lCycle;
@@ -2923,36 +2938,21 @@ static void AtariIo_DrawLineModeD(_6502_Context_t *pContext)
 			cPhase = 0x00;
 		}
 
-		cColor = ((cData >> 6) & 0x03) == 0 ? SRAM[IO_COLBK] :
-				 ((cData >> 6) & 0x03) == 1 ? SRAM[IO_COLPF0] :
-				 ((cData >> 6) & 0x03) == 2 ? SRAM[IO_COLPF1] :
-											  SRAM[IO_COLPF2];
-		cPriority = ((cData >> 6) & 0x03) == 0 ? PRIO_BKG :
-					 ((cData >> 6) & 0x03) == 1 ? PRIO_PF0 :
-					 ((cData >> 6) & 0x03) == 2 ? PRIO_PF1 :
-												  PRIO_PF2;
-		*(pIoData->tDrawLineData.pDestination)++ = cColor;
-		*(pIoData->tDrawLineData.pDestination)++ = cColor;
-
-		*(pIoData->tDrawLineData.pPriorityData)++ = cPriority;
-		*(pIoData->tDrawLineData.pPriorityData)++ = cPriority;
-
-		cData <<= 2;
-
-		cColor = ((cData >> 6) & 0x03) == 0 ? SRAM[IO_COLBK] :
-				 ((cData >> 6) & 0x03) == 1 ? SRAM[IO_COLPF0] :
-				 ((cData >> 6) & 0x03) == 2 ? SRAM[IO_COLPF1] :
-											  SRAM[IO_COLPF2];
-		cPriority = ((cData >> 6) & 0x03) == 0 ? PRIO_BKG :
-					 ((cData >> 6) & 0x03) == 1 ? PRIO_PF0 :
-					 ((cData >> 6) & 0x03) == 2 ? PRIO_PF1 :
-												  PRIO_PF2;
-		*(pIoData->tDrawLineData.pDestination)++ = cColor;
-		*(pIoData->tDrawLineData.pDestination)++ = cColor;
-		*(pIoData->tDrawLineData.pPriorityData)++ = cPriority;
-		*(pIoData->tDrawLineData.pPriorityData)++ = cPriority;
-
-		cData <<= 2;
+		/* two 2 pixel wide four colour pixels per clock */
+		cIndex0 = (cData >> 6) & 0x03;
+		cIndex1 = (cData >> 4) & 0x03;
+		AtariIo_PutClockPixels(
+			pIoData,
+			AtariIo_SelectPixels(
+				lMask,
+				SRAM[m_aFourColorRegister[cIndex0]],
+				SRAM[m_aFourColorRegister[cIndex1]]),
+			AtariIo_SelectPixels(
+				lMask,
+				m_aFourColorPriority[cIndex0],
+				m_aFourColorPriority[cIndex1]));
+
+		cData <<= 4;
 		cPhase++;
 		AtariIo_DrawClockAction(pContext);
 	}
@@ -2963,181 +2963,24 @@ static void AtariIo_DrawLineModeE(_6502_Context_t *pContext)
 	AtariIo_DrawLineModeD(pContext);
 }
 
-static void AtariIo_DrawLineModeF(_6502_Context_t *pContext)
+static void AtariIo_DrawLineModeFPrior0(_6502_Context_t *pContext)
 {
-	IoData_t *pIoData = (IoData_t *)pContext->pIoData;
-	u8 cData;
-	u8 cColor;
-	u32 lPlayfieldCycles = pIoData->tDrawLineData.lBytesPerLine * 2;
-	u32 lCycle;
-	u8 cMask = 0x00;
-	u8 cBufferIndex = 0x00;
+	AtariIo_DrawHiresLine(pContext, 0x0f, 0);
+}
 
-	for(lCycle = 0; lCycle < lPlayfieldCycles; lCycle++)
-	{
-		u8 cPriorMode = SRAM[IO_PRIOR] >> 6;
+static void AtariIo_DrawLineModeFPrior1(_6502_Context_t *pContext)
+{
+	AtariIo_DrawHiresLine(pContext, 0x0f, 1);
+}
 
-		if(cMask == 0x00)
-		{
-			cData = AtariIo_FetchBufferedDisplayByte(pContext, cBufferIndex++, 0);
-			cMask = 0x80;
-		}
-
-		switch(cPriorMode)
-		{
-		case 0:
-			{
-				u8 cColor0 = SRAM[IO_COLPF2];
-				u8 cColor1 = (SRAM[IO_COLPF2] & 0xf0) | (SRAM[IO_COLPF1] & 0x0f);
-
-				if(cData & cMask)
-				{
-					*(pIoData->tDrawLineData.pDestination)++ = cColor1;
-					*(pIoData->tDrawLineData.pPriorityData)++ = PRIO_PF1;
-				}
-				else
-				{
-					*(pIoData->tDrawLineData.pDestination)++ = cColor0;
-					*(pIoData->tDrawLineData.pPriorityData)++ = PRIO_PF2;
-				}
-
-				cMask >>= 1;
-
-				if(cData & cMask)
-				{
-					*(pIoData->tDrawLineData.pDestination)++ = cColor1;
-					*(pIoData->tDrawLineData.pPriorityData)++ = PRIO_PF1;
-				}
-				else
-				{
-					*(pIoData->tDrawLineData.pDestination)++ = cColor0;
-					*(pIoData->tDrawLineData.pPriorityData)++ = PRIO_PF2;
-				}
-
-				cMask >>= 1;
-
-				if(cData & cMask)
-				{
-					*(pIoData->tDrawLineData.pDestination)++ = cColor1;
-					*(pIoData->tDrawLineData.pPriorityData)++ = PRIO_PF1;
-				}
-				else
-				{
-					*(pIoData->tDrawLineData.pDestination)++ = cColor0;
-					*(pIoData->tDrawLineData.pPriorityData)++ = PRIO_PF2;
-				}
-
-				cMask >>= 1;
-
-				if(cData & cMask)
-				{
-					*(pIoData->tDrawLineData.pDestination)++ = cColor1;
-					*(pIoData->tDrawLineData.pPriorityData)++ = PRIO_PF1;
-				}
-				else
-				{
-					*(pIoData->tDrawLineData.pDestination)++ = cColor0;
-					*(pIoData->tDrawLineData.pPriorityData)++ = PRIO_PF2;
-				}
-
-				cMask >>= 1;
-			}
-			break;
-
-		case 1:
-			if(cMask > 0x08)
-			{
-				cColor = SRAM[IO_COLBK] | (cData >> 4);
-			}
-			else
-			{
-				cColor = SRAM[IO_COLBK] | (cData & 0x0f);
-			}
-
-			*(pIoData->tDrawLineData.pDestination)++ = cColor;
-			*(pIoData->tDrawLineData.pDestination)++ = cColor;
-			*(pIoData->tDrawLineData.pDestination)++ = cColor;
-			*(pIoData->tDrawLineData.pDestination)++ = cColor;
-
-			*(pIoData->tDrawLineData.pPriorityData)++ = PRIO_BKG;
-			*(pIoData->tDrawLineData.pPriorityData)++ = PRIO_BKG;
-			*(pIoData->tDrawLineData.pPriorityData)++ = PRIO_BKG;
-			*(pIoData->tDrawLineData.pPriorityData)++ = PRIO_BKG;
-
-			cMask >>= 4;
-			break;
-
-		case 2:
-			{
-				u8 aColorTable[16] =
-					{
-						SRAM[IO_COLPM0_TRIG2],
-						SRAM[IO_COLPM1_TRIG3],
-						SRAM[IO_COLPM2_PAL],
-						SRAM[IO_COLPM3],
-						SRAM[IO_COLPF0],
-						SRAM[IO_COLPF1],
-						SRAM[IO_COLPF2],
-						SRAM[IO_COLPF3],
-						SRAM[IO_COLBK],
-						SRAM[IO_COLBK],
-						SRAM[IO_COLBK],
-						SRAM[IO_COLBK],
-						SRAM[IO_COLPF0],
-						SRAM[IO_COLPF1],
-						SRAM[IO_COLPF2],
-						SRAM[IO_COLPF3],
-					};
-
-				if(cMask > 0x08)
-				{
-					cColor = aColorTable[cData >> 4];
-				}
-				else
-				{
-					cColor = aColorTable[cData & 0x0f];
-				}
-			}
-
-			*(pIoData->tDrawLineData.pDestination)++ = cColor;
-			*(pIoData->tDrawLineData.pDestination)++ = cColor;
-			*(pIoData->tDrawLineData.pDestination)++ = cColor;
-			*(pIoData->tDrawLineData.pDestination)++ = cColor;
-
-			*(pIoData->tDrawLineData.pPriorityData)++ = PRIO_BKG;
-			*(pIoData->tDrawLineData.pPriorityData)++ = PRIO_BKG;
-			*(pIoData->tDrawLineData.pPriorityData)++ = PRIO_BKG;
-			*(pIoData->tDrawLineData.pPriorityData)++ = PRIO_BKG;
-
-			cMask >>= 4;
-			break;
-
-		case 3:
-			if(cMask > 0x08)
-			{
-				cColor = (cData & 0xf0) ? (SRAM[IO_COLBK] | (cData & 0xf0)) : (SRAM[IO_COLBK] & 0xf0);
-			}
-			else
-			{
-				cColor = (cData & 0x0f) ? (SRAM[IO_COLBK] | (cData << 4)) : (SRAM[IO_COLBK] & 0xf0);
-			}
-
-			*(pIoData->tDrawLineData.pDestination)++ = cColor;
-			*(pIoData->tDrawLineData.pDestination)++ = cColor;
-			*(pIoData->tDrawLineData.pDestination)++ = cColor;
-			*(pIoData->tDrawLineData.pDestination)++ = cColor;
-
-			*(pIoData->tDrawLineData.pPriorityData)++ = PRIO_BKG;
-			*(pIoData->tDrawLineData.pPriorityData)++ = PRIO_BKG;
-			*(pIoData->tDrawLineData.pPriorityData)++ = PRIO_BKG;
-			*(pIoData->tDrawLineData.pPriorityData)++ = PRIO_BKG;
-
-			cMask >>= 4;
-			break;
-		}
+static void AtariIo_DrawLineModeFPrior2(_6502_Context_t *pContext)
+{
+	AtariIo_DrawHiresLine(pContext, 0x0f, 2);
+}
 
-		AtariIo_DrawClockAction(pContext);
-	}
+static void AtariIo_DrawLineModeFPrior3(_6502_Context_t *pContext)
+{
+	AtariIo_DrawHiresLine(pContext, 0x0f, 3);
 }
 
 void AtariIoFetchLine(_6502_Context_t *pContext)
@@ -3244,16 +3087,19 @@ void AtariIoFetchLine(_6502_Context_t *pContext)
 				if((pIoData->cCurrentDisplayListCommand & 0x4f) == 0x41)
 				{
 					/* JVB mode line height is one scanline while replayed. */
-					pIoData->llDliCycle = pIoData->llCycle + DLI_HORIZONTAL_OFFSET;
-					AtariIoCycleTimedEventUpdate(pContext);
+					AtariIoScheduleTimedEvent(
+						pContext,
+						TIMED_EVENT_DLI,
+						pIoData->llCycle + DLI_HORIZONTAL_OFFSET);
 				}
 				else if(!pIoData->bModeLineScrollExit)
 				{
-					pIoData->llDliCycle =
+					AtariIoScheduleTimedEvent(
+						pContext,
+						TIMED_EVENT_DLI,
 						pIoData->llCycle +
-						(pIoData->lNextDisplayListLine - pIoData->tVideoData.lCurrentDisplayLine - 1) * CYCLES_PER_LINE +
-						DLI_HORIZONTAL_OFFSET;
-					AtariIoCycleTimedEventUpdate(pContext);
+							(pIoData->lNextDisplayListLine - pIoData->tVideoData.lCurrentDisplayLine - 1) * CYCLES_PER_LINE +
+							DLI_HORIZONTAL_OFFSET);
 				}
 			}
 
@@ -3338,8 +3184,13 @@ void AtariIoDrawLine(_6502_Context_t *pContext)
 	u64 llLineStartCycle = pIoData->llDisplayListFetchCycle;
 	if(pIoData->llCycle < llLineStartCycle) pIoData->llCycle = llLineStartCycle;
 
-	if(pIoData->tVideoData.lCurrentDisplayLine < FIRST_VISIBLE_LINE ||
-	   pIoData->tVideoData.lCurrentDisplayLine > LAST_VISIBLE_LINE)
+	if(pIoData->tVideoData.lCurrentDisplayLine > LAST_VISIBLE_LINE)
+	{
+		AtariIo_DrawBlankingLine(pContext);
+		return;
+	}
+
+	if(pIoData->tVideoData.lCurrentDisplayLine < FIRST_VISIBLE_LINE)
 	{
 		u32 i;
 		for(i = 0; i < 114; i++)
@@ -3357,39 +3208,27 @@ void AtariIoDrawLine(_6502_Context_t *pContext)
 		}
 		else
 		{
-			ActiveLineGeometry_t tGeometry;
-			ActiveLineGeometry_t tVisibleGeometry;
-			u8 bClipScrolledNonWide = 0;
+			const AnticLineTemplate_t *pTemplate = AtariIo_LookupLineTemplate(
+				pIoData->cCurrentDisplayListCommand,
+				SRAM[IO_DMACTL],
+				SRAM[IO_HSCROL]);
+			const ActiveLineGeometry_t *pGeometry = &pTemplate->tGeometry;
 			u8 cMode = pIoData->cCurrentDisplayListCommand & 0x0f;
 			u32 lLineBaseOffset =
 				pIoData->tVideoData.lCurrentDisplayLine * PIXELS_PER_LINE;
 			u8 cBaseColor;
 			u32 i;
 
-			if(!AtariIo_ComputeActiveLineGeometry(
-				pIoData->cCurrentDisplayListCommand,
-				SRAM[IO_DMACTL] & 0x03,
-				SRAM[IO_HSCROL] & 0x0f,
-				m_aAnticModeInfoTable[cMode].lPixelsPerByte,
-				&tGeometry))
+			if(!pTemplate->bActive)
 			{
 				AtariIo_DrawVisibleBlankLine(pContext, pLineDestination, pLinePriorityData);
 				return;
 			}
 
-			if((pIoData->cCurrentDisplayListCommand & 0x10) &&
-			   ((SRAM[IO_DMACTL] & 0x03) != 0x03))
-			{
-				if(AtariIo_ComputeActiveLineGeometry(
-					   pIoData->cCurrentDisplayListCommand & 0xef,
-					   SRAM[IO_DMACTL] & 0x03,
-					   0,
-					   m_aAnticModeInfoTable[cMode].lPixelsPerByte,
-					   &tVisibleGeometry))
-				{
-					bClipScrolledNonWide = 1;
-				}
-			}
+			memcpy(
+				pIoData->tDrawLineData.aPlayfieldDmaTemplate,
+				pIoData->bFirstRowScanline ? pTemplate->aFirstRowDma : pTemplate->aRepeatRowDma,
+				sizeof(pIoData->tDrawLineData.aPlayfieldDmaTemplate));
 
 			cBaseColor = AtariIo_GetCurrentBackgroundColor(pContext);
 			for(i = 0; i < PIXELS_PER_LINE; i++)
@@ -3401,33 +3240,33 @@ void AtariIoDrawLine(_6502_Context_t *pContext)
 			pIoData->tDrawLineData.pDestination =
 				(u8 *)pIoData->tVideoData.pSdlAtariSurface->pixels +
 				lLineBaseOffset +
-				tGeometry.lPlayfieldStartX;
+				pGeometry->lPlayfieldStartX;
 
 			pIoData->tDrawLineData.pPriorityData =
 				pIoData->tVideoData.pPriorityData +
 				lLineBaseOffset +
-				tGeometry.lPlayfieldStartX;
-			pIoData->tDrawLineData.lBytesPerLine = tGeometry.lBytesPerLine;
+				pGeometry->lPlayfieldStartX;
+			pIoData->tDrawLineData.lBytesPerLine = pGeometry->lBytesPerLine;
 
 			AtariIo_StepClockActions(pContext, ACTIVE_LINE_COLOR_BURST_CYCLES);
 			AtariIo_DrawBackgroundClipped(
 				pContext,
 				pLineDestination,
 				pLinePriorityData,
-				tGeometry.lLeftBorderStartX,
-				tGeometry.lLeftBorderCycles);
+				pGeometry->lLeftBorderStartX,
+				pGeometry->lLeftBorderCycles);
 
 			pIoData->tDrawLineData.sDisplayMemoryAddress = pIoData->sRowDisplayMemoryAddress;
 
-			m_aAnticModeInfoTable[cMode].DrawFunction(pContext);
+			m_aAnticModeInfoTable[cMode].DrawFunction[SRAM[IO_PRIOR] >> 6](pContext);
 
-			if(bClipScrolledNonWide)
+			if(pTemplate->bClipScrolledNonWide)
 			{
-				u32 lFetchStartX = tGeometry.lPlayfieldStartX;
-				u32 lFetchEndX = lFetchStartX + tGeometry.lPlayfieldPixelWidth;
-				u32 lVisibleStartX = tVisibleGeometry.lPlayfieldStartX;
+				u32 lFetchStartX = pGeometry->lPlayfieldStartX;
+				u32 lFetchEndX = lFetchStartX + pGeometry->lPlayfieldPixelWidth;
+				u32 lVisibleStartX = pTemplate->tVisibleGeometry.lPlayfieldStartX;
 				u32 lVisibleEndX =
-					lVisibleStartX + tVisibleGeometry.lPlayfieldPixelWidth;
+					lVisibleStartX + pTemplate->tVisibleGeometry.lPlayfieldPixelWidth;
 				u32 lLeftClipEnd = MIN(lFetchEndX, lVisibleStartX);
 				u32 lRightClipStart = MAX(lFetchStartX, lVisibleEndX);
 
@@ -3459,7 +3298,7 @@ void AtariIoDrawLine(_6502_Context_t *pContext)
 					pContext,
 					pLineDestination,
 					pLinePriorityData,
-					tGeometry.lPlayfieldStartX + tGeometry.lPlayfieldPixelWidth,
+					pGeometry->lPlayfieldStartX + pGeometry->lPlayfieldPixelWidth,
 					(u32)((llLineStartCycle + 114) - pIoData->llCycle));
 			}
 		}
@@ -4184,15 +4023,14 @@ static void AtariIo_DrawPlayerMissilesClock(_6502_Context_t *pContext)
 	u8 cPrior;
 	u8 cData;
 	u8 cHpos;
-	u8 cCollision;
 	u8 cSpecial;
 	u8 cLeadingSpan;
 	u8 *pPlayerShift;
 	u8 *pPlayerState;
 	u8 *pMissileShift;
 	u8 *pMissileState;
-	u8 aPlayerCollision[4] = {0, 0, 0, 0};
-	u8 aMissileCollision[4] = {0, 0, 0, 0};
+	u8 *pPlayerCollision;
+	u8 *pMissileCollision;
 
 	if(lDisplayLine >= 248 || pIoData->llCycle < llLineStartCycle)
 	{
@@ -4225,6 +4063,8 @@ static void AtariIo_DrawPlayerMissilesClock(_6502_Context_t *pContext)
 	pPlayerState = pIoData->tDrawLineData.aPlayerPmgState;
 	pMissileShift = pIoData->tDrawLineData.aMissilePmgShift;
 	pMissileState = pIoData->tDrawLineData.aMissilePmgState;
+	pPlayerCollision = pIoData->aPlayerCollision;
+	pMissileCollision = pIoData->aMissileCollision;
 
 	// Keep the order of the players being drawn!
 
@@ -4310,7 +4150,7 @@ static void AtariIo_DrawPlayerMissilesClock(_6502_Context_t *pContext)
 		}
 		if(pPlayerShift[3] & 0x80)
 		{
-			aPlayerCollision[3] |= AtariIo_DrawPlayerClockCell(
+			pPlayerCollision[3] |= AtariIo_DrawPlayerClockCell(
 				SRAM[IO_COLPM3],
 				AtariIo_PlayerPriorityMask(cPrior, 3),
 				PRIO_PM3,
@@ -4330,7 +4170,7 @@ static void AtariIo_DrawPlayerMissilesClock(_6502_Context_t *pContext)
 		}
 		if(pPlayerShift[2] & 0x80)
 		{
-			aPlayerCollision[2] |= AtariIo_DrawPlayerClockCell(
+			pPlayerCollision[2] |= AtariIo_DrawPlayerClockCell(
 				SRAM[IO_COLPM2_PAL],
 				AtariIo_PlayerPriorityMask(cPrior, 2),
 				PRIO_PM2,
@@ -4350,7 +4190,7 @@ static void AtariIo_DrawPlayerMissilesClock(_6502_Context_t *pContext)
 		}
 		if(pPlayerShift[1] & 0x80)
 		{
-			aPlayerCollision[1] |= AtariIo_DrawPlayerClockCell(
+			pPlayerCollision[1] |= AtariIo_DrawPlayerClockCell(
 				SRAM[IO_COLPM1_TRIG3],
 				AtariIo_PlayerPriorityMask(cPrior, 1),
 				PRIO_PM1,
@@ -4370,7 +4210,7 @@ static void AtariIo_DrawPlayerMissilesClock(_6502_Context_t *pContext)
 		}
 		if(pPlayerShift[0] & 0x80)
 		{
-			aPlayerCollision[0] |= AtariIo_DrawPlayerClockCell(
+			pPlayerCollision[0] |= AtariIo_DrawPlayerClockCell(
 				SRAM[IO_COLPM0_TRIG2],
 				AtariIo_PlayerPriorityMask(cPrior, 0),
 				PRIO_PM0,
@@ -4390,7 +4230,7 @@ static void AtariIo_DrawPlayerMissilesClock(_6502_Context_t *pContext)
 		}
 		if(pMissileShift[3] & 0x02)
 		{
-			aMissileCollision[3] |= AtariIo_DrawMissileClockCell(
+			pMissileCollision[3] |= AtariIo_DrawMissileClockCell(
 				cPrior & 0x10 ? SRAM[IO_COLPF3] : SRAM[IO_COLPM3],
 				AtariIo_MissilePriorityMask(cPrior, 3),
 				pLinePriorityData,
@@ -4408,7 +4248,7 @@ static void AtariIo_DrawPlayerMissilesClock(_6502_Context_t *pContext)
 		}
 		if(pMissileShift[2] & 0x02)
 		{
-			aMissileCollision[2] |= AtariIo_DrawMissileClockCell(
+			pMissileCollision[2] |= AtariIo_DrawMissileClockCell(
 				cPrior & 0x10 ? SRAM[IO_COLPF3] : SRAM[IO_COLPM2_PAL],
 				AtariIo_MissilePriorityMask(cPrior, 2),
 				pLinePriorityData,
@@ -4426,7 +4266,7 @@ static void AtariIo_DrawPlayerMissilesClock(_6502_Context_t *pContext)
 		}
 		if(pMissileShift[1] & 0x02)
 		{
-			aMissileCollision[1] |= AtariIo_DrawMissileClockCell(
+			pMissileCollision[1] |= AtariIo_DrawMissileClockCell(
 				cPrior & 0x10 ? SRAM[IO_COLPF3] : SRAM[IO_COLPM1_TRIG3],
 				AtariIo_MissilePriorityMask(cPrior, 1),
 				pLinePriorityData,
@@ -4444,7 +4284,7 @@ static void AtariIo_DrawPlayerMissilesClock(_6502_Context_t *pContext)
 		}
 		if(pMissileShift[0] & 0x02)
 		{
-			aMissileCollision[0] |= AtariIo_DrawMissileClockCell(
+			pMissileCollision[0] |= AtariIo_DrawMissileClockCell(
 				cPrior & 0x10 ? SRAM[IO_COLPF3] : SRAM[IO_COLPM0_TRIG2],
 				AtariIo_MissilePriorityMask(cPrior, 0),
 				pLinePriorityData,
@@ -4454,14 +4294,22 @@ static void AtariIo_DrawPlayerMissilesClock(_6502_Context_t *pContext)
 		}
 		AtariIo_AdvanceMissileShift(&pMissileShift[0], &pMissileState[0], 0, SRAM[IO_SIZEM_P0PL]);
 	}
+}
+
+/* Folds the collision bits gathered by AtariIo_DrawPlayerMissilesClock into
+ * the GTIA collision read registers.  Called on demand when one of M0PF..P3PL
+ * is read, so the per-clock path only ORs the cell priorities.
+ */
+void AtariIoUpdateCollisions(_6502_Context_t *pContext)
+{
+	IoData_t *pIoData = (IoData_t *)pContext->pIoData;
+	u8 cCollision;
 
-	cCollision = aPlayerCollision[3];
 #ifndef DISABLE_COLLISIONS
+	cCollision = pIoData->aPlayerCollision[3];
 	RAM[IO_HPOSM3_P3PF] |= cCollision & 0x0f;
-#endif
 
-	cCollision = aPlayerCollision[2];
-#ifndef DISABLE_COLLISIONS
+	cCollision = pIoData->aPlayerCollision[2];
 	RAM[IO_HPOSM2_P2PF] |= cCollision & 0x0f;
 
 	if(cCollision & PRIO_PM3)
@@ -4470,10 +4318,8 @@ static void AtariIo_DrawPlayerMissilesClock(_6502_Context_t *pContext)
 	}
 
 	RAM[IO_GRAFP1_P2PL] |= (cCollision >> 4) & ~0x04;
-#endif
 
-	cCollision = aPlayerCollision[1];
-#ifndef DISABLE_COLLISIONS
+	cCollision = pIoData->aPlayerCollision[1];
 	RAM[IO_HPOSM1_P1PF] |= cCollision & 0x0f;
 
 	if(cCollision & PRIO_PM3)
@@ -4487,10 +4333,8 @@ static void AtariIo_DrawPlayerMissilesClock(_6502_Context_t *pContext)
 	}
 
 	RAM[IO_GRAFP0_P1PL] |= (cCollision >> 4) & ~0x02;
-#endif
 
-	cCollision = aPlayerCollision[0];
-#ifndef DISABLE_COLLISIONS
+	cCollision = pIoData->aPlayerCollision[0];
 	RAM[IO_HPOSM0_P0PF] |= cCollision & 0x0f;
 
 	if(cCollision & PRIO_PM3)
@@ -4509,31 +4353,26 @@ static void AtariIo_DrawPlayerMissilesClock(_6502_Context_t *pContext)
 	}
 
 	RAM[IO_SIZEM_P0PL] |= (cCollision >> 4) & ~0x01;
-#endif
 
-	cCollision = aMissileCollision[3];
-#ifndef DISABLE_COLLISIONS
+	cCollision = pIoData->aMissileCollision[3];
 	RAM[IO_HPOSP3_M3PF] |= cCollision & 0x0f;
 	RAM[IO_SIZEP3_M3PL] |= cCollision >> 4;
-#endif
 
-	cCollision = aMissileCollision[2];
-#ifndef DISABLE_COLLISIONS
+	cCollision = pIoData->aMissileCollision[2];
 	RAM[IO_HPOSP2_M2PF] |= cCollision & 0x0f;
 	RAM[IO_SIZEP2_M2PL] |= cCollision >> 4;
-#endif
 
-	cCollision = aMissileCollision[1];
-#ifndef DISABLE_COLLISIONS
+	cCollision = pIoData->aMissileCollision[1];
 	RAM[IO_HPOSP1_M1PF] |= cCollision & 0x0f;
 	RAM[IO_SIZEP1_M1PL] |= cCollision >> 4;
-#endif
 
-	cCollision = aMissileCollision[0];
-#ifndef DISABLE_COLLISIONS
+	cCollision = pIoData->aMissileCollision[0];
 	RAM[IO_HPOSP0_M0PF] |= cCollision & 0x0f;
 	RAM[IO_SIZEP0_M0PL] |= cCollision >> 4;
 #endif
+
+	memset(pIoData->aPlayerCollision, 0, sizeof(pIoData->aPlayerCollision));
+	memset(pIoData->aMissileCollision, 0, sizeof(pIoData->aMissileCollision));
 }
 
 void AtariIoDrawPlayerMissiles(_6502_Context_t *pContext)
@@ -5178,276 +5017,1327 @@ void AtariIoDrawScreen(
 	}
 }
 
-void AtariIoCycleTimedEventUpdate(_6502_Context_t *pContext)
+static u64 AtariIo_TimedEventCycle(const IoData_t *pIoData, u8 cEvent)
 {
-	IoData_t *pIoData = (IoData_t *)pContext->pIoData;
-
-	pContext->llIoCycleTimedEventCycle = CYCLE_NEVER;
-	pContext->llIoMasterTimedEventCycle = CYCLE_NEVER;
-	pContext->llIoBeamTimedEventCycle = CYCLE_NEVER;
-
-	if(!pIoData->bInDrawLine)
-	{
-		pContext->llIoMasterTimedEventCycle =
-			MIN(pIoData->llDisplayListFetchCycle, pContext->llIoMasterTimedEventCycle);
-	}
-
-	pContext->llIoBeamTimedEventCycle =
-		MIN(pIoData->llDliCycle, pContext->llIoBeamTimedEventCycle);
-
-	pContext->llIoBeamTimedEventCycle =
-		MIN(pIoData->llVbiCycle, pContext->llIoBeamTimedEventCycle);
-
-	pContext->llIoMasterTimedEventCycle =
-		MIN(pIoData->llSerialOutputTransmissionDoneCycle, pContext->llIoMasterTimedEventCycle);
-
-	pContext->llIoMasterTimedEventCycle =
-		MIN(pIoData->llSerialOutputNeedDataCycle, pContext->llIoMasterTimedEventCycle);
-
-	pContext->llIoMasterTimedEventCycle =
-		MIN(pIoData->llSerialInputDataReadyCycle, pContext->llIoMasterTimedEventCycle);
+	return *pIoData->aTimedEvents[cEvent].pCycle;
+}
 
-	pContext->llIoMasterTimedEventCycle =
-		MIN(pIoData->llTimer1Cycle, pContext->llIoMasterTimedEventCycle);
+static int AtariIo_TimedEventBefore(const IoData_t *pIoData, u8 cEvent, u8 cOther)
+{
+	u64 llCycle = AtariIo_TimedEventCycle(pIoData, cEvent);
+	u64 llOtherCycle = AtariIo_TimedEventCycle(pIoData, cOther);
 
-	pContext->llIoMasterTimedEventCycle =
-		MIN(pIoData->llTimer2Cycle, pContext->llIoMasterTimedEventCycle);
+	return llCycle < llOtherCycle || (llCycle == llOtherCycle && cEvent < cOther);
+}
 
-	pContext->llIoMasterTimedEventCycle =
-		MIN(pIoData->llTimer4Cycle, pContext->llIoMasterTimedEventCycle);
+static TimedEventHeap_t *AtariIo_TimedEventHeap(IoData_t *pIoData, u8 cEvent)
+{
+	return pIoData->aTimedEvents[cEvent].bBeamClock ?
+			   &pIoData->tBeamEventHeap :
+			   &pIoData->tMasterEventHeap;
+}
 
-	pContext->llIoCycleTimedEventCycle = pContext->llIoMasterTimedEventCycle;
+static void AtariIo_TimedEventHeapPlace(IoData_t *pIoData, TimedEventHeap_t *pHeap, u8 cSlot, u8 cEvent)
+{
+	pHeap->aEvents[cSlot] = cEvent;
+	pIoData->aTimedEvents[cEvent].cHeapSlot = cSlot;
 }
 
-static void AtariIo_CycleTimedEvent(_6502_Context_t *pContext)
+static void AtariIo_TimedEventHeapSift(IoData_t *pIoData, TimedEventHeap_t *pHeap, u8 cSlot)
 {
-	IoData_t *pIoData = (IoData_t *)pContext->pIoData;
-	u64 llMasterCycle = pContext->llCycleCounter;
-	u64 llBeamCycle = pIoData->llCycle;
+	u8 cEvent = pHeap->aEvents[cSlot];
 
-	if(!pIoData->bInDrawLine &&
-	   pContext->llCycleCounter >= pIoData->llDisplayListFetchCycle)
+	while(cSlot > 0)
 	{
-		if(pIoData->tVideoData.lCurrentDisplayLine == 0)
+		u8 cParentSlot = (u8)((cSlot - 1) >> 1);
+
+		if(!AtariIo_TimedEventBefore(pIoData, cEvent, pHeap->aEvents[cParentSlot]))
 		{
-			pIoData->llCycle = pIoData->llDisplayListFetchCycle;
+			break;
 		}
 
-		pIoData->tDrawLineData.cPlayfieldDmaStealCount = 0;
-		pIoData->tDrawLineData.cRefreshDmaPending = 0;
-		pIoData->tDrawLineData.cDisplayListInstructionDmaPending = 0;
-		pIoData->tDrawLineData.cDisplayListAddressDmaRemaining = 0;
-		AtariIo_ResetPmgClockState(&pIoData->tDrawLineData);
-		memset(pIoData->tDrawLineData.aScheduledPlayfieldDma, 0, sizeof(pIoData->tDrawLineData.aScheduledPlayfieldDma));
-		AtariIoResetNmiEnableTiming(pContext);
-
-		AtariIoFetchLine(pContext);
-
-		pIoData->bInDrawLine = 1;
-		AtariIoCycleTimedEventUpdate(pContext);
-
-		AtariIoDrawLine(pContext);
-		AtariIoEvaluateModeLineEnd(pContext);
-		pIoData->llDisplayListFetchCycle += CYCLES_PER_LINE;
-		AtariIoAdvanceScanline(pContext);
-		pIoData->bInDrawLine = 0;
+		AtariIo_TimedEventHeapPlace(pIoData, pHeap, cSlot, pHeap->aEvents[cParentSlot]);
+		cSlot = cParentSlot;
 	}
 
-	if(llBeamCycle >= pIoData->llDliCycle)
+	for(;;)
 	{
-#ifdef VERBOSE_DL
-		printf("             [%16llu]", pContext->llCycleCounter);
-		printf(" DL: %3lu DLI\n", pIoData->tVideoData.lCurrentDisplayLine);
-#endif
-		/* NMIST is set at cycle 7 unconditionally (AHRM 4.8). */
-		/* DLI/VBI status bits are mutually exclusive. */
-		RAM[IO_NMIRES_NMIST] &= ~NMI_VBI;
-		RAM[IO_NMIRES_NMIST] |= NMI_DLI;
+		u8 cChildSlot = (u8)(cSlot * 2 + 1);
 
-		if(llBeamCycle > pIoData->llDliCycle)
+		if(cChildSlot >= pHeap->cCount)
 		{
-			/* NMI fires at cycle 8 (one cycle after NMIST at cycle 7). */
-			NmiSourceTiming_t tDliTiming =
-				AtariIoCurrentLineNmiSourceState(pIoData, NMI_DLI);
-			if(tDliTiming.cEnabled)
-			{
-				if(tDliTiming.cDelayOneCycle && llBeamCycle == pIoData->llDliCycle + 1)
-				{
-					pIoData->cNmienEnabledOnCycle7Mask &= (u8)~NMI_DLI;
-					pIoData->llDliCycle = llBeamCycle; /* reschedule: NMI fires at llBeamCycle+1 */
-				}
-				else
-				{
-					_6502_Nmi(pContext);
-					pIoData->llDliCycle = CYCLE_NEVER;
-				}
-			}
-			else
-			{
-				pIoData->llDliCycle = CYCLE_NEVER;
-			}
+			break;
 		}
-	}
-
-	if(llBeamCycle >= pIoData->llVbiCycle)
-	{
-#ifdef VERBOSE_DL
-		printf("             [%16llu]", pContext->llCycleCounter);
-		printf(" DL: %3lu VBI\n", pIoData->tVideoData.lCurrentDisplayLine);
-#endif
-		/* NMIST is set at cycle 7 unconditionally (AHRM 4.8). */
-		/* DLI/VBI status bits are mutually exclusive. */
-		RAM[IO_NMIRES_NMIST] &= ~NMI_DLI;
-		RAM[IO_NMIRES_NMIST] |= NMI_VBI;
 
-		if(llBeamCycle > pIoData->llVbiCycle)
+		if(cChildSlot + 1 < pHeap->cCount &&
+		   AtariIo_TimedEventBefore(pIoData, pHeap->aEvents[cChildSlot + 1], pHeap->aEvents[cChildSlot]))
 		{
-			/* NMI fires at cycle 8 (one cycle after NMIST at cycle 7). */
-			NmiSourceTiming_t tVbiTiming =
-				AtariIoCurrentLineNmiSourceState(pIoData, NMI_VBI);
-			if(tVbiTiming.cEnabled)
-			{
-				if(tVbiTiming.cDelayOneCycle && llBeamCycle == pIoData->llVbiCycle + 1)
-				{
-					pIoData->cNmienEnabledOnCycle7Mask &= (u8)~NMI_VBI;
-					pIoData->llVbiCycle = llBeamCycle; /* reschedule: NMI fires at llBeamCycle+1 */
-				}
-				else
-				{
-					_6502_Nmi(pContext);
-					pIoData->llVbiCycle = CYCLE_NEVER;
-				}
-			}
-			else
-			{
-				pIoData->llVbiCycle = CYCLE_NEVER;
-			}
+			cChildSlot++;
 		}
-	}
 
-	if(llMasterCycle >= pIoData->llSerialOutputTransmissionDoneCycle)
-	{
-#ifdef VERBOSE_SIO
-		printf("             [%16llu] SERIAL_OUTPUT_TRANSMISSION_DONE request!\n", pContext->llCycleCounter);
-#endif
-		RAM[IO_IRQEN_IRQST] &= ~IRQ_SERIAL_OUTPUT_TRANSMISSION_DONE;
-		if(SRAM[IO_IRQEN_IRQST] & IRQ_SERIAL_OUTPUT_TRANSMISSION_DONE)
+		if(!AtariIo_TimedEventBefore(pIoData, pHeap->aEvents[cChildSlot], cEvent))
 		{
-			_6502_Irq(pContext);
+			break;
 		}
 
-		pIoData->llSerialOutputTransmissionDoneCycle = CYCLE_NEVER;
+		AtariIo_TimedEventHeapPlace(pIoData, pHeap, cSlot, pHeap->aEvents[cChildSlot]);
+		cSlot = cChildSlot;
 	}
 
-	if(llMasterCycle >= pIoData->llSerialOutputNeedDataCycle)
-	{
-#ifdef VERBOSE_SIO
-		printf("             [%16llu] SERIAL_OUTPUT_DATA_NEEDED request!\n", pContext->llCycleCounter);
-#endif
-		RAM[IO_IRQEN_IRQST] &= ~IRQ_SERIAL_OUTPUT_DATA_NEEDED;
-		if(SRAM[IO_IRQEN_IRQST] & IRQ_SERIAL_OUTPUT_DATA_NEEDED)
-		{
-			_6502_Irq(pContext);
-		}
+	AtariIo_TimedEventHeapPlace(pIoData, pHeap, cSlot, cEvent);
+}
+
+static void AtariIo_TimedEventHeapRemove(IoData_t *pIoData, u8 cEvent)
+{
+	TimedEventHeap_t *pHeap = AtariIo_TimedEventHeap(pIoData, cEvent);
+	u8 cSlot = pIoData->aTimedEvents[cEvent].cHeapSlot;
 
-		pIoData->llSerialOutputNeedDataCycle = CYCLE_NEVER;
+	if(cSlot == TIMED_EVENT_NOT_QUEUED)
+	{
+		return;
 	}
 
-	if(llMasterCycle >= pIoData->llSerialInputDataReadyCycle)
+	pIoData->aTimedEvents[cEvent].cHeapSlot = TIMED_EVENT_NOT_QUEUED;
+	pHeap->cCount--;
+
+	if(cSlot < pHeap->cCount)
 	{
-#ifdef VERBOSE_SIO
-		printf("             [%16llu] SERIAL_INPUT_DATA_READY request!\n", pContext->llCycleCounter);
-#endif
-		RAM[IO_IRQEN_IRQST] &= ~IRQ_SERIAL_INPUT_DATA_READY;
-		if(SRAM[IO_IRQEN_IRQST] & IRQ_SERIAL_INPUT_DATA_READY)
-		{
-			_6502_Irq(pContext);
-		}
+		AtariIo_TimedEventHeapPlace(pIoData, pHeap, cSlot, pHeap->aEvents[pHeap->cCount]);
+		AtariIo_TimedEventHeapSift(pIoData, pHeap, cSlot);
+	}
+}
+
+static void AtariIo_TimedEventHeapQueue(IoData_t *pIoData, u8 cEvent)
+{
+	TimedEventHeap_t *pHeap = AtariIo_TimedEventHeap(pIoData, cEvent);
+	u8 cSlot = pIoData->aTimedEvents[cEvent].cHeapSlot;
 
-		pIoData->llSerialInputDataReadyCycle = CYCLE_NEVER;
+	if(AtariIo_TimedEventCycle(pIoData, cEvent) == CYCLE_NEVER)
+	{
+		AtariIo_TimedEventHeapRemove(pIoData, cEvent);
+		return;
 	}
 
-	if(llMasterCycle >= pIoData->llTimer1Cycle)
+	if(cSlot == TIMED_EVENT_NOT_QUEUED)
 	{
-		u64 period = Pokey_TimerPeriodCpuCycles(pContext, 1);
-#ifdef VERBOSE_SIO
-		printf("             [%16llu] TIMER_1 request!\n", pContext->llCycleCounter);
-#endif
-		RAM[IO_IRQEN_IRQST] &= ~IRQ_TIMER_1;
-		if(SRAM[IO_IRQEN_IRQST] & IRQ_TIMER_1)
-		{
-			_6502_Irq(pContext);
-		}
+		cSlot = pHeap->cCount++;
+		AtariIo_TimedEventHeapPlace(pIoData, pHeap, cSlot, cEvent);
+	}
 
-		if(period == 0)
-		{
-			pIoData->llTimer1Cycle = CYCLE_NEVER;
-		}
-		else
-		{
-			while(pIoData->llTimer1Cycle <= llMasterCycle)
-			{
-				pIoData->llTimer1Cycle += period;
-			}
-		}
+	AtariIo_TimedEventHeapSift(pIoData, pHeap, cSlot);
+}
+
+static void AtariIo_UpdateTimedEventCycles(_6502_Context_t *pContext)
+{
+	IoData_t *pIoData = (IoData_t *)pContext->pIoData;
+
+	pContext->llIoMasterTimedEventCycle =
+		pIoData->tMasterEventHeap.cCount ?
+			AtariIo_TimedEventCycle(pIoData, pIoData->tMasterEventHeap.aEvents[0]) :
+			CYCLE_NEVER;
+
+	pContext->llIoBeamTimedEventCycle =
+		pIoData->tBeamEventHeap.cCount ?
+			AtariIo_TimedEventCycle(pIoData, pIoData->tBeamEventHeap.aEvents[0]) :
+			CYCLE_NEVER;
+
+	pContext->llIoCycleTimedEventCycle = pContext->llIoMasterTimedEventCycle;
+}
+
+/* Returns the events of a heap due at llClockCycle as a bit mask; only
+ * subtrees whose root is due are visited.
+ */
+static u32 AtariIo_DueTimedEvents(const IoData_t *pIoData, const TimedEventHeap_t *pHeap, u64 llClockCycle)
+{
+	u8 aStack[TIMED_EVENT_COUNT];
+	u32 lDepth = 0;
+	u32 lDue = 0;
+
+	if(pHeap->cCount && AtariIo_TimedEventCycle(pIoData, pHeap->aEvents[0]) <= llClockCycle)
+	{
+		aStack[lDepth++] = 0;
 	}
 
-	if(llMasterCycle >= pIoData->llTimer2Cycle)
+	while(lDepth)
 	{
-		u64 period = Pokey_TimerPeriodCpuCycles(pContext, 2);
-#ifdef VERBOSE_SIO
-		printf("             [%16llu] TIMER_2 request!\n", pContext->llCycleCounter);
-#endif
-		RAM[IO_IRQEN_IRQST] &= ~IRQ_TIMER_2;
-		if(SRAM[IO_IRQEN_IRQST] & IRQ_TIMER_2)
-		{
-			_6502_Irq(pContext);
-		}
+		u8 cSlot = aStack[--lDepth];
+		u32 lChildSlot;
 
-		if(period == 0)
-		{
-			pIoData->llTimer2Cycle = CYCLE_NEVER;
-		}
-		else
+		lDue |= 1u << pHeap->aEvents[cSlot];
+
+		for(lChildSlot = cSlot * 2u + 1; lChildSlot <= cSlot * 2u + 2 && lChildSlot < pHeap->cCount; lChildSlot++)
 		{
-			while(pIoData->llTimer2Cycle <= llMasterCycle)
+			if(AtariIo_TimedEventCycle(pIoData, pHeap->aEvents[lChildSlot]) <= llClockCycle)
 			{
-				pIoData->llTimer2Cycle += period;
+				aStack[lDepth++] = (u8)lChildSlot;
 			}
 		}
 	}
 
-	if(llMasterCycle >= pIoData->llTimer4Cycle)
-	{
-		u64 period = Pokey_TimerPeriodCpuCycles(pContext, 4);
-#ifdef VERBOSE_SIO
-		printf("             [%16llu] TIMER_4 request!\n", pContext->llCycleCounter);
-#endif
-		RAM[IO_IRQEN_IRQST] &= ~IRQ_TIMER_4;
-		if(SRAM[IO_IRQEN_IRQST] & IRQ_TIMER_4)
-		{
-			_6502_Irq(pContext);
-		}
+	return lDue;
+}
 
-		if(period == 0)
+void AtariIoOnce(AtariIoOnce_t *pOnce, void (*Build)(void))
+{
+	if(SDL_AtomicGet(&pOnce->tDone))
+	{
+		return;
+	}
+
+	SDL_AtomicLock(&pOnce->tLock);
+
+	/* Set only once the table is complete, for readers not taking the lock. */
+	if(!SDL_AtomicGet(&pOnce->tDone))
+	{
+		Build();
+		SDL_AtomicSet(&pOnce->tDone, 1);
+	}
+
+	SDL_AtomicUnlock(&pOnce->tLock);
+}
+
+void AtariIoRegisterTimedEvent(
+	_6502_Context_t *pContext,
+	TimedEventId_t eEvent,
+	u64 *pCycle,
+	u8 bBeamClock,
+	TimedEventHandler_t Handler)
+{
+	IoData_t *pIoData = (IoData_t *)pContext->pIoData;
+
+	if(pIoData->aTimedEvents[eEvent].pCycle)
+	{
+		AtariIo_TimedEventHeapRemove(pIoData, eEvent);
+	}
+
+	pIoData->aTimedEvents[eEvent].pCycle = pCycle;
+	pIoData->aTimedEvents[eEvent].Handler = Handler;
+	pIoData->aTimedEvents[eEvent].bBeamClock = bBeamClock;
+	pIoData->aTimedEvents[eEvent].cHeapSlot = TIMED_EVENT_NOT_QUEUED;
+
+	AtariIo_TimedEventHeapQueue(pIoData, eEvent);
+	AtariIo_UpdateTimedEventCycles(pContext);
+}
+
+/* Sets the event's cycle field (CYCLE_NEVER disarms it) and requeues it. */
+void AtariIoScheduleTimedEvent(_6502_Context_t *pContext, TimedEventId_t eEvent, u64 llCycle)
+{
+	IoData_t *pIoData = (IoData_t *)pContext->pIoData;
+
+	*pIoData->aTimedEvents[eEvent].pCycle = llCycle;
+	AtariIo_TimedEventHeapQueue(pIoData, eEvent);
+	AtariIo_UpdateTimedEventCycles(pContext);
+}
+
+/* Takes the event out of its queue but leaves its cycle field alone. */
+void AtariIoCancelTimedEvent(_6502_Context_t *pContext, TimedEventId_t eEvent)
+{
+	IoData_t *pIoData = (IoData_t *)pContext->pIoData;
+
+	AtariIo_TimedEventHeapRemove(pIoData, eEvent);
+	AtariIo_UpdateTimedEventCycles(pContext);
+}
+
+/* Rebuilds both queues from the registered cycle fields, for callers that
+ * write several of them directly.
+ */
+void AtariIoCycleTimedEventUpdate(_6502_Context_t *pContext)
+{
+	IoData_t *pIoData = (IoData_t *)pContext->pIoData;
+	u8 cEvent;
+
+	pIoData->tMasterEventHeap.cCount = 0;
+	pIoData->tBeamEventHeap.cCount = 0;
+
+	for(cEvent = 0; cEvent < TIMED_EVENT_COUNT; cEvent++)
+	{
+		pIoData->aTimedEvents[cEvent].cHeapSlot = TIMED_EVENT_NOT_QUEUED;
+
+		if(pIoData->aTimedEvents[cEvent].pCycle == NULL ||
+		   (cEvent == TIMED_EVENT_DISPLAY_LIST_FETCH && pIoData->bInDrawLine))
+		{
+			continue;
+		}
+
+		AtariIo_TimedEventHeapQueue(pIoData, cEvent);
+	}
+
+	AtariIo_UpdateTimedEventCycles(pContext);
+}
+
+static void AtariIo_DisplayListFetchEvent(_6502_Context_t *pContext, u64 llMasterCycle)
+{
+	IoData_t *pIoData = (IoData_t *)pContext->pIoData;
+
+	if(pIoData->tVideoData.lCurrentDisplayLine == 0)
+	{
+		pIoData->llCycle = pIoData->llDisplayListFetchCycle;
+	}
+
+	pIoData->tDrawLineData.cPlayfieldDmaStealCount = 0;
+	pIoData->tDrawLineData.cRefreshDmaPending = 0;
+	pIoData->tDrawLineData.cDisplayListInstructionDmaPending = 0;
+	pIoData->tDrawLineData.cDisplayListAddressDmaRemaining = 0;
+	AtariIo_ResetPmgClockState(&pIoData->tDrawLineData);
+	pIoData->tDrawLineData.lQuietFromCycle = 0;
+	pIoData->tDrawLineData.lQuietUntilCycle = 0;
+	memset(pIoData->tDrawLineData.aPlayfieldDmaTemplate, 0, sizeof(pIoData->tDrawLineData.aPlayfieldDmaTemplate));
+	memset(pIoData->tDrawLineData.aScheduledPlayfieldDma, 0, sizeof(pIoData->tDrawLineData.aScheduledPlayfieldDma));
+	AtariIoResetNmiEnableTiming(pContext);
+
+	AtariIoFetchLine(pContext);
+
+	pIoData->bInDrawLine = 1;
+	AtariIoCancelTimedEvent(pContext, TIMED_EVENT_DISPLAY_LIST_FETCH);
+
+	AtariIoDrawLine(pContext);
+	AtariIoEvaluateModeLineEnd(pContext);
+	pIoData->llDisplayListFetchCycle += CYCLES_PER_LINE;
+	AtariIoAdvanceScanline(pContext);
+	pIoData->bInDrawLine = 0;
+	AtariIoScheduleTimedEvent(pContext, TIMED_EVENT_DISPLAY_LIST_FETCH, pIoData->llDisplayListFetchCycle);
+	(void)llMasterCycle;
+}
+
+static void AtariIo_NmiSourceEvent(
+	_6502_Context_t *pContext,
+	u64 llBeamCycle,
+	TimedEventId_t eEvent,
+	u8 cSource)
+{
+	IoData_t *pIoData = (IoData_t *)pContext->pIoData;
+	u64 llSourceCycle = *pIoData->aTimedEvents[eEvent].pCycle;
+
+	/* NMIST is set at cycle 7 unconditionally (AHRM 4.8). */
+	/* DLI/VBI status bits are mutually exclusive. */
+	RAM[IO_NMIRES_NMIST] &= ~(NMI_DLI | NMI_VBI);
+	RAM[IO_NMIRES_NMIST] |= cSource;
+
+	if(llBeamCycle > llSourceCycle)
+	{
+		/* NMI fires at cycle 8 (one cycle after NMIST at cycle 7). */
+		NmiSourceTiming_t tTiming =
+			AtariIoCurrentLineNmiSourceState(pIoData, cSource);
+		if(tTiming.cEnabled)
+		{
+			if(tTiming.cDelayOneCycle && llBeamCycle == llSourceCycle + 1)
+			{
+				pIoData->cNmienEnabledOnCycle7Mask &= (u8)~cSource;
+				/* reschedule: NMI fires at llBeamCycle+1 */
+				AtariIoScheduleTimedEvent(pContext, eEvent, llBeamCycle);
+			}
+			else
+			{
+				_6502_Nmi(pContext);
+				AtariIoScheduleTimedEvent(pContext, eEvent, CYCLE_NEVER);
+			}
+		}
+		else
+		{
+			AtariIoScheduleTimedEvent(pContext, eEvent, CYCLE_NEVER);
+		}
+	}
+}
+
+static void AtariIo_DliEvent(_6502_Context_t *pContext, u64 llBeamCycle)
+{
+#ifdef VERBOSE_DL
+	IoData_t *pIoData = (IoData_t *)pContext->pIoData;
+
+	printf("             [%16llu]", pContext->llCycleCounter);
+	printf(" DL: %3lu DLI\n", pIoData->tVideoData.lCurrentDisplayLine);
+#endif
+	AtariIo_NmiSourceEvent(pContext, llBeamCycle, TIMED_EVENT_DLI, NMI_DLI);
+}
+
+static void AtariIo_VbiEvent(_6502_Context_t *pContext, u64 llBeamCycle)
+{
+#ifdef VERBOSE_DL
+	IoData_t *pIoData = (IoData_t *)pContext->pIoData;
+
+	printf("             [%16llu]", pContext->llCycleCounter);
+	printf(" DL: %3lu VBI\n", pIoData->tVideoData.lCurrentDisplayLine);
+#endif
+	AtariIo_NmiSourceEvent(pContext, llBeamCycle, TIMED_EVENT_VBI, NMI_VBI);
+}
+
+static void AtariIo_CycleTimedEvent(_6502_Context_t *pContext)
+{
+	IoData_t *pIoData = (IoData_t *)pContext->pIoData;
+	u64 llMasterCycle = pContext->llCycleCounter;
+	u64 llBeamCycle = pIoData->llCycle;
+	u32 lEvent = 0;
+	u32 lDue;
+
+	/* Handlers may arm, move or run other events (the display list fetch
+	 * draws a whole line), so the due set is taken again after each one.
+	 */
+	while((lDue = (AtariIo_DueTimedEvents(pIoData, &pIoData->tMasterEventHeap, llMasterCycle) |
+				   AtariIo_DueTimedEvents(pIoData, &pIoData->tBeamEventHeap, llBeamCycle)) >>
+				  lEvent << lEvent) != 0)
+	{
+		lEvent = AtariIo_CountTrailingZeros(lDue);
+		pIoData->aTimedEvents[lEvent].Handler(
+			pContext,
+			pIoData->aTimedEvents[lEvent].bBeamClock ? llBeamCycle : llMasterCycle);
+		lEvent++;
+	}
+
+	Pokey_Sync(pContext, pContext->llCycleCounter);
+}
+
+/* Traps: $22 halts a real 6502, so no OS or program code uses it. */
+#define TRAP_OPCODE 0x22
+
+/* SIOV patch */
+#define OS_SIOV 0xe459
+#define OS_STATUS 0x0030
+#define OS_CRITIC 0x0042
+#define OS_DSTATS 0x0303
+
+/* Charged for a patched request: roughly the OS SIO setup plus a tight
+   copy loop, far below the ~950 cycles per byte of a 19200 baud transfer. */
+#define SIO_TRAP_BASE_CYCLES 400u
+#define SIO_TRAP_BYTE_CYCLES 12u
+
+/* H: device. CIOV is JMP CIO; its operand bytes are only reached through
+   the put byte vector of H: channels, which points at the first minus
+   one. Costs follow the jsA8E H: device. */
+#define OS_CIOV 0xe456
+#define CIO_TRAP_BASE_CYCLES 96u
+#define CIO_TRAP_BYTE_CYCLES 2u
+#define CIO_GET_RECORD 0x05
+#define CIO_NOT_OPEN 0x85
+
+/* BASIC program injection: SAVE files start with the pointers from LOMEM
+   to STARP, less LOMEM, followed by the memory from VNTP to STARP. */
+#define BASIC_HEADER_SIZE 14u
+#define BASIC_LOMEM 0x0080
+#define BASIC_STARP 0x008c
+#define BASIC_RUNSTK 0x008e
+#define BASIC_MEMTOP 0x0090
+#define OS_APPMHI 0x000e
+#define OS_MEMTOP 0x02e5
+#define OS_ICCOM 0x0342
+#define OS_ICSTA 0x0343
+#define OS_ICBAL 0x0344
+#define OS_ICBLL 0x0348
+
+/* Direct XEX loading. The boot sector keeps the layout of aXexBootLoader,
+   so the OS boots it the same way, but the loader itself is two traps:
+   DOSINI enters at XEX_DIRECT_ENTRY, INITAD routines return to
+   XEX_DIRECT_RETURN. Segments are read from the image as XexToAtr laid
+   them out, from sector 4 on. */
+#define XEX_DIRECT_ENTRY 0x0707
+#define XEX_DIRECT_RETURN 0x0709
+#define XEX_DIRECT_DATA_OFFSET (16u + 3u * 128u)
+#define OS_RUNAD 0x02e0
+#define OS_INITAD 0x02e2
+
+static const u8 aXexDirectBootSector[] =
+	{
+		0x00, /* flags */
+		0x01, /* 1 boot sector */
+		0x00,
+		0x07, /* load address $0700 */
+		0x07,
+		0x07, /* init address $0707 */
+		0x60, /* $0706: RTS */
+		TRAP_OPCODE, /* $0707: load until an INITAD or the end */
+		0x60, /* $0708: RTS (no RUNAD) */
+		TRAP_OPCODE, /* $0709: go on after INITAD */
+		0x60,
+};
+
+static void AtariIo_SetDriveGeometry(SioDrive_t *pDrive)
+{
+	pDrive->sSectorSize = pDrive->pImage[4] | (pDrive->pImage[5] << 8);
+	if(pDrive->sSectorSize == 0)
+	{
+		pDrive->sSectorSize = 128;
+	}
+}
+
+/* Reads the whole file into a buffer of its own size. */
+static int AtariIo_ReadDisk(SioDrive_t *pDrive, const char *pFileName)
+{
+	FILE *pFile = fopen(pFileName, "rb");
+	long lSize;
+
+	if(!pFile)
+	{
+		return 0;
+	}
+
+	fseek(pFile, 0, SEEK_END);
+	lSize = ftell(pFile);
+	fseek(pFile, 0, SEEK_SET);
+
+	if(lSize < 16 || lSize > MAX_DISK_SIZE)
+	{
+		AtariIo_LogError("A8E: Not a disk image: %s\n", pFileName);
+		AtariIo_CloseFileOrWarn(pFile, pFileName);
+		return 0;
+	}
+
+	pDrive->pImage = (u8 *)malloc((size_t)lSize);
+	if(pDrive->pImage == NULL || fread(pDrive->pImage, 1, (size_t)lSize, pFile) != (size_t)lSize)
+	{
+		AtariIo_LogError("A8E: Failed to read disk image: %s\n", pFileName);
+		free(pDrive->pImage);
+		pDrive->pImage = NULL;
+		AtariIo_CloseFileOrWarn(pFile, pFileName);
+		return 0;
+	}
+
+	AtariIo_CloseFileOrWarn(pFile, pFileName);
+	pDrive->lSize = (u32)lSize;
+
+	return 1;
+}
+
+#ifndef _WIN32
+/* Maps the file instead of reading it; pages come in as sectors are used. */
+static int AtariIo_MapDisk(SioDrive_t *pDrive, const char *pFileName, u8 bWriteThrough)
+{
+	struct stat tStat;
+	void *pImage;
+	int lFile = open(pFileName, bWriteThrough ? O_RDWR : O_RDONLY);
+
+	if(lFile < 0 && bWriteThrough)
+	{
+		AtariIo_LogError("A8E: %s is read-only, writes stay in memory.\n", pFileName);
+		bWriteThrough = 0;
+		lFile = open(pFileName, O_RDONLY);
+	}
+
+	if(lFile < 0)
+	{
+		return 0;
+	}
+
+	if(fstat(lFile, &tStat) != 0 || tStat.st_size < 16 || tStat.st_size > MAX_DISK_SIZE)
+	{
+		close(lFile);
+		return 0;
+	}
+
+	pImage = mmap(NULL, (size_t)tStat.st_size, PROT_READ | PROT_WRITE,
+				  bWriteThrough ? MAP_SHARED : MAP_PRIVATE, lFile, 0);
+	close(lFile);
+
+	if(pImage == MAP_FAILED)
+	{
+		return 0;
+	}
+
+	pDrive->pImage = (u8 *)pImage;
+	pDrive->lSize = (u32)tStat.st_size;
+	pDrive->bMapped = 1;
+	pDrive->bWriteThrough = bWriteThrough;
+
+	return 1;
+}
+#endif
+
+/* Converts an XEX file into a malloced boot disk; with bDirect its boot
+   sector loads the segments through traps instead of over SIO. */
+static int AtariIo_MountXex(SioDrive_t *pDrive, const char *pFileName, u8 bDirect)
+{
+	SioDrive_t tXex;
+	u8 *pImage;
+	u8 *pTrimmed;
+
+	memset(&tXex, 0, sizeof(tXex));
+	if(!AtariIo_ReadDisk(&tXex, pFileName))
+	{
+		return 0;
+	}
+
+	pImage = (u8 *)malloc(MAX_DISK_SIZE);
+	if(pImage == NULL || !XexToAtr(pImage, &pDrive->lSize, tXex.pImage, tXex.lSize))
+	{
+		AtariIo_LogError("A8E: Failed to convert XEX to ATR: %s\n", pFileName);
+		free(pImage);
+		free(tXex.pImage);
+		pDrive->lSize = 0;
+		return 0;
+	}
+
+	free(tXex.pImage);
+	pTrimmed = (u8 *)realloc(pImage, pDrive->lSize);
+	pDrive->pImage = pTrimmed ? pTrimmed : pImage;
+
+	if(bDirect)
+	{
+		memcpy(pDrive->pImage + 16, aXexDirectBootSector, sizeof(aXexDirectBootSector));
+		pDrive->bXexDirect = 1;
+	}
+
+	return 1;
+}
+
+int AtariIoMountDisk(_6502_Context_t *pContext, u8 cDrive, const char *pFileName, u8 cWriteMode)
+{
+	IoData_t *pIoData = (IoData_t *)pContext->pIoData;
+	SioDrive_t *pDrive;
+	int bMounted;
+
+	if(cDrive >= SIO_DRIVES || pFileName == NULL)
+	{
+		return 0;
+	}
+
+	AtariIoUnmountDisk(pContext, cDrive);
+	pDrive = &pIoData->aDrives[cDrive];
+
+	if(IsXexFile(pFileName))
+	{
+		bMounted = AtariIo_MountXex(pDrive, pFileName, cDrive == 0 && pIoData->bXexDirect);
+	}
+	else
+	{
+#ifndef _WIN32
+		bMounted = AtariIo_MapDisk(pDrive, pFileName, cWriteMode == SIO_WRITE_THROUGH);
+		if(!bMounted)
+#endif
+		{
+			bMounted = AtariIo_ReadDisk(pDrive, pFileName);
+		}
+	}
+
+	if(!bMounted)
+	{
+		return 0;
+	}
+
+	AtariIo_SetDriveGeometry(pDrive);
+
+	if(cWriteMode == SIO_WRITE_BACK && !IsXexFile(pFileName))
+	{
+		pDrive->pJournal = DiskJournal_Open(pFileName, pDrive->pImage, pDrive->lSize,
+											pIoData->lDiskCommitMilliseconds);
+		if(!pDrive->pJournal)
+		{
+			AtariIo_LogError("A8E: No write-back for %s, writes stay in memory.\n", pFileName);
+		}
+	}
+#ifdef VERBOSE_SIO
+	printf("D%d: %s, size = %lu, sector size = %d\n", cDrive + 1, pFileName, pDrive->lSize, pDrive->sSectorSize);
+#endif
+
+	return 1;
+}
+
+void AtariIoSetXexDirect(_6502_Context_t *pContext, u8 bEnable)
+{
+	IoData_t *pIoData = (IoData_t *)pContext->pIoData;
+
+	pIoData->bXexDirect = bEnable ? 1 : 0;
+}
+
+void AtariIoSetDiskCommitInterval(_6502_Context_t *pContext, u32 lMilliseconds)
+{
+	IoData_t *pIoData = (IoData_t *)pContext->pIoData;
+
+	pIoData->lDiskCommitMilliseconds = lMilliseconds;
+}
+
+void AtariIoUnmountDisk(_6502_Context_t *pContext, u8 cDrive)
+{
+	IoData_t *pIoData = (IoData_t *)pContext->pIoData;
+	SioDrive_t *pDrive;
+
+	if(cDrive >= SIO_DRIVES)
+	{
+		return;
+	}
+
+	pDrive = &pIoData->aDrives[cDrive];
+	DiskJournal_Close(pDrive->pJournal);
+#ifndef _WIN32
+	if(pDrive->bMapped)
+	{
+		munmap(pDrive->pImage, pDrive->lSize);
+	}
+	else
+#endif
+	{
+		free(pDrive->pImage);
+	}
+
+	memset(pDrive, 0, sizeof(*pDrive));
+}
+
+/* Loads segments from where the last call stopped until one sets INITAD,
+   which is then called to return to XEX_DIRECT_RETURN, or until the end,
+   where it jumps through RUNAD. Same order as aXexBootLoader. */
+static u8 AtariIo_XexTrap(_6502_Context_t *pContext)
+{
+	IoData_t *pIoData = (IoData_t *)pContext->pIoData;
+	SioDrive_t *pDrive = &pIoData->aDrives[0];
+	u32 lBytes = 0;
+
+	if(!pDrive->bXexDirect)
+	{
+		return 0;
+	}
+
+	if((u16)(CPU.pc - 1) == XEX_DIRECT_ENTRY)
+	{
+		pIoData->lXexOffset = XEX_DIRECT_DATA_OFFSET;
+		RAM[OS_RUNAD] = 0;
+		RAM[OS_RUNAD + 1] = 0;
+	}
+
+	RAM[OS_INITAD] = 0;
+	RAM[OS_INITAD + 1] = 0;
+
+	while(pIoData->lXexOffset + 6 <= pDrive->lSize &&
+		  pDrive->pImage[pIoData->lXexOffset] == 0xff && pDrive->pImage[pIoData->lXexOffset + 1] == 0xff)
+	{
+		u8 *pSegment = &pDrive->pImage[pIoData->lXexOffset];
+		u16 sStart = pSegment[2] | (pSegment[3] << 8);
+		u16 sEnd = pSegment[4] | (pSegment[5] << 8);
+		u32 lLength = (u32)(sEnd - sStart) + 1;
+		u32 lIndex;
+
+		if(sEnd < sStart || pIoData->lXexOffset + 6 + lLength > pDrive->lSize)
+		{
+			break;
+		}
+
+		/* Through the access functions, so ROM stays read-only. */
+		for(lIndex = 0; lIndex < lLength; lIndex++)
+		{
+			_6502_Write(pContext, (u16)(sStart + lIndex), pSegment[6 + lIndex]);
+		}
+
+		lBytes += lLength;
+		pIoData->lXexOffset += 6 + lLength;
+
+		if(RAM[OS_INITAD + 1])
+		{
+			/* JSR (INITAD) */
+			RAM[0x100 + CPU.sp] = (XEX_DIRECT_RETURN - 1) >> 8;
+			CPU.sp--;
+			RAM[0x100 + CPU.sp] = (XEX_DIRECT_RETURN - 1) & 0xff;
+			CPU.sp--;
+			CPU.pc = RAM[OS_INITAD] | (RAM[OS_INITAD + 1] << 8);
+
+			_6502_STALL(lBytes * SIO_TRAP_BYTE_CYCLES);
+
+			return 1;
+		}
+	}
+
+	/* The end: JMP (RUNAD), or on to the RTS after the trap. */
+	pIoData->lXexOffset = pDrive->lSize;
+	if(RAM[OS_RUNAD + 1])
+	{
+		CPU.pc = RAM[OS_RUNAD] | (RAM[OS_RUNAD + 1] << 8);
+	}
+
+	_6502_STALL(lBytes * SIO_TRAP_BYTE_CYCLES);
+
+	return 1;
+}
+
+/* Returns from the JSR that reached a trap with cStatus in Y, as the OS
+   CIO and SIO code do, and charges lCycles. */
+static void AtariIo_TrapReturn(_6502_Context_t *pContext, u8 cStatus, u32 lCycles)
+{
+	u16 sReturn;
+
+	CPU.y = cStatus;
+	PS.n = cStatus & 0x80;
+	PS.z = 0;
+
+	/* RTS */
+	CPU.sp++;
+	sReturn = RAM[0x100 + CPU.sp];
+	CPU.sp++;
+	sReturn |= RAM[0x100 + CPU.sp] << 8;
+	CPU.pc = (u16)(sReturn + 1);
+
+	_6502_STALL(lCycles);
+}
+
+/* Puts the trap opcodes in the CIOV entry while H: or a pending BASIC
+   program needs them, and the JMP back once neither does. */
+static void AtariIo_UpdateCiovTrap(_6502_Context_t *pContext)
+{
+	IoData_t *pIoData = (IoData_t *)pContext->pIoData;
+	u8 *pRomBytes = &pIoData->pFloatingPointRom[OS_CIOV - 0xd800];
+	u8 bTrap = pIoData->pHostDevice || pIoData->pBasicProgram;
+
+	if(bTrap == pIoData->bCiovTrap)
+	{
+		return;
+	}
+
+	if(bTrap)
+	{
+		pIoData->aCiovBytes[0] = pRomBytes[0];
+		pIoData->aCiovBytes[1] = pRomBytes[1];
+		pIoData->sCioTarget = pRomBytes[1] | (pRomBytes[2] << 8);
+		pRomBytes[0] = TRAP_OPCODE;
+		pRomBytes[1] = TRAP_OPCODE;
+	}
+	else
+	{
+		pRomBytes[0] = pIoData->aCiovBytes[0];
+		pRomBytes[1] = pIoData->aCiovBytes[1];
+	}
+
+	/* PORTB banking copies the ROM image in; patch the live copy too. */
+	if(SRAM[IO_PORTB] & 0x01)
+	{
+		RAM[OS_CIOV] = pRomBytes[0];
+		RAM[OS_CIOV + 1] = pRomBytes[1];
+	}
+
+	pIoData->bCiovTrap = bTrap;
+}
+
+static void AtariIo_SetWord(_6502_Context_t *pContext, u16 sAddress, u16 sValue)
+{
+	RAM[sAddress] = (u8)(sValue & 0xff);
+	RAM[sAddress + 1] = (u8)(sValue >> 8);
+}
+
+/* Puts the pending BASIC program in memory once BASIC asks E: for its
+   first line, with BASIC set up and its ROM banked in. Returns 0 to let
+   the OS read that line, else the status of serving it as RUN. */
+static u8 AtariIo_BasicTrap(_6502_Context_t *pContext, u32 *pBytes)
+{
+	IoData_t *pIoData = (IoData_t *)pContext->pIoData;
+	u8 *pHeader = pIoData->pBasicProgram;
+	u16 sReturn = RAM[0x100 + (u8)(CPU.sp + 1)] | (RAM[0x100 + (u8)(CPU.sp + 2)] << 8);
+	u16 sLomem = RAM[BASIC_LOMEM] | (RAM[BASIC_LOMEM + 1] << 8);
+	u16 sVntp = pHeader[2] | (pHeader[3] << 8);
+	u16 sStarp = pHeader[12] | (pHeader[13] << 8);
+	u16 sBuffer;
+	u32 lIndex;
+	u8 bLoaded = 0;
+
+	if(CPU.x != 0 || RAM[OS_ICCOM] != CIO_GET_RECORD || (SRAM[IO_PORTB] & 0x02) ||
+	   sReturn < 0xa000 || sReturn > 0xbfff)
+	{
+		return 0;
+	}
+
+	if((u32)sLomem + sStarp > (u32)(RAM[OS_MEMTOP] | (RAM[OS_MEMTOP + 1] << 8)))
+	{
+		AtariIo_LogError("A8E: BASIC program does not fit below MEMTOP.\n");
+	}
+	else
+	{
+		for(lIndex = 0; lIndex < (u32)(sStarp - sVntp); lIndex++)
+		{
+			_6502_Write(pContext, (u16)(sLomem + sVntp + lIndex), pHeader[BASIC_HEADER_SIZE + lIndex]);
+		}
+
+		/* VNTP to STARP as LOAD leaves them; no runtime stack, no arrays. */
+		for(lIndex = 1; lIndex < BASIC_HEADER_SIZE / 2; lIndex++)
+		{
+			AtariIo_SetWord(pContext, (u16)(BASIC_LOMEM + lIndex * 2),
+							(u16)(sLomem + (pHeader[lIndex * 2] | (pHeader[lIndex * 2 + 1] << 8))));
+		}
+
+		AtariIo_SetWord(pContext, BASIC_RUNSTK, (u16)(sLomem + sStarp));
+		AtariIo_SetWord(pContext, BASIC_MEMTOP, (u16)(sLomem + sStarp));
+		AtariIo_SetWord(pContext, OS_APPMHI, (u16)(sLomem + sStarp));
+		_6502_STALL((u32)(sStarp - sVntp) * CIO_TRAP_BYTE_CYCLES);
+		bLoaded = 1;
+	}
+
+	free(pIoData->pBasicProgram);
+	pIoData->pBasicProgram = NULL;
+	AtariIo_UpdateCiovTrap(pContext);
+
+	if(!bLoaded || !pIoData->bBasicRun)
+	{
+		return 0;
+	}
+
+	/* The line typed: RUN. */
+	sBuffer = RAM[OS_ICBAL] | (RAM[OS_ICBAL + 1] << 8);
+	for(lIndex = 0; lIndex < 4; lIndex++)
+	{
+		_6502_Write(pContext, (u16)(sBuffer + lIndex), (u8)"RUN\x9b"[lIndex]);
+	}
+
+	AtariIo_SetWord(pContext, OS_ICBLL, 4);
+	RAM[OS_ICSTA] = 0x01;
+	*pBytes = 4;
+
+	return 0x01;
+}
+
+static u8 AtariIo_CioTrap(_6502_Context_t *pContext)
+{
+	IoData_t *pIoData = (IoData_t *)pContext->pIoData;
+	u32 lBytes = 0;
+	u8 cStatus = 0;
+
+	if((u16)(CPU.pc - 1) == OS_CIOV + 1)
+	{
+		cStatus = pIoData->pHostDevice ? HostDevice_PutByte(pIoData->pHostDevice, pContext, &lBytes) : CIO_NOT_OPEN;
+	}
+	else
+	{
+		if(pIoData->pBasicProgram)
+		{
+			cStatus = AtariIo_BasicTrap(pContext, &lBytes);
+		}
+
+		if(cStatus == 0 && pIoData->pHostDevice)
+		{
+			cStatus = HostDevice_Cio(pIoData->pHostDevice, pContext, &lBytes);
+		}
+
+		if(cStatus == 0)
+		{
+			/* Neither for H: nor the loader: on into the OS CIO as the JMP would. */
+			CPU.pc = pIoData->sCioTarget;
+			pContext->llCycleCounter++;
+
+			return 1;
+		}
+	}
+
+	AtariIo_TrapReturn(pContext, cStatus, CIO_TRAP_BASE_CYCLES + lBytes * CIO_TRAP_BYTE_CYCLES);
+
+	return 1;
+}
+
+/* Puts the trap opcode in the SIOV entry while the disk patch, fast
+   cassette loading or a pending boot snapshot needs it, and the JMP back
+   once none does. */
+static void AtariIo_UpdateSiovTrap(_6502_Context_t *pContext)
+{
+	IoData_t *pIoData = (IoData_t *)pContext->pIoData;
+	u8 *pRomByte = &pIoData->pFloatingPointRom[OS_SIOV - 0xd800];
+	u8 bTrap = pIoData->bSioPatch || pIoData->bCassetteFast || pIoData->pBootCacheFileName != NULL;
+
+	if(bTrap == pIoData->bSiovTrap)
+	{
+		return;
+	}
+
+	if(bTrap)
+	{
+		pIoData->cSiovOpcode = *pRomByte;
+		*pRomByte = TRAP_OPCODE;
+	}
+	else
+	{
+		*pRomByte = pIoData->cSiovOpcode;
+	}
+
+	/* PORTB banking copies the ROM image in; patch the live copy too. */
+	if(SRAM[IO_PORTB] & 0x01)
+	{
+		RAM[OS_SIOV] = *pRomByte;
+	}
+
+	pIoData->bSiovTrap = bTrap;
+}
+
+/* Boot cache snapshot: this build's machine state as it is in memory,
+   then the POKEY chip state (Pokey_SaveState). Only good for the build,
+   ROM set and BASIC option it was taken with, which the key covers. */
+#define BOOT_CACHE_MAGIC "A8EBOOT1"
+#define BOOT_CACHE_HASH_SEED 2166136261u
+
+typedef struct
+{
+	char aMagic[8];
+	u32 lKey;
+	_6502_Context_t tContext;
+	IoData_t tIoData;
+	u64 llDestinationOffset; /* of tDrawLineData.pDestination in the surface */
+	u64 llPriorityOffset; /* of tDrawLineData.pPriorityData */
+	u8 aMemory[_6502_MEMORY_SIZE];
+	u8 aShadowMemory[_6502_MEMORY_SIZE];
+} BootState_t;
+
+/* FNV-1a, continued from lHash. */
+static u32 AtariIo_Hash(u32 lHash, const void *pData, u32 lLength)
+{
+	const u8 *pByte = (const u8 *)pData;
+
+	while(lLength--)
+	{
+		lHash = ((lHash ^ *pByte++) * 16777619u) & 0xffffffffu;
+	}
+
+	return lHash;
+}
+
+static u32 AtariIo_BootCacheKey(IoData_t *pIoData)
+{
+	static const char aBuild[] = A8E_BUILD_VERSION " " __DATE__ " " __TIME__;
+	u32 aSizes[2];
+	u32 lKey = pIoData->lRomHash;
+
+	aSizes[0] = sizeof(BootState_t);
+	aSizes[1] = Pokey_StateSize();
+	lKey = AtariIo_Hash(lKey, &m_cConsolHack, 1);
+	lKey = AtariIo_Hash(lKey, aSizes, sizeof(aSizes));
+
+	return AtariIo_Hash(lKey, aBuild, sizeof(aBuild));
+}
+
+/* Writes the pending boot snapshot, the CPU at the trap in the SIOV entry,
+   and stops waiting for it. */
+static void AtariIo_SaveBootState(_6502_Context_t *pContext)
+{
+	IoData_t *pIoData = (IoData_t *)pContext->pIoData;
+	u8 *pPixels = (u8 *)pIoData->tVideoData.pSdlAtariSurface->pixels;
+	u32 lPokeySize = Pokey_StateSize();
+	BootState_t *pState = (BootState_t *)calloc(1, sizeof(BootState_t) + lPokeySize);
+	FILE *pFile = NULL;
+
+	if(pState)
+	{
+		memcpy(pState->aMagic, BOOT_CACHE_MAGIC, sizeof(pState->aMagic));
+		pState->lKey = AtariIo_BootCacheKey(pIoData);
+		pState->tContext = *pContext;
+		pState->tContext.tCpu.pc = OS_SIOV;
+		pState->tIoData = *pIoData;
+		if(pIoData->tDrawLineData.pDestination)
 		{
-			pIoData->llTimer4Cycle = CYCLE_NEVER;
+			pState->llDestinationOffset = (u64)(pIoData->tDrawLineData.pDestination - pPixels);
+			pState->llPriorityOffset =
+				(u64)(pIoData->tDrawLineData.pPriorityData - pIoData->tVideoData.pPriorityData);
 		}
-		else
+		memcpy(pState->aMemory, RAM, _6502_MEMORY_SIZE);
+		memcpy(pState->aShadowMemory, SRAM, _6502_MEMORY_SIZE);
+		Pokey_SaveState(pContext, pState + 1);
+
+		pFile = fopen(pIoData->pBootCacheFileName, "wb");
+	}
+
+	if(!pFile || fwrite(pState, sizeof(BootState_t) + lPokeySize, 1, pFile) != 1)
+	{
+		AtariIo_LogError("A8E: Cannot write boot snapshot %s.\n", pIoData->pBootCacheFileName);
+	}
+
+	if(pFile)
+	{
+		AtariIo_CloseFileOrWarn(pFile, pIoData->pBootCacheFileName);
+	}
+
+	free(pState);
+	free(pIoData->pBootCacheFileName);
+	pIoData->pBootCacheFileName = NULL;
+	AtariIo_UpdateSiovTrap(pContext);
+}
+
+/* Restores the machine from the boot snapshot in pFile; what belongs to
+   this run stays. Returns 0, with nothing changed, if pFile is no snapshot
+   for this build, ROM set and BASIC option. */
+static int AtariIo_LoadBootState(_6502_Context_t *pContext, FILE *pFile)
+{
+	IoData_t *pIoData = (IoData_t *)pContext->pIoData;
+	u32 lPokeySize = Pokey_StateSize();
+	BootState_t *pState = (BootState_t *)malloc(sizeof(BootState_t) + lPokeySize);
+	IoData_t tLive;
+	u8 cEvent;
+
+	if(!pState || fread(pState, sizeof(BootState_t) + lPokeySize, 1, pFile) != 1 || fgetc(pFile) != EOF ||
+	   memcmp(pState->aMagic, BOOT_CACHE_MAGIC, sizeof(pState->aMagic)) != 0 ||
+	   pState->lKey != AtariIo_BootCacheKey(pIoData))
+	{
+		free(pState);
+
+		return 0;
+	}
+
+	CPU = pState->tContext.tCpu;
+	pContext->llCycleCounter = pState->tContext.llCycleCounter;
+	pContext->llStallCycleCounter = pState->tContext.llStallCycleCounter;
+	pContext->llIoCycleTimedEventCycle = pState->tContext.llIoCycleTimedEventCycle;
+	pContext->llIoMasterTimedEventCycle = pState->tContext.llIoMasterTimedEventCycle;
+	pContext->llIoBeamTimedEventCycle = pState->tContext.llIoBeamTimedEventCycle;
+	pContext->cNmiPendingFlag = pState->tContext.cNmiPendingFlag;
+	pContext->cNmiActiveFlag = pState->tContext.cNmiActiveFlag;
+	pContext->cIrqPendingFlag = pState->tContext.cIrqPendingFlag;
+
+	memcpy(RAM, pState->aMemory, _6502_MEMORY_SIZE);
+	memcpy(SRAM, pState->aShadowMemory, _6502_MEMORY_SIZE);
+
+	/* The machine part of the I/O state, with this run's pointers. */
+	tLive = *pIoData;
+	memcpy(pIoData, &pState->tIoData, offsetof(IoData_t, aDrives));
+
+	for(cEvent = 0; cEvent < TIMED_EVENT_COUNT; cEvent++)
+	{
+		pIoData->aTimedEvents[cEvent].pCycle = tLive.aTimedEvents[cEvent].pCycle;
+		pIoData->aTimedEvents[cEvent].Handler = tLive.aTimedEvents[cEvent].Handler;
+	}
+
+	pIoData->pPokey = tLive.pPokey;
+	pIoData->tVideoData = tLive.tVideoData;
+	pIoData->tVideoData.lCurrentDisplayLine = pState->tIoData.tVideoData.lCurrentDisplayLine;
+	if(pIoData->tDrawLineData.pDestination)
+	{
+		pIoData->tDrawLineData.pDestination =
+			(u8 *)pIoData->tVideoData.pSdlAtariSurface->pixels + pState->llDestinationOffset;
+		pIoData->tDrawLineData.pPriorityData = pIoData->tVideoData.pPriorityData + pState->llPriorityOffset;
+	}
+
+	/* The tape stays rewound, as if put in now. */
+	pIoData->llCassetteMotorCycle = pContext->llCycleCounter;
+
+	/* Banking as PORTB has it, with the ROMs (and their traps) of this run. */
+	if(SRAM[IO_PORTB] & 0x01)
+	{
+		_6502_SetRom(pContext, 0xc000, 0xcfff);
+		memcpy(&RAM[0xc000], pIoData->pOsRom, 0x1000);
+		_6502_SetRom(pContext, 0xd800, 0xffff);
+		memcpy(&RAM[0xd800], pIoData->pFloatingPointRom, 0x2800);
+	}
+	else
+	{
+		_6502_SetRam(pContext, 0xc000, 0xcfff);
+		_6502_SetRam(pContext, 0xd800, 0xffff);
+	}
+
+	if(SRAM[IO_PORTB] & 0x02)
+	{
+		_6502_SetRam(pContext, 0xa000, 0xbfff);
+	}
+	else
+	{
+		_6502_SetRom(pContext, 0xa000, 0xbfff);
+		memcpy(&RAM[0xa000], pIoData->pBasicRom, 0x2000);
+	}
+
+	if(SRAM[IO_PORTB] & 0x80)
+	{
+		_6502_SetRam(pContext, 0x5000, 0x57ff);
+	}
+	else
+	{
+		_6502_SetRom(pContext, 0x5000, 0x57ff);
+		memcpy(&RAM[0x5000], pIoData->pSelfTestRom, 0x0800);
+	}
+
+	Pokey_LoadState(pContext, pState + 1);
+	free(pState);
+
+	return 1;
+}
+
+static u8 AtariIo_Trap(_6502_Context_t *pContext)
+{
+	IoData_t *pIoData = (IoData_t *)pContext->pIoData;
+	u32 lBytes;
+	u8 cStatus;
+
+	if((u16)(CPU.pc - 1) == XEX_DIRECT_ENTRY || (u16)(CPU.pc - 1) == XEX_DIRECT_RETURN)
+	{
+		return AtariIo_XexTrap(pContext);
+	}
+
+	if(pIoData->bCiovTrap && (SRAM[IO_PORTB] & 0x01) &&
+	   ((u16)(CPU.pc - 1) == OS_CIOV || (u16)(CPU.pc - 1) == OS_CIOV + 1))
+	{
+		return AtariIo_CioTrap(pContext);
+	}
+
+	if(!pIoData->bSiovTrap || (u16)(CPU.pc - 1) != OS_SIOV || !(SRAM[IO_PORTB] & 0x01))
+	{
+		return 0;
+	}
+
+	if(pIoData->pBootCacheFileName)
+	{
+		AtariIo_SaveBootState(pContext);
+	}
+
+	cStatus = Pokey_SioRequest(pContext, &lBytes);
+	if(cStatus == 0)
+	{
+		/* Not for the patch: take the vector's JMP into the OS SIO code. */
+		CPU.pc = RAM[OS_SIOV + 1] | (RAM[OS_SIOV + 2] << 8);
+		pContext->llCycleCounter++;
+
+		return 1;
+	}
+
+	/* Leave the way the OS SIO does: status in DSTATS, STATUS and Y. */
+	RAM[OS_DSTATS] = cStatus;
+	RAM[OS_STATUS] = cStatus;
+	RAM[OS_CRITIC] = 0;
+	AtariIo_TrapReturn(pContext, cStatus, SIO_TRAP_BASE_CYCLES + lBytes * SIO_TRAP_BYTE_CYCLES);
+
+	return 1;
+}
+
+void AtariIoSetSioPatch(_6502_Context_t *pContext, u8 bEnable)
+{
+	IoData_t *pIoData = (IoData_t *)pContext->pIoData;
+
+	pIoData->bSioPatch = bEnable ? 1 : 0;
+	AtariIo_UpdateSiovTrap(pContext);
+}
+
+void AtariIoSetCassetteFast(_6502_Context_t *pContext, u8 bEnable)
+{
+	IoData_t *pIoData = (IoData_t *)pContext->pIoData;
+
+	pIoData->bCassetteFast = bEnable ? 1 : 0;
+	AtariIo_UpdateSiovTrap(pContext);
+}
+
+int AtariIoSetHostDirectory(_6502_Context_t *pContext, const char *pDirectory)
+{
+	IoData_t *pIoData = (IoData_t *)pContext->pIoData;
+	HostDevice_t *pHostDevice = NULL;
+
+	if(pDirectory)
+	{
+		pHostDevice = HostDevice_Open(pDirectory, OS_CIOV);
+		if(!pHostDevice)
 		{
-			while(pIoData->llTimer4Cycle <= llMasterCycle)
-			{
-				pIoData->llTimer4Cycle += period;
-			}
+			return 0;
 		}
 	}
 
-	Pokey_Sync(pContext, pContext->llCycleCounter);
+	HostDevice_Close(pIoData->pHostDevice);
+	pIoData->pHostDevice = pHostDevice;
+	AtariIo_UpdateCiovTrap(pContext);
+
+	return 1;
+}
+
+int AtariIoLoadBasic(_6502_Context_t *pContext, const char *pFileName, u8 bRun)
+{
+	IoData_t *pIoData = (IoData_t *)pContext->pIoData;
+	FILE *pFile = fopen(pFileName, "rb");
+	u8 *pProgram = NULL;
+	long lSize = 0;
+	u32 lIndex;
+
+	if(!pFile)
+	{
+		return 0;
+	}
+
+	fseek(pFile, 0, SEEK_END);
+	lSize = ftell(pFile);
+	fseek(pFile, 0, SEEK_SET);
+
+	if(lSize >= (long)BASIC_HEADER_SIZE)
+	{
+		pProgram = (u8 *)malloc((size_t)lSize);
+	}
+
+	if(!pProgram || fread(pProgram, 1, (size_t)lSize, pFile) != (size_t)lSize)
+	{
+		fclose(pFile);
+		free(pProgram);
+
+		return 0;
+	}
+
+	fclose(pFile);
+
+	/* LOMEM 0, the others in order, and the memory from VNTP to STARP. */
+	for(lIndex = 2; lIndex < BASIC_HEADER_SIZE; lIndex += 2)
+	{
+		if((pProgram[lIndex] | (pProgram[lIndex + 1] << 8)) < (pProgram[lIndex - 2] | (pProgram[lIndex - 1] << 8)))
+		{
+			break;
+		}
+	}
+
+	if(pProgram[0] != 0 || pProgram[1] != 0 || lIndex < BASIC_HEADER_SIZE ||
+	   (u32)((pProgram[12] | (pProgram[13] << 8)) - (pProgram[2] | (pProgram[3] << 8))) >
+		   (u32)lSize - BASIC_HEADER_SIZE)
+	{
+		free(pProgram);
+
+		return 0;
+	}
+
+	free(pIoData->pBasicProgram);
+	pIoData->pBasicProgram = pProgram;
+	pIoData->bBasicRun = bRun ? 1 : 0;
+	AtariIo_UpdateCiovTrap(pContext);
+
+	return 1;
+}
+
+u8 AtariIoSetBootCache(_6502_Context_t *pContext, const char *pDirectory)
+{
+	IoData_t *pIoData = (IoData_t *)pContext->pIoData;
+	size_t lLength = strlen(pDirectory) + sizeof("/boot-00000000.a8e");
+	char *pFileName = (char *)malloc(lLength);
+	FILE *pFile;
+	u8 bRestored = 0;
+
+	if(!pFileName)
+	{
+		return 0;
+	}
+
+	snprintf(pFileName, lLength, "%s/boot-%08lx.a8e", pDirectory, (unsigned long)AtariIo_BootCacheKey(pIoData));
+
+	pFile = fopen(pFileName, "rb");
+	if(pFile)
+	{
+		bRestored = (u8)AtariIo_LoadBootState(pContext, pFile);
+		fclose(pFile);
+	}
+
+	free(pIoData->pBootCacheFileName);
+	pIoData->pBootCacheFileName = bRestored ? NULL : pFileName;
+	if(bRestored)
+	{
+		free(pFileName);
+	}
+
+	AtariIo_UpdateSiovTrap(pContext);
+
+	return bRestored;
+}
+
+int AtariIoMountCassette(_6502_Context_t *pContext, const char *pFileName)
+{
+	IoData_t *pIoData = (IoData_t *)pContext->pIoData;
+	Cassette_t *pCassette = NULL;
 
-	AtariIoCycleTimedEventUpdate(pContext);
+	if(pFileName)
+	{
+		pCassette = Cassette_Open(pFileName, ATARI_CPU_HZ_PAL);
+		if(!pCassette)
+		{
+			return 0;
+		}
+	}
+
+	Cassette_Close(pIoData->pCassette);
+	pIoData->pCassette = pCassette;
+
+	/* Rewound: tape time starts over from here. */
+	pIoData->llCassetteTime = 0;
+	pIoData->llCassetteMotorCycle = pContext->llCycleCounter;
+	Pokey_SetCassetteMotor(pContext, pIoData->bCassetteMotor);
+
+	return 1;
 }
 
-void AtariIoOpen(_6502_Context_t *pContext, u32 lMode, char *pDiskFileName)
+void AtariIoOpen(
+	_6502_Context_t *pContext,
+	u32 lMode,
+	char *pDiskFileName,
+	u8 cAudioBackend,
+	const char *pAudioFileName)
 {
 	FILE *pFile;
 	IoInitValue_t *pIoInitValue = m_aIoInitValues;
@@ -5523,6 +6413,12 @@ void AtariIoOpen(_6502_Context_t *pContext, u32 lMode, char *pDiskFileName)
 	memcpy(&RAM[0xd800], pIoData->pFloatingPointRom, 0x2800);
 	AtariIo_CloseFileOrDie(pFile, "ATARIXL.ROM");
 
+	/* Taken before any trap patches them; part of the boot cache key. */
+	pIoData->lRomHash = AtariIo_Hash(BOOT_CACHE_HASH_SEED, pIoData->pBasicRom, 0x2000);
+	pIoData->lRomHash = AtariIo_Hash(pIoData->lRomHash, pIoData->pOsRom, 0x1000);
+	pIoData->lRomHash = AtariIo_Hash(pIoData->lRomHash, pIoData->pSelfTestRom, 0x0800);
+	pIoData->lRomHash = AtariIo_Hash(pIoData->lRomHash, pIoData->pFloatingPointRom, 0x2800);
+
 	_6502_SetRom(pContext, 0xa000, 0xbfff);
 	_6502_SetRom(pContext, 0xc000, 0xcfff);
 	_6502_SetRom(pContext, 0xd000, 0xd7ff);
@@ -5544,7 +6440,14 @@ void AtariIoOpen(_6502_Context_t *pContext, u32 lMode, char *pDiskFileName)
 	pIoData->llTimer1Cycle = CYCLE_NEVER;
 	pIoData->llTimer2Cycle = CYCLE_NEVER;
 	pIoData->llTimer4Cycle = CYCLE_NEVER;
-	AtariIoCycleTimedEventUpdate(pContext);
+	pIoData->llCassetteByteCycle = CYCLE_NEVER;
+	AtariIoRegisterTimedEvent(
+		pContext, TIMED_EVENT_DISPLAY_LIST_FETCH,
+		&pIoData->llDisplayListFetchCycle, 0, AtariIo_DisplayListFetchEvent);
+	AtariIoRegisterTimedEvent(
+		pContext, TIMED_EVENT_DLI, &pIoData->llDliCycle, 1, AtariIo_DliEvent);
+	AtariIoRegisterTimedEvent(
+		pContext, TIMED_EVENT_VBI, &pIoData->llVbiCycle, 1, AtariIo_VbiEvent);
 
 	pIoData->tVideoData.pSdlAtariSurface = pSdlAtariSurface;
 
@@ -5561,79 +6464,148 @@ void AtariIoOpen(_6502_Context_t *pContext, u32 lMode, char *pDiskFileName)
 		pIoInitValue++;
 	}
 
-	pIoData->pDisk1 = (u8 *)malloc(MAX_DISK_SIZE);
-	if(pIoData->pDisk1 == NULL)
+	pIoData->lDiskCommitMilliseconds = DISK_JOURNAL_DEFAULT_MILLISECONDS;
+	AtariIoMountDisk(pContext, 0, pDiskFileName, SIO_WRITE_MEMORY);
+
+	pIoData->tVideoData.pPriorityData = (u8 *)malloc(PIXELS_PER_LINE * LINES_PER_SCREEN_PAL);
+
+	if(pIoData->tVideoData.pPriorityData == NULL)
 	{
-		AtariIo_LogError("A8E: Out of memory allocating disk buffer.\n");
+		AtariIo_LogError("A8E: Out of memory allocating priority buffer.\n");
 		exit(1);
 	}
-	memset(pIoData->pDisk1, 0, MAX_DISK_SIZE);
 
-	if(pDiskFileName)
+	memset(pIoData->tVideoData.pPriorityData, 0, PIXELS_PER_LINE * LINES_PER_SCREEN_PAL);
+
+	AtariIoOnce(&m_tAnticLineTemplatesOnce, AtariIo_BuildLineTemplates);
+
+	pContext->IoCycleTimedEventFunction = AtariIo_CycleTimedEvent;
+	pContext->TrapFunction = AtariIo_Trap;
+
+	srand(AtariIo_GetRandomSeed());
+
+	Pokey_Init(pContext, cAudioBackend, pAudioFileName);
+}
+
+/* ANTIC stub for AtariIoOpenCore: no display list, only the memory
+ * refresh DMA (9 cycles per line, taken as one block at the first refresh
+ * slot) and the line counter behind VCOUNT and WSYNC.
+ */
+#define CORE_REFRESH_CYCLES 9u
+
+static void AtariIo_CoreLineEvent(_6502_Context_t *pContext, u64 llMasterCycle)
+{
+	IoData_t *pIoData = (IoData_t *)pContext->pIoData;
+	u32 lLine = pIoData->tVideoData.lCurrentDisplayLine + 1;
+
+	if(lLine >= LINES_PER_SCREEN_PAL)
 	{
-		pFile = fopen(pDiskFileName, "rb");
+		lLine = 0;
+	}
 
-		if(pFile)
-		{
-			pIoData->lDiskSize = fread(pIoData->pDisk1, 1, MAX_DISK_SIZE, pFile);
-			AtariIo_CloseFileOrWarn(pFile, pDiskFileName);
+	pIoData->tVideoData.lCurrentDisplayLine = lLine;
+	RAM[IO_VCOUNT] = (u8)(lLine >> 1);
 
-			if(IsXexFile(pDiskFileName))
-			{
-				u8 *pXexCopy = (u8 *)malloc(pIoData->lDiskSize);
+	_6502_STALL(CORE_REFRESH_CYCLES);
 
-				if(pXexCopy)
-				{
-					memcpy(pXexCopy, pIoData->pDisk1, pIoData->lDiskSize);
-					if(!XexToAtr(pIoData->pDisk1, &pIoData->lDiskSize,
-								 pXexCopy, pIoData->lDiskSize))
-					{
-						pIoData->lDiskSize = 0;
-						AtariIo_LogError("A8E: Failed to convert XEX to ATR: %s\n",
-										 pDiskFileName);
-					}
-					free(pXexCopy);
-				}
-				else
-				{
-					pIoData->lDiskSize = 0;
-					AtariIo_LogError("A8E: Out of memory converting XEX: %s\n",
-									 pDiskFileName);
-				}
-			}
-#ifdef VERBOSE_SIO
-			printf("Disk name: %s, size = %lu\n", pDiskFileName, pIoData->lDiskSize);
-#endif
-		}
+	AtariIoScheduleTimedEvent(
+		pContext, TIMED_EVENT_DISPLAY_LIST_FETCH,
+		pIoData->llDisplayListFetchCycle + CYCLES_PER_LINE);
+	(void)llMasterCycle;
+}
+
+void AtariIoOpenCore(_6502_Context_t *pContext, u8 cAudioBackend, const char *pAudioFileName)
+{
+	IoInitValue_t *pIoInitValue = m_aIoInitValues;
+	IoData_t *pIoData;
+
+	pIoData = malloc(sizeof(IoData_t));
+	if(pIoData == NULL)
+	{
+		AtariIo_LogError("A8E: Out of memory allocating IO state.\n");
+		exit(1);
 	}
 
-	pIoData->tVideoData.pPriorityData = (u8 *)malloc(PIXELS_PER_LINE * LINES_PER_SCREEN_PAL);
+	pContext->pIoData = pIoData;
+	memset(pIoData, 0, sizeof(IoData_t));
 
-	if(pIoData->tVideoData.pPriorityData == NULL)
+	/* PORTB banking copies these in; blank ROMs keep that harmless. */
+	pIoData->pBasicRom = calloc(1, 0x2000);
+	pIoData->pOsRom = calloc(1, 0x1000);
+	pIoData->pSelfTestRom = calloc(1, 0x0800);
+	pIoData->pFloatingPointRom = calloc(1, 0x2800);
+	if(pIoData->pBasicRom == NULL || pIoData->pOsRom == NULL ||
+	   pIoData->pSelfTestRom == NULL || pIoData->pFloatingPointRom == NULL)
 	{
-		AtariIo_LogError("A8E: Out of memory allocating priority buffer.\n");
+		AtariIo_LogError("A8E: Out of memory allocating ROM buffers.\n");
 		exit(1);
 	}
 
-	memset(pIoData->tVideoData.pPriorityData, 0, PIXELS_PER_LINE * LINES_PER_SCREEN_PAL);
+	pIoData->llDisplayListFetchCycle = pContext->llCycleCounter + REFRESH_FIRST_CYCLE;
+	pIoData->llDliCycle = CYCLE_NEVER;
+	pIoData->llVbiCycle = CYCLE_NEVER;
+	pIoData->llChbasePendingCycle = CYCLE_NEVER;
+	pIoData->tVideoData.lCurrentDisplayLine = LINES_PER_SCREEN_PAL - 1;
+	pIoData->llSerialOutputNeedDataCycle = CYCLE_NEVER;
+	pIoData->llSerialOutputTransmissionDoneCycle = CYCLE_NEVER;
+	pIoData->llSerialInputDataReadyCycle = CYCLE_NEVER;
+	pIoData->llTimer1Cycle = CYCLE_NEVER;
+	pIoData->llTimer2Cycle = CYCLE_NEVER;
+	pIoData->llTimer4Cycle = CYCLE_NEVER;
+	pIoData->llCassetteByteCycle = CYCLE_NEVER;
+	AtariIoRegisterTimedEvent(
+		pContext, TIMED_EVENT_DISPLAY_LIST_FETCH,
+		&pIoData->llDisplayListFetchCycle, 0, AtariIo_CoreLineEvent);
 
-	pContext->IoCycleTimedEventFunction = AtariIo_CycleTimedEvent;
+	while(pIoInitValue->sAddress != 0)
+	{
+		if((pIoInitValue->sAddress & 0xff00) == 0xd200 ||
+		   (pIoInitValue->sAddress & 0xff00) == 0xd300)
+		{
+			SRAM[pIoInitValue->sAddress] = pIoInitValue->cDefaultValueWrite;
+			RAM[pIoInitValue->sAddress] = pIoInitValue->cDefaultValueRead;
 
-	srand(AtariIo_GetRandomSeed());
+			_6502_SetIo(
+				pContext,
+				pIoInitValue->sAddress,
+				pIoInitValue->AccessFunction);
+		}
+
+		pIoInitValue++;
+	}
+
+	_6502_SetIo(pContext, IO_WSYNC, Antic_WSYNC);
+	_6502_SetIo(pContext, IO_VCOUNT, Antic_VCOUNT);
+	_6502_SetIo(pContext, IO_NMIEN, Antic_NMIEN);
+	_6502_SetIo(pContext, IO_NMIRES_NMIST, Antic_NMIRES_NMIST);
+
+	/* All RAM: OS, BASIC and self-test banked out. */
+	SRAM[IO_PORTB] = 0xfe;
+	RAM[IO_PORTB] = 0xfe;
 
-	Pokey_Init(pContext);
+	pContext->IoCycleTimedEventFunction = AtariIo_CycleTimedEvent;
+
+	Pokey_Init(pContext, cAudioBackend, pAudioFileName);
 }
 
 void AtariIoClose(_6502_Context_t *pContext)
 {
 	IoData_t *pIoData = (IoData_t *)pContext->pIoData;
+	u8 cDrive;
 
 	Pokey_Close(pContext);
 
 	SDL_FreeSurface(pIoData->tVideoData.pSdlAtariSurface);
 
 	free(pIoData->tVideoData.pPriorityData);
-	free(pIoData->pDisk1);
+	for(cDrive = 0; cDrive < SIO_DRIVES; cDrive++)
+	{
+		AtariIoUnmountDisk(pContext, cDrive);
+	}
+	Cassette_Close(pIoData->pCassette);
+	HostDevice_Close(pIoData->pHostDevice);
+	free(pIoData->pBasicProgram);
+	free(pIoData->pBootCacheFileName);
 	free(pIoData->pBasicRom);
 	free(pIoData->pOsRom);
 	free(pIoData->pSelfTestRom);
@@ -5808,20 +6780,7 @@ void AtariIoKeyboardEvent(_6502_Context_t *pContext, SDL_KeyboardEvent *pKeyboar
 			break;
 
 		case SDLK_F11: // Insert new disk "D1.ATR"
-		{
-			FILE *pFile;
-
-			pFile = fopen("D1.ATR", "rb");
-
-			if(pFile)
-			{
-				pIoData->lDiskSize = fread(pIoData->pDisk1, 1, MAX_DISK_SIZE, pFile);
-				AtariIo_CloseFileOrWarn(pFile, "D1.ATR");
-#ifdef VERBOSE_SIO
-				printf("Disk name: %s, size = %lu\n", "D1.ATR", pIoData->lDiskSize);
-#endif
-			}
-		}
+			AtariIoMountDisk(pContext, 0, "D1.ATR", SIO_WRITE_MEMORY);
 
 		break;
 
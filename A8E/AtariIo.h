@@ -16,6 +16,9 @@
 #include <SDL2/SDL.h>
 
 #include "6502.h"
+#include "Cassette.h"
+#include "DiskJournal.h"
+#include "HostDevice.h"
 
 /********************************************************************
 *
@@ -53,6 +56,48 @@
 
 #define CYCLE_NEVER 0xffffffffffffffffLL
 
+/* Timed events; events due in the same dispatch run in this order. */
+typedef enum
+{
+	TIMED_EVENT_DISPLAY_LIST_FETCH,
+	TIMED_EVENT_DLI,
+	TIMED_EVENT_VBI,
+	TIMED_EVENT_SERIAL_OUTPUT_TRANSMISSION_DONE,
+	TIMED_EVENT_SERIAL_OUTPUT_NEED_DATA,
+	TIMED_EVENT_SERIAL_INPUT_DATA_READY,
+	TIMED_EVENT_TIMER_1,
+	TIMED_EVENT_TIMER_2,
+	TIMED_EVENT_TIMER_4,
+	TIMED_EVENT_CASSETTE_BYTE,
+	TIMED_EVENT_COUNT
+} TimedEventId_t;
+
+#define TIMED_EVENT_NOT_QUEUED 0xff
+
+/* llClockCycle is the beam cycle for beam-clock events, otherwise the
+ * master cycle, both sampled when the dispatch started.
+ */
+typedef void (*TimedEventHandler_t)(_6502_Context_t *pContext, u64 llClockCycle);
+
+typedef struct
+{
+	u64 *pCycle;
+	TimedEventHandler_t Handler;
+	u8 bBeamClock;
+	u8 cHeapSlot;
+} TimedEvent_t;
+
+typedef struct
+{
+	u8 aEvents[TIMED_EVENT_COUNT];
+	u8 cCount;
+} TimedEventHeap_t;
+
+/* One bit per cycle of a scanline */
+#define LINE_CYCLE_MASK_WORDS ((CYCLES_PER_LINE + 63) / 64)
+#define LINE_CYCLE_MASK_SET(aMask, lCycle) ((aMask)[(lCycle) >> 6] |= 1ULL << ((lCycle) & 63))
+#define LINE_CYCLE_MASK_TEST(aMask, lCycle) (((aMask)[(lCycle) >> 6] >> ((lCycle) & 63)) & 1)
+
 #define CONSOL_HACK
 
 #define SERIAL_OUTPUT_DATA_NEEDED_CYCLES 900
@@ -72,6 +117,13 @@
 #define MIN(a, b) ((a) < (b) ? (a) : (b))
 #define MAX(a, b) ((a) > (b) ? (a) : (b))
 
+/* Guard of a table shared by all machines (AtariIoOnce); zero = not built. */
+typedef struct
+{
+	SDL_atomic_t tDone;
+	SDL_SpinLock tLock;
+} AtariIoOnce_t;
+
 typedef struct
 {
 	u32 lCurrentDisplayLine;
@@ -96,9 +148,40 @@ typedef struct
 	u8 aMissilePmgShift[4];
 	u8 aMissilePmgState[4];
 	u8 aPlayfieldLineBuffer[48];
-	u8 aScheduledPlayfieldDma[CYCLES_PER_LINE];
+
+	/* Playfield DMA steal cycles of the current line. The template holds
+	 * every cycle the mode line may fetch on (looked up at line start);
+	 * the scheduled mask the fetches that were actually granted.
+	 */
+	u64 aPlayfieldDmaTemplate[LINE_CYCLE_MASK_WORDS];
+	u64 aScheduledPlayfieldDma[LINE_CYCLE_MASK_WORDS];
+
+	/* Line cycles [lQuietFromCycle, lQuietUntilCycle) have no DMA, refresh,
+	 * VCOUNT, DLI or VSCROL work; only the CPU and PMG advance there.
+	 */
+	u32 lQuietFromCycle;
+	u32 lQuietUntilCycle;
 } DrawLineData_t;
 
+#define SIO_DRIVES 8
+
+/* What sector writes do to the image file (AtariIoMountDisk). */
+#define SIO_WRITE_MEMORY 0 /* nothing; they stay in memory */
+#define SIO_WRITE_THROUGH 1 /* land in the file via a shared mapping */
+#define SIO_WRITE_BACK 2 /* are journaled and committed by a thread */
+
+/* A mounted D1:-D8: image: the 16-byte ATR header, then the sectors. */
+typedef struct
+{
+	u8 *pImage;
+	u32 lSize;
+	u16 sSectorSize;
+	u8 bMapped; /* pImage is a mapping of the file, else malloced */
+	u8 bWriteThrough; /* sector writes reach the file */
+	DiskJournal_t *pJournal; /* SIO_WRITE_BACK, else NULL */
+	u8 bXexDirect; /* boot sector loads the XEX through traps */
+} SioDrive_t;
+
 typedef struct
 {
 	u64 llCycle;
@@ -111,6 +194,15 @@ typedef struct
 	u64 llTimer1Cycle;
 	u64 llTimer2Cycle;
 	u64 llTimer4Cycle;
+	u64 llCassetteByteCycle;
+
+	/* Armed timed events as min-heaps keyed by their cycle field, one per
+	 * clock domain; the heap roots feed the 6502 context's event cycles.
+	 */
+	TimedEvent_t aTimedEvents[TIMED_EVENT_COUNT];
+	TimedEventHeap_t tMasterEventHeap;
+	TimedEventHeap_t tBeamEventHeap;
+
 	u8 bInDrawLine;
 	u8 cNmienEnabledByCycle7;
 	u8 cNmienEnabledByCycle8;
@@ -149,6 +241,12 @@ typedef struct
 	VideoData_t tVideoData;
 	DrawLineData_t tDrawLineData;
 
+	/* Collision bits (PRIO_* masks) seen by each player/missile since the
+	 * last collision register read; folded into M0PF..P3PL on demand.
+	 */
+	u8 aPlayerCollision[4];
+	u8 aMissileCollision[4];
+
 	u32 lKeyPressCounter;
 	u8 cJoystickArrowMask;
 
@@ -160,19 +258,141 @@ typedef struct
 	u8 aPotValues[8]; /* target values per pot (set by input layer) */
 	u8 aPotLatched[8]; /* 1 = latched at target */
 
-	u8 *pDisk1;
-	u32 lDiskSize;
+	/* poly17 position for RANDOM while POKEY has no audio state. */
+	u32 lStandalonePoly17Pos;
+
+	/* The fields from here on belong to the run rather than the machine:
+	   media, host resources and traps. Restoring a boot snapshot
+	   (AtariIoSetBootCache) keeps them as they are. */
+	SioDrive_t aDrives[SIO_DRIVES];
+	u32 lDiskCommitMilliseconds;
+
+	/* Direct XEX loading: enabled for the next D1: mount, and the image
+	   offset of the next segment. */
+	u8 bXexDirect;
+	u32 lXexOffset;
+
+	/* C: tape and its motor (PIA CA2). Tape time only runs while the motor
+	   does: it was llCassetteTime when the motor last started or stopped
+	   at llCassetteMotorCycle. cCassetteByte is the byte whose end is
+	   scheduled as TIMED_EVENT_CASSETTE_BYTE. */
+	Cassette_t *pCassette;
+	u8 bCassetteMotor;
+	u64 llCassetteTime;
+	u64 llCassetteMotorCycle;
+	u8 cCassetteByte;
+
+	/* SIOV trap: the OS entry holds a trap opcode instead of its JMP while
+	   the disk patch or fast cassette loading (bCassetteFast) is on. */
+	u8 bSioPatch;
+	u8 bCassetteFast;
+	u8 bSiovTrap;
+	u8 cSiovOpcode;
+
+	/* H: device. While bCiovTrap is set the OS CIOV entry holds two trap
+	   opcodes: the first for CIO calls, the second for the put byte vector
+	   of H: channels. sCioTarget is the address the JMP there went to. */
+	HostDevice_t *pHostDevice;
+	u8 bCiovTrap;
+	u8 aCiovBytes[2];
+	u16 sCioTarget;
+
+	/* SAVEd BASIC program put in memory, and RUN if bBasicRun, when BASIC
+	   first reads a line; the CIOV trap is on until then. */
+	u8 *pBasicProgram;
+	u8 bBasicRun;
+
+	/* POKEY_SIO_DRIVE_x emulated on every drive. */
+	u8 cSioDriveModel;
 
 	u8 *pBasicRom;
 	u8 *pOsRom;
 	u8 *pSelfTestRom;
 	u8 *pFloatingPointRom;
+
+	/* Boot cache: the snapshot file written at the next SIOV call while
+	   set, and a hash of the ROM images as loaded, which names it. */
+	char *pBootCacheFileName;
+	u32 lRomHash;
 } IoData_t;
 
-void AtariIoOpen(_6502_Context_t *pContext, u32 lMode, char *pDiskFileName);
+/* cAudioBackend and pAudioFileName go to Pokey_Init and only concern
+   this machine. */
+void AtariIoOpen(
+	_6502_Context_t *pContext,
+	u32 lMode,
+	char *pDiskFileName,
+	u8 cAudioBackend,
+	const char *pAudioFileName);
+
+/* Opens a machine with only PIA and POKEY behind the CPU, all RAM and no
+   ROMs. ANTIC is a stub that steals refresh cycles and counts lines for
+   VCOUNT and WSYNC; there is no GTIA and no video. */
+void AtariIoOpenCore(_6502_Context_t *pContext, u8 cAudioBackend, const char *pAudioFileName);
 void AtariIoClose(_6502_Context_t *pContext);
 
+/* Mounts an ATR (or XEX, converted to a boot disk) on drive cDrive, 0 for
+   D1: to 7 for D8:. ATR files are mapped rather than read; cWriteMode
+   (SIO_WRITE_x) decides whether sector writes reach the file. XEX disks
+   always keep them in memory. Returns 1 on success. */
+int AtariIoMountDisk(_6502_Context_t *pContext, u8 cDrive, const char *pFileName, u8 cWriteMode);
+
+/* XEX files mounted on D1: from now on load their segments straight into
+   memory, without SIO, once the OS boots them. Off by default. */
+void AtariIoSetXexDirect(_6502_Context_t *pContext, u8 bEnable);
+
+/* Puts a CAS image in the cassette recorder, rewound; NULL just takes the
+   tape out. Returns 1 on success. */
+int AtariIoMountCassette(_6502_Context_t *pContext, const char *pFileName);
+
+/* Serves the OS cassette record reads (SIO device $60) through the SIOV
+   trap straight from the tape, instead of playing it in real time. Off by
+   default. */
+void AtariIoSetCassetteFast(_6502_Context_t *pContext, u8 bEnable);
+
+/* Serves H: from the host directory pDirectory through a trap in the OS
+   CIOV entry; NULL takes H: away again. Closes what H: had open. Returns 1
+   on success. */
+int AtariIoSetHostDirectory(_6502_Context_t *pContext, const char *pDirectory);
+
+/* Loads a tokenized (SAVEd) BASIC program. Once BASIC has started and
+   asks for its first line, with its ROM banked in through PORTB, the
+   program goes straight to LOMEM with VNTP to STARP set as LOAD would,
+   and with bRun that line is RUN. Returns 1 if the file is a BASIC
+   program. */
+int AtariIoLoadBasic(_6502_Context_t *pContext, const char *pFileName, u8 bRun);
+
+/* Cold starts from a snapshot in pDirectory, called right after
+   _6502_Reset. The snapshot holds the machine as the OS left it at its
+   first SIOV call, before it boots anything, and is kept per ROM set,
+   BASIC option and build. If there is one, the machine is restored from it
+   with the media of this run attached and 1 is returned; otherwise the
+   snapshot is written when the OS gets there and 0 is returned. */
+u8 AtariIoSetBootCache(_6502_Context_t *pContext, const char *pDirectory);
+
+/* Commit interval of SIO_WRITE_BACK journals mounted from now on. */
+void AtariIoSetDiskCommitInterval(_6502_Context_t *pContext, u32 lMilliseconds);
+void AtariIoUnmountDisk(_6502_Context_t *pContext, u8 cDrive);
+
+/* Patches the OS SIOV entry so D1:-D8: requests are carried out directly
+   against the disk images instead of byte by byte over SIO. Off by default;
+   copy-protected titles that time or inspect SIO need it off. */
+void AtariIoSetSioPatch(_6502_Context_t *pContext, u8 bEnable);
+
+/* Calls Build the first time pOnce is passed in. Machines may be opened on
+   several threads; those arriving meanwhile wait until Build has returned. */
+void AtariIoOnce(AtariIoOnce_t *pOnce, void (*Build)(void));
+
+void AtariIoRegisterTimedEvent(
+	_6502_Context_t *pContext,
+	TimedEventId_t eEvent,
+	u64 *pCycle,
+	u8 bBeamClock,
+	TimedEventHandler_t Handler);
+void AtariIoScheduleTimedEvent(_6502_Context_t *pContext, TimedEventId_t eEvent, u64 llCycle);
+void AtariIoCancelTimedEvent(_6502_Context_t *pContext, TimedEventId_t eEvent);
 void AtariIoCycleTimedEventUpdate(_6502_Context_t *pContext);
+void AtariIoUpdateCollisions(_6502_Context_t *pContext);
 void AtariIoStatus(_6502_Context_t *pContext);
 
 #ifdef A8E_ENABLE_TEST_PROBES
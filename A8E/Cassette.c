@@ -0,0 +1,342 @@
+/********************************************************************
+*
+*
+*
+* Cassette Player
+*
+* (c) 2004 Sascha Springer
+*
+*
+*
+********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "6502.h"
+#include "Cassette.h"
+
+/********************************************************************
+*
+*
+* Definitionen
+*
+*
+********************************************************************/
+
+#define CASSETTE_CHUNK_HEADER_SIZE 8u
+
+/* Start bit, eight data bits (LSB first), stop bit. */
+#define CASSETTE_BITS_PER_BYTE 10u
+
+/* "fsk " chunk pulses are given in tenths of a millisecond. */
+#define CASSETTE_FSK_UNITS_PER_SECOND 10000u
+
+/* A "data" or "fsk " chunk as it plays: the gap, then its bits. */
+typedef struct
+{
+	u64 llStart;
+	u64 llDataStart;
+	u64 llEnd;
+	u32 lOffset; /* of the chunk data in pImage */
+	u16 sLength; /* bytes, or for fsk twice the pulse count */
+	u32 lBitCycles; /* data chunks only */
+	u8 bFsk;
+} CassetteBlock_t;
+
+struct Cassette
+{
+	u8 *pImage;
+	u32 lSize;
+	u32 lCyclesPerSecond;
+
+	CassetteBlock_t *pBlocks;
+	u32 lBlockCount;
+
+	/* Last block looked up; tape time mostly moves forward from there. */
+	u32 lHint;
+};
+
+/********************************************************************
+*
+*
+* Funktionen
+*
+*
+********************************************************************/
+
+static u16 Cassette_GetLe16(const u8 *pBuffer)
+{
+	return (u16)(pBuffer[0] | (pBuffer[1] << 8));
+}
+
+static u64 Cassette_FskPulseCycles(Cassette_t *pCassette, const u8 *pPulse)
+{
+	return (u64)Cassette_GetLe16(pPulse) * pCassette->lCyclesPerSecond / CASSETTE_FSK_UNITS_PER_SECOND;
+}
+
+static int Cassette_AddBlock(Cassette_t *pCassette, CassetteBlock_t *pBlock)
+{
+	CassetteBlock_t *pBlocks;
+
+	if((pCassette->lBlockCount & (pCassette->lBlockCount - 1)) == 0)
+	{
+		pBlocks = (CassetteBlock_t *)realloc(
+			pCassette->pBlocks, (pCassette->lBlockCount ? pCassette->lBlockCount * 2 : 1) * sizeof(CassetteBlock_t));
+		if(!pBlocks)
+		{
+			return 0;
+		}
+
+		pCassette->pBlocks = pBlocks;
+	}
+
+	pCassette->pBlocks[pCassette->lBlockCount++] = *pBlock;
+
+	return 1;
+}
+
+/* Lays the chunks out on the tape. Returns 0 on a malformed image. */
+static int Cassette_Parse(Cassette_t *pCassette)
+{
+	u8 *pImage = pCassette->pImage;
+	u32 lOffset = 0;
+	u32 lBaud = CASSETTE_DEFAULT_BAUD;
+	u64 llTime = 0;
+
+	if(pCassette->lSize < CASSETTE_CHUNK_HEADER_SIZE || memcmp(pImage, "FUJI", 4) != 0)
+	{
+		return 0;
+	}
+
+	while(lOffset + CASSETTE_CHUNK_HEADER_SIZE <= pCassette->lSize)
+	{
+		u8 *pChunk = &pImage[lOffset];
+		u16 sLength = Cassette_GetLe16(&pChunk[4]);
+		u16 sAux = Cassette_GetLe16(&pChunk[6]);
+		CassetteBlock_t tBlock;
+
+		if(lOffset + CASSETTE_CHUNK_HEADER_SIZE + sLength > pCassette->lSize)
+		{
+			break;
+		}
+
+		if(memcmp(pChunk, "baud", 4) == 0 && sAux != 0)
+		{
+			lBaud = sAux;
+		}
+		else if(memcmp(pChunk, "data", 4) == 0 || memcmp(pChunk, "fsk ", 4) == 0)
+		{
+			memset(&tBlock, 0, sizeof(tBlock));
+			tBlock.llStart = llTime;
+			tBlock.llDataStart = llTime + (u64)sAux * pCassette->lCyclesPerSecond / 1000u;
+			tBlock.lOffset = lOffset + CASSETTE_CHUNK_HEADER_SIZE;
+			tBlock.sLength = sLength;
+			tBlock.bFsk = pChunk[0] == 'f';
+			tBlock.llEnd = tBlock.llDataStart;
+
+			if(tBlock.bFsk)
+			{
+				u32 lPulse;
+
+				tBlock.sLength &= ~1u;
+				for(lPulse = 0; lPulse < tBlock.sLength; lPulse += 2)
+				{
+					tBlock.llEnd += Cassette_FskPulseCycles(pCassette, &pImage[tBlock.lOffset + lPulse]);
+				}
+			}
+			else
+			{
+				tBlock.lBitCycles = (pCassette->lCyclesPerSecond + lBaud / 2) / lBaud;
+				tBlock.llEnd += (u64)sLength * CASSETTE_BITS_PER_BYTE * tBlock.lBitCycles;
+			}
+
+			if(!Cassette_AddBlock(pCassette, &tBlock))
+			{
+				return 0;
+			}
+
+			llTime = tBlock.llEnd;
+		}
+
+		/* "FUJI" (the description) and unknown chunks take no tape time. */
+		lOffset += CASSETTE_CHUNK_HEADER_SIZE + sLength;
+	}
+
+	return 1;
+}
+
+Cassette_t *Cassette_Open(const char *pFileName, u32 lCyclesPerSecond)
+{
+	Cassette_t *pCassette;
+	FILE *pFile = fopen(pFileName, "rb");
+	long lSize;
+
+	if(!pFile)
+	{
+		return NULL;
+	}
+
+	pCassette = (Cassette_t *)calloc(1, sizeof(Cassette_t));
+	fseek(pFile, 0, SEEK_END);
+	lSize = ftell(pFile);
+	fseek(pFile, 0, SEEK_SET);
+
+	if(pCassette && lSize > 0)
+	{
+		pCassette->pImage = (u8 *)malloc((size_t)lSize);
+		pCassette->lSize = (u32)lSize;
+		pCassette->lCyclesPerSecond = lCyclesPerSecond;
+	}
+
+	if(!pCassette || !pCassette->pImage ||
+	   fread(pCassette->pImage, 1, (size_t)lSize, pFile) != (size_t)lSize ||
+	   !Cassette_Parse(pCassette))
+	{
+		fclose(pFile);
+		Cassette_Close(pCassette);
+
+		return NULL;
+	}
+
+	fclose(pFile);
+
+	return pCassette;
+}
+
+void Cassette_Close(Cassette_t *pCassette)
+{
+	if(!pCassette)
+	{
+		return;
+	}
+
+	free(pCassette->pBlocks);
+	free(pCassette->pImage);
+	free(pCassette);
+}
+
+/* Index of the first block that has not ended by llTime, or lBlockCount. */
+static u32 Cassette_FindBlock(Cassette_t *pCassette, u64 llTime)
+{
+	u32 lBlock = pCassette->lHint;
+
+	if(lBlock >= pCassette->lBlockCount || pCassette->pBlocks[lBlock].llStart > llTime)
+	{
+		lBlock = 0;
+	}
+
+	while(lBlock < pCassette->lBlockCount && pCassette->pBlocks[lBlock].llEnd <= llTime)
+	{
+		lBlock++;
+	}
+
+	pCassette->lHint = lBlock;
+
+	return lBlock;
+}
+
+u8 Cassette_Level(Cassette_t *pCassette, u64 llTime)
+{
+	u32 lBlock = Cassette_FindBlock(pCassette, llTime);
+	CassetteBlock_t *pBlock;
+	const u8 *pData;
+	u64 llOffset;
+	u32 lBit;
+
+	if(lBlock == pCassette->lBlockCount || pCassette->pBlocks[lBlock].llDataStart > llTime)
+	{
+		return 1;
+	}
+
+	pBlock = &pCassette->pBlocks[lBlock];
+	pData = &pCassette->pImage[pBlock->lOffset];
+	llOffset = llTime - pBlock->llDataStart;
+
+	if(pBlock->bFsk)
+	{
+		u32 lPulse;
+
+		/* Pulses alternate between space and mark, space first. */
+		for(lPulse = 0; lPulse < pBlock->sLength; lPulse += 2)
+		{
+			u64 llPulseCycles = Cassette_FskPulseCycles(pCassette, &pData[lPulse]);
+
+			if(llOffset < llPulseCycles)
+			{
+				return (u8)((lPulse >> 1) & 1);
+			}
+
+			llOffset -= llPulseCycles;
+		}
+
+		return 1;
+	}
+
+	lBit = (u32)(llOffset / pBlock->lBitCycles);
+	switch(lBit % CASSETTE_BITS_PER_BYTE)
+	{
+	case 0:
+		return 0;
+
+	case CASSETTE_BITS_PER_BYTE - 1:
+		return 1;
+
+	default:
+		return (pData[lBit / CASSETTE_BITS_PER_BYTE] >> (lBit % CASSETTE_BITS_PER_BYTE - 1)) & 1;
+	}
+}
+
+int Cassette_NextByte(Cassette_t *pCassette, u64 llTime, u8 *pValue, u64 *pEndTime)
+{
+	u32 lBlock;
+
+	for(lBlock = Cassette_FindBlock(pCassette, llTime); lBlock < pCassette->lBlockCount; lBlock++)
+	{
+		CassetteBlock_t *pBlock = &pCassette->pBlocks[lBlock];
+		u64 llByteCycles = (u64)pBlock->lBitCycles * CASSETTE_BITS_PER_BYTE;
+		u32 lByte = 0;
+
+		if(pBlock->bFsk || pBlock->sLength == 0)
+		{
+			continue;
+		}
+
+		if(llTime >= pBlock->llDataStart)
+		{
+			lByte = (u32)((llTime - pBlock->llDataStart) / llByteCycles);
+		}
+
+		if(lByte < pBlock->sLength)
+		{
+			*pValue = pCassette->pImage[pBlock->lOffset + lByte];
+			*pEndTime = pBlock->llDataStart + (lByte + 1) * llByteCycles;
+
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+int Cassette_NextRecord(Cassette_t *pCassette, u64 llTime, const u8 **ppData, u32 *pLength, u64 *pEndTime)
+{
+	u32 lBlock;
+
+	for(lBlock = Cassette_FindBlock(pCassette, llTime); lBlock < pCassette->lBlockCount; lBlock++)
+	{
+		CassetteBlock_t *pBlock = &pCassette->pBlocks[lBlock];
+
+		if(!pBlock->bFsk && pBlock->sLength != 0)
+		{
+			*ppData = &pCassette->pImage[pBlock->lOffset];
+			*pLength = pBlock->sLength;
+			*pEndTime = pBlock->llEnd;
+
+			return 1;
+		}
+	}
+
+	return 0;
+}
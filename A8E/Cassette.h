@@ -0,0 +1,52 @@
+/********************************************************************
+*
+*
+*
+* Cassette Player
+*
+* (c) 2004 Sascha Springer
+*
+*
+*
+********************************************************************/
+
+#ifndef _CASSETTE_H_
+#define _CASSETTE_H_
+
+#include "6502.h"
+
+/********************************************************************
+*
+*
+* Definitionen
+*
+*
+********************************************************************/
+
+/* Baud rate of data chunks before the first "baud" chunk. */
+#define CASSETTE_DEFAULT_BAUD 600u
+
+typedef struct Cassette Cassette_t;
+
+/* Loads a CAS image. Tape time is counted in units of 1/lCyclesPerSecond
+   from the start of the tape; every data record is played at the baud
+   rate of the last "baud" chunk before it, after the inter-record gap its
+   chunk gives. Returns NULL if the file cannot be read or is no CAS. */
+Cassette_t *Cassette_Open(const char *pFileName, u32 lCyclesPerSecond);
+void Cassette_Close(Cassette_t *pCassette);
+
+/* Level of the data line at llTime: 1 (mark) in gaps and after the end,
+   else the start, data and stop bits of the record bytes, or the pulses
+   of an "fsk " chunk. */
+u8 Cassette_Level(Cassette_t *pCassette, u64 llTime);
+
+/* The first record byte whose stop bit ends after llTime: stores its value
+   and that end time. Returns 0 past the last byte. */
+int Cassette_NextByte(Cassette_t *pCassette, u64 llTime, u8 *pValue, u64 *pEndTime);
+
+/* The first data record that has not been played to its end by llTime:
+   stores its bytes, its length and the time its last byte ends. Returns 0
+   past the last record. */
+int Cassette_NextRecord(Cassette_t *pCassette, u64 llTime, const u8 **ppData, u32 *pLength, u64 *pEndTime);
+
+#endif
@@ -0,0 +1,360 @@
+/********************************************************************
+*
+*
+*
+* Disk Write-Back Journal
+*
+* (c) 2004 Sascha Springer
+*
+*
+*
+********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <SDL2/SDL.h>
+
+#ifdef _WIN32
+#include <io.h>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "6502.h"
+#include "DiskJournal.h"
+
+/********************************************************************
+*
+*
+* Definitionen
+*
+*
+********************************************************************/
+
+#define DISK_JOURNAL_POLL_MILLISECONDS 10
+#define DISK_JOURNAL_INITIAL_BYTES 4096u
+
+typedef struct
+{
+	u32 lOffset;
+	u32 lBytes;
+} DiskJournalRecord_t;
+
+/* Records and their data, appended back to back. */
+typedef struct
+{
+	u8 *pBuffer;
+	u32 lUsed;
+	u32 lCapacity;
+} DiskJournalBatch_t;
+
+struct DiskJournal
+{
+	char *pFileName;
+	char *pTempFileName;
+	u32 lCommitMilliseconds;
+
+	/* The thread's copy of the image, brought up to date batch by batch. */
+	u8 *pShadow;
+	u32 lSize;
+
+	/* Filled by the emulation thread; the thread swaps it out under the
+	   mutex and does all file work with the mutex released. */
+	SDL_mutex *pMutex;
+	DiskJournalBatch_t tPending;
+	u32 lFirstPendingTicks;
+
+	SDL_Thread *pThread;
+	SDL_atomic_t tQuit;
+	SDL_atomic_t tCommits;
+};
+
+/********************************************************************
+*
+*
+* Funktionen
+*
+*
+********************************************************************/
+
+static int DiskJournal_Append(DiskJournalBatch_t *pBatch, const DiskJournalRecord_t *pRecord, const u8 *pData)
+{
+	u32 lNeeded = pBatch->lUsed + (u32)sizeof(DiskJournalRecord_t) + pRecord->lBytes;
+
+	if(lNeeded > pBatch->lCapacity)
+	{
+		u32 lCapacity = pBatch->lCapacity ? pBatch->lCapacity : DISK_JOURNAL_INITIAL_BYTES;
+		u8 *pBuffer;
+
+		while(lCapacity < lNeeded)
+		{
+			lCapacity *= 2;
+		}
+
+		pBuffer = (u8 *)realloc(pBatch->pBuffer, lCapacity);
+		if(!pBuffer)
+		{
+			return 0;
+		}
+
+		pBatch->pBuffer = pBuffer;
+		pBatch->lCapacity = lCapacity;
+	}
+
+	memcpy(pBatch->pBuffer + pBatch->lUsed, pRecord, sizeof(DiskJournalRecord_t));
+	memcpy(pBatch->pBuffer + pBatch->lUsed + sizeof(DiskJournalRecord_t), pData, pRecord->lBytes);
+	pBatch->lUsed = lNeeded;
+
+	return 1;
+}
+
+/* Later records overwrite earlier ones, so the shadow ends up as the
+   emulation thread's image was when the batch was taken. */
+static void DiskJournal_Apply(DiskJournal_t *pJournal, const DiskJournalBatch_t *pBatch)
+{
+	u32 lIndex = 0;
+
+	while(lIndex + sizeof(DiskJournalRecord_t) <= pBatch->lUsed)
+	{
+		DiskJournalRecord_t tRecord;
+
+		memcpy(&tRecord, pBatch->pBuffer + lIndex, sizeof(tRecord));
+		lIndex += sizeof(tRecord);
+
+		memcpy(pJournal->pShadow + tRecord.lOffset, pBatch->pBuffer + lIndex, tRecord.lBytes);
+		lIndex += tRecord.lBytes;
+	}
+}
+
+static int DiskJournal_SyncFile(FILE *pFile)
+{
+	if(fflush(pFile) != 0)
+	{
+		return 0;
+	}
+
+#ifdef _WIN32
+	return _commit(_fileno(pFile)) == 0;
+#else
+	return fsync(fileno(pFile)) == 0;
+#endif
+}
+
+/* Makes the rename itself durable. */
+static void DiskJournal_SyncDirectory(const char *pFileName)
+{
+#ifndef _WIN32
+	char *pDirectory = strdup(pFileName);
+	char *pSlash;
+	int lDirectory;
+
+	if(!pDirectory)
+	{
+		return;
+	}
+
+	pSlash = strrchr(pDirectory, '/');
+	if(pSlash)
+	{
+		pSlash[pSlash == pDirectory ? 1 : 0] = 0;
+	}
+	else
+	{
+		strcpy(pDirectory, ".");
+	}
+
+	lDirectory = open(pDirectory, O_RDONLY);
+	if(lDirectory >= 0)
+	{
+		fsync(lDirectory);
+		close(lDirectory);
+	}
+
+	free(pDirectory);
+#else
+	(void)pFileName;
+#endif
+}
+
+/* Writes the shadow to the temporary file and renames it over the image. */
+static int DiskJournal_Commit(DiskJournal_t *pJournal)
+{
+	FILE *pFile = fopen(pJournal->pTempFileName, "wb");
+	int bOk;
+
+	if(!pFile)
+	{
+		fprintf(stderr, "A8E: Cannot write %s: %s\n", pJournal->pTempFileName, strerror(errno));
+		return 0;
+	}
+
+	bOk = fwrite(pJournal->pShadow, 1, pJournal->lSize, pFile) == pJournal->lSize &&
+		  DiskJournal_SyncFile(pFile);
+	bOk = fclose(pFile) == 0 && bOk;
+
+#ifdef _WIN32
+	bOk = bOk && MoveFileExA(pJournal->pTempFileName, pJournal->pFileName,
+							 MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+#else
+	bOk = bOk && rename(pJournal->pTempFileName, pJournal->pFileName) == 0;
+#endif
+
+	if(!bOk)
+	{
+		fprintf(stderr, "A8E: Failed to commit %s: %s\n", pJournal->pFileName, strerror(errno));
+		remove(pJournal->pTempFileName);
+		return 0;
+	}
+
+	DiskJournal_SyncDirectory(pJournal->pFileName);
+	SDL_AtomicAdd(&pJournal->tCommits, 1);
+
+	return 1;
+}
+
+static int SDLCALL DiskJournal_Thread(void *pData)
+{
+	DiskJournal_t *pJournal = (DiskJournal_t *)pData;
+	DiskJournalBatch_t tBatch;
+	u8 bDirty = 0;
+
+	memset(&tBatch, 0, sizeof(tBatch));
+
+	while(1)
+	{
+		/* Sample the quit flag first so the last batch holds every write. */
+		int bQuit = SDL_AtomicGet(&pJournal->tQuit);
+		u8 bTake;
+
+		SDL_LockMutex(pJournal->pMutex);
+		bTake = pJournal->tPending.lUsed != 0 &&
+				(bQuit || SDL_GetTicks() - pJournal->lFirstPendingTicks >= pJournal->lCommitMilliseconds);
+		if(bTake)
+		{
+			DiskJournalBatch_t tSwap = pJournal->tPending;
+
+			pJournal->tPending = tBatch;
+			pJournal->tPending.lUsed = 0;
+			tBatch = tSwap;
+		}
+		SDL_UnlockMutex(pJournal->pMutex);
+
+		if(bTake)
+		{
+			DiskJournal_Apply(pJournal, &tBatch);
+			bDirty = 1;
+		}
+
+		/* A failed commit is retried with the next batch. */
+		if(bDirty && (bTake || bQuit) && DiskJournal_Commit(pJournal))
+		{
+			bDirty = 0;
+		}
+
+		if(bQuit)
+		{
+			break;
+		}
+
+		SDL_Delay(DISK_JOURNAL_POLL_MILLISECONDS);
+	}
+
+	free(tBatch.pBuffer);
+
+	return 0;
+}
+
+DiskJournal_t *DiskJournal_Open(const char *pFileName, const u8 *pImage, u32 lSize, u32 lCommitMilliseconds)
+{
+	DiskJournal_t *pJournal = (DiskJournal_t *)calloc(1, sizeof(DiskJournal_t));
+	size_t lNameLength = strlen(pFileName);
+
+	if(!pJournal)
+	{
+		return NULL;
+	}
+
+	pJournal->pFileName = (char *)malloc(lNameLength + 1);
+	pJournal->pTempFileName = (char *)malloc(lNameLength + 5);
+	pJournal->pShadow = (u8 *)malloc(lSize);
+	pJournal->pMutex = SDL_CreateMutex();
+	if(!pJournal->pFileName || !pJournal->pTempFileName || !pJournal->pShadow || !pJournal->pMutex)
+	{
+		DiskJournal_Close(pJournal);
+		return NULL;
+	}
+
+	strcpy(pJournal->pFileName, pFileName);
+	sprintf(pJournal->pTempFileName, "%s.tmp", pFileName);
+	memcpy(pJournal->pShadow, pImage, lSize);
+	pJournal->lSize = lSize;
+	pJournal->lCommitMilliseconds = lCommitMilliseconds;
+
+	pJournal->pThread = SDL_CreateThread(DiskJournal_Thread, "Disk journal", pJournal);
+	if(!pJournal->pThread)
+	{
+		DiskJournal_Close(pJournal);
+		return NULL;
+	}
+
+	return pJournal;
+}
+
+void DiskJournal_Close(DiskJournal_t *pJournal)
+{
+	if(!pJournal)
+	{
+		return;
+	}
+
+	if(pJournal->pThread)
+	{
+		SDL_AtomicSet(&pJournal->tQuit, 1);
+		SDL_WaitThread(pJournal->pThread, NULL);
+	}
+
+	if(pJournal->pMutex)
+	{
+		SDL_DestroyMutex(pJournal->pMutex);
+	}
+
+	free(pJournal->tPending.pBuffer);
+	free(pJournal->pShadow);
+	free(pJournal->pTempFileName);
+	free(pJournal->pFileName);
+	free(pJournal);
+}
+
+void DiskJournal_Write(DiskJournal_t *pJournal, u32 lOffset, const u8 *pData, u32 lBytes)
+{
+	DiskJournalRecord_t tRecord;
+
+	if(lOffset + lBytes > pJournal->lSize)
+	{
+		return;
+	}
+
+	tRecord.lOffset = lOffset;
+	tRecord.lBytes = lBytes;
+
+	SDL_LockMutex(pJournal->pMutex);
+	if(pJournal->tPending.lUsed == 0)
+	{
+		pJournal->lFirstPendingTicks = SDL_GetTicks();
+	}
+
+	if(!DiskJournal_Append(&pJournal->tPending, &tRecord, pData))
+	{
+		fprintf(stderr, "A8E: Out of memory journaling %s.\n", pJournal->pFileName);
+	}
+	SDL_UnlockMutex(pJournal->pMutex);
+}
+
+u32 DiskJournal_Commits(DiskJournal_t *pJournal)
+{
+	return (u32)SDL_AtomicGet(&pJournal->tCommits);
+}
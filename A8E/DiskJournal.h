@@ -0,0 +1,48 @@
+/********************************************************************
+*
+*
+*
+* Disk Write-Back Journal
+*
+* (c) 2004 Sascha Springer
+*
+*
+*
+********************************************************************/
+
+#ifndef _DISKJOURNAL_H_
+#define _DISKJOURNAL_H_
+
+#include "6502.h"
+
+/********************************************************************
+*
+*
+* Definitionen
+*
+*
+********************************************************************/
+
+/* Commit interval used when the caller does not give one. */
+#define DISK_JOURNAL_DEFAULT_MILLISECONDS 2000u
+
+typedef struct DiskJournal DiskJournal_t;
+
+/* Starts a journal for the image file pFileName, whose current contents
+   are pImage. Sector writes are committed by a thread of its own: after
+   lCommitMilliseconds of collecting, the image is written to a temporary
+   file, synced and renamed over pFileName, so the file always holds either
+   the previous or the new image. Returns NULL if no thread can be run. */
+DiskJournal_t *DiskJournal_Open(const char *pFileName, const u8 *pImage, u32 lSize, u32 lCommitMilliseconds);
+
+/* Commits what is still queued, then stops the thread. */
+void DiskJournal_Close(DiskJournal_t *pJournal);
+
+/* Queues lBytes written at lOffset of the image. Only copies to memory;
+   the caller never waits on disk I/O. */
+void DiskJournal_Write(DiskJournal_t *pJournal, u32 lOffset, const u8 *pData, u32 lBytes);
+
+/* Number of commits that reached the file so far. */
+u32 DiskJournal_Commits(DiskJournal_t *pJournal);
+
+#endif
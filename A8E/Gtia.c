@@ -14,6 +14,7 @@
 #include <SDL2/SDL.h>
 
 #include <stdio.h>
+#include <string.h>
 
 #include "6502.h"
 #include "AtariIo.h"
@@ -52,6 +53,10 @@ u8 *Gtia_HPOSP0_M0PF(_6502_Context_t *pContext, u8 *pValue)
 		printf(" HPOSP0: %02X\n", *pValue);
 #endif
 	}
+	else
+	{
+		AtariIoUpdateCollisions(pContext);
+	}
 
 	return &RAM[IO_HPOSP0_M0PF];
 }
@@ -67,6 +72,10 @@ u8 *Gtia_HPOSP1_M1PF(_6502_Context_t *pContext, u8 *pValue)
 		printf(" HPOSP1: %02X\n", *pValue);
 #endif
 	}
+	else
+	{
+		AtariIoUpdateCollisions(pContext);
+	}
 
 	return &RAM[IO_HPOSP1_M1PF];
 }
@@ -82,6 +91,10 @@ u8 *Gtia_HPOSP2_M2PF(_6502_Context_t *pContext, u8 *pValue)
 		printf(" HPOSP2: %02X\n", *pValue);
 #endif
 	}
+	else
+	{
+		AtariIoUpdateCollisions(pContext);
+	}
 
 	return &RAM[IO_HPOSP2_M2PF];
 }
@@ -97,6 +110,10 @@ u8 *Gtia_HPOSP3_M3PF(_6502_Context_t *pContext, u8 *pValue)
 		printf(" HPOSP3: %02X\n", *pValue);
 #endif
 	}
+	else
+	{
+		AtariIoUpdateCollisions(pContext);
+	}
 
 	return &RAM[IO_HPOSP3_M3PF];
 }
@@ -112,6 +129,10 @@ u8 *Gtia_HPOSM0_P0PF(_6502_Context_t *pContext, u8 *pValue)
 		printf(" HPOSM0: %02X\n", *pValue);
 #endif
 	}
+	else
+	{
+		AtariIoUpdateCollisions(pContext);
+	}
 
 	return &RAM[IO_HPOSM0_P0PF];
 }
@@ -127,6 +148,10 @@ u8 *Gtia_HPOSM1_P1PF(_6502_Context_t *pContext, u8 *pValue)
 		printf(" HPOSM1: %02X\n", *pValue);
 #endif
 	}
+	else
+	{
+		AtariIoUpdateCollisions(pContext);
+	}
 
 	return &RAM[IO_HPOSM1_P1PF];
 }
@@ -142,6 +167,10 @@ u8 *Gtia_HPOSM2_P2PF(_6502_Context_t *pContext, u8 *pValue)
 		printf(" HPOSM2: %02X\n", *pValue);
 #endif
 	}
+	else
+	{
+		AtariIoUpdateCollisions(pContext);
+	}
 
 	return &RAM[IO_HPOSM2_P2PF];
 }
@@ -157,6 +186,10 @@ u8 *Gtia_HPOSM3_P3PF(_6502_Context_t *pContext, u8 *pValue)
 		printf(" HPOSM3: %02X\n", *pValue);
 #endif
 	}
+	else
+	{
+		AtariIoUpdateCollisions(pContext);
+	}
 
 	return &RAM[IO_HPOSM3_P3PF];
 }
@@ -172,6 +205,10 @@ u8 *Gtia_SIZEP0_M0PL(_6502_Context_t *pContext, u8 *pValue)
 		printf(" SIZEP0: %02X\n", *pValue);
 #endif
 	}
+	else
+	{
+		AtariIoUpdateCollisions(pContext);
+	}
 
 	return &RAM[IO_SIZEP0_M0PL];
 }
@@ -187,6 +224,10 @@ u8 *Gtia_SIZEP1_M1PL(_6502_Context_t *pContext, u8 *pValue)
 		printf(" SIZEP1: %02X\n", *pValue);
 #endif
 	}
+	else
+	{
+		AtariIoUpdateCollisions(pContext);
+	}
 
 	return &RAM[IO_SIZEP1_M1PL];
 }
@@ -202,6 +243,10 @@ u8 *Gtia_SIZEP2_M2PL(_6502_Context_t *pContext, u8 *pValue)
 		printf(" SIZEP2: %02X\n", *pValue);
 #endif
 	}
+	else
+	{
+		AtariIoUpdateCollisions(pContext);
+	}
 
 	return &RAM[IO_SIZEP2_M2PL];
 }
@@ -217,6 +262,10 @@ u8 *Gtia_SIZEP3_M3PL(_6502_Context_t *pContext, u8 *pValue)
 		printf(" SIZEP3: %02X\n", *pValue);
 #endif
 	}
+	else
+	{
+		AtariIoUpdateCollisions(pContext);
+	}
 
 	return &RAM[IO_SIZEP3_M3PL];
 }
@@ -232,6 +281,10 @@ u8 *Gtia_SIZEM_P0PL(_6502_Context_t *pContext, u8 *pValue)
 		printf(" SIZEM: %02X\n", *pValue);
 #endif
 	}
+	else
+	{
+		AtariIoUpdateCollisions(pContext);
+	}
 
 	return &RAM[IO_SIZEM_P0PL];
 }
@@ -247,6 +300,10 @@ u8 *Gtia_GRAFP0_P1PL(_6502_Context_t *pContext, u8 *pValue)
 		printf(" GRAFP0: %02X\n", *pValue);
 #endif
 	}
+	else
+	{
+		AtariIoUpdateCollisions(pContext);
+	}
 
 	return &RAM[IO_GRAFP0_P1PL];
 }
@@ -262,6 +319,10 @@ u8 *Gtia_GRAFP1_P2PL(_6502_Context_t *pContext, u8 *pValue)
 		printf(" GRAFP1: %02X\n", *pValue);
 #endif
 	}
+	else
+	{
+		AtariIoUpdateCollisions(pContext);
+	}
 
 	return &RAM[IO_GRAFP1_P2PL];
 }
@@ -277,6 +338,10 @@ u8 *Gtia_GRAFP2_P3PL(_6502_Context_t *pContext, u8 *pValue)
 		printf(" GRAFP2: %02X\n", *pValue);
 #endif
 	}
+	else
+	{
+		AtariIoUpdateCollisions(pContext);
+	}
 
 	return &RAM[IO_GRAFP2_P3PL];
 }
@@ -494,6 +559,8 @@ u8 *Gtia_GRACTL(_6502_Context_t *pContext, u8 *pValue)
 /* $D01E HITCLR */
 u8 *Gtia_HITCLR(_6502_Context_t *pContext, u8 *pValue)
 {
+	IoData_t *pIoData = (IoData_t *)pContext->pIoData;
+
 	if(pValue)
 	{
 		RAM[IO_HPOSP0_M0PF] = 0x00;
@@ -513,6 +580,10 @@ u8 *Gtia_HITCLR(_6502_Context_t *pContext, u8 *pValue)
 		RAM[IO_GRAFP1_P2PL] = 0x00;
 		RAM[IO_GRAFP2_P3PL] = 0x00;
 
+		/* Drop collisions not yet folded into the read registers. */
+		memset(pIoData->aPlayerCollision, 0, sizeof(pIoData->aPlayerCollision));
+		memset(pIoData->aMissileCollision, 0, sizeof(pIoData->aMissileCollision));
+
 		SRAM[IO_HITCLR] = *pValue;
 #ifdef VERBOSE_REGISTER
 		printf("             [%16llu]", pContext->llCycleCounter);
@@ -0,0 +1,981 @@
+/********************************************************************
+*
+*
+*
+* H: Host Filesystem Device
+*
+* (c) 2004 Sascha Springer
+*
+*
+*
+********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dirent.h>
+#endif
+
+#ifndef S_ISREG
+#define S_ISREG(mode) (((mode) & S_IFMT) == S_IFREG)
+#define S_ISDIR(mode) (((mode) & S_IFMT) == S_IFDIR)
+#endif
+
+#include "6502.h"
+#include "HostDevice.h"
+
+/********************************************************************
+*
+*
+* Definitionen
+*
+*
+********************************************************************/
+
+#define HOST_DEVICE_CHANNELS 8
+#define HOST_DEVICE_PATH_SIZE 1024
+#define HOST_DEVICE_STRING_SIZE 128
+
+/* 8.3 names without the dot, each field padded with spaces. */
+#define HOST_DEVICE_NAME_LENGTH 11
+#define HOST_DEVICE_BASE_LENGTH 8
+
+/* Room for the directory, a slash and the longest host name "NAME.EXT". */
+#define HOST_DEVICE_DIRECTORY_SIZE (HOST_DEVICE_PATH_SIZE - HOST_DEVICE_NAME_LENGTH - 2)
+
+/* The directory footer counts free sectors of a disk this size. */
+#define HOST_DEVICE_SECTOR_SIZE 128u
+#define HOST_DEVICE_SECTORS 999u
+
+/* "* NAME    EXT 001" and EOL. */
+#define HOST_DEVICE_ENTRY_SIZE 18u
+#define HOST_DEVICE_FOOTER_SIZE 32u
+
+#define ATARI_EOL 0x9b
+
+/* IOCBs */
+#define IOCB_BASE 0x0340
+#define IOCB_ICHID 0x00
+#define IOCB_ICCOM 0x02
+#define IOCB_ICSTA 0x03
+#define IOCB_ICBAL 0x04
+#define IOCB_ICBAH 0x05
+#define IOCB_ICPTL 0x06
+#define IOCB_ICPTH 0x07
+#define IOCB_ICBLL 0x08
+#define IOCB_ICBLH 0x09
+#define IOCB_ICAX1 0x0a
+
+/* CIO commands */
+#define CIO_OPEN 0x03
+#define CIO_GET_RECORD 0x05
+#define CIO_GET_BYTES 0x07
+#define CIO_PUT_RECORD 0x09
+#define CIO_PUT_BYTES 0x0b
+#define CIO_CLOSE 0x0c
+#define CIO_STATUS 0x0d
+#define CIO_RENAME 0x20
+#define CIO_DELETE 0x21
+
+/* ICAX1 of OPEN */
+#define OPEN_APPEND 0x01
+#define OPEN_DIRECTORY 0x02
+#define OPEN_READ 0x04
+#define OPEN_WRITE 0x08
+
+/* CIO and DOS 2 statuses */
+#define CIO_SUCCESS 0x01
+#define CIO_ALREADY_OPEN 0x81
+#define CIO_WRITE_ONLY 0x83
+#define CIO_BAD_COMMAND 0x84
+#define CIO_NOT_OPEN 0x85
+#define CIO_BAD_IOCB 0x86
+#define CIO_READ_ONLY 0x87
+#define CIO_END_OF_FILE 0x88
+#define CIO_TRUNCATED 0x89
+#define CIO_DISK_FULL 0xa2
+#define CIO_BAD_NAME 0xa5
+#define CIO_LOCKED 0xa7
+#define CIO_NOT_FOUND 0xaa
+#define CIO_EXISTS 0xae
+
+#define IOCB(offset) RAM[IOCB_BASE + CPU.x + (offset)]
+
+typedef struct
+{
+	char aName[HOST_DEVICE_NAME_LENGTH];
+	char aHostName[HOST_DEVICE_NAME_LENGTH + 2];
+	u32 lSize;
+} HostEntry_t;
+
+typedef struct
+{
+	FILE *pFile;
+
+	/* Directory channels read this instead of a file. */
+	u8 *pListing;
+	u32 lListingSize;
+	u32 lListingOffset;
+
+	/* ICAX1 of the OPEN, 0 while closed. */
+	u8 cMode;
+
+	/* Update channels seek between reading and writing. */
+	u8 bWriting;
+} HostChannel_t;
+
+struct HostDevice
+{
+	char aDirectory[HOST_DEVICE_DIRECTORY_SIZE];
+	u16 sPutByteVector;
+	HostChannel_t aChannels[HOST_DEVICE_CHANNELS];
+};
+
+/********************************************************************
+*
+*
+* Funktionen
+*
+*
+********************************************************************/
+
+/* Copies the guest string at sAddress up to EOL or NUL. */
+static void HostDevice_ReadString(_6502_Context_t *pContext, u16 sAddress, char *pString)
+{
+	u32 lIndex;
+
+	for(lIndex = 0; lIndex < HOST_DEVICE_STRING_SIZE - 1; lIndex++)
+	{
+		u8 cValue = RAM[(u16)(sAddress + lIndex)];
+
+		if(cValue == ATARI_EOL || cValue == 0)
+		{
+			break;
+		}
+
+		pString[lIndex] = (char)cValue;
+	}
+
+	pString[lIndex] = 0;
+}
+
+/* Length of "H:" or "H1:" to "H9:" at the start of pString, else 0. */
+static u32 HostDevice_Prefix(const char *pString)
+{
+	if(pString[0] != 'H' && pString[0] != 'h')
+	{
+		return 0;
+	}
+
+	if(pString[1] == ':')
+	{
+		return 2;
+	}
+
+	if(pString[1] >= '1' && pString[1] <= '9' && pString[2] == ':')
+	{
+		return 3;
+	}
+
+	return 0;
+}
+
+/* Reads the name at pString into its 11 character form, cut to 8.3. With
+   bWildcards '?' is kept and '*' fills the rest of its field with '?'.
+   Stops at the first character no name has. Returns the characters read,
+   or 0 if there is no name. */
+static u32 HostDevice_ParseName(const char *pString, char *pName, u8 bWildcards)
+{
+	const char *pChar = pString;
+	u32 lStart = 0;
+	u32 lEnd = HOST_DEVICE_BASE_LENGTH;
+	u32 lIndex = 0;
+
+	memset(pName, ' ', HOST_DEVICE_NAME_LENGTH);
+
+	while(*pChar == '>' || *pChar == '/' || *pChar == '\\')
+	{
+		pChar++;
+	}
+
+	for(;; pChar++)
+	{
+		char cChar = (char)toupper((unsigned char)*pChar);
+
+		if(cChar == '.' && lEnd == HOST_DEVICE_BASE_LENGTH)
+		{
+			lStart = lEnd;
+			lEnd = HOST_DEVICE_NAME_LENGTH;
+			lIndex = lStart;
+		}
+		else if(cChar == '*' && bWildcards)
+		{
+			while(lIndex < lEnd)
+			{
+				pName[lIndex++] = '?';
+			}
+		}
+		else if((cChar >= 'A' && cChar <= 'Z') || (cChar >= '0' && cChar <= '9') || cChar == '_' ||
+				(cChar == '?' && bWildcards))
+		{
+			if(lIndex < lEnd)
+			{
+				pName[lIndex++] = cChar;
+			}
+		}
+		else
+		{
+			break;
+		}
+	}
+
+	return pName[0] == ' ' ? 0 : (u32)(pChar - pString);
+}
+
+/* "NAME.EXT", or "NAME" without an extension. */
+static void HostDevice_FormatName(const char *pName, char *pString)
+{
+	u32 lIndex;
+
+	for(lIndex = 0; lIndex < HOST_DEVICE_BASE_LENGTH && pName[lIndex] != ' '; lIndex++)
+	{
+		*pString++ = pName[lIndex];
+	}
+
+	if(pName[HOST_DEVICE_BASE_LENGTH] != ' ')
+	{
+		*pString++ = '.';
+		for(lIndex = HOST_DEVICE_BASE_LENGTH; lIndex < HOST_DEVICE_NAME_LENGTH && pName[lIndex] != ' '; lIndex++)
+		{
+			*pString++ = pName[lIndex];
+		}
+	}
+
+	*pString = 0;
+}
+
+static int HostDevice_Match(const char *pPattern, const char *pName)
+{
+	u32 lIndex;
+
+	for(lIndex = 0; lIndex < HOST_DEVICE_NAME_LENGTH; lIndex++)
+	{
+		if(pPattern[lIndex] != '?' && pPattern[lIndex] != pName[lIndex])
+		{
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+static void HostDevice_Path(HostDevice_t *pDevice, const char *pHostName, char *pPath)
+{
+	snprintf(pPath, HOST_DEVICE_PATH_SIZE, "%s/%s", pDevice->aDirectory, pHostName);
+}
+
+static int HostDevice_CompareEntries(const void *pFirst, const void *pSecond)
+{
+	return memcmp(((const HostEntry_t *)pFirst)->aName, ((const HostEntry_t *)pSecond)->aName,
+				  HOST_DEVICE_NAME_LENGTH);
+}
+
+/* Adds the host file pHostName to the list if its name is a whole 8.3
+   name matching pPattern. */
+static void HostDevice_AddEntry(HostDevice_t *pDevice, const char *pHostName, const char *pPattern,
+								HostEntry_t **ppEntries, u32 *pCount)
+{
+	char aName[HOST_DEVICE_NAME_LENGTH];
+	char aString[HOST_DEVICE_NAME_LENGTH + 2];
+	char aPath[HOST_DEVICE_PATH_SIZE];
+	struct stat tStat;
+	HostEntry_t *pEntries;
+	u32 lIndex;
+
+	if(strlen(pHostName) >= sizeof(aString) ||
+	   HostDevice_ParseName(pHostName, aName, 0) != strlen(pHostName) ||
+	   !HostDevice_Match(pPattern, aName))
+	{
+		return;
+	}
+
+	/* Cut names like LONGNAME1.TXT are not reachable from the Atari. */
+	HostDevice_FormatName(aName, aString);
+	if(strlen(aString) != strlen(pHostName))
+	{
+		return;
+	}
+
+	for(lIndex = 0; aString[lIndex]; lIndex++)
+	{
+		if(aString[lIndex] != toupper((unsigned char)pHostName[lIndex]))
+		{
+			return;
+		}
+	}
+
+	HostDevice_Path(pDevice, pHostName, aPath);
+	if(stat(aPath, &tStat) != 0 || !S_ISREG(tStat.st_mode))
+	{
+		return;
+	}
+
+	if((*pCount & (*pCount - 1)) == 0)
+	{
+		pEntries = (HostEntry_t *)realloc(*ppEntries, (*pCount ? *pCount * 2 : 1) * sizeof(HostEntry_t));
+		if(!pEntries)
+		{
+			return;
+		}
+
+		*ppEntries = pEntries;
+	}
+
+	pEntries = &(*ppEntries)[(*pCount)++];
+	memcpy(pEntries->aName, aName, HOST_DEVICE_NAME_LENGTH);
+	strcpy(pEntries->aHostName, pHostName);
+	pEntries->lSize = (u32)tStat.st_size;
+}
+
+/* The files matching pPattern, sorted by name, in a list to be freed. */
+static u32 HostDevice_List(HostDevice_t *pDevice, const char *pPattern, HostEntry_t **ppEntries)
+{
+	u32 lCount = 0;
+#ifdef _WIN32
+	char aPath[HOST_DEVICE_PATH_SIZE];
+	WIN32_FIND_DATAA tFindData;
+	HANDLE hFind;
+#else
+	DIR *pDirectory;
+	struct dirent *pDirectoryEntry;
+#endif
+
+	*ppEntries = NULL;
+
+#ifdef _WIN32
+	HostDevice_Path(pDevice, "*", aPath);
+	hFind = FindFirstFileA(aPath, &tFindData);
+	if(hFind == INVALID_HANDLE_VALUE)
+	{
+		return 0;
+	}
+
+	do
+	{
+		HostDevice_AddEntry(pDevice, tFindData.cFileName, pPattern, ppEntries, &lCount);
+	} while(FindNextFileA(hFind, &tFindData));
+
+	FindClose(hFind);
+#else
+	pDirectory = opendir(pDevice->aDirectory);
+	if(!pDirectory)
+	{
+		return 0;
+	}
+
+	while((pDirectoryEntry = readdir(pDirectory)) != NULL)
+	{
+		HostDevice_AddEntry(pDevice, pDirectoryEntry->d_name, pPattern, ppEntries, &lCount);
+	}
+
+	closedir(pDirectory);
+#endif
+
+	if(lCount > 1)
+	{
+		qsort(*ppEntries, lCount, sizeof(HostEntry_t), HostDevice_CompareEntries);
+	}
+
+	return lCount;
+}
+
+/* Looks up the file named pName. Returns 0 if there is none. */
+static int HostDevice_Find(HostDevice_t *pDevice, const char *pName, HostEntry_t *pEntry)
+{
+	HostEntry_t *pEntries;
+	u32 lCount = HostDevice_List(pDevice, pName, &pEntries);
+
+	if(lCount)
+	{
+		*pEntry = pEntries[0];
+	}
+
+	free(pEntries);
+
+	return lCount != 0;
+}
+
+static u32 HostDevice_Sectors(u32 lSize)
+{
+	u32 lSectors = (lSize + HOST_DEVICE_SECTOR_SIZE - 1) / HOST_DEVICE_SECTOR_SIZE;
+
+	return lSectors ? lSectors : 1;
+}
+
+/* The DOS 2 directory text: one line per file, then the free sectors. */
+static u8 HostDevice_OpenListing(HostDevice_t *pDevice, HostChannel_t *pChannel, const char *pPattern)
+{
+	HostEntry_t *pEntries;
+	u32 lCount = HostDevice_List(pDevice, pPattern, &pEntries);
+	u32 lFree = HOST_DEVICE_SECTORS;
+	char *pText;
+	u32 lIndex;
+
+	pText = (char *)malloc(lCount * HOST_DEVICE_ENTRY_SIZE + HOST_DEVICE_FOOTER_SIZE);
+	if(!pText)
+	{
+		free(pEntries);
+		return CIO_DISK_FULL;
+	}
+
+	pChannel->pListing = (u8 *)pText;
+	for(lIndex = 0; lIndex < lCount; lIndex++)
+	{
+		u32 lSectors = HostDevice_Sectors(pEntries[lIndex].lSize);
+
+		lFree = lFree > lSectors ? lFree - lSectors : 0;
+		pText += sprintf(pText, "  %.8s%.3s %03u", pEntries[lIndex].aName,
+						 &pEntries[lIndex].aName[HOST_DEVICE_BASE_LENGTH],
+						 (unsigned int)(lSectors > 999 ? 999 : lSectors));
+		*pText++ = (char)ATARI_EOL;
+	}
+
+	pText += sprintf(pText, "%03u FREE SECTORS", (unsigned int)lFree);
+	*pText++ = (char)ATARI_EOL;
+
+	pChannel->lListingSize = (u32)((u8 *)pText - pChannel->pListing);
+	pChannel->lListingOffset = 0;
+	free(pEntries);
+
+	return CIO_SUCCESS;
+}
+
+static void HostDevice_CloseChannel(HostChannel_t *pChannel)
+{
+	if(pChannel->pFile)
+	{
+		fclose(pChannel->pFile);
+	}
+
+	free(pChannel->pListing);
+	memset(pChannel, 0, sizeof(*pChannel));
+}
+
+static u8 HostDevice_ErrnoStatus(void)
+{
+	return errno == EACCES || errno == EPERM || errno == EROFS ? CIO_LOCKED : CIO_NOT_FOUND;
+}
+
+static u8 HostDevice_OpenChannel(HostDevice_t *pDevice, _6502_Context_t *pContext, HostChannel_t *pChannel,
+								 const char *pString)
+{
+	u8 cMode = IOCB(IOCB_ICAX1) & 0x0f;
+	char aName[HOST_DEVICE_NAME_LENGTH];
+	char aPath[HOST_DEVICE_PATH_SIZE];
+	const char *pFileMode;
+	HostEntry_t tEntry;
+	u8 bFound;
+	u8 cStatus;
+
+	if(IOCB(IOCB_ICHID) != 0xff)
+	{
+		return CIO_ALREADY_OPEN;
+	}
+
+	/* Still open from before a reset closed the IOCBs. */
+	HostDevice_CloseChannel(pChannel);
+
+	if(!HostDevice_ParseName(pString, aName, 1))
+	{
+		if(!(cMode & OPEN_DIRECTORY))
+		{
+			return CIO_BAD_NAME;
+		}
+
+		memset(aName, '?', HOST_DEVICE_NAME_LENGTH);
+	}
+
+	if(cMode == (OPEN_READ | OPEN_DIRECTORY) ||
+	   (cMode == OPEN_READ && memchr(aName, '?', HOST_DEVICE_NAME_LENGTH)))
+	{
+		cStatus = HostDevice_OpenListing(pDevice, pChannel, aName);
+		if(cStatus != CIO_SUCCESS)
+		{
+			return cStatus;
+		}
+	}
+	else
+	{
+		switch(cMode)
+		{
+		case OPEN_READ:
+			pFileMode = "rb";
+			break;
+
+		case OPEN_WRITE:
+			pFileMode = "wb";
+			break;
+
+		case OPEN_WRITE | OPEN_APPEND:
+			pFileMode = "ab";
+			break;
+
+		case OPEN_READ | OPEN_WRITE:
+			pFileMode = "r+b";
+			break;
+
+		default:
+			return CIO_BAD_COMMAND;
+		}
+
+		if(memchr(aName, '?', HOST_DEVICE_NAME_LENGTH))
+		{
+			return CIO_BAD_NAME;
+		}
+
+		bFound = (u8)HostDevice_Find(pDevice, aName, &tEntry);
+		if(!bFound)
+		{
+			if(cMode != OPEN_WRITE)
+			{
+				return CIO_NOT_FOUND;
+			}
+
+			HostDevice_FormatName(aName, tEntry.aHostName);
+		}
+
+		HostDevice_Path(pDevice, tEntry.aHostName, aPath);
+		pChannel->pFile = fopen(aPath, pFileMode);
+		if(!pChannel->pFile)
+		{
+			return HostDevice_ErrnoStatus();
+		}
+	}
+
+	pChannel->cMode = cMode;
+	IOCB(IOCB_ICHID) = HOST_DEVICE_HANDLER_ID;
+	IOCB(IOCB_ICPTL) = (u8)(pDevice->sPutByteVector & 0xff);
+	IOCB(IOCB_ICPTH) = (u8)(pDevice->sPutByteVector >> 8);
+
+	return CIO_SUCCESS;
+}
+
+static u32 HostDevice_Read(HostChannel_t *pChannel, u8 *pBuffer, u32 lLength)
+{
+	if(pChannel->pListing)
+	{
+		if(lLength > pChannel->lListingSize - pChannel->lListingOffset)
+		{
+			lLength = pChannel->lListingSize - pChannel->lListingOffset;
+		}
+
+		memcpy(pBuffer, &pChannel->pListing[pChannel->lListingOffset], lLength);
+		pChannel->lListingOffset += lLength;
+
+		return lLength;
+	}
+
+	if(pChannel->bWriting)
+	{
+		fseek(pChannel->pFile, 0, SEEK_CUR);
+		pChannel->bWriting = 0;
+	}
+
+	return (u32)fread(pBuffer, 1, lLength, pChannel->pFile);
+}
+
+static u32 HostDevice_Write(HostChannel_t *pChannel, const u8 *pBuffer, u32 lLength)
+{
+	if(!pChannel->bWriting)
+	{
+		fseek(pChannel->pFile, 0, SEEK_CUR);
+		pChannel->bWriting = 1;
+	}
+
+	return (u32)fwrite(pBuffer, 1, lLength, pChannel->pFile);
+}
+
+/* Reads into the IOCB buffer, or with a zero length the byte in A.
+   Plain RAM is filled straight from the file. */
+static u8 HostDevice_GetBytes(_6502_Context_t *pContext, HostChannel_t *pChannel, u32 *pBytes)
+{
+	u16 sBuffer = IOCB(IOCB_ICBAL) | (IOCB(IOCB_ICBAH) << 8);
+	u32 lLength = IOCB(IOCB_ICBLL) | (IOCB(IOCB_ICBLH) << 8);
+	u32 lRead = 0;
+	u8 cValue;
+
+	if(lLength == 0)
+	{
+		if(!HostDevice_Read(pChannel, &cValue, 1))
+		{
+			return CIO_END_OF_FILE;
+		}
+
+		CPU.a = cValue;
+		*pBytes = 1;
+
+		return CIO_SUCCESS;
+	}
+
+	if(_6502_IsRam(pContext, sBuffer, lLength))
+	{
+		lRead = HostDevice_Read(pChannel, &RAM[sBuffer], lLength);
+	}
+	else
+	{
+		while(lRead < lLength && HostDevice_Read(pChannel, &cValue, 1))
+		{
+			_6502_Write(pContext, (u16)(sBuffer + lRead++), cValue);
+		}
+	}
+
+	IOCB(IOCB_ICBLL) = (u8)(lRead & 0xff);
+	IOCB(IOCB_ICBLH) = (u8)(lRead >> 8);
+	*pBytes = lRead;
+
+	return lRead == lLength ? CIO_SUCCESS : CIO_END_OF_FILE;
+}
+
+/* Reads up to and with the next EOL. What does not fit in the buffer is
+   skipped, as CIO does. */
+static u8 HostDevice_GetRecord(_6502_Context_t *pContext, HostChannel_t *pChannel, u32 *pBytes)
+{
+	u16 sBuffer = IOCB(IOCB_ICBAL) | (IOCB(IOCB_ICBAH) << 8);
+	u32 lLength = IOCB(IOCB_ICBLL) | (IOCB(IOCB_ICBLH) << 8);
+	u32 lRead = 0;
+	u32 lStored = 0;
+	u8 cValue = 0;
+
+	while(cValue != ATARI_EOL && HostDevice_Read(pChannel, &cValue, 1))
+	{
+		if(lStored < lLength)
+		{
+			_6502_Write(pContext, (u16)(sBuffer + lStored++), cValue);
+		}
+
+		lRead++;
+	}
+
+	IOCB(IOCB_ICBLL) = (u8)(lStored & 0xff);
+	IOCB(IOCB_ICBLH) = (u8)(lStored >> 8);
+	*pBytes = lRead;
+
+	if(lRead == 0)
+	{
+		return CIO_END_OF_FILE;
+	}
+
+	return lRead > lStored ? CIO_TRUNCATED : CIO_SUCCESS;
+}
+
+/* Writes the IOCB buffer, or with a zero length the byte in A, straight
+   from guest memory. */
+static u8 HostDevice_PutBytes(_6502_Context_t *pContext, HostChannel_t *pChannel, u32 *pBytes)
+{
+	u16 sBuffer = IOCB(IOCB_ICBAL) | (IOCB(IOCB_ICBAH) << 8);
+	u32 lLength = IOCB(IOCB_ICBLL) | (IOCB(IOCB_ICBLH) << 8);
+	u32 lFirst;
+	u32 lWritten;
+
+	if(lLength == 0)
+	{
+		*pBytes = 1;
+		return HostDevice_Write(pChannel, &CPU.a, 1) == 1 ? CIO_SUCCESS : CIO_DISK_FULL;
+	}
+
+	/* A buffer running past $FFFF goes on at $0000. */
+	lFirst = _6502_MEMORY_SIZE - sBuffer;
+	lFirst = lLength < lFirst ? lLength : lFirst;
+	lWritten = HostDevice_Write(pChannel, &RAM[sBuffer], lFirst);
+	if(lWritten == lFirst && lLength > lFirst)
+	{
+		lWritten += HostDevice_Write(pChannel, RAM, lLength - lFirst);
+	}
+
+	*pBytes = lWritten;
+
+	return lWritten == lLength ? CIO_SUCCESS : CIO_DISK_FULL;
+}
+
+/* Writes up to and with the first EOL, adding one if the buffer has none. */
+static u8 HostDevice_PutRecord(_6502_Context_t *pContext, HostChannel_t *pChannel, u32 *pBytes)
+{
+	u16 sBuffer = IOCB(IOCB_ICBAL) | (IOCB(IOCB_ICBAH) << 8);
+	u32 lLength = IOCB(IOCB_ICBLL) | (IOCB(IOCB_ICBLH) << 8);
+	u32 lIndex;
+	u8 cValue = 0;
+
+	for(lIndex = 0; lIndex < lLength && cValue != ATARI_EOL; lIndex++)
+	{
+		cValue = RAM[(u16)(sBuffer + lIndex)];
+		if(HostDevice_Write(pChannel, &cValue, 1) != 1)
+		{
+			return CIO_DISK_FULL;
+		}
+	}
+
+	*pBytes = lIndex;
+
+	if(cValue != ATARI_EOL)
+	{
+		cValue = ATARI_EOL;
+		if(HostDevice_Write(pChannel, &cValue, 1) != 1)
+		{
+			return CIO_DISK_FULL;
+		}
+
+		(*pBytes)++;
+	}
+
+	return CIO_SUCCESS;
+}
+
+/* "H:OLD.EXT,NEW.EXT" */
+static u8 HostDevice_Rename(HostDevice_t *pDevice, const char *pString)
+{
+	char aOldName[HOST_DEVICE_NAME_LENGTH];
+	char aNewName[HOST_DEVICE_NAME_LENGTH];
+	char aOldPath[HOST_DEVICE_PATH_SIZE];
+	char aNewPath[HOST_DEVICE_PATH_SIZE];
+	char aHostName[HOST_DEVICE_NAME_LENGTH + 2];
+	HostEntry_t tOld;
+	HostEntry_t tNew;
+	u32 lLength = HostDevice_ParseName(pString, aOldName, 0);
+
+	if(!lLength || pString[lLength] != ',' || !HostDevice_ParseName(&pString[lLength + 1], aNewName, 0))
+	{
+		return CIO_BAD_NAME;
+	}
+
+	if(!HostDevice_Find(pDevice, aOldName, &tOld))
+	{
+		return CIO_NOT_FOUND;
+	}
+
+	/* Changing only the case of a host name is fine. */
+	if(HostDevice_Find(pDevice, aNewName, &tNew) && strcmp(tNew.aHostName, tOld.aHostName) != 0)
+	{
+		return CIO_EXISTS;
+	}
+
+	HostDevice_FormatName(aNewName, aHostName);
+	HostDevice_Path(pDevice, tOld.aHostName, aOldPath);
+	HostDevice_Path(pDevice, aHostName, aNewPath);
+
+	return rename(aOldPath, aNewPath) == 0 ? CIO_SUCCESS : HostDevice_ErrnoStatus();
+}
+
+/* Deletes every file the name matches, as DOS 2 does. */
+static u8 HostDevice_Delete(HostDevice_t *pDevice, const char *pString)
+{
+	char aName[HOST_DEVICE_NAME_LENGTH];
+	char aPath[HOST_DEVICE_PATH_SIZE];
+	HostEntry_t *pEntries;
+	u32 lCount;
+	u32 lIndex;
+	u8 cStatus = CIO_SUCCESS;
+
+	if(!HostDevice_ParseName(pString, aName, 1))
+	{
+		return CIO_BAD_NAME;
+	}
+
+	lCount = HostDevice_List(pDevice, aName, &pEntries);
+	for(lIndex = 0; lIndex < lCount; lIndex++)
+	{
+		HostDevice_Path(pDevice, pEntries[lIndex].aHostName, aPath);
+		if(remove(aPath) != 0)
+		{
+			cStatus = HostDevice_ErrnoStatus();
+		}
+	}
+
+	free(pEntries);
+
+	return lCount ? cStatus : CIO_NOT_FOUND;
+}
+
+HostDevice_t *HostDevice_Open(const char *pDirectory, u16 sPutByteVector)
+{
+	HostDevice_t *pDevice;
+	struct stat tStat;
+
+	if(strlen(pDirectory) >= HOST_DEVICE_DIRECTORY_SIZE ||
+	   stat(pDirectory, &tStat) != 0 || !S_ISDIR(tStat.st_mode))
+	{
+		return NULL;
+	}
+
+	pDevice = (HostDevice_t *)calloc(1, sizeof(HostDevice_t));
+	if(!pDevice)
+	{
+		return NULL;
+	}
+
+	strcpy(pDevice->aDirectory, pDirectory);
+	pDevice->sPutByteVector = sPutByteVector;
+
+	return pDevice;
+}
+
+void HostDevice_Close(HostDevice_t *pDevice)
+{
+	u32 lChannel;
+
+	if(!pDevice)
+	{
+		return;
+	}
+
+	for(lChannel = 0; lChannel < HOST_DEVICE_CHANNELS; lChannel++)
+	{
+		HostDevice_CloseChannel(&pDevice->aChannels[lChannel]);
+	}
+
+	free(pDevice);
+}
+
+u8 HostDevice_Cio(HostDevice_t *pDevice, _6502_Context_t *pContext, u32 *pBytes)
+{
+	HostChannel_t *pChannel;
+	char aString[HOST_DEVICE_STRING_SIZE];
+	u32 lPrefix;
+	u8 cCommand;
+	u8 cStatus;
+
+	*pBytes = 0;
+
+	/* X holds $00, $10, ... $70 for a valid IOCB. */
+	if(CPU.x & 0x8f)
+	{
+		return 0;
+	}
+
+	pChannel = &pDevice->aChannels[CPU.x >> 4];
+	cCommand = IOCB(IOCB_ICCOM);
+
+	if(cCommand == CIO_OPEN || cCommand == CIO_RENAME || cCommand == CIO_DELETE)
+	{
+		HostDevice_ReadString(pContext, (u16)(IOCB(IOCB_ICBAL) | (IOCB(IOCB_ICBAH) << 8)), aString);
+		lPrefix = HostDevice_Prefix(aString);
+		if(!lPrefix)
+		{
+			return 0;
+		}
+
+		if(cCommand == CIO_OPEN)
+		{
+			cStatus = HostDevice_OpenChannel(pDevice, pContext, pChannel, &aString[lPrefix]);
+		}
+		else if(cCommand == CIO_RENAME)
+		{
+			cStatus = HostDevice_Rename(pDevice, &aString[lPrefix]);
+		}
+		else
+		{
+			cStatus = HostDevice_Delete(pDevice, &aString[lPrefix]);
+		}
+	}
+	else if(IOCB(IOCB_ICHID) != HOST_DEVICE_HANDLER_ID)
+	{
+		return 0;
+	}
+	else if(!pChannel->cMode)
+	{
+		cStatus = CIO_NOT_OPEN;
+	}
+	else
+	{
+		switch(cCommand)
+		{
+		case CIO_GET_RECORD:
+		case CIO_GET_BYTES:
+			if(!(pChannel->cMode & OPEN_READ))
+			{
+				cStatus = CIO_WRITE_ONLY;
+			}
+			else if(cCommand == CIO_GET_RECORD)
+			{
+				cStatus = HostDevice_GetRecord(pContext, pChannel, pBytes);
+			}
+			else
+			{
+				cStatus = HostDevice_GetBytes(pContext, pChannel, pBytes);
+			}
+			break;
+
+		case CIO_PUT_RECORD:
+		case CIO_PUT_BYTES:
+			if(!(pChannel->cMode & OPEN_WRITE))
+			{
+				cStatus = CIO_READ_ONLY;
+			}
+			else if(cCommand == CIO_PUT_RECORD)
+			{
+				cStatus = HostDevice_PutRecord(pContext, pChannel, pBytes);
+			}
+			else
+			{
+				cStatus = HostDevice_PutBytes(pContext, pChannel, pBytes);
+			}
+			break;
+
+		case CIO_CLOSE:
+			HostDevice_CloseChannel(pChannel);
+			IOCB(IOCB_ICHID) = 0xff;
+			cStatus = CIO_SUCCESS;
+			break;
+
+		case CIO_STATUS:
+			cStatus = CIO_SUCCESS;
+			break;
+
+		default:
+			cStatus = CIO_BAD_COMMAND;
+			break;
+		}
+	}
+
+	IOCB(IOCB_ICSTA) = cStatus;
+
+	return cStatus;
+}
+
+u8 HostDevice_PutByte(HostDevice_t *pDevice, _6502_Context_t *pContext, u32 *pBytes)
+{
+	HostChannel_t *pChannel;
+	u8 cStatus;
+
+	*pBytes = 0;
+
+	if(CPU.x & 0x8f)
+	{
+		return CIO_BAD_IOCB;
+	}
+
+	pChannel = &pDevice->aChannels[CPU.x >> 4];
+	if(IOCB(IOCB_ICHID) != HOST_DEVICE_HANDLER_ID || !pChannel->cMode)
+	{
+		cStatus = CIO_NOT_OPEN;
+	}
+	else if(!(pChannel->cMode & OPEN_WRITE))
+	{
+		cStatus = CIO_READ_ONLY;
+	}
+	else
+	{
+		*pBytes = 1;
+		cStatus = HostDevice_Write(pChannel, &CPU.a, 1) == 1 ? CIO_SUCCESS : CIO_DISK_FULL;
+	}
+
+	IOCB(IOCB_ICSTA) = cStatus;
+
+	return cStatus;
+}
@@ -0,0 +1,51 @@
+/********************************************************************
+*
+*
+*
+* H: Host Filesystem Device
+*
+* (c) 2004 Sascha Springer
+*
+*
+*
+********************************************************************/
+
+#ifndef _HOSTDEVICE_H_
+#define _HOSTDEVICE_H_
+
+#include "6502.h"
+
+/********************************************************************
+*
+*
+* Definitionen
+*
+*
+********************************************************************/
+
+/* ICHID of an IOCB open on H:. No HATABS entry: the OS CIO never sees it. */
+#define HOST_DEVICE_HANDLER_ID 0xfe
+
+typedef struct HostDevice HostDevice_t;
+
+/* Maps H: (and H1: to H9:) to the host directory pDirectory. Files are the
+   8.3 names in it, matched without regard to case; new files get upper
+   case names. sPutByteVector is stored in ICPT of every IOCB opened on H:.
+   Returns NULL if pDirectory cannot be listed. */
+HostDevice_t *HostDevice_Open(const char *pDirectory, u16 sPutByteVector);
+
+/* Closes the host files of all channels still open. */
+void HostDevice_Close(HostDevice_t *pDevice);
+
+/* Serves a CIO call with the IOCB in X if it is for H:: OPEN and the XIO
+   commands by file name, everything else by an H: ICHID. Data moves
+   between the host file and the guest buffer directly, with ICBLL/H set
+   to the bytes moved, and the status is stored in ICSTA. Returns that
+   status and the bytes moved in *pBytes, or 0 if the call is not for H:. */
+u8 HostDevice_Cio(HostDevice_t *pDevice, _6502_Context_t *pContext, u32 *pBytes);
+
+/* Serves a call through sPutByteVector: writes A to the channel in X.
+   Returns the status as HostDevice_Cio. */
+u8 HostDevice_PutByte(HostDevice_t *pDevice, _6502_Context_t *pContext, u32 *pBytes);
+
+#endif
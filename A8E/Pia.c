@@ -16,6 +16,7 @@
 #include "6502.h"
 #include "AtariIo.h"
 #include "Pia.h"
+#include "Pokey.h"
 
 /********************************************************************
 *
@@ -166,6 +167,9 @@ u8 *Pia_PACTL(_6502_Context_t *pContext, u8 *pValue)
 	{
 		SRAM[IO_PACTL] = *pValue;
 		RAM[IO_PACTL] = (*pValue & 0x0d) | 0x30;
+
+		/* CA2 drives the cassette motor, on while low. */
+		Pokey_SetCassetteMotor(pContext, !(*pValue & 0x08));
 #ifdef VERBOSE_REGISTER
 		printf("             [%16llu]", pContext->llCycleCounter);
 		printf(" PACTL: %02X\n", *pValue);
@@ -19,9 +19,6 @@
 
 #include <SDL2/SDL.h>
 
-/* Window handle defined in A8E.c; used to update the title bar. */
-extern SDL_Window *g_pSdlWindow;
-
 #include "6502.h"
 #include "AtariIo.h"
 #include "Pokey.h"
@@ -34,15 +31,6 @@ extern SDL_Window *g_pSdlWindow;
 *
 ********************************************************************/
 
-typedef struct
-{
-	u16 sMagic;
-	u16 sNumberOfParagraphs;
-	u16 sSectorSize;
-	u16 sNumberOfParagraphsHigh;
-	u8 aUnused[8];
-} AtrHeader_t;
-
 typedef struct
 {
 	u8 audf;
@@ -55,6 +43,51 @@ typedef struct
 	u32 clk_acc_cycles;
 } PokeyAudioChannel_t;
 
+/* Cycle-stamped POKEY register write for the synthesis thread. cRegister is
+   the offset within $D2xx, or POKEY_LOG_SYNC for a plain time stamp. */
+typedef struct
+{
+	u64 llCycle;
+	u8 cRegister;
+	u8 cValue;
+} PokeyLogRecord_t;
+
+/* Captured POKEY register write (Pokey_SetCapture). The cycle is stored as
+   the distance to the previous record; gaps too long for 32 bits are split
+   with POKEY_LOG_SYNC filler records. */
+typedef struct
+{
+	u32 lCycleDelta;
+	u8 cRegister;
+	u8 cValue;
+} PokeyCaptureRecord_t;
+
+#define POKEY_CAPTURE_INITIAL_RECORDS 65536u
+
+/* Lossless capture stream: header, then 6 bytes per record (cycle delta,
+   register offset, value), all little-endian. */
+#define POKEY_CAPTURE_MAGIC "A8EPOKEY"
+#define POKEY_CAPTURE_VERSION 1u
+#define POKEY_CAPTURE_HEADER_SIZE 44u
+#define POKEY_CAPTURE_RECORD_SIZE 6u
+
+/* SAP type R frames: AUDF1..AUDC4 and AUDCTL, once per PAL frame. */
+#define POKEY_SAP_REGISTERS 9u
+#define POKEY_SAP_FRAME_CYCLES ((u64)CYCLES_PER_LINE * LINES_PER_SCREEN_PAL)
+
+#define POKEY_LOG_SIZE 16384u /* records, power of two */
+#define POKEY_LOG_MASK (POKEY_LOG_SIZE - 1u)
+#define POKEY_LOG_SYNC 0xff
+
+/* Drive activity reports: at most one per PAL frame. */
+#define POKEY_SIO_STATUS_CYCLES ((u64)CYCLES_PER_LINE * LINES_PER_SCREEN_PAL)
+
+/* Band-limited step kernel: sub-sample phases x taps (power of two). */
+#define POKEY_BLEP_PHASES 64
+#define POKEY_BLEP_TAPS 32
+#define POKEY_BLEP_TAP_MASK (POKEY_BLEP_TAPS - 1)
+#define POKEY_BLEP_SCALE_BITS 13
+
 typedef struct
 {
 	u32 sample_rate_hz;
@@ -65,11 +98,12 @@ typedef struct
 	/* 32.32 fixed-point audio sample time in CPU cycles. */
 	u64 cycles_per_sample_fp;
 
-	/* POKEY polynomial counters clocked at ~1.77MHz (PAL). */
-	u32 lfsr17;
-	u16 lfsr9;
-	u8 lfsr5;
-	u8 lfsr4;
+	/* POKEY polynomial counters clocked at ~1.77MHz (PAL), as positions
+	   in the shared sequence tables (0 = reset state). */
+	u32 poly17_pos;
+	u32 poly9_pos;
+	u32 poly5_pos;
+	u32 poly4_pos;
 
 	/* High-pass filter latches (AUDCTL bit2/bit1). */
 	u8 hp1_latch;
@@ -78,6 +112,11 @@ typedef struct
 	int audio_subsystem_started;
 	int audio_opened;
 
+	/* Output backend (POKEY_AUDIO_*); only SDL is paced by a device. */
+	u8 backend;
+	FILE *pWavFile;
+	u64 samples_out;
+
 	/* Sample phase (32.32 fixed-point CPU cycles since last output sample). */
 	u64 sample_phase_fp;
 	int64_t sample_accum;
@@ -85,12 +124,14 @@ typedef struct
 	/* Last emitted sample (for underrun hold). */
 	int16_t last_sample;
 
+	/* Single-producer (emulation) / single-consumer (SDL audio callback)
+	   ring. Positions run freely and are masked on access; each side only
+	   stores its own position, so neither ever waits for the other. */
 	int16_t *ring;
-	u32 ring_size; /* in samples */
-	u32 ring_mask; /* ring_size-1 if power-of-two, else 0 */
-	u32 ring_read;
-	u32 ring_write;
-	u32 ring_count;
+	u32 ring_size; /* in samples, power of two */
+	u32 ring_mask; /* ring_size-1 */
+	SDL_atomic_t ring_read;
+	SDL_atomic_t ring_write;
 
 	/* Dynamic sample rate adjustment for audio/emulation sync. */
 	u64 cycles_per_sample_fp_base; /* nominal rate */
@@ -104,8 +145,82 @@ typedef struct
 	float dc_block_r;
 	float dc_block_x1;
 	float dc_block_y1;
+
+	/* Band-limited step synthesis (POKEY_SYNTHESIS_BLEP): level transitions
+	   add kernel taps into a small delta ring at output rate, which is then
+	   integrated back into levels one output sample at a time. */
+	u8 synthesis_mode;
+	int32_t blep_level;
+	int64_t blep_integrator;
+	u32 blep_read;
+	int64_t blep_deltas[POKEY_BLEP_TAPS];
+
+	/* Fixed-point DC block for the BLEP path (x/y in 1/256 output LSBs). */
+	int32_t dc_r_q15;
+	int64_t dc_x1_fp;
+	int64_t dc_y1_fp;
+
+	/* Synthesis thread: the emulation thread appends register writes to
+	   the log and the thread renders them into the ring. While it runs,
+	   the thread owns every field above except the ring read position. */
+	SDL_Thread *synthesis_thread;
+	SDL_atomic_t synthesis_quit;
+	PokeyLogRecord_t *log;
+	SDL_atomic_t log_read;
+	SDL_atomic_t log_write;
+
+	/* Register write capture, on the emulation thread. capture_registers
+	   holds $D200-$D20F as written when the capture started. */
+	PokeyCaptureRecord_t *capture;
+	u32 capture_count;
+	u32 capture_size;
+	u8 capture_running;
+	u64 capture_start_cycle;
+	u64 capture_last_cycle;
+	u64 capture_end_cycle;
+	u8 capture_registers[16];
+
+	/* SIO protocol: the command frame goes out to aSioBuffer, the answer
+	   comes back in from it. cSioOutPhase 1 collects the data frame of
+	   the pending WRITE/PUT/VERIFY at SIO_DATA_OFFSET. */
+	u8 aSioBuffer[1024];
+	u16 sSioOutIndex;
+	u16 sSioInIndex;
+	u16 sSioInSize;
+	u8 cSioOutPhase;
+	u16 sSioDataIndex;
+	u8 cSioPendingCmd;
+	u8 cSioPendingDevice;
+	u16 sSioPendingSector;
+	u16 sSioPendingBytes;
+
+	/* Pokey_SetSioStatusCallback: the sector to report at
+	   llSioStatusCycle (CYCLE_NEVER if none), and when the last went. */
+	PokeySioStatusCallback_t SioStatusCallback;
+	void *pSioStatusUser;
+	u16 sSioStatusSector;
+	u64 llSioStatusCycle;
+	u64 llSioStatusLastCycle;
+
+	/* Emulation thread side while the synthesis thread runs. */
+	u64 log_last_cycle;
+	u32 rng_poly17_pos; /* poly17 position for RANDOM at rng_cycle */
+	u64 rng_cycle;
+	u8 rng_running;
 } PokeyState_t;
 
+/* Pokey_SaveState block: what PokeyState_t holds of the chip itself. */
+typedef struct
+{
+	u64 llLastCycle;
+	u32 aPolyPos[4]; /* poly17, poly9, poly5, poly4 */
+	u8 cHp1Latch;
+	u8 cHp2Latch;
+	u8 cAudctl;
+	u8 cSkctl;
+	PokeyAudioChannel_t aChannels[4];
+} PokeySnapshot_t;
+
 static u64 PokeyMasterReferenceCycle(_6502_Context_t *pContext)
 {
 	(void)pContext;
@@ -134,111 +249,194 @@ static u32 Pokey_CpuHz(void)
 	return ATARI_CPU_HZ_PAL;
 }
 
-static u32 PokeyAudio_RingWrap(u32 idx, u32 ring_size, u32 ring_mask)
+static u32 PokeyAudio_LoadAcquire(SDL_atomic_t *pPosition)
 {
-	if(ring_mask != 0)
-	{
-		return idx & ring_mask;
-	}
-	return (ring_size != 0) ? (idx % ring_size) : 0;
+#if defined(__GNUC__) || defined(__clang__)
+	return (u32)__atomic_load_n(&pPosition->value, __ATOMIC_ACQUIRE);
+#else
+	/* Full barrier, which subsumes acquire. */
+	return (u32)SDL_AtomicGet(pPosition);
+#endif
+}
+
+static void PokeyAudio_StoreRelease(SDL_atomic_t *pPosition, u32 lValue)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	__atomic_store_n(&pPosition->value, (int)lValue, __ATOMIC_RELEASE);
+#else
+	/* Full barrier, which subsumes release. */
+	SDL_AtomicSet(pPosition, (int)lValue);
+#endif
+}
+
+/* Samples queued for the audio callback; safe from either thread. */
+static u32 PokeyAudio_RingFill(PokeyState_t *pPokey)
+{
+	u32 write_pos = PokeyAudio_LoadAcquire(&pPokey->ring_write);
+	u32 read_pos = PokeyAudio_LoadAcquire(&pPokey->ring_read);
+
+	return write_pos - read_pos;
 }
 
+/* Producer side (emulation thread). */
 static void PokeyAudio_RingWrite(PokeyState_t *pPokey, const int16_t *pSamples, u32 count)
 {
+	u32 write_pos;
+	u32 free_space;
+	u32 index;
+	u32 first;
+
 	if(!pPokey || !pPokey->ring || pPokey->ring_size == 0)
 	{
 		return;
 	}
 
-	/* If asked to write more than the whole ring, keep only the newest samples. */
-	if(count >= pPokey->ring_size)
+	write_pos = PokeyAudio_LoadAcquire(&pPokey->ring_write);
+	free_space = pPokey->ring_size - (write_pos - PokeyAudio_LoadAcquire(&pPokey->ring_read));
+
+	/* The consumer owns the read position, so an overrun cannot drop queued
+	   samples any more; keep only the newest samples of this batch instead. */
+	if(count > free_space)
+	{
+		pSamples += (count - free_space);
+		count = free_space;
+	}
+	if(count == 0)
 	{
-		u32 keep = pPokey->ring_size;
-		pSamples += (count - keep);
-		count = keep;
+		return;
 	}
 
-	/* Protect against the SDL audio callback thread. */
-	if(pPokey->audio_opened)
+	index = write_pos & pPokey->ring_mask;
+	first = pPokey->ring_size - index;
+	if(first > count)
 	{
-		SDL_LockAudio();
+		first = count;
 	}
 
+	memcpy(&pPokey->ring[index], pSamples, (size_t)first * sizeof(int16_t));
+	if(count > first)
 	{
-		u32 ring_size = pPokey->ring_size;
-		u32 ring_mask = pPokey->ring_mask;
-		u32 free_space = ring_size - pPokey->ring_count;
-		u32 drop = (count > free_space) ? (count - free_space) : 0;
+		memcpy(&pPokey->ring[0], &pSamples[first], (size_t)(count - first) * sizeof(int16_t));
+	}
 
-		if(drop)
-		{
-			pPokey->ring_read = PokeyAudio_RingWrap(pPokey->ring_read + drop, ring_size, ring_mask);
-			pPokey->ring_count -= drop;
-		}
+	/* Publish the samples only after they are in place. */
+	PokeyAudio_StoreRelease(&pPokey->ring_write, write_pos + count);
+}
 
-		{
-			u32 first = count;
-			u32 to_end = ring_size - pPokey->ring_write;
-			if(first > to_end)
-			{
-				first = to_end;
-			}
+/* Consumer side (SDL audio callback thread). */
+static u32 PokeyAudio_RingRead(PokeyState_t *pPokey, int16_t *pSamples, u32 count)
+{
+	u32 read_pos;
+	u32 avail;
+	u32 index;
+	u32 first;
 
-			memcpy(&pPokey->ring[pPokey->ring_write], pSamples, (size_t)first * sizeof(int16_t));
+	if(!pPokey || !pPokey->ring || pPokey->ring_size == 0)
+	{
+		return 0;
+	}
 
-			{
-				u32 second = count - first;
-				if(second)
-				{
-					memcpy(&pPokey->ring[0], &pSamples[first], (size_t)second * sizeof(int16_t));
-				}
-			}
+	read_pos = PokeyAudio_LoadAcquire(&pPokey->ring_read);
+	avail = PokeyAudio_LoadAcquire(&pPokey->ring_write) - read_pos;
+	if(count > avail)
+	{
+		count = avail;
+	}
+	if(count == 0)
+	{
+		return 0;
+	}
 
-			pPokey->ring_write = PokeyAudio_RingWrap(pPokey->ring_write + count, ring_size, ring_mask);
-			pPokey->ring_count += count;
-		}
+	index = read_pos & pPokey->ring_mask;
+	first = pPokey->ring_size - index;
+	if(first > count)
+	{
+		first = count;
 	}
 
-	if(pPokey->audio_opened)
+	memcpy(pSamples, &pPokey->ring[index], (size_t)first * sizeof(int16_t));
+	if(count > first)
 	{
-		SDL_UnlockAudio();
+		memcpy(&pSamples[first], &pPokey->ring[0], (size_t)(count - first) * sizeof(int16_t));
 	}
+
+	/* Hand the slots back to the producer only after copying them out. */
+	PokeyAudio_StoreRelease(&pPokey->ring_read, read_pos + count);
+	return count;
 }
 
-static u32 PokeyAudio_RingRead(PokeyState_t *pPokey, int16_t *pSamples, u32 count)
+#define POKEY_WAV_HEADER_SIZE 44
+
+static void PokeyAudio_PutLe(u8 *pBuffer, u32 lValue, u32 lBytes)
 {
-	if(!pPokey || !pPokey->ring || pPokey->ring_size == 0)
+	while(lBytes--)
 	{
-		return 0;
+		*pBuffer++ = (u8)lValue;
+		lValue >>= 8;
 	}
+}
+
+/* Writes a 16-bit mono WAV header; the sizes are patched on close. */
+static void PokeyAudio_WriteWavHeader(PokeyState_t *pPokey, u32 lDataBytes)
+{
+	u8 aHeader[POKEY_WAV_HEADER_SIZE];
+
+	memcpy(&aHeader[0], "RIFF", 4);
+	PokeyAudio_PutLe(&aHeader[4], 36 + lDataBytes, 4);
+	memcpy(&aHeader[8], "WAVEfmt ", 8);
+	PokeyAudio_PutLe(&aHeader[16], 16, 4);
+	PokeyAudio_PutLe(&aHeader[20], 1, 2); /* PCM */
+	PokeyAudio_PutLe(&aHeader[22], 1, 2); /* mono */
+	PokeyAudio_PutLe(&aHeader[24], pPokey->sample_rate_hz, 4);
+	PokeyAudio_PutLe(&aHeader[28], pPokey->sample_rate_hz * 2, 4);
+	PokeyAudio_PutLe(&aHeader[32], 2, 2);
+	PokeyAudio_PutLe(&aHeader[34], 16, 2);
+	memcpy(&aHeader[36], "data", 4);
+	PokeyAudio_PutLe(&aHeader[40], lDataBytes, 4);
+
+	fseek(pPokey->pWavFile, 0, SEEK_SET);
+	fwrite(aHeader, 1, sizeof(aHeader), pPokey->pWavFile);
+}
 
-	/* Called from the SDL audio callback; do not SDL_LockAudio() here. */
+static void PokeyAudio_CloseWavFile(PokeyState_t *pPokey)
+{
+	if(!pPokey->pWavFile)
 	{
-		u32 ring_size = pPokey->ring_size;
-		u32 ring_mask = pPokey->ring_mask;
-		u32 avail = pPokey->ring_count;
-		u32 to_read = (count < avail) ? count : avail;
-		u32 first = to_read;
-		u32 to_end = ring_size - pPokey->ring_read;
+		return;
+	}
 
-		if(first > to_end)
-		{
-			first = to_end;
-		}
+	PokeyAudio_WriteWavHeader(pPokey, (u32)(pPokey->samples_out * 2));
+	fclose(pPokey->pWavFile);
+	pPokey->pWavFile = NULL;
+}
+
+/* Hands finished samples to the backend. The null and file backends
+   consume them immediately, in emulated time. */
+static void PokeyAudio_Output(PokeyState_t *pPokey, const int16_t *pSamples, u32 count)
+{
+	pPokey->samples_out += count;
 
-		memcpy(pSamples, &pPokey->ring[pPokey->ring_read], (size_t)first * sizeof(int16_t));
+	if(pPokey->backend == POKEY_AUDIO_SDL)
+	{
+		PokeyAudio_RingWrite(pPokey, pSamples, count);
+	}
+	else if(pPokey->pWavFile)
+	{
+		u8 aBytes[256 * 2];
+		u32 i;
 
+		while(count)
 		{
-			u32 second = to_read - first;
-			if(second)
+			u32 chunk = (count < 256) ? count : 256;
+
+			for(i = 0; i < chunk; i++)
 			{
-				memcpy(&pSamples[first], &pPokey->ring[0], (size_t)second * sizeof(int16_t));
+				PokeyAudio_PutLe(&aBytes[i * 2], (u32)(u16)pSamples[i], 2);
 			}
+			fwrite(aBytes, 2, chunk, pPokey->pWavFile);
+			pSamples += chunk;
+			count -= chunk;
 		}
-
-		pPokey->ring_read = PokeyAudio_RingWrap(pPokey->ring_read + to_read, ring_size, ring_mask);
-		pPokey->ring_count -= to_read;
-		return to_read;
 	}
 }
 
@@ -287,53 +485,100 @@ static void PokeyAudio_RecomputeClocks(PokeyAudioChannel_t *pChannels, u8 audctl
 	pChannels[3].clk_div_cycles = base;
 }
 
-static void PokeyAudio_PolyStep(PokeyState_t *pPokey)
+/* Period of each polynomial counter. The reset states lie on the full
+   cycle, so a generator is just a position modulo its period. */
+#define POKEY_POLY4_PERIOD 15u
+#define POKEY_POLY5_PERIOD 31u
+#define POKEY_POLY9_PERIOD 511u
+#define POKEY_POLY17_PERIOD 131071u
+
+/* Output bit of poly4/poly5/poly9 and the low byte of poly17 (RANDOM) at
+   each position, built once and shared by all instances. */
+static u8 m_aPoly4[POKEY_POLY4_PERIOD];
+static u8 m_aPoly5[POKEY_POLY5_PERIOD];
+static u8 m_aPoly9[POKEY_POLY9_PERIOD];
+static u8 m_aPoly17[POKEY_POLY17_PERIOD];
+static AtariIoOnce_t m_tPolyTablesOnce;
+
+static void PokeyAudio_BuildPolyTables(void)
 {
-	if(!pPokey)
-	{
-		return;
-	}
+	u32 l4 = 0x00u;
+	u32 l5 = 0x00u;
+	u32 l9 = 0x1ffu;
+	u32 l17 = 0x1ffffu;
+	u32 i;
 
-	/* Polynomials clocked by the ~1.79MHz (PAL) master clock.
-	   The exact stepping matters for the perceived noise/buzz; these taps
+	/* The exact stepping matters for the perceived noise/buzz; these taps
 	   match widely used reference implementations. */
+	for(i = 0; i < POKEY_POLY17_PERIOD; i++)
 	{
+		if(i < POKEY_POLY4_PERIOD)
+		{
+			m_aPoly4[i] = (u8)(l4 & 1u);
+		}
+		if(i < POKEY_POLY5_PERIOD)
+		{
+			m_aPoly5[i] = (u8)(l5 & 1u);
+		}
+		if(i < POKEY_POLY9_PERIOD)
+		{
+			m_aPoly9[i] = (u8)(l9 & 1u);
+		}
+		m_aPoly17[i] = (u8)(l17 & 0xffu);
+
 		/* poly4/poly5: shift left, new bit in bit0. */
-		u32 l4 = (u32)pPokey->lfsr4 & 0x0fu;
-		u32 l5 = (u32)pPokey->lfsr5 & 0x1fu;
-		u32 new4 = (u32)(~(((l4 >> 2) ^ (l4 >> 3)) & 1u) & 1u);
-		u32 new5 = (u32)(~(((l5 >> 2) ^ (l5 >> 4)) & 1u) & 1u);
-		pPokey->lfsr4 = (u8)(((l4 << 1) | new4) & 0x0fu);
-		pPokey->lfsr5 = (u8)(((l5 << 1) | new5) & 0x1fu);
-	}
+		l4 = ((l4 << 1) | (~((l4 >> 2) ^ (l4 >> 3)) & 1u)) & 0x0fu;
+		l5 = ((l5 << 1) | (~((l5 >> 2) ^ (l5 >> 4)) & 1u)) & 0x1fu;
 
-	{
 		/* poly9: 9-bit LFSR (BIT0 ^ BIT5). */
-		u32 l9 = (u32)pPokey->lfsr9 & 0x1ffu;
-		u32 in9 = ((l9 >> 0) ^ (l9 >> 5)) & 1u;
-		l9 = (l9 >> 1) | (in9 << 8);
-		pPokey->lfsr9 = (u16)(l9 & 0x1ffu);
-	}
+		l9 = ((l9 >> 1) | (((l9 ^ (l9 >> 5)) & 1u) << 8)) & 0x1ffu;
 
-	{
 		/* poly17: POKEY-specific 17-bit polynomial. */
-		u32 l17 = pPokey->lfsr17 & 0x1ffffu;
-		u32 in8 = ((l17 >> 8) ^ (l17 >> 13)) & 1u;
-		u32 in0 = l17 & 1u;
-		l17 >>= 1;
-		l17 = (l17 & 0xff7fu) | (in8 << 7);
-		l17 = (l17 & 0xffffu) | (in0 << 16);
-		pPokey->lfsr17 = l17 & 0x1ffffu;
+		{
+			u32 in8 = ((l17 >> 8) ^ (l17 >> 13)) & 1u;
+			u32 in0 = l17 & 1u;
+			l17 >>= 1;
+			l17 = (l17 & 0xff7fu) | (in8 << 7);
+			l17 = ((l17 & 0xffffu) | (in0 << 16)) & 0x1ffffu;
+		}
 	}
 }
 
+static void PokeyAudio_InitPolyTables(void)
+{
+	AtariIoOnce(&m_tPolyTablesOnce, PokeyAudio_BuildPolyTables);
+}
+
+static u32 PokeyAudio_PolySeek(u32 pos, u64 cycles, u32 period)
+{
+	pos += (u32)(cycles % period);
+	return (pos >= period) ? (pos - period) : pos;
+}
+
+static void PokeyAudio_PolyReset(PokeyState_t *pPokey)
+{
+	pPokey->poly17_pos = 0;
+	pPokey->poly9_pos = 0;
+	pPokey->poly5_pos = 0;
+	pPokey->poly4_pos = 0;
+}
+
+/* Polynomials clocked by the ~1.79MHz (PAL) master clock. */
+static void PokeyAudio_PolyAdvance(PokeyState_t *pPokey, u64 cycles)
+{
+	pPokey->poly4_pos = PokeyAudio_PolySeek(pPokey->poly4_pos, cycles, POKEY_POLY4_PERIOD);
+	pPokey->poly5_pos = PokeyAudio_PolySeek(pPokey->poly5_pos, cycles, POKEY_POLY5_PERIOD);
+	pPokey->poly9_pos = PokeyAudio_PolySeek(pPokey->poly9_pos, cycles, POKEY_POLY9_PERIOD);
+	pPokey->poly17_pos = PokeyAudio_PolySeek(pPokey->poly17_pos, cycles, POKEY_POLY17_PERIOD);
+}
+
 static u8 PokeyAudio_Poly17Bit(PokeyState_t *pPokey, u8 audctl)
 {
 	if(!pPokey)
 	{
 		return 0;
 	}
-	return (u8)(((audctl & 0x80) ? pPokey->lfsr9 : pPokey->lfsr17) & 1u);
+	return (audctl & 0x80) ? m_aPoly9[pPokey->poly9_pos] : (u8)(m_aPoly17[pPokey->poly17_pos] & 1u);
 }
 
 static void PokeyAudio_ChannelClockOut(PokeyState_t *pPokey, PokeyAudioChannel_t *pCh, u8 audctl)
@@ -364,7 +609,7 @@ static void PokeyAudio_ChannelClockOut(PokeyState_t *pPokey, PokeyAudioChannel_t
 	/* poly5 gates the flip-flop clock for distortions 0..3. */
 	if(dist <= 3)
 	{
-		poly5 = (u8)(pPokey->lfsr5 & 1u);
+		poly5 = m_aPoly5[pPokey->poly5_pos];
 		if(!poly5)
 		{
 			return;
@@ -384,7 +629,7 @@ static void PokeyAudio_ChannelClockOut(PokeyState_t *pPokey, PokeyAudioChannel_t
 	/* 6: 4-bit poly noise (latch poly4). */
 	case 2:
 	case 6:
-		pCh->output = (u8)(pPokey->lfsr4 & 1u);
+		pCh->output = m_aPoly4[pPokey->poly4_pos];
 		break;
 
 	/* 1/3: square buzz (poly5 gated toggle). */
@@ -481,7 +726,7 @@ static void PokeyAudio_StepCpuCycle(
 	}
 
 	/* Master clock tick: advance polynomial counters. */
-	PokeyAudio_PolyStep(pPokey);
+	PokeyAudio_PolyAdvance(pPokey, 1);
 
 	if(pair12)
 	{
@@ -580,6 +825,115 @@ static void PokeyAudio_StepCpuCycle(
 	}
 }
 
+/* Cycles until the divider driven by pClock underflows pCounter. A
+   prescaler left above its divisor by an AUDCTL change returns 1 so the
+   next cycles are stepped singly until it is back in range. */
+static u64 PokeyAudio_CyclesToUnderflow(const PokeyAudioChannel_t *pClock, const PokeyAudioChannel_t *pCounter)
+{
+	u64 ticks = pCounter->counter ? (u64)pCounter->counter : 1u;
+	u64 div = pClock->clk_div_cycles;
+
+	if(div == 1)
+	{
+		return ticks;
+	}
+	if(div == 0 || pClock->clk_acc_cycles >= div)
+	{
+		return 1;
+	}
+
+	return (div - pClock->clk_acc_cycles) + (ticks - 1) * div;
+}
+
+/* Advances a divider by fewer cycles than PokeyAudio_CyclesToUnderflow. */
+static void PokeyAudio_DividerAdvance(PokeyAudioChannel_t *pClock, PokeyAudioChannel_t *pCounter, u64 cycles)
+{
+	u64 ticks = cycles;
+
+	if(pClock->clk_div_cycles != 1)
+	{
+		u64 acc = (u64)pClock->clk_acc_cycles + cycles;
+		ticks = acc / pClock->clk_div_cycles;
+		pClock->clk_acc_cycles = (u32)(acc % pClock->clk_div_cycles);
+	}
+
+	pCounter->counter -= (u32)ticks;
+}
+
+/* Cycles from now up to and including the next one whose step underflows
+   a divider; only those steps can change the mixer level. */
+static u64 PokeyAudio_CyclesToNextEdge(PokeyState_t *pPokey)
+{
+	PokeyAudioChannel_t *pChannels = pPokey->aChannels;
+	u64 cycles;
+	u64 other;
+
+	if((pPokey->skctl & 0x03) == 0)
+	{
+		return (u64)-1;
+	}
+
+	if(pPokey->audctl & 0x10)
+	{
+		cycles = PokeyAudio_CyclesToUnderflow(&pChannels[0], &pChannels[1]);
+	}
+	else
+	{
+		cycles = PokeyAudio_CyclesToUnderflow(&pChannels[0], &pChannels[0]);
+		other = PokeyAudio_CyclesToUnderflow(&pChannels[1], &pChannels[1]);
+		cycles = (other < cycles) ? other : cycles;
+	}
+
+	if(pPokey->audctl & 0x08)
+	{
+		other = PokeyAudio_CyclesToUnderflow(&pChannels[2], &pChannels[3]);
+		cycles = (other < cycles) ? other : cycles;
+	}
+	else
+	{
+		other = PokeyAudio_CyclesToUnderflow(&pChannels[2], &pChannels[2]);
+		cycles = (other < cycles) ? other : cycles;
+		other = PokeyAudio_CyclesToUnderflow(&pChannels[3], &pChannels[3]);
+		cycles = (other < cycles) ? other : cycles;
+	}
+
+	return cycles;
+}
+
+/* Steps that underflow no divider: only the polynomials, prescalers and
+   counters move. */
+static void PokeyAudio_AdvanceQuietCycles(PokeyState_t *pPokey, u64 cycles)
+{
+	PokeyAudioChannel_t *pChannels = pPokey->aChannels;
+
+	if(cycles == 0 || (pPokey->skctl & 0x03) == 0)
+	{
+		return;
+	}
+
+	PokeyAudio_PolyAdvance(pPokey, cycles);
+
+	if(pPokey->audctl & 0x10)
+	{
+		PokeyAudio_DividerAdvance(&pChannels[0], &pChannels[1], cycles);
+	}
+	else
+	{
+		PokeyAudio_DividerAdvance(&pChannels[0], &pChannels[0], cycles);
+		PokeyAudio_DividerAdvance(&pChannels[1], &pChannels[1], cycles);
+	}
+
+	if(pPokey->audctl & 0x08)
+	{
+		PokeyAudio_DividerAdvance(&pChannels[2], &pChannels[3], cycles);
+	}
+	else
+	{
+		PokeyAudio_DividerAdvance(&pChannels[2], &pChannels[2], cycles);
+		PokeyAudio_DividerAdvance(&pChannels[3], &pChannels[3], cycles);
+	}
+}
+
 /* Normalize unipolar mixer output (0..28000), apply 0.75 gain, DC block, and
    scale to int16. Max-vol-all-ch soft-clipped ~= 26000, so 28000 headroom. */
 static int16_t PokeyAudio_FinalizeSample(PokeyState_t *pPokey, int32_t raw)
@@ -600,6 +954,123 @@ static int16_t PokeyAudio_FinalizeSample(PokeyState_t *pPokey, int32_t raw)
 	return (int16_t)out;
 }
 
+/* Band-limited impulse per sub-sample phase, each phase summing to exactly
+   1 << POKEY_BLEP_SCALE_BITS so a finished step lands on the exact level.
+   Built once and shared by all instances. */
+static int32_t m_aBlepKernel[POKEY_BLEP_PHASES][POKEY_BLEP_TAPS];
+static AtariIoOnce_t m_tBlepKernelOnce;
+
+static void PokeyAudio_BuildBlepKernel(void)
+{
+	const double cutoff = 0.45; /* of the output sample rate */
+	const double pi = 3.14159265358979;
+	u32 p;
+	u32 j;
+
+	for(p = 0; p < POKEY_BLEP_PHASES; p++)
+	{
+		double aTaps[POKEY_BLEP_TAPS];
+		double f = (double)p / (double)POKEY_BLEP_PHASES;
+		double sum = 0.0;
+		int32_t total = 0;
+		u32 peak = 0;
+
+		/* Tap j is output sample j after the step, (j + 1 - f) samples later;
+		   the impulse is centered half the kernel length out. */
+		for(j = 0; j < POKEY_BLEP_TAPS; j++)
+		{
+			double x = (double)j + 1.0 - f - (double)(POKEY_BLEP_TAPS / 2);
+			double w = 0.42 + 0.5 * cos(2.0 * pi * x / (double)POKEY_BLEP_TAPS) +
+					   0.08 * cos(4.0 * pi * x / (double)POKEY_BLEP_TAPS);
+			double h = 2.0 * cutoff;
+
+			if(x != 0.0)
+			{
+				h = sin(2.0 * pi * cutoff * x) / (pi * x);
+			}
+			if(w < 0.0)
+			{
+				w = 0.0;
+			}
+
+			aTaps[j] = h * w;
+			sum += aTaps[j];
+		}
+
+		for(j = 0; j < POKEY_BLEP_TAPS; j++)
+		{
+			m_aBlepKernel[p][j] = (int32_t)floor(
+				aTaps[j] / sum * (double)(1 << POKEY_BLEP_SCALE_BITS) + 0.5);
+			total += m_aBlepKernel[p][j];
+			if(m_aBlepKernel[p][j] > m_aBlepKernel[p][peak])
+			{
+				peak = j;
+			}
+		}
+
+		/* Fold the rounding residue into the peak tap. */
+		m_aBlepKernel[p][peak] += (1 << POKEY_BLEP_SCALE_BITS) - total;
+	}
+}
+
+static void PokeyAudio_InitBlepKernel(void)
+{
+	AtariIoOnce(&m_tBlepKernelOnce, PokeyAudio_BuildBlepKernel);
+}
+
+/* Mixer level 0..28000 -> int16 with 0.75 gain (as PokeyAudio_FinalizeSample),
+   in 16.16 fixed point: 0.75 * 32767 / 28000 * 65536. */
+#define POKEY_DC_GAIN_Q16 57521
+
+/* Fixed-point counterpart of the DC block in PokeyAudio_FinalizeSample, run
+   over a whole block of integrated levels. The gain and narrowing passes are
+   plain element-wise loops; only the one-pole recursion is serial. */
+static void PokeyAudio_DcBlockBlock(PokeyState_t *pPokey, int32_t *pRaw, int16_t *pSamples, u32 count)
+{
+	int64_t x1 = pPokey->dc_x1_fp;
+	int64_t y1 = pPokey->dc_y1_fp;
+	int64_t r = pPokey->dc_r_q15;
+	u32 i;
+
+	/* Scale to 1/256 output LSBs. */
+	for(i = 0; i < count; i++)
+	{
+		pRaw[i] = (int32_t)(((int64_t)pRaw[i] * POKEY_DC_GAIN_Q16) >> 8);
+	}
+
+	for(i = 0; i < count; i++)
+	{
+		int64_t x = pRaw[i];
+		int64_t y = x - x1 + ((r * y1) >> 15);
+
+		x1 = x;
+		y1 = y;
+		pRaw[i] = (int32_t)(y >> 8);
+	}
+
+	for(i = 0; i < count; i++)
+	{
+		int32_t out = pRaw[i];
+
+		out = (out > 32767) ? 32767 : out;
+		out = (out < -32768) ? -32768 : out;
+		pSamples[i] = (int16_t)out;
+	}
+
+	pPokey->dc_x1_fp = x1;
+	pPokey->dc_y1_fp = y1;
+}
+
+static void PokeyAudio_BlepReset(PokeyState_t *pPokey)
+{
+	memset(pPokey->blep_deltas, 0, sizeof(pPokey->blep_deltas));
+	pPokey->blep_level = 0;
+	pPokey->blep_integrator = 0;
+	pPokey->blep_read = 0;
+	pPokey->dc_x1_fp = 0;
+	pPokey->dc_y1_fp = 0;
+}
+
 static int32_t PokeyAudio_MixCycleLevel(PokeyState_t *pPokey, PokeyAudioChannel_t *pChannels, u8 audctl)
 {
 	u32 i;
@@ -688,6 +1159,13 @@ static PokeyState_t *Pokey_GetState(_6502_Context_t *pContext)
 	return (PokeyState_t *)pIoData->pPokey;
 }
 
+static void Pokey_SioReportStatus(PokeyState_t *pPokey, u64 llCycle)
+{
+	pPokey->llSioStatusCycle = CYCLE_NEVER;
+	pPokey->llSioStatusLastCycle = llCycle;
+	pPokey->SioStatusCallback(pPokey->pSioStatusUser, pPokey->sSioStatusSector);
+}
+
 u64 Pokey_TimerPeriodCpuCycles(_6502_Context_t *pContext, u8 timer)
 {
 	u8 audctl;
@@ -767,55 +1245,226 @@ u64 Pokey_TimerPeriodCpuCycles(_6502_Context_t *pContext, u8 timer)
 	}
 }
 
-void Pokey_Init(_6502_Context_t *pContext)
+static void Pokey_IrqEvent(_6502_Context_t *pContext, u8 cIrq)
+{
+	RAM[IO_IRQEN_IRQST] &= ~cIrq;
+	if(SRAM[IO_IRQEN_IRQST] & cIrq)
+	{
+		_6502_Irq(pContext);
+	}
+}
+
+static void Pokey_SerialOutputTransmissionDoneEvent(_6502_Context_t *pContext, u64 llMasterCycle)
+{
+#ifdef VERBOSE_SIO
+	printf("             [%16llu] SERIAL_OUTPUT_TRANSMISSION_DONE request!\n", pContext->llCycleCounter);
+#endif
+	Pokey_IrqEvent(pContext, IRQ_SERIAL_OUTPUT_TRANSMISSION_DONE);
+	AtariIoScheduleTimedEvent(pContext, TIMED_EVENT_SERIAL_OUTPUT_TRANSMISSION_DONE, CYCLE_NEVER);
+	(void)llMasterCycle;
+}
+
+static void Pokey_SerialOutputNeedDataEvent(_6502_Context_t *pContext, u64 llMasterCycle)
+{
+#ifdef VERBOSE_SIO
+	printf("             [%16llu] SERIAL_OUTPUT_DATA_NEEDED request!\n", pContext->llCycleCounter);
+#endif
+	Pokey_IrqEvent(pContext, IRQ_SERIAL_OUTPUT_DATA_NEEDED);
+	AtariIoScheduleTimedEvent(pContext, TIMED_EVENT_SERIAL_OUTPUT_NEED_DATA, CYCLE_NEVER);
+	(void)llMasterCycle;
+}
+
+static void Pokey_SerialInputDataReadyEvent(_6502_Context_t *pContext, u64 llMasterCycle)
+{
+#ifdef VERBOSE_SIO
+	printf("             [%16llu] SERIAL_INPUT_DATA_READY request!\n", pContext->llCycleCounter);
+#endif
+	Pokey_IrqEvent(pContext, IRQ_SERIAL_INPUT_DATA_READY);
+	AtariIoScheduleTimedEvent(pContext, TIMED_EVENT_SERIAL_INPUT_DATA_READY, CYCLE_NEVER);
+	(void)llMasterCycle;
+}
+
+/* Tape time: frozen while the motor is off. */
+static u64 Pokey_CassetteTime(_6502_Context_t *pContext)
 {
 	IoData_t *pIoData = (IoData_t *)pContext->pIoData;
-	PokeyState_t *pPokey;
-	SDL_AudioSpec want;
-	u32 i;
 
-	if(!pIoData)
+	if(!pIoData->bCassetteMotor)
 	{
-		return;
+		return pIoData->llCassetteTime;
 	}
 
-	pPokey = (PokeyState_t *)malloc(sizeof(PokeyState_t));
-	if(!pPokey)
+	return pIoData->llCassetteTime + (PokeyMasterReferenceCycle(pContext) - pIoData->llCassetteMotorCycle);
+}
+
+/* Arms TIMED_EVENT_CASSETTE_BYTE for the next tape byte to arrive. */
+static void Pokey_CassetteSchedule(_6502_Context_t *pContext)
+{
+	IoData_t *pIoData = (IoData_t *)pContext->pIoData;
+	u64 llTime = Pokey_CassetteTime(pContext);
+	u64 llEndTime;
+
+	if(pIoData->pCassette && pIoData->bCassetteMotor &&
+	   Cassette_NextByte(pIoData->pCassette, llTime, &pIoData->cCassetteByte, &llEndTime))
 	{
-		return;
+		AtariIoScheduleTimedEvent(
+			pContext,
+			TIMED_EVENT_CASSETTE_BYTE,
+			PokeyMasterReferenceCycle(pContext) + (llEndTime - llTime));
 	}
-	memset(pPokey, 0, sizeof(PokeyState_t));
+	else
+	{
+		AtariIoScheduleTimedEvent(pContext, TIMED_EVENT_CASSETTE_BYTE, CYCLE_NEVER);
+	}
+}
 
-	/* Prefer 48kHz to avoid common host-side resampling. */
-	pPokey->sample_rate_hz = 48000;
-	pPokey->cpu_hz = Pokey_CpuHz();
+/* A tape byte's stop bit has passed: it is in SERIN. */
+static void Pokey_CassetteByteEvent(_6502_Context_t *pContext, u64 llMasterCycle)
+{
+	IoData_t *pIoData = (IoData_t *)pContext->pIoData;
+
+#ifdef VERBOSE_SIO
+	printf("             [%16llu] CASSETTE byte %02X!\n", pContext->llCycleCounter, pIoData->cCassetteByte);
+#endif
+	RAM[IO_SEROUT_SERIN] = pIoData->cCassetteByte;
+	Pokey_IrqEvent(pContext, IRQ_SERIAL_INPUT_DATA_READY);
+	Pokey_CassetteSchedule(pContext);
+	(void)llMasterCycle;
+}
+
+void Pokey_SetCassetteMotor(_6502_Context_t *pContext, u8 bOn)
+{
+	IoData_t *pIoData = (IoData_t *)pContext->pIoData;
+
+	pIoData->llCassetteTime = Pokey_CassetteTime(pContext);
+	pIoData->llCassetteMotorCycle = PokeyMasterReferenceCycle(pContext);
+	pIoData->bCassetteMotor = bOn ? 1 : 0;
+	Pokey_CassetteSchedule(pContext);
+}
+
+static void Pokey_TimerEvent(
+	_6502_Context_t *pContext,
+	u64 llMasterCycle,
+	u8 cTimer,
+	TimedEventId_t eEvent,
+	u8 cIrq)
+{
+	IoData_t *pIoData = (IoData_t *)pContext->pIoData;
+	u64 llCycle = *pIoData->aTimedEvents[eEvent].pCycle;
+	u64 period = Pokey_TimerPeriodCpuCycles(pContext, cTimer);
+
+	Pokey_IrqEvent(pContext, cIrq);
+
+	if(period == 0)
+	{
+		AtariIoScheduleTimedEvent(pContext, eEvent, CYCLE_NEVER);
+	}
+	else
+	{
+		/* Next underflow after llMasterCycle; late dispatches skip the
+		 * periods they missed.
+		 */
+		AtariIoScheduleTimedEvent(
+			pContext,
+			eEvent,
+			llCycle + ((llMasterCycle - llCycle) / period + 1) * period);
+	}
+}
+
+static void Pokey_Timer1Event(_6502_Context_t *pContext, u64 llMasterCycle)
+{
+#ifdef VERBOSE_SIO
+	printf("             [%16llu] TIMER_1 request!\n", pContext->llCycleCounter);
+#endif
+	Pokey_TimerEvent(pContext, llMasterCycle, 1, TIMED_EVENT_TIMER_1, IRQ_TIMER_1);
+}
+
+static void Pokey_Timer2Event(_6502_Context_t *pContext, u64 llMasterCycle)
+{
+#ifdef VERBOSE_SIO
+	printf("             [%16llu] TIMER_2 request!\n", pContext->llCycleCounter);
+#endif
+	Pokey_TimerEvent(pContext, llMasterCycle, 2, TIMED_EVENT_TIMER_2, IRQ_TIMER_2);
+}
+
+static void Pokey_Timer4Event(_6502_Context_t *pContext, u64 llMasterCycle)
+{
+#ifdef VERBOSE_SIO
+	printf("             [%16llu] TIMER_4 request!\n", pContext->llCycleCounter);
+#endif
+	Pokey_TimerEvent(pContext, llMasterCycle, 4, TIMED_EVENT_TIMER_4, IRQ_TIMER_4);
+}
+
+void Pokey_Init(_6502_Context_t *pContext, u8 cAudioBackend, const char *pAudioFileName)
+{
+	IoData_t *pIoData = (IoData_t *)pContext->pIoData;
+	PokeyState_t *pPokey;
+	SDL_AudioSpec want;
+	u32 i;
+
+	if(!pIoData)
+	{
+		return;
+	}
+
+	PokeyAudio_InitPolyTables();
+	PokeyAudio_InitBlepKernel();
+
+	AtariIoRegisterTimedEvent(
+		pContext, TIMED_EVENT_SERIAL_OUTPUT_TRANSMISSION_DONE,
+		&pIoData->llSerialOutputTransmissionDoneCycle, 0, Pokey_SerialOutputTransmissionDoneEvent);
+	AtariIoRegisterTimedEvent(
+		pContext, TIMED_EVENT_SERIAL_OUTPUT_NEED_DATA,
+		&pIoData->llSerialOutputNeedDataCycle, 0, Pokey_SerialOutputNeedDataEvent);
+	AtariIoRegisterTimedEvent(
+		pContext, TIMED_EVENT_SERIAL_INPUT_DATA_READY,
+		&pIoData->llSerialInputDataReadyCycle, 0, Pokey_SerialInputDataReadyEvent);
+	AtariIoRegisterTimedEvent(
+		pContext, TIMED_EVENT_TIMER_1, &pIoData->llTimer1Cycle, 0, Pokey_Timer1Event);
+	AtariIoRegisterTimedEvent(
+		pContext, TIMED_EVENT_TIMER_2, &pIoData->llTimer2Cycle, 0, Pokey_Timer2Event);
+	AtariIoRegisterTimedEvent(
+		pContext, TIMED_EVENT_TIMER_4, &pIoData->llTimer4Cycle, 0, Pokey_Timer4Event);
+	AtariIoRegisterTimedEvent(
+		pContext, TIMED_EVENT_CASSETTE_BYTE, &pIoData->llCassetteByteCycle, 0, Pokey_CassetteByteEvent);
+
+	pPokey = (PokeyState_t *)malloc(sizeof(PokeyState_t));
+	if(!pPokey)
+	{
+		return;
+	}
+	memset(pPokey, 0, sizeof(PokeyState_t));
+
+	/* Prefer 48kHz to avoid common host-side resampling. */
+	pPokey->sample_rate_hz = 48000;
+	pPokey->cpu_hz = Pokey_CpuHz();
 	pPokey->cycles_per_sample_fp =
 		(((u64)pPokey->cpu_hz) << 32) / (u64)pPokey->sample_rate_hz;
 	pPokey->cycles_per_sample_fp_base = pPokey->cycles_per_sample_fp;
 	pPokey->last_cycle = pContext->llCycleCounter;
 	pPokey->sample_phase_fp = 0;
+	pPokey->llSioStatusCycle = CYCLE_NEVER;
 
-	pPokey->lfsr17 = 0x1ffffu;
-	pPokey->lfsr9 = 0x01ffu;
-	pPokey->lfsr5 = 0x00u;
-	pPokey->lfsr4 = 0x00u;
+	PokeyAudio_PolyReset(pPokey);
 	pPokey->hp1_latch = 0;
 	pPokey->hp2_latch = 0;
 	pPokey->dc_block_r = (float)exp(-2.0 * 3.14159265358979 * 20.0 / (double)pPokey->sample_rate_hz);
 	pPokey->dc_block_x1 = 0.0f;
 	pPokey->dc_block_y1 = 0.0f;
+	pPokey->dc_r_q15 = (int32_t)floor((double)pPokey->dc_block_r * 32768.0 + 0.5);
+	pPokey->synthesis_mode = POKEY_SYNTHESIS_BLEP;
+	PokeyAudio_BlepReset(pPokey);
 	/* Ring buffer to absorb timing variations between emulation and audio output. */
 	pPokey->ring_size = 8192;
-	pPokey->ring_mask = ((pPokey->ring_size & (pPokey->ring_size - 1u)) == 0) ? (pPokey->ring_size - 1u) : 0;
+	pPokey->ring_mask = pPokey->ring_size - 1u;
 	pPokey->ring = (int16_t *)malloc(sizeof(int16_t) * pPokey->ring_size);
 	if(pPokey->ring)
 	{
 		memset(pPokey->ring, 0, sizeof(int16_t) * pPokey->ring_size);
 	}
 
-	pPokey->ring_write = 0;
-	pPokey->ring_read = 0;
-	pPokey->ring_count = 0;
+	SDL_AtomicSet(&pPokey->ring_write, 0);
+	SDL_AtomicSet(&pPokey->ring_read, 0);
 
 	/* Default target: 1/4 ring for low latency. This gets refined after SDL_OpenAudio. */
 	pPokey->target_buffer_samples = PokeyAudio_ClampU32(pPokey->ring_size / 4u, 256u, (pPokey->ring_size > 0) ? (pPokey->ring_size - 1u) : 0u);
@@ -841,6 +1490,28 @@ void Pokey_Init(_6502_Context_t *pContext)
 	pIoData->llPotScanTerminalCycle = CYCLE_NEVER;
 	pIoData->cPotScanCounter = 0;
 
+	pPokey->backend = (cAudioBackend <= POKEY_AUDIO_FILE) ? cAudioBackend : POKEY_AUDIO_SDL;
+	if(pPokey->backend != POKEY_AUDIO_SDL)
+	{
+		if(pPokey->backend == POKEY_AUDIO_FILE)
+		{
+			pPokey->pWavFile = pAudioFileName ? fopen(pAudioFileName, "wb") : NULL;
+			if(!pPokey->pWavFile)
+			{
+				/* Keep emulator running without audio. */
+				fprintf(stderr, "Pokey_Init: cannot write audio file %s\n",
+						pAudioFileName ? pAudioFileName : "(none)");
+				pIoData->pPokey = pPokey;
+				return;
+			}
+			PokeyAudio_WriteWavHeader(pPokey, 0);
+		}
+
+		pPokey->audio_opened = 1;
+		pIoData->pPokey = pPokey;
+		return;
+	}
+
 	memset(&want, 0, sizeof(want));
 	want.freq = (int)pPokey->sample_rate_hz;
 	want.format = AUDIO_S16SYS;
@@ -909,6 +1580,8 @@ void Pokey_Init(_6502_Context_t *pContext)
 	pIoData->pPokey = pPokey;
 }
 
+static void PokeyAudio_StopThread(PokeyState_t *pPokey);
+
 void Pokey_Close(_6502_Context_t *pContext)
 {
 	IoData_t *pIoData = (IoData_t *)pContext->pIoData;
@@ -925,7 +1598,10 @@ void Pokey_Close(_6502_Context_t *pContext)
 		return;
 	}
 
-	if(pPokey->audio_opened)
+	PokeyAudio_StopThread(pPokey);
+	PokeyAudio_CloseWavFile(pPokey);
+
+	if(pPokey->audio_opened && pPokey->backend == POKEY_AUDIO_SDL)
 	{
 		SDL_LockAudio();
 		pPokey->audio_opened = 0;
@@ -937,77 +1613,202 @@ void Pokey_Close(_6502_Context_t *pContext)
 		SDL_QuitSubSystem(SDL_INIT_AUDIO);
 	}
 
+	free(pPokey->capture);
+	free(pPokey->log);
 	free(pPokey->ring);
 	free(pPokey);
 	pIoData->pPokey = NULL;
 }
 
-void Pokey_Sync(_6502_Context_t *pContext, u64 llCycleCounter)
-{
-	PokeyState_t *pPokey;
-	int16_t tmp[512];
-	u32 tmpCount = 0;
+#define POKEY_SYNC_SAMPLE_BUFFER 512u
 
-	u64 cur;
+/* Keeps a run's length in 32.32 fixed point well inside 64 bits. */
+#define POKEY_MAX_RUN_CYCLES (1u << 24)
 
-	pPokey = Pokey_GetState(pContext);
-	if(!pPokey || !pPokey->ring)
+/* Box-filters a constant mixer level over a run of cycles into output
+   samples, flushing the sample buffer to the ring when it fills up. */
+static void PokeyAudio_IntegrateLevel(
+	PokeyState_t *pPokey,
+	int32_t level,
+	u64 cycles,
+	u64 adjusted_cps,
+	int16_t *pSamples,
+	u32 *pSampleCount)
+{
+	u64 cycles_needed_fp;
+	u64 batch_fp = cycles << 32;
+
+	/* adjusted_cps can decrease between sync calls due adaptive rate control.
+	   Keep phase/accum consistent so subtraction below cannot underflow. */
+	if(pPokey->sample_phase_fp >= adjusted_cps)
 	{
-		if(pPokey)
+		int64_t avg_level = 0;
+		if(pPokey->sample_phase_fp != 0)
 		{
-			pPokey->last_cycle = llCycleCounter;
+			avg_level = pPokey->sample_accum / (int64_t)pPokey->sample_phase_fp;
 		}
-		return;
+		pPokey->sample_accum = avg_level * (int64_t)adjusted_cps;
+		pPokey->sample_phase_fp = adjusted_cps;
 	}
 
-	if(!pPokey->audio_opened)
+	cycles_needed_fp = adjusted_cps - pPokey->sample_phase_fp;
+
+	if(batch_fp < cycles_needed_fp)
 	{
-		pPokey->last_cycle = llCycleCounter;
+		pPokey->sample_accum += (int64_t)level * (int64_t)batch_fp;
+		pPokey->sample_phase_fp += batch_fp;
 		return;
 	}
 
-	if(llCycleCounter <= pPokey->last_cycle)
+	pPokey->sample_accum += (int64_t)level * (int64_t)cycles_needed_fp;
+	pSamples[(*pSampleCount)++] = PokeyAudio_FinalizeSample(pPokey,
+															 (int32_t)(pPokey->sample_accum / (int64_t)adjusted_cps));
+
+	if(*pSampleCount == POKEY_SYNC_SAMPLE_BUFFER)
+	{
+		PokeyAudio_Output(pPokey, pSamples, *pSampleCount);
+		*pSampleCount = 0;
+	}
+
+	batch_fp -= cycles_needed_fp;
+	while(batch_fp >= adjusted_cps)
+	{
+		pSamples[(*pSampleCount)++] = PokeyAudio_FinalizeSample(pPokey, level);
+
+		if(*pSampleCount == POKEY_SYNC_SAMPLE_BUFFER)
+		{
+			PokeyAudio_Output(pPokey, pSamples, *pSampleCount);
+			*pSampleCount = 0;
+		}
+		batch_fp -= adjusted_cps;
+	}
+
+	pPokey->sample_accum = (int64_t)level * (int64_t)batch_fp;
+	pPokey->sample_phase_fp = batch_fp;
+}
+
+/* Holds a constant mixer level over a run of cycles in BLEP mode: a level
+   change at the start of the run adds a band-limited step at its sub-sample
+   phase, then every output sample crossed just integrates the delta ring. */
+static void PokeyAudio_BlepLevel(
+	PokeyState_t *pPokey,
+	int32_t level,
+	u64 cycles,
+	u64 adjusted_cps,
+	int32_t *pRaw,
+	int16_t *pSamples,
+	u32 *pSampleCount)
+{
+	if(level != pPokey->blep_level)
+	{
+		int64_t delta = (int64_t)level - (int64_t)pPokey->blep_level;
+		u64 phase = (pPokey->sample_phase_fp * POKEY_BLEP_PHASES) / adjusted_cps;
+		const int32_t *pKernel;
+		u32 j;
+
+		/* adjusted_cps can shrink between syncs and leave a sample overdue. */
+		if(phase >= POKEY_BLEP_PHASES)
+		{
+			phase = POKEY_BLEP_PHASES - 1;
+		}
+
+		pKernel = m_aBlepKernel[phase];
+		for(j = 0; j < POKEY_BLEP_TAPS; j++)
+		{
+			pPokey->blep_deltas[(pPokey->blep_read + j) & POKEY_BLEP_TAP_MASK] += delta * pKernel[j];
+		}
+		pPokey->blep_level = level;
+	}
+
+	pPokey->sample_phase_fp += cycles << 32;
+	while(pPokey->sample_phase_fp >= adjusted_cps)
+	{
+		u32 idx = pPokey->blep_read & POKEY_BLEP_TAP_MASK;
+
+		pPokey->blep_integrator += pPokey->blep_deltas[idx];
+		pPokey->blep_deltas[idx] = 0;
+		pPokey->blep_read++;
+		pRaw[(*pSampleCount)++] = (int32_t)(pPokey->blep_integrator >> POKEY_BLEP_SCALE_BITS);
+
+		if(*pSampleCount == POKEY_SYNC_SAMPLE_BUFFER)
+		{
+			PokeyAudio_DcBlockBlock(pPokey, pRaw, pSamples, *pSampleCount);
+			PokeyAudio_Output(pPokey, pSamples, *pSampleCount);
+			*pSampleCount = 0;
+		}
+		pPokey->sample_phase_fp -= adjusted_cps;
+	}
+}
+
+/* Applies an SKCTL value to the synthesis state. */
+static void PokeyAudio_SetSkctl(PokeyState_t *pPokey, u8 skctl)
+{
+	u32 i;
+
+	if(pPokey->skctl == skctl)
 	{
 		return;
 	}
 
-	/* Read latest control regs; callers sync before writes for cycle correctness. */
+	pPokey->skctl = skctl;
+	if((skctl & 0x03) == 0)
 	{
-		u8 skctl = SRAM[IO_SKCTL_SKSTAT];
-		if(pPokey->skctl != skctl)
+		/* Hold RNG/audio in reset: restart polynomials and prescalers. */
+		PokeyAudio_PolyReset(pPokey);
+		for(i = 0; i < 4; i++)
 		{
-			u32 i;
-			pPokey->skctl = skctl;
-			if((skctl & 0x03) == 0)
-			{
-				/* Hold RNG/audio in reset: restart polynomials and prescalers. */
-				pPokey->lfsr17 = 0x1ffffu;
-				pPokey->lfsr9 = 0x01ffu;
-				pPokey->lfsr5 = 0x00u;
-				pPokey->lfsr4 = 0x00u;
-				for(i = 0; i < 4; i++)
-				{
-					pPokey->aChannels[i].clk_acc_cycles = 0;
-				}
-				pPokey->hp1_latch = 0;
-				pPokey->hp2_latch = 0;
-			}
+			pPokey->aChannels[i].clk_acc_cycles = 0;
 		}
+		pPokey->hp1_latch = 0;
+		pPokey->hp2_latch = 0;
 	}
+}
 
-	if(pPokey->audctl != SRAM[IO_AUDCTL_ALLPOT])
+/* STIMER resets all audio channel dividers to their AUDF values. */
+static void PokeyAudio_RestartDividers(PokeyState_t *pPokey)
+{
+	u32 i;
+
+	for(i = 0; i < 4; i++)
 	{
-		pPokey->audctl = SRAM[IO_AUDCTL_ALLPOT];
-		PokeyAudio_RecomputeClocks(pPokey->aChannels, pPokey->audctl);
+		pPokey->aChannels[i].clk_acc_cycles = 0;
+	}
+
+	if(pPokey->audctl & 0x10)
+	{
+		u32 p12 = (((u32)pPokey->aChannels[1].audf) << 8) | (u32)pPokey->aChannels[0].audf;
+		pPokey->aChannels[1].counter = (pPokey->audctl & 0x40) ? (p12 + 7u) : (p12 + 1u);
+	}
+	else
+	{
+		pPokey->aChannels[0].counter = (pPokey->audctl & 0x40) ? ((u32)pPokey->aChannels[0].audf + 4u) : ((u32)pPokey->aChannels[0].audf + 1u);
+		pPokey->aChannels[1].counter = (u32)pPokey->aChannels[1].audf + 1u;
+	}
+	if(pPokey->audctl & 0x08)
+	{
+		u32 p34 = (((u32)pPokey->aChannels[3].audf) << 8) | (u32)pPokey->aChannels[2].audf;
+		pPokey->aChannels[3].counter = (pPokey->audctl & 0x20) ? (p34 + 7u) : (p34 + 1u);
+	}
+	else
+	{
+		pPokey->aChannels[2].counter = (pPokey->audctl & 0x20) ? ((u32)pPokey->aChannels[2].audf + 4u) : ((u32)pPokey->aChannels[2].audf + 1u);
+		pPokey->aChannels[3].counter = (u32)pPokey->aChannels[3].audf + 1u;
+	}
+}
+
+/* Renders audio from the synthesis state up to llCycleCounter. */
+static void PokeyAudio_Render(PokeyState_t *pPokey, u64 llCycleCounter)
+{
+	int16_t tmp[POKEY_SYNC_SAMPLE_BUFFER];
+	int32_t aRaw[POKEY_SYNC_SAMPLE_BUFFER];
+	u32 tmpCount = 0;
+
+	u64 cur;
+
+	if(llCycleCounter <= pPokey->last_cycle)
+	{
+		return;
 	}
-	pPokey->aChannels[0].audf = SRAM[IO_AUDF1_POT0];
-	pPokey->aChannels[0].audc = SRAM[IO_AUDC1_POT1];
-	pPokey->aChannels[1].audf = SRAM[IO_AUDF2_POT2];
-	pPokey->aChannels[1].audc = SRAM[IO_AUDC2_POT3];
-	pPokey->aChannels[2].audf = SRAM[IO_AUDF3_POT4];
-	pPokey->aChannels[2].audc = SRAM[IO_AUDC3_POT5];
-	pPokey->aChannels[3].audf = SRAM[IO_AUDF4_POT6];
-	pPokey->aChannels[3].audc = SRAM[IO_AUDC4_POT7];
 
 	{
 		u64 adjusted_cps;
@@ -1017,22 +1818,15 @@ void Pokey_Sync(_6502_Context_t *pContext, u64 llCycleCounter)
 
 		/* Dynamic rate adjustment: speed up sample generation when buffer is low,
 		   slow down when buffer is filling up. This keeps audio in sync. */
-		if(pPokey->audio_opened)
-		{
-			SDL_LockAudio();
-		}
-		fill_level = pPokey->ring_count;
-		if(pPokey->audio_opened)
-		{
-			SDL_UnlockAudio();
-		}
-
 		target = pPokey->target_buffer_samples;
 		if(target == 0)
 		{
 			target = 1;
 		}
 
+		/* Backends without a device consume samples at the nominal rate. */
+		fill_level = (pPokey->backend == POKEY_AUDIO_SDL) ? PokeyAudio_RingFill(pPokey) : target;
+
 		fill_delta = (int32_t)fill_level - (int32_t)target;
 
 		/* Clamp control error so we never apply a runaway correction. */
@@ -1070,74 +1864,639 @@ void Pokey_Sync(_6502_Context_t *pContext, u64 llCycleCounter)
 			adjusted_cps = (u64)adjusted;
 		}
 
-		cur = pPokey->last_cycle;
+		cur = pPokey->last_cycle;
+
+		/* The mixer level only changes on steps that underflow a divider,
+		   so integrate it over whole runs of cycles up to each such edge. */
+		while(cur < llCycleCounter)
+		{
+			int32_t level = PokeyAudio_MixCycleLevel(pPokey, pPokey->aChannels, pPokey->audctl);
+			u64 cycles = PokeyAudio_CyclesToNextEdge(pPokey);
+
+			if(cycles > llCycleCounter - cur)
+			{
+				cycles = llCycleCounter - cur;
+			}
+			if(cycles > POKEY_MAX_RUN_CYCLES)
+			{
+				cycles = POKEY_MAX_RUN_CYCLES;
+			}
+
+			if(pPokey->synthesis_mode == POKEY_SYNTHESIS_BLEP)
+			{
+				PokeyAudio_BlepLevel(pPokey, level, cycles, adjusted_cps, aRaw, tmp, &tmpCount);
+			}
+			else
+			{
+				PokeyAudio_IntegrateLevel(pPokey, level, cycles, adjusted_cps, tmp, &tmpCount);
+			}
+
+			PokeyAudio_AdvanceQuietCycles(pPokey, cycles - 1);
+			PokeyAudio_StepCpuCycle(pPokey, pPokey->aChannels, pPokey->audctl);
+			cur += cycles;
+		}
+
+		if(tmpCount)
+		{
+			if(pPokey->synthesis_mode == POKEY_SYNTHESIS_BLEP)
+			{
+				PokeyAudio_DcBlockBlock(pPokey, aRaw, tmp, tmpCount);
+			}
+			PokeyAudio_Output(pPokey, tmp, tmpCount);
+		}
+	}
+
+	pPokey->last_cycle = llCycleCounter;
+}
+
+/* Applies a logged register write on the synthesis thread. */
+static void PokeyAudio_ApplyWrite(PokeyState_t *pPokey, u8 cRegister, u8 cValue)
+{
+	switch(cRegister)
+	{
+	case IO_AUDF1_POT0 & 0x0f:
+	case IO_AUDF2_POT2 & 0x0f:
+	case IO_AUDF3_POT4 & 0x0f:
+	case IO_AUDF4_POT6 & 0x0f:
+		pPokey->aChannels[cRegister >> 1].audf = cValue;
+		break;
+
+	case IO_AUDC1_POT1 & 0x0f:
+	case IO_AUDC2_POT3 & 0x0f:
+	case IO_AUDC3_POT5 & 0x0f:
+	case IO_AUDC4_POT7 & 0x0f:
+		pPokey->aChannels[cRegister >> 1].audc = cValue;
+		break;
+
+	case IO_AUDCTL_ALLPOT & 0x0f:
+		pPokey->audctl = cValue;
+		PokeyAudio_RecomputeClocks(pPokey->aChannels, pPokey->audctl);
+		break;
+
+	case IO_STIMER_KBCODE & 0x0f:
+		PokeyAudio_RestartDividers(pPokey);
+		break;
+
+	case IO_SKCTL_SKSTAT & 0x0f:
+		PokeyAudio_SetSkctl(pPokey, cValue);
+		break;
+
+	default:
+		break;
+	}
+}
+
+/* Emulation thread: appends a record, waiting for the synthesis thread
+   only if it has fallen a whole log behind. */
+static void PokeyAudio_LogAppend(PokeyState_t *pPokey, u64 llCycle, u8 cRegister, u8 cValue)
+{
+	u32 write_pos = PokeyAudio_LoadAcquire(&pPokey->log_write);
+	PokeyLogRecord_t *pRecord;
+
+	while(write_pos - PokeyAudio_LoadAcquire(&pPokey->log_read) >= POKEY_LOG_SIZE)
+	{
+		SDL_Delay(1);
+	}
+
+	pRecord = &pPokey->log[write_pos & POKEY_LOG_MASK];
+	pRecord->llCycle = llCycle;
+	pRecord->cRegister = cRegister;
+	pRecord->cValue = cValue;
+	PokeyAudio_StoreRelease(&pPokey->log_write, write_pos + 1u);
+
+	pPokey->log_last_cycle = llCycle;
+}
+
+/* Time stamps keep the thread rendering between register writes; one per
+   POKEY_LOG_SYNC_CYCLES is plenty since it renders whole runs anyway. */
+#define POKEY_LOG_SYNC_CYCLES (CYCLES_PER_LINE * 16)
+
+static void PokeyAudio_LogSync(PokeyState_t *pPokey, u64 llCycle)
+{
+	if(llCycle >= pPokey->log_last_cycle + POKEY_LOG_SYNC_CYCLES)
+	{
+		PokeyAudio_LogAppend(pPokey, llCycle, POKEY_LOG_SYNC, 0);
+	}
+}
+
+/* Synthesis thread: renders up to and applies every queued record. */
+static u8 PokeyAudio_LogDrain(PokeyState_t *pPokey)
+{
+	u32 read_pos = PokeyAudio_LoadAcquire(&pPokey->log_read);
+	u32 write_pos = PokeyAudio_LoadAcquire(&pPokey->log_write);
+
+	if(read_pos == write_pos)
+	{
+		return 0;
+	}
+
+	while(read_pos != write_pos)
+	{
+		const PokeyLogRecord_t *pRecord = &pPokey->log[read_pos & POKEY_LOG_MASK];
+
+		PokeyAudio_Render(pPokey, pRecord->llCycle);
+		PokeyAudio_ApplyWrite(pPokey, pRecord->cRegister, pRecord->cValue);
+		read_pos++;
+		PokeyAudio_StoreRelease(&pPokey->log_read, read_pos);
+	}
+
+	return 1;
+}
+
+static int SDLCALL PokeyAudio_SynthesisThread(void *pData)
+{
+	PokeyState_t *pPokey = (PokeyState_t *)pData;
+
+	while(1)
+	{
+		/* Sample the quit flag first so the final drain sees every record
+		   appended before it was raised. */
+		u32 quit = PokeyAudio_LoadAcquire(&pPokey->synthesis_quit);
+
+		if(!PokeyAudio_LogDrain(pPokey))
+		{
+			if(quit)
+			{
+				break;
+			}
+			SDL_Delay(1);
+		}
+	}
+
+	return 0;
+}
+
+/* poly17 position for RANDOM at llCycle, tracked on the emulation thread. */
+static u32 PokeyAudio_RngPosition(PokeyState_t *pPokey, u64 llCycle)
+{
+	if(!pPokey->rng_running || llCycle <= pPokey->rng_cycle)
+	{
+		return pPokey->rng_poly17_pos;
+	}
+
+	return PokeyAudio_PolySeek(pPokey->rng_poly17_pos, llCycle - pPokey->rng_cycle, POKEY_POLY17_PERIOD);
+}
+
+static void PokeyCapture_Append(PokeyState_t *pPokey, u64 llCycle, u8 cRegister, u8 cValue)
+{
+	u64 llDelta = llCycle - pPokey->capture_last_cycle;
+
+	do
+	{
+		PokeyCaptureRecord_t *pRecord;
+
+		if(pPokey->capture_count == pPokey->capture_size)
+		{
+			PokeyCaptureRecord_t *pGrown = (PokeyCaptureRecord_t *)realloc(
+				pPokey->capture, sizeof(PokeyCaptureRecord_t) * pPokey->capture_size * 2u);
+
+			if(!pGrown)
+			{
+				/* Keep what was captured so far. */
+				fprintf(stderr, "Pokey: capture stopped, out of memory\n");
+				pPokey->capture_running = 0;
+				pPokey->capture_end_cycle = pPokey->capture_last_cycle;
+				return;
+			}
+
+			pPokey->capture = pGrown;
+			pPokey->capture_size *= 2u;
+		}
+
+		pRecord = &pPokey->capture[pPokey->capture_count++];
+		if(llDelta > 0xffffffffu)
+		{
+			pRecord->lCycleDelta = 0xffffffffu;
+			pRecord->cRegister = POKEY_LOG_SYNC;
+			pRecord->cValue = 0;
+			llDelta -= 0xffffffffu;
+			continue;
+		}
+
+		pRecord->lCycleDelta = (u32)llDelta;
+		pRecord->cRegister = cRegister;
+		pRecord->cValue = cValue;
+		llDelta = 0;
+	} while(llDelta);
+
+	pPokey->capture_last_cycle = llCycle;
+}
+
+/* Logs an audio register write for the capture and the synthesis thread.
+   Returns 1 if the thread owns the audio state, in which case the caller
+   must not touch it. */
+static u8 Pokey_LogRegisterWrite(_6502_Context_t *pContext, u16 sAddress, u8 cValue)
+{
+	PokeyState_t *pPokey = Pokey_GetState(pContext);
+	u64 llNow = pContext->llCycleCounter;
+
+	if(!pPokey)
+	{
+		return 0;
+	}
+
+	if(pPokey->capture_running)
+	{
+		PokeyCapture_Append(pPokey, llNow, (u8)(sAddress & 0x0f), cValue);
+	}
+
+	if(!pPokey->synthesis_thread)
+	{
+		return 0;
+	}
+
+	if(sAddress == IO_SKCTL_SKSTAT)
+	{
+		pPokey->rng_poly17_pos = PokeyAudio_RngPosition(pPokey, llNow);
+		pPokey->rng_cycle = llNow;
+		pPokey->rng_running = (u8)((cValue & 0x03) != 0);
+		if(!pPokey->rng_running)
+		{
+			pPokey->rng_poly17_pos = 0;
+		}
+	}
+
+	PokeyAudio_LogAppend(pPokey, llNow, (u8)(sAddress & 0x0f), cValue);
+	return 1;
+}
+
+static void PokeyAudio_StartThread(PokeyState_t *pPokey)
+{
+	if(pPokey->synthesis_thread || !pPokey->audio_opened)
+	{
+		return;
+	}
+
+	if(!pPokey->log)
+	{
+		pPokey->log = (PokeyLogRecord_t *)malloc(sizeof(PokeyLogRecord_t) * POKEY_LOG_SIZE);
+		if(!pPokey->log)
+		{
+			return;
+		}
+	}
+
+	SDL_AtomicSet(&pPokey->log_read, 0);
+	SDL_AtomicSet(&pPokey->log_write, 0);
+	SDL_AtomicSet(&pPokey->synthesis_quit, 0);
+	pPokey->log_last_cycle = pPokey->last_cycle;
+
+	pPokey->rng_poly17_pos = pPokey->poly17_pos;
+	pPokey->rng_cycle = pPokey->last_cycle;
+	pPokey->rng_running = (u8)((pPokey->skctl & 0x03) != 0);
+
+	/* Stays on the emulation thread if no thread can be created. */
+	pPokey->synthesis_thread = SDL_CreateThread(PokeyAudio_SynthesisThread, "POKEY synthesis", pPokey);
+}
+
+/* Drains the log and hands the audio state back to the emulation thread. */
+static void PokeyAudio_StopThread(PokeyState_t *pPokey)
+{
+	if(!pPokey->synthesis_thread)
+	{
+		return;
+	}
+
+	PokeyAudio_StoreRelease(&pPokey->synthesis_quit, 1);
+	SDL_WaitThread(pPokey->synthesis_thread, NULL);
+	pPokey->synthesis_thread = NULL;
+}
+
+void Pokey_Sync(_6502_Context_t *pContext, u64 llCycleCounter)
+{
+	PokeyState_t *pPokey;
+
+	pPokey = Pokey_GetState(pContext);
+	if(pPokey && llCycleCounter >= pPokey->llSioStatusCycle)
+	{
+		Pokey_SioReportStatus(pPokey, llCycleCounter);
+	}
+
+	if(!pPokey || !pPokey->ring)
+	{
+		if(pPokey)
+		{
+			pPokey->last_cycle = llCycleCounter;
+		}
+		return;
+	}
+
+	/* The synthesis thread owns the audio state; only note the time. */
+	if(pPokey->synthesis_thread)
+	{
+		PokeyAudio_LogSync(pPokey, llCycleCounter);
+		return;
+	}
+
+	if(!pPokey->audio_opened)
+	{
+		pPokey->last_cycle = llCycleCounter;
+		return;
+	}
+
+	if(llCycleCounter <= pPokey->last_cycle)
+	{
+		return;
+	}
+
+	/* Read latest control regs; callers sync before writes for cycle correctness. */
+	PokeyAudio_SetSkctl(pPokey, SRAM[IO_SKCTL_SKSTAT]);
+
+	if(pPokey->audctl != SRAM[IO_AUDCTL_ALLPOT])
+	{
+		pPokey->audctl = SRAM[IO_AUDCTL_ALLPOT];
+		PokeyAudio_RecomputeClocks(pPokey->aChannels, pPokey->audctl);
+	}
+	pPokey->aChannels[0].audf = SRAM[IO_AUDF1_POT0];
+	pPokey->aChannels[0].audc = SRAM[IO_AUDC1_POT1];
+	pPokey->aChannels[1].audf = SRAM[IO_AUDF2_POT2];
+	pPokey->aChannels[1].audc = SRAM[IO_AUDC2_POT3];
+	pPokey->aChannels[2].audf = SRAM[IO_AUDF3_POT4];
+	pPokey->aChannels[2].audc = SRAM[IO_AUDC3_POT5];
+	pPokey->aChannels[3].audf = SRAM[IO_AUDF4_POT6];
+	pPokey->aChannels[3].audc = SRAM[IO_AUDC4_POT7];
+
+	PokeyAudio_Render(pPokey, llCycleCounter);
+}
+
+void Pokey_SetSynthesisMode(_6502_Context_t *pContext, u8 cMode)
+{
+	PokeyState_t *pPokey = Pokey_GetState(pContext);
+
+	if(!pPokey)
+	{
+		return;
+	}
+
+	if(pPokey->synthesis_thread)
+	{
+		PokeyAudio_StopThread(pPokey);
+		Pokey_SetSynthesisMode(pContext, cMode);
+		PokeyAudio_StartThread(pPokey);
+		return;
+	}
+
+	pPokey->synthesis_mode = (cMode == POKEY_SYNTHESIS_BOX) ? POKEY_SYNTHESIS_BOX : POKEY_SYNTHESIS_BLEP;
+	pPokey->sample_phase_fp = 0;
+	pPokey->sample_accum = 0;
+	PokeyAudio_BlepReset(pPokey);
+}
+
+void Pokey_SetSynthesisThread(_6502_Context_t *pContext, u8 bEnable)
+{
+	PokeyState_t *pPokey = Pokey_GetState(pContext);
+
+	if(!pPokey)
+	{
+		return;
+	}
+
+	if(bEnable)
+	{
+		/* Bring the synthesis state up to date before the thread owns it. */
+		Pokey_Sync(pContext, pContext->llCycleCounter);
+		PokeyAudio_StartThread(pPokey);
+	}
+	else
+	{
+		PokeyAudio_StopThread(pPokey);
+	}
+}
+
+u32 Pokey_StateSize(void)
+{
+	return sizeof(PokeySnapshot_t);
+}
+
+void Pokey_SaveState(_6502_Context_t *pContext, void *pState)
+{
+	PokeyState_t *pPokey = Pokey_GetState(pContext);
+	PokeySnapshot_t *pSnapshot = (PokeySnapshot_t *)pState;
+	u8 bThread;
+
+	memset(pSnapshot, 0, sizeof(PokeySnapshot_t));
+	if(!pPokey)
+	{
+		return;
+	}
+
+	/* Let the synthesis thread catch up and hand the chip back. */
+	bThread = pPokey->synthesis_thread != NULL;
+	Pokey_Sync(pContext, pContext->llCycleCounter);
+	PokeyAudio_StopThread(pPokey);
+
+	pSnapshot->llLastCycle = pPokey->last_cycle;
+	pSnapshot->aPolyPos[0] = pPokey->poly17_pos;
+	pSnapshot->aPolyPos[1] = pPokey->poly9_pos;
+	pSnapshot->aPolyPos[2] = pPokey->poly5_pos;
+	pSnapshot->aPolyPos[3] = pPokey->poly4_pos;
+	pSnapshot->cHp1Latch = pPokey->hp1_latch;
+	pSnapshot->cHp2Latch = pPokey->hp2_latch;
+	pSnapshot->cAudctl = pPokey->audctl;
+	pSnapshot->cSkctl = pPokey->skctl;
+	memcpy(pSnapshot->aChannels, pPokey->aChannels, sizeof(pSnapshot->aChannels));
+
+	if(bThread)
+	{
+		PokeyAudio_StartThread(pPokey);
+	}
+}
+
+void Pokey_LoadState(_6502_Context_t *pContext, const void *pState)
+{
+	PokeyState_t *pPokey = Pokey_GetState(pContext);
+	const PokeySnapshot_t *pSnapshot = (const PokeySnapshot_t *)pState;
+	u8 bThread;
+
+	if(!pPokey)
+	{
+		return;
+	}
+
+	bThread = pPokey->synthesis_thread != NULL;
+	PokeyAudio_StopThread(pPokey);
+
+	pPokey->last_cycle = pSnapshot->llLastCycle;
+	pPokey->poly17_pos = pSnapshot->aPolyPos[0];
+	pPokey->poly9_pos = pSnapshot->aPolyPos[1];
+	pPokey->poly5_pos = pSnapshot->aPolyPos[2];
+	pPokey->poly4_pos = pSnapshot->aPolyPos[3];
+	pPokey->hp1_latch = pSnapshot->cHp1Latch;
+	pPokey->hp2_latch = pSnapshot->cHp2Latch;
+	pPokey->audctl = pSnapshot->cAudctl;
+	pPokey->skctl = pSnapshot->cSkctl;
+	memcpy(pPokey->aChannels, pSnapshot->aChannels, sizeof(pPokey->aChannels));
+
+	if(bThread)
+	{
+		PokeyAudio_StartThread(pPokey);
+	}
+
+	if(pPokey->capture_running)
+	{
+		Pokey_SetCapture(pContext, 1);
+	}
+}
+
+u64 Pokey_AudioSamplesOut(_6502_Context_t *pContext)
+{
+	PokeyState_t *pPokey = Pokey_GetState(pContext);
+
+	return pPokey ? pPokey->samples_out : 0;
+}
+
+void Pokey_SetCapture(_6502_Context_t *pContext, u8 bEnable)
+{
+	PokeyState_t *pPokey = Pokey_GetState(pContext);
+
+	if(!pPokey)
+	{
+		return;
+	}
+
+	if(!bEnable)
+	{
+		if(pPokey->capture_running)
+		{
+			pPokey->capture_running = 0;
+			pPokey->capture_end_cycle = pContext->llCycleCounter;
+		}
+		return;
+	}
+
+	if(!pPokey->capture)
+	{
+		pPokey->capture = (PokeyCaptureRecord_t *)malloc(
+			sizeof(PokeyCaptureRecord_t) * POKEY_CAPTURE_INITIAL_RECORDS);
+		if(!pPokey->capture)
+		{
+			return;
+		}
+		pPokey->capture_size = POKEY_CAPTURE_INITIAL_RECORDS;
+	}
+
+	pPokey->capture_count = 0;
+	pPokey->capture_start_cycle = pContext->llCycleCounter;
+	pPokey->capture_last_cycle = pContext->llCycleCounter;
+	pPokey->capture_end_cycle = pContext->llCycleCounter;
+	memcpy(pPokey->capture_registers, &SRAM[IO_AUDF1_POT0], sizeof(pPokey->capture_registers));
+	pPokey->capture_running = 1;
+}
+
+u32 Pokey_CaptureCount(_6502_Context_t *pContext)
+{
+	PokeyState_t *pPokey = Pokey_GetState(pContext);
+
+	return pPokey ? pPokey->capture_count : 0;
+}
+
+/* End of the captured span: now while running, else where it stopped. */
+static u64 PokeyCapture_EndCycle(_6502_Context_t *pContext, PokeyState_t *pPokey)
+{
+	return pPokey->capture_running ? pContext->llCycleCounter : pPokey->capture_end_cycle;
+}
+
+int Pokey_SaveCaptureStream(_6502_Context_t *pContext, const char *pFileName)
+{
+	PokeyState_t *pPokey = Pokey_GetState(pContext);
+	u8 aHeader[POKEY_CAPTURE_HEADER_SIZE];
+	u8 aRecord[POKEY_CAPTURE_RECORD_SIZE];
+	u64 llEndCycle;
+	FILE *pFile;
+	u32 i;
+
+	if(!pPokey || !pPokey->capture)
+	{
+		return 0;
+	}
+
+	pFile = fopen(pFileName, "wb");
+	if(!pFile)
+	{
+		fprintf(stderr, "Pokey: cannot write capture file %s\n", pFileName);
+		return 0;
+	}
 
-		while(cur < llCycleCounter)
-		{
-			int32_t level = PokeyAudio_MixCycleLevel(pPokey, pPokey->aChannels, pPokey->audctl);
-			u64 cycles_needed_fp;
-			u64 batch_fp = (1ull << 32);
+	llEndCycle = PokeyCapture_EndCycle(pContext, pPokey);
 
-			/* adjusted_cps can decrease between sync calls due adaptive rate control.
-			   Keep phase/accum consistent so subtraction below cannot underflow. */
-			if(pPokey->sample_phase_fp >= adjusted_cps)
-			{
-				int64_t avg_level = 0;
-				if(pPokey->sample_phase_fp != 0)
-				{
-					avg_level = pPokey->sample_accum / (int64_t)pPokey->sample_phase_fp;
-				}
-				pPokey->sample_accum = avg_level * (int64_t)adjusted_cps;
-				pPokey->sample_phase_fp = adjusted_cps;
-			}
+	memcpy(&aHeader[0], POKEY_CAPTURE_MAGIC, 8);
+	PokeyAudio_PutLe(&aHeader[8], POKEY_CAPTURE_VERSION, 4);
+	PokeyAudio_PutLe(&aHeader[12], pPokey->cpu_hz, 4);
+	PokeyAudio_PutLe(&aHeader[16], (u32)(llEndCycle - pPokey->capture_start_cycle), 4);
+	PokeyAudio_PutLe(&aHeader[20], (u32)((llEndCycle - pPokey->capture_start_cycle) >> 32), 4);
+	PokeyAudio_PutLe(&aHeader[24], pPokey->capture_count, 4);
+	memcpy(&aHeader[28], pPokey->capture_registers, 16);
+	fwrite(aHeader, 1, sizeof(aHeader), pFile);
 
-			cycles_needed_fp = adjusted_cps - pPokey->sample_phase_fp;
+	for(i = 0; i < pPokey->capture_count; i++)
+	{
+		PokeyAudio_PutLe(&aRecord[0], pPokey->capture[i].lCycleDelta, 4);
+		aRecord[4] = pPokey->capture[i].cRegister;
+		aRecord[5] = pPokey->capture[i].cValue;
+		fwrite(aRecord, 1, sizeof(aRecord), pFile);
+	}
 
-			if(batch_fp < cycles_needed_fp)
-			{
-				pPokey->sample_accum += (int64_t)level * (int64_t)batch_fp;
-				pPokey->sample_phase_fp += batch_fp;
-			}
-			else
-			{
-				pPokey->sample_accum += (int64_t)level * (int64_t)cycles_needed_fp;
-				tmp[tmpCount++] = PokeyAudio_FinalizeSample(pPokey,
-															(int32_t)(pPokey->sample_accum / (int64_t)adjusted_cps));
+	return fclose(pFile) == 0;
+}
 
-				if(tmpCount == (sizeof(tmp) / sizeof(tmp[0])))
-				{
-					PokeyAudio_RingWrite(pPokey, tmp, tmpCount);
-					tmpCount = 0;
-				}
+int Pokey_SaveCaptureSap(_6502_Context_t *pContext, const char *pFileName)
+{
+	PokeyState_t *pPokey = Pokey_GetState(pContext);
+	u8 aRegisters[16];
+	u64 llCycle;
+	u64 llFrameEndCycle;
+	u64 llEndCycle;
+	u64 llFrames;
+	u64 llMilliseconds;
+	FILE *pFile;
+	u32 i = 0;
 
-				batch_fp -= cycles_needed_fp;
-				while(batch_fp >= adjusted_cps)
-				{
-					tmp[tmpCount++] = PokeyAudio_FinalizeSample(pPokey, level);
+	if(!pPokey || !pPokey->capture)
+	{
+		return 0;
+	}
 
-					if(tmpCount == (sizeof(tmp) / sizeof(tmp[0])))
-					{
-						PokeyAudio_RingWrite(pPokey, tmp, tmpCount);
-						tmpCount = 0;
-					}
-					batch_fp -= adjusted_cps;
-				}
+	pFile = fopen(pFileName, "wb");
+	if(!pFile)
+	{
+		fprintf(stderr, "Pokey: cannot write capture file %s\n", pFileName);
+		return 0;
+	}
 
-				pPokey->sample_accum = (int64_t)level * (int64_t)batch_fp;
-				pPokey->sample_phase_fp = batch_fp;
-			}
+	llEndCycle = PokeyCapture_EndCycle(pContext, pPokey);
+	llFrames = (llEndCycle - pPokey->capture_start_cycle + POKEY_SAP_FRAME_CYCLES - 1) / POKEY_SAP_FRAME_CYCLES;
+	llMilliseconds = llFrames * POKEY_SAP_FRAME_CYCLES * 1000u / pPokey->cpu_hz;
 
-			PokeyAudio_StepCpuCycle(pPokey, pPokey->aChannels, pPokey->audctl);
-			cur++;
-		}
+	fprintf(pFile,
+			"SAP\r\nNAME \"A8E capture\"\r\nTYPE R\r\nTIME %02u:%02u.%03u\r\n",
+			(unsigned)(llMilliseconds / 60000u),
+			(unsigned)(llMilliseconds / 1000u % 60u),
+			(unsigned)(llMilliseconds % 1000u));
+	fputc(0xff, pFile);
+	fputc(0xff, pFile);
 
-		if(tmpCount)
+	/* Each frame holds the registers as they stand at its end. */
+	memcpy(aRegisters, pPokey->capture_registers, sizeof(aRegisters));
+	llCycle = pPokey->capture_start_cycle;
+	for(llFrameEndCycle = pPokey->capture_start_cycle + POKEY_SAP_FRAME_CYCLES;
+		llFrames--;
+		llFrameEndCycle += POKEY_SAP_FRAME_CYCLES)
+	{
+		while(i < pPokey->capture_count &&
+			  llCycle + pPokey->capture[i].lCycleDelta < llFrameEndCycle)
 		{
-			PokeyAudio_RingWrite(pPokey, tmp, tmpCount);
+			llCycle += pPokey->capture[i].lCycleDelta;
+			if(pPokey->capture[i].cRegister < sizeof(aRegisters))
+			{
+				aRegisters[pPokey->capture[i].cRegister] = pPokey->capture[i].cValue;
+			}
+			i++;
 		}
+
+		fwrite(aRegisters, 1, POKEY_SAP_REGISTERS, pFile);
 	}
 
-	pPokey->last_cycle = llCycleCounter;
+	return fclose(pFile) == 0;
 }
 
 int Pokey_ShouldThrottle(_6502_Context_t *pContext)
@@ -1151,6 +2510,12 @@ int Pokey_ShouldThrottle(_6502_Context_t *pContext)
 		return 0;
 	}
 
+	/* Only a device backend sets a real-time limit. */
+	if(pPokey->backend != POKEY_AUDIO_SDL)
+	{
+		return 0;
+	}
+
 	/* If audio isn't actually playing, don't stall the emulator. */
 	if(SDL_GetAudioStatus() != SDL_AUDIO_PLAYING)
 	{
@@ -1176,9 +2541,14 @@ int Pokey_ShouldThrottle(_6502_Context_t *pContext)
 		}
 	}
 
-	SDL_LockAudio();
-	fill_level = pPokey->ring_count;
-	SDL_UnlockAudio();
+	fill_level = PokeyAudio_RingFill(pPokey);
+
+	/* Also let the synthesis thread catch up on a long register log. */
+	if(pPokey->synthesis_thread &&
+	   PokeyAudio_LoadAcquire(&pPokey->log_write) - PokeyAudio_LoadAcquire(&pPokey->log_read) >= POKEY_LOG_SIZE / 2u)
+	{
+		return 1;
+	}
 
 	return (fill_level >= high_water) ? 1 : 0;
 }
@@ -1396,6 +2766,7 @@ u8 *Pokey_AUDF1_POT0(_6502_Context_t *pContext, u8 *pValue)
 	{
 		Pokey_Sync(pContext, pContext->llCycleCounter);
 		SRAM[IO_AUDF1_POT0] = *pValue;
+		if(!Pokey_LogRegisterWrite(pContext, IO_AUDF1_POT0, *pValue))
 		{
 			PokeyState_t *pPokey = Pokey_GetState(pContext);
 			if(pPokey)
@@ -1423,6 +2794,7 @@ u8 *Pokey_AUDC1_POT1(_6502_Context_t *pContext, u8 *pValue)
 	{
 		Pokey_Sync(pContext, pContext->llCycleCounter);
 		SRAM[IO_AUDC1_POT1] = *pValue;
+		Pokey_LogRegisterWrite(pContext, IO_AUDC1_POT1, *pValue);
 #ifdef VERBOSE_REGISTER
 		printf("             [%16llu]", pContext->llCycleCounter);
 		printf(" AUDC1: %02X\n", *pValue);
@@ -1443,6 +2815,7 @@ u8 *Pokey_AUDF2_POT2(_6502_Context_t *pContext, u8 *pValue)
 	{
 		Pokey_Sync(pContext, pContext->llCycleCounter);
 		SRAM[IO_AUDF2_POT2] = *pValue;
+		if(!Pokey_LogRegisterWrite(pContext, IO_AUDF2_POT2, *pValue))
 		{
 			PokeyState_t *pPokey = Pokey_GetState(pContext);
 			if(pPokey)
@@ -1470,6 +2843,7 @@ u8 *Pokey_AUDC2_POT3(_6502_Context_t *pContext, u8 *pValue)
 	{
 		Pokey_Sync(pContext, pContext->llCycleCounter);
 		SRAM[IO_AUDC2_POT3] = *pValue;
+		Pokey_LogRegisterWrite(pContext, IO_AUDC2_POT3, *pValue);
 #ifdef VERBOSE_REGISTER
 		printf("             [%16llu]", pContext->llCycleCounter);
 		printf(" AUDC2: %02X\n", *pValue);
@@ -1490,6 +2864,7 @@ u8 *Pokey_AUDF3_POT4(_6502_Context_t *pContext, u8 *pValue)
 	{
 		Pokey_Sync(pContext, pContext->llCycleCounter);
 		SRAM[IO_AUDF3_POT4] = *pValue;
+		if(!Pokey_LogRegisterWrite(pContext, IO_AUDF3_POT4, *pValue))
 		{
 			PokeyState_t *pPokey = Pokey_GetState(pContext);
 			if(pPokey)
@@ -1517,6 +2892,7 @@ u8 *Pokey_AUDC3_POT5(_6502_Context_t *pContext, u8 *pValue)
 	{
 		Pokey_Sync(pContext, pContext->llCycleCounter);
 		SRAM[IO_AUDC3_POT5] = *pValue;
+		Pokey_LogRegisterWrite(pContext, IO_AUDC3_POT5, *pValue);
 #ifdef VERBOSE_REGISTER
 		printf("             [%16llu]", pContext->llCycleCounter);
 		printf(" AUDC3: %02X\n", *pValue);
@@ -1537,6 +2913,7 @@ u8 *Pokey_AUDF4_POT6(_6502_Context_t *pContext, u8 *pValue)
 	{
 		Pokey_Sync(pContext, pContext->llCycleCounter);
 		SRAM[IO_AUDF4_POT6] = *pValue;
+		if(!Pokey_LogRegisterWrite(pContext, IO_AUDF4_POT6, *pValue))
 		{
 			PokeyState_t *pPokey = Pokey_GetState(pContext);
 			if(pPokey)
@@ -1564,6 +2941,7 @@ u8 *Pokey_AUDC4_POT7(_6502_Context_t *pContext, u8 *pValue)
 	{
 		Pokey_Sync(pContext, pContext->llCycleCounter);
 		SRAM[IO_AUDC4_POT7] = *pValue;
+		Pokey_LogRegisterWrite(pContext, IO_AUDC4_POT7, *pValue);
 #ifdef VERBOSE_REGISTER
 		printf("             [%16llu]", pContext->llCycleCounter);
 		printf(" AUDC4: %02X\n", *pValue);
@@ -1584,6 +2962,7 @@ u8 *Pokey_AUDCTL_ALLPOT(_6502_Context_t *pContext, u8 *pValue)
 	{
 		Pokey_Sync(pContext, pContext->llCycleCounter);
 		SRAM[IO_AUDCTL_ALLPOT] = *pValue;
+		if(!Pokey_LogRegisterWrite(pContext, IO_AUDCTL_ALLPOT, *pValue))
 		{
 			PokeyState_t *pPokey = Pokey_GetState(pContext);
 			if(pPokey)
@@ -1610,7 +2989,6 @@ u8 *Pokey_STIMER_KBCODE(_6502_Context_t *pContext, u8 *pValue)
 {
 	if(pValue)
 	{
-		IoData_t *pIoData = (IoData_t *)pContext->pIoData;
 		u64 llNow;
 		u64 period;
 
@@ -1621,70 +2999,36 @@ u8 *Pokey_STIMER_KBCODE(_6502_Context_t *pContext, u8 *pValue)
 		printf(" STIMER: %02X\n", *pValue);
 #endif
 
-		/* STIMER resets all audio channel dividers to their AUDF values. */
+		if(!Pokey_LogRegisterWrite(pContext, IO_STIMER_KBCODE, *pValue))
 		{
 			PokeyState_t *pPokey = Pokey_GetState(pContext);
 			if(pPokey)
 			{
-				u32 i;
-				for(i = 0; i < 4; i++)
-				{
-					pPokey->aChannels[i].clk_acc_cycles = 0;
-				}
-
-				if(pPokey->audctl & 0x10)
-				{
-					u32 p12 = (((u32)pPokey->aChannels[1].audf) << 8) | (u32)pPokey->aChannels[0].audf;
-					pPokey->aChannels[1].counter = (pPokey->audctl & 0x40) ? (p12 + 7u) : (p12 + 1u);
-				}
-				else
-				{
-					pPokey->aChannels[0].counter = (pPokey->audctl & 0x40) ? ((u32)pPokey->aChannels[0].audf + 4u) : ((u32)pPokey->aChannels[0].audf + 1u);
-					pPokey->aChannels[1].counter = (u32)pPokey->aChannels[1].audf + 1u;
-				}
-				if(pPokey->audctl & 0x08)
-				{
-					u32 p34 = (((u32)pPokey->aChannels[3].audf) << 8) | (u32)pPokey->aChannels[2].audf;
-					pPokey->aChannels[3].counter = (pPokey->audctl & 0x20) ? (p34 + 7u) : (p34 + 1u);
-				}
-				else
-				{
-					pPokey->aChannels[2].counter = (pPokey->audctl & 0x20) ? ((u32)pPokey->aChannels[2].audf + 4u) : ((u32)pPokey->aChannels[2].audf + 1u);
-					pPokey->aChannels[3].counter = (u32)pPokey->aChannels[3].audf + 1u;
-				}
+				PokeyAudio_RestartDividers(pPokey);
 			}
 		}
 
 		llNow = PokeyMasterReferenceCycle(pContext);
 
 		period = Pokey_TimerPeriodCpuCycles(pContext, 1);
-		pIoData->llTimer1Cycle = period ? (llNow + period) : CYCLE_NEVER;
+		AtariIoScheduleTimedEvent(pContext, TIMED_EVENT_TIMER_1, period ? (llNow + period) : CYCLE_NEVER);
 
 		period = Pokey_TimerPeriodCpuCycles(pContext, 2);
-		pIoData->llTimer2Cycle = period ? (llNow + period) : CYCLE_NEVER;
+		AtariIoScheduleTimedEvent(pContext, TIMED_EVENT_TIMER_2, period ? (llNow + period) : CYCLE_NEVER);
 
 		period = Pokey_TimerPeriodCpuCycles(pContext, 4);
-		pIoData->llTimer4Cycle = period ? (llNow + period) : CYCLE_NEVER;
-
-		AtariIoCycleTimedEventUpdate(pContext);
+		AtariIoScheduleTimedEvent(pContext, TIMED_EVENT_TIMER_4, period ? (llNow + period) : CYCLE_NEVER);
 	}
 
 	return &RAM[IO_STIMER_KBCODE];
 }
 
-/* Standalone LFSR17 for RANDOM when audio state is unavailable. */
-static u32 m_lStandaloneLfsr17 = 0x1ffffu;
-
-static u8 Pokey_StepStandaloneLfsr17(void)
+/* Steps the machine's own poly17 for RANDOM when audio state is unavailable. */
+static u8 Pokey_StepStandaloneLfsr17(IoData_t *pIoData)
 {
-	u32 l17 = m_lStandaloneLfsr17 & 0x1ffffu;
-	u32 in8 = ((l17 >> 8) ^ (l17 >> 13)) & 1u;
-	u32 in0 = l17 & 1u;
-	l17 >>= 1;
-	l17 = (l17 & 0xff7fu) | (in8 << 7);
-	l17 = (l17 & 0xffffu) | (in0 << 16);
-	m_lStandaloneLfsr17 = l17 & 0x1ffffu;
-	return (u8)(m_lStandaloneLfsr17 & 0xffu);
+	PokeyAudio_InitPolyTables();
+	pIoData->lStandalonePoly17Pos = PokeyAudio_PolySeek(pIoData->lStandalonePoly17Pos, 1, POKEY_POLY17_PERIOD);
+	return m_aPoly17[pIoData->lStandalonePoly17Pos];
 }
 
 /* $D20A SKREST/RANDOM */
@@ -1702,13 +3046,29 @@ u8 *Pokey_SKREST_RANDOM(_6502_Context_t *pContext, u8 *pValue)
 #endif
 	}
 
-	if(pPokey)
+	if(pPokey && pPokey->synthesis_thread)
 	{
-		RAM[IO_SKREST_RANDOM] = (u8)(pPokey->lfsr17 & 0xff);
+		RAM[IO_SKREST_RANDOM] = m_aPoly17[PokeyAudio_RngPosition(pPokey, pContext->llCycleCounter)];
+	}
+	else if(pPokey)
+	{
+		u32 pos = pPokey->poly17_pos;
+
+		/* Seek from the last sync to the reading cycle instead of syncing
+		   the whole synthesis for a register read. */
+		if(pPokey->audio_opened &&
+		   (pPokey->skctl & 0x03) != 0 &&
+		   pPokey->skctl == SRAM[IO_SKCTL_SKSTAT] &&
+		   pContext->llCycleCounter > pPokey->last_cycle)
+		{
+			pos = PokeyAudio_PolySeek(pos, pContext->llCycleCounter - pPokey->last_cycle, POKEY_POLY17_PERIOD);
+		}
+
+		RAM[IO_SKREST_RANDOM] = m_aPoly17[pos];
 	}
 	else
 	{
-		RAM[IO_SKREST_RANDOM] = Pokey_StepStandaloneLfsr17();
+		RAM[IO_SKREST_RANDOM] = Pokey_StepStandaloneLfsr17((IoData_t *)pContext->pIoData);
 	}
 
 	return &RAM[IO_SKREST_RANDOM];
@@ -1731,20 +3091,10 @@ u8 *Pokey_POTGO(_6502_Context_t *pContext, u8 *pValue)
 	return &RAM[IO_POTGO];
 }
 
-static u8 aSioBuffer[1024];
-static u16 cSioOutIndex = 0;
-static u16 sSioInIndex = 0;
-static u16 sSioInSize = 0;
-
-/* SIO data phase state (for WRITE/PUT/VERIFY commands) */
+/* Data frames of WRITE/PUT/VERIFY go to aSioBuffer from here on. */
 #define SIO_DATA_OFFSET 32
-static u8 cSioOutPhase = 0;
-static u16 sSioDataIndex = 0;
-static u8 cSioPendingCmd = 0;
-static u16 sSioPendingSector = 0;
-static u16 sSioPendingBytes = 0;
 
-static u8 AtariIo_SioChecksum(u8 *pBuffer, u32 lSize)
+static u8 AtariIo_SioChecksum(const u8 *pBuffer, u32 lSize)
 {
 	u8 cChecksum = 0;
 
@@ -1761,13 +3111,15 @@ static u8 AtariIo_SioChecksum(u8 *pBuffer, u32 lSize)
 static void Pokey_SioQueueSerinResponse(_6502_Context_t *pContext, u16 size)
 {
 	IoData_t *pIoData = (IoData_t *)pContext->pIoData;
+	PokeyState_t *pPokey = (PokeyState_t *)pIoData->pPokey;
 	u64 llNow = PokeyMasterReferenceCycle(pContext);
 
-	sSioInSize = size;
-	sSioInIndex = 0;
-	pIoData->llSerialInputDataReadyCycle =
-		llNow + SERIAL_INPUT_FIRST_DATA_READY_CYCLES;
-	AtariIoCycleTimedEventUpdate(pContext);
+	pPokey->sSioInSize = size;
+	pPokey->sSioInIndex = 0;
+	AtariIoScheduleTimedEvent(
+		pContext,
+		TIMED_EVENT_SERIAL_INPUT_DATA_READY,
+		llNow + SERIAL_INPUT_FIRST_DATA_READY_CYCLES);
 }
 
 static void Pokey_SioSectorBytesAndOffset(u16 sSectorIndex, u16 sSectorSize,
@@ -1785,12 +3137,332 @@ static void Pokey_SioSectorBytesAndOffset(u16 sSectorIndex, u16 sSectorSize,
 	}
 }
 
+/* The SERIAL_x_CYCLES constants are tuned for the OS's 19200 baud setup:
+   channels 3+4 joined at 1.79 MHz with a divisor of $0028, i.e. 2 * ($28 + 7)
+   cycles per bit. Other divisors scale them; other clockings keep them. */
+#define SIO_STOCK_DIVISOR 0x28u
+#define SIO_DIVISOR_OFFSET 7u
+#define SIO_AUDCTL_FAST_JOINED 0x28
+
+static u64 Pokey_SioCycles(_6502_Context_t *pContext, u32 lStockCycles)
+{
+	u32 lDivisor;
+
+	if((SRAM[IO_AUDCTL_ALLPOT] & SIO_AUDCTL_FAST_JOINED) != SIO_AUDCTL_FAST_JOINED)
+	{
+		return lStockCycles;
+	}
+
+	lDivisor = ((u32)SRAM[IO_AUDF4_POT6] << 8) | SRAM[IO_AUDF3_POT4];
+
+	return (u64)lStockCycles * (lDivisor + SIO_DIVISOR_OFFSET) / (SIO_STOCK_DIVISOR + SIO_DIVISOR_OFFSET);
+}
+
+/* US Doubler "?" answer: POKEY divisor of its Ultra Speed mode (~52 kbaud). */
+#define SIO_ULTRA_SPEED_DIVISOR 0x0a
+
+/* No drive answers it; stands for commands the drive model lacks. */
+#define SIO_COMMAND_NONE 0x00
+#define SIO_COMMAND_FORMAT 0x21
+#define SIO_COMMAND_GET_SPEED 0x3f
+#define SIO_COMMAND_HAPPY_CONFIG 0x48
+
+/* Maps a drive's high-speed command onto the stock command it stands for:
+   XF551 sets bit 7, Happy uses the lower-case letters. The Ultra Speed and
+   Happy extras become SIO_COMMAND_NONE on other models; everything else is
+   returned unchanged and falls to the stock dispatch. */
+static u8 Pokey_SioStockCommand(u8 cModel, u8 cCommand)
+{
+	if((cCommand == SIO_COMMAND_GET_SPEED && cModel != POKEY_SIO_DRIVE_ULTRA) ||
+	   (cCommand == SIO_COMMAND_HAPPY_CONFIG && cModel != POKEY_SIO_DRIVE_HAPPY))
+	{
+		return SIO_COMMAND_NONE;
+	}
+
+	switch(cModel)
+	{
+	case POKEY_SIO_DRIVE_XF551:
+		switch(cCommand & 0x7f)
+		{
+		case 0x52: /* READ SECTOR */
+		case 0x53: /* STATUS */
+		case 0x57: /* WRITE SECTOR */
+		case 0x50: /* PUT SECTOR */
+		case 0x56: /* VERIFY SECTOR */
+		case SIO_COMMAND_FORMAT:
+			return cCommand & 0x7f;
+		}
+
+		break;
+
+	case POKEY_SIO_DRIVE_HAPPY:
+		switch(cCommand)
+		{
+		case 0x72: /* READ SECTOR */
+		case 0x73: /* STATUS */
+		case 0x77: /* WRITE SECTOR */
+		case 0x70: /* PUT SECTOR */
+		case 0x76: /* VERIFY SECTOR */
+			return cCommand & ~0x20;
+		}
+
+		break;
+	}
+
+	return cCommand;
+}
+
+void Pokey_SetSioDrive(_6502_Context_t *pContext, u8 cModel)
+{
+	IoData_t *pIoData = (IoData_t *)pContext->pIoData;
+
+	pIoData->cSioDriveModel = cModel;
+}
+
+void Pokey_SetSioStatusCallback(_6502_Context_t *pContext, PokeySioStatusCallback_t Callback, void *pUser)
+{
+	PokeyState_t *pPokey = Pokey_GetState(pContext);
+
+	if(!pPokey)
+	{
+		return;
+	}
+
+	pPokey->SioStatusCallback = Callback;
+	pPokey->pSioStatusUser = pUser;
+	pPokey->llSioStatusCycle = CYCLE_NEVER;
+}
+
+/* Notes drive activity on sSector; the report goes out now or, if the
+   last one is less than a frame ago, from Pokey_Sync once it is due. */
+static void Pokey_SioStatus(_6502_Context_t *pContext, u16 sSector)
+{
+	PokeyState_t *pPokey = Pokey_GetState(pContext);
+
+	if(!pPokey || !pPokey->SioStatusCallback)
+	{
+		return;
+	}
+
+	pPokey->sSioStatusSector = sSector;
+	pPokey->llSioStatusCycle = pPokey->llSioStatusLastCycle + POKEY_SIO_STATUS_CYCLES;
+	if(pContext->llCycleCounter >= pPokey->llSioStatusCycle)
+	{
+		Pokey_SioReportStatus(pPokey, pContext->llCycleCounter);
+	}
+}
+
+/* D1: is always there, with or without a disk; D2:-D8: only answer while
+   an image is mounted. Returns NULL for a device no drive answers to. */
+static SioDrive_t *Pokey_SioDrive(IoData_t *pIoData, u8 cDevice)
+{
+	SioDrive_t *pDrive;
+
+	if(cDevice < 0x31 || cDevice >= 0x31 + SIO_DRIVES)
+	{
+		return NULL;
+	}
+
+	pDrive = &pIoData->aDrives[cDevice - 0x31];
+
+	return (cDevice == 0x31 || pDrive->pImage) ? pDrive : NULL;
+}
+
+/* Returns 1 if the sector lies wholly inside the image. */
+static u8 Pokey_SioSector(SioDrive_t *pDrive, u16 sSectorIndex, u16 *pBytesToRead, u32 *pOffset)
+{
+	if(sSectorIndex == 0 || pDrive->pImage == NULL)
+	{
+		return 0;
+	}
+
+	Pokey_SioSectorBytesAndOffset(sSectorIndex, pDrive->sSectorSize, pBytesToRead, pOffset);
+
+	return 16 + *pOffset + *pBytesToRead <= pDrive->lSize;
+}
+
+/* Hands a changed range of the image to the drive's write-back journal. */
+static void Pokey_SioImageWritten(SioDrive_t *pDrive, u32 lOffset, u32 lBytes)
+{
+	if(pDrive->pJournal)
+	{
+		DiskJournal_Write(pDrive->pJournal, lOffset, pDrive->pImage + lOffset, lBytes);
+	}
+}
+
+/* Device control block at $0300 (OS SIO interface). */
+#define SIO_DCB_DDEVIC 0x0300
+#define SIO_DCB_DUNIT 0x0301
+#define SIO_DCB_DCOMND 0x0302
+#define SIO_DCB_DSTATS 0x0303
+#define SIO_DCB_DBUFLO 0x0304
+#define SIO_DCB_DBYTLO 0x0308
+#define SIO_DCB_DAUX1 0x030a
+
+#define SIO_DEVICE_CASSETTE 0x60
+
+#define SIO_STATUS_SUCCESS 0x01
+#define SIO_STATUS_TIMEOUT 0x8a
+#define SIO_STATUS_NAK 0x8b
+#define SIO_STATUS_CHECKSUM 0x8f
+#define SIO_STATUS_DEVICE_ERROR 0x90
+
+/* Cassette record read: DBYT bytes of the next record on the tape into the
+   buffer, then its checksum, which the OS does not store. The tape is then
+   where playing it would have left it. */
+static u8 Pokey_SioCassetteRequest(_6502_Context_t *pContext, u32 *pBytes)
+{
+	IoData_t *pIoData = (IoData_t *)pContext->pIoData;
+	u16 sBuffer = RAM[SIO_DCB_DBUFLO] | (RAM[SIO_DCB_DBUFLO + 1] << 8);
+	u16 sLength = RAM[SIO_DCB_DBYTLO] | (RAM[SIO_DCB_DBYTLO + 1] << 8);
+	const u8 *pRecord;
+	u32 lRecordLength;
+	u64 llEndTime;
+	u32 lIndex;
+
+	if(!pIoData->pCassette || RAM[SIO_DCB_DCOMND] != 0x52)
+	{
+		return 0;
+	}
+
+	if(!Cassette_NextRecord(pIoData->pCassette, Pokey_CassetteTime(pContext), &pRecord, &lRecordLength, &llEndTime))
+	{
+		return SIO_STATUS_TIMEOUT;
+	}
+
+	pIoData->llCassetteTime = llEndTime;
+	pIoData->llCassetteMotorCycle = PokeyMasterReferenceCycle(pContext);
+	Pokey_CassetteSchedule(pContext);
+
+	if(lRecordLength < (u32)sLength + 1)
+	{
+		return SIO_STATUS_TIMEOUT;
+	}
+
+	for(lIndex = 0; lIndex < sLength; lIndex++)
+	{
+		_6502_Write(pContext, (u16)(sBuffer + lIndex), pRecord[lIndex]);
+	}
+
+	*pBytes = sLength;
+
+	return AtariIo_SioChecksum(pRecord, sLength) == pRecord[sLength] ? SIO_STATUS_SUCCESS : SIO_STATUS_CHECKSUM;
+}
+
+u8 Pokey_SioRequest(_6502_Context_t *pContext, u32 *pBytes)
+{
+	IoData_t *pIoData = (IoData_t *)pContext->pIoData;
+	SioDrive_t *pDrive = Pokey_SioDrive(pIoData, (u8)(RAM[SIO_DCB_DDEVIC] + RAM[SIO_DCB_DUNIT] - 1));
+	u8 cCommand = RAM[SIO_DCB_DCOMND];
+	u16 sBuffer = RAM[SIO_DCB_DBUFLO] | (RAM[SIO_DCB_DBUFLO + 1] << 8);
+	u16 sLength = RAM[SIO_DCB_DBYTLO] | (RAM[SIO_DCB_DBYTLO + 1] << 8);
+	u16 sSectorIndex = RAM[SIO_DCB_DAUX1] | (RAM[SIO_DCB_DAUX1 + 1] << 8);
+	u16 sBytesToRead;
+	u32 lOffset;
+	u32 lIndex;
+
+	*pBytes = 0;
+
+	if(RAM[SIO_DCB_DDEVIC] == SIO_DEVICE_CASSETTE)
+	{
+		return pIoData->bCassetteFast ? Pokey_SioCassetteRequest(pContext, pBytes) : 0;
+	}
+
+	if(pDrive == NULL || !pIoData->bSioPatch)
+	{
+		return 0;
+	}
+
+	if(cCommand != 0x52 && cCommand != 0x53 && cCommand != 0x57 &&
+	   cCommand != 0x50 && cCommand != 0x56)
+	{
+		return 0;
+	}
+
+	if(!pDrive->pImage)
+	{
+		return SIO_STATUS_TIMEOUT;
+	}
+
+	if(cCommand == 0x53) /* STATUS */
+	{
+		u8 aStatus[4] = {0x10, 0x00, 0x01, 0x00};
+
+		Pokey_SioStatus(pContext, 0);
+		if(pDrive->sSectorSize == 256)
+		{
+			aStatus[0] = 0x30;
+		}
+
+		for(lIndex = 0; lIndex < 4; lIndex++)
+		{
+			_6502_Write(pContext, (u16)(sBuffer + lIndex), aStatus[lIndex]);
+		}
+
+		*pBytes = 4;
+		return SIO_STATUS_SUCCESS;
+	}
+
+	if(!Pokey_SioSector(pDrive, sSectorIndex, &sBytesToRead, &lOffset))
+	{
+		return SIO_STATUS_NAK;
+	}
+
+	if(sLength && sLength < sBytesToRead)
+	{
+		sBytesToRead = sLength;
+	}
+
+	*pBytes = sBytesToRead;
+
+	switch(cCommand)
+	{
+	case 0x52: /* READ SECTOR */
+		Pokey_SioStatus(pContext, sSectorIndex);
+
+		/* Through the access functions, so ROM stays read-only. */
+		for(lIndex = 0; lIndex < sBytesToRead; lIndex++)
+		{
+			_6502_Write(pContext, (u16)(sBuffer + lIndex), pDrive->pImage[16 + lOffset + lIndex]);
+		}
+
+		return SIO_STATUS_SUCCESS;
+
+	case 0x56: /* VERIFY SECTOR */
+		for(lIndex = 0; lIndex < sBytesToRead; lIndex++)
+		{
+			if(pDrive->pImage[16 + lOffset + lIndex] != RAM[(u16)(sBuffer + lIndex)])
+			{
+				return SIO_STATUS_DEVICE_ERROR;
+			}
+		}
+
+		return SIO_STATUS_SUCCESS;
+
+	default: /* WRITE / PUT SECTOR */
+		for(lIndex = 0; lIndex < sBytesToRead; lIndex++)
+		{
+			pDrive->pImage[16 + lOffset + lIndex] = RAM[(u16)(sBuffer + lIndex)];
+		}
+
+		Pokey_SioImageWritten(pDrive, 16 + lOffset, sBytesToRead);
+
+		return SIO_STATUS_SUCCESS;
+	}
+}
+
 /* $D20D SEROUT/SERIN */
 u8 *Pokey_SEROUT_SERIN(_6502_Context_t *pContext, u8 *pValue)
 {
 	IoData_t *pIoData = (IoData_t *)pContext->pIoData;
+	PokeyState_t *pPokey = (PokeyState_t *)pIoData->pPokey;
 
 	Pokey_Sync(pContext, pContext->llCycleCounter);
+	if(!pPokey)
+	{
+		return &RAM[IO_SEROUT_SERIN];
+	}
+
 	if(pValue)
 	{
 		u64 llNow = PokeyMasterReferenceCycle(pContext);
@@ -1798,211 +3470,210 @@ u8 *Pokey_SEROUT_SERIN(_6502_Context_t *pContext, u8 *pValue)
 		printf("             [%16llu] SEROUT ", pContext->llCycleCounter);
 		printf("(%02X)!\n", *pValue);
 #endif
-		pIoData->llSerialOutputNeedDataCycle =
-			llNow + SERIAL_OUTPUT_DATA_NEEDED_CYCLES;
-
-		AtariIoCycleTimedEventUpdate(pContext);
+		AtariIoScheduleTimedEvent(
+			pContext,
+			TIMED_EVENT_SERIAL_OUTPUT_NEED_DATA,
+			llNow + Pokey_SioCycles(pContext, SERIAL_OUTPUT_DATA_NEEDED_CYCLES));
 
 		/* --- Data phase (WRITE/PUT/VERIFY) --- */
-		if(cSioOutPhase == 1)
+		if(pPokey->cSioOutPhase == 1)
 		{
 			u16 expected;
 
-			aSioBuffer[SIO_DATA_OFFSET + sSioDataIndex] = *pValue;
-			sSioDataIndex++;
+			pPokey->aSioBuffer[SIO_DATA_OFFSET + pPokey->sSioDataIndex] = *pValue;
+			pPokey->sSioDataIndex++;
 
-			expected = sSioPendingBytes + 1; /* data + checksum */
-			if(sSioDataIndex == expected)
+			expected = pPokey->sSioPendingBytes + 1; /* data + checksum */
+			if(pPokey->sSioDataIndex == expected)
 			{
-				u16 sSectorSize = ((AtrHeader_t *)pIoData->pDisk1)->sSectorSize;
+				SioDrive_t *pDrive = Pokey_SioDrive(pIoData, pPokey->cSioPendingDevice);
 				u16 sBytesToRead;
 				u32 lOffset;
-				u8 provided = aSioBuffer[SIO_DATA_OFFSET + sSioPendingBytes];
-				u8 calculated = AtariIo_SioChecksum(&aSioBuffer[SIO_DATA_OFFSET], sSioPendingBytes);
-
-				pIoData->llSerialOutputTransmissionDoneCycle =
-					llNow + SERIAL_OUTPUT_TRANSMISSION_DONE_CYCLES;
-				AtariIoCycleTimedEventUpdate(pContext);
+				u8 provided = pPokey->aSioBuffer[SIO_DATA_OFFSET + pPokey->sSioPendingBytes];
+				u8 calculated = AtariIo_SioChecksum(&pPokey->aSioBuffer[SIO_DATA_OFFSET], pPokey->sSioPendingBytes);
 
-				Pokey_SioSectorBytesAndOffset(sSioPendingSector, sSectorSize, &sBytesToRead, &lOffset);
+				AtariIoScheduleTimedEvent(
+					pContext,
+					TIMED_EVENT_SERIAL_OUTPUT_TRANSMISSION_DONE,
+					llNow + Pokey_SioCycles(pContext, SERIAL_OUTPUT_TRANSMISSION_DONE_CYCLES));
 
-				if(calculated != provided || !pIoData->pDisk1 ||
-				   sSioPendingSector == 0 || lOffset + 16 >= pIoData->lDiskSize ||
-				   sBytesToRead != sSioPendingBytes)
+				if(calculated != provided || pDrive == NULL ||
+				   !Pokey_SioSector(pDrive, pPokey->sSioPendingSector, &sBytesToRead, &lOffset) ||
+				   sBytesToRead != pPokey->sSioPendingBytes)
 				{
-					aSioBuffer[0] = 'N';
+					pPokey->aSioBuffer[0] = 'N';
 					Pokey_SioQueueSerinResponse(pContext, 1);
 				}
-				else if(cSioPendingCmd == 0x56) /* VERIFY */
+				else if(pPokey->cSioPendingCmd == 0x56) /* VERIFY */
 				{
 					u32 vi;
 					u8 ok = 1;
 
 					for(vi = 0; vi < sBytesToRead; vi++)
 					{
-						if(pIoData->pDisk1[16 + lOffset + vi] != aSioBuffer[SIO_DATA_OFFSET + vi])
+						if(pDrive->pImage[16 + lOffset + vi] != pPokey->aSioBuffer[SIO_DATA_OFFSET + vi])
 						{
 							ok = 0;
 							break;
 						}
 					}
-					aSioBuffer[0] = 'A';
-					aSioBuffer[1] = ok ? 'C' : 'E';
+					pPokey->aSioBuffer[0] = 'A';
+					pPokey->aSioBuffer[1] = ok ? 'C' : 'E';
 					Pokey_SioQueueSerinResponse(pContext, 2);
 				}
 				else /* WRITE / PUT */
 				{
-					memcpy(pIoData->pDisk1 + 16 + lOffset,
-						   &aSioBuffer[SIO_DATA_OFFSET], sBytesToRead);
-					aSioBuffer[0] = 'A';
-					aSioBuffer[1] = 'C';
+					memcpy(pDrive->pImage + 16 + lOffset,
+						   &pPokey->aSioBuffer[SIO_DATA_OFFSET], sBytesToRead);
+					Pokey_SioImageWritten(pDrive, 16 + lOffset, sBytesToRead);
+					pPokey->aSioBuffer[0] = 'A';
+					pPokey->aSioBuffer[1] = 'C';
 					Pokey_SioQueueSerinResponse(pContext, 2);
 				}
 
 				/* Reset data phase state */
-				cSioOutPhase = 0;
-				sSioDataIndex = 0;
-				cSioPendingCmd = 0;
-				sSioPendingSector = 0;
-				sSioPendingBytes = 0;
-				cSioOutIndex = 0;
+				pPokey->cSioOutPhase = 0;
+				pPokey->sSioDataIndex = 0;
+				pPokey->cSioPendingCmd = 0;
+				pPokey->cSioPendingDevice = 0;
+				pPokey->sSioPendingSector = 0;
+				pPokey->sSioPendingBytes = 0;
+				pPokey->sSioOutIndex = 0;
 			}
 
 			return &RAM[IO_SEROUT_SERIN];
 		}
 
 		/* --- Command phase --- */
-		if(cSioOutIndex == 0 && *pValue > 0 && *pValue < 255)
+		if(pPokey->sSioOutIndex == 0 && *pValue > 0 && *pValue < 255)
 		{
-			aSioBuffer[cSioOutIndex++] = *pValue;
+			pPokey->aSioBuffer[pPokey->sSioOutIndex++] = *pValue;
 		}
-		else if(cSioOutIndex > 0)
+		else if(pPokey->sSioOutIndex > 0)
 		{
-			aSioBuffer[cSioOutIndex++] = *pValue;
+			pPokey->aSioBuffer[pPokey->sSioOutIndex++] = *pValue;
 
-			if(cSioOutIndex == 5)
+			if(pPokey->sSioOutIndex == 5)
 			{
-				if(AtariIo_SioChecksum(aSioBuffer, 4) == aSioBuffer[4])
+				SioDrive_t *pDrive = NULL;
+
+				/* A frame for a device no drive answers to goes unanswered. */
+				if(AtariIo_SioChecksum(pPokey->aSioBuffer, 4) == pPokey->aSioBuffer[4] &&
+				   (pDrive = Pokey_SioDrive(pIoData, pPokey->aSioBuffer[0])) != NULL)
 				{
-					char aCaption[100];
 					u16 sSectorIndex;
-					u16 sSectorSize = ((AtrHeader_t *)pIoData->pDisk1)->sSectorSize;
 					u16 sBytesToRead;
 					u32 lOffset;
 #ifdef VERBOSE_SIO
 					{
 						u32 lIndex;
 						printf("SIO data send (checksum calculated: %02X): ",
-							   AtariIo_SioChecksum(aSioBuffer, 4));
+							   AtariIo_SioChecksum(pPokey->aSioBuffer, 4));
 
 						for(lIndex = 0; lIndex < 5; lIndex++)
 						{
-							printf("%02X ", aSioBuffer[lIndex]);
+							printf("%02X ", pPokey->aSioBuffer[lIndex]);
 						}
 
 						printf("\n");
 					}
 #endif
-					pIoData->llSerialOutputTransmissionDoneCycle =
-						llNow + SERIAL_OUTPUT_TRANSMISSION_DONE_CYCLES;
-
-					AtariIoCycleTimedEventUpdate(pContext);
+					AtariIoScheduleTimedEvent(
+						pContext,
+						TIMED_EVENT_SERIAL_OUTPUT_TRANSMISSION_DONE,
+						llNow + Pokey_SioCycles(pContext, SERIAL_OUTPUT_TRANSMISSION_DONE_CYCLES));
 
-					switch(aSioBuffer[1])
+					switch(Pokey_SioStockCommand(pIoData->cSioDriveModel, pPokey->aSioBuffer[1]))
 					{
 					case 0x52: /* READ SECTOR */
-						sSectorIndex = aSioBuffer[2] + (aSioBuffer[3] << 8);
+						sSectorIndex = pPokey->aSioBuffer[2] + (pPokey->aSioBuffer[3] << 8);
 
-						sprintf(aCaption, APPLICATION_CAPTION "  [%d]", sSectorIndex);
-						SDL_SetWindowTitle(g_pSdlWindow, aCaption);
+						Pokey_SioStatus(pContext, sSectorIndex);
 #ifdef VERBOSE_SIO
 						printf("SIO read sector %d\n", sSectorIndex);
 #endif
 						if(sSectorIndex == 0)
 						{
-							aSioBuffer[0] = 'N';
-							sSioInSize = 1;
+							pPokey->aSioBuffer[0] = 'N';
+							pPokey->sSioInSize = 1;
 						}
 						else
 						{
-							Pokey_SioSectorBytesAndOffset(sSectorIndex, sSectorSize,
-														  &sBytesToRead, &lOffset);
-
-							if(lOffset + 16 >= pIoData->lDiskSize)
+							if(!Pokey_SioSector(pDrive, sSectorIndex, &sBytesToRead, &lOffset))
 							{
-								aSioBuffer[0] = 'N';
-								sSioInSize = 1;
+								pPokey->aSioBuffer[0] = 'N';
+								pPokey->sSioInSize = 1;
 #ifdef VERBOSE_SIO
 								printf("Not accepted (sector %d, offset = %lu, disk size = %lu!\n",
-									   sSectorIndex, lOffset, pIoData->lDiskSize);
+									   sSectorIndex, lOffset, pDrive->lSize);
 #endif
 							}
 							else
 							{
-								aSioBuffer[0] = 'A';
-								aSioBuffer[1] = 'C';
+								pPokey->aSioBuffer[0] = 'A';
+								pPokey->aSioBuffer[1] = 'C';
 
-								memcpy(aSioBuffer + 2, pIoData->pDisk1 + 16 + lOffset, sBytesToRead);
+								memcpy(pPokey->aSioBuffer + 2, pDrive->pImage + 16 + lOffset, sBytesToRead);
 
-								aSioBuffer[sBytesToRead + 2] = AtariIo_SioChecksum(aSioBuffer + 2, sBytesToRead);
+								pPokey->aSioBuffer[sBytesToRead + 2] = AtariIo_SioChecksum(pPokey->aSioBuffer + 2, sBytesToRead);
 
-								sSioInSize = sBytesToRead + 3;
+								pPokey->sSioInSize = sBytesToRead + 3;
 #ifdef VERBOSE_SIO
 								{
 									u32 lIndex;
 									printf("%04X: ", sSectorIndex);
 
-									for(lIndex = 0; lIndex < sSioInSize; lIndex++)
+									for(lIndex = 0; lIndex < pPokey->sSioInSize; lIndex++)
 									{
-										printf("%02X ", aSioBuffer[lIndex]);
+										printf("%02X ", pPokey->aSioBuffer[lIndex]);
 									}
 
 									printf("\n");
 								}
 #endif
-								pIoData->llSerialInputDataReadyCycle =
-									llNow + SERIAL_INPUT_FIRST_DATA_READY_CYCLES;
+								AtariIoScheduleTimedEvent(
+									pContext,
+									TIMED_EVENT_SERIAL_INPUT_DATA_READY,
+									llNow + SERIAL_INPUT_FIRST_DATA_READY_CYCLES);
 							}
 						}
 
-						AtariIoCycleTimedEventUpdate(pContext);
-
 						break;
 
 					case 0x53: /* STATUS */
-						SDL_SetWindowTitle(g_pSdlWindow, APPLICATION_CAPTION "  [-]");
+						Pokey_SioStatus(pContext, 0);
 #ifdef VERBOSE_SIO
 						printf("SIO get status\n");
 #endif
-						if(sSectorSize == 128)
+						if(pDrive->sSectorSize == 128)
 						{
-							aSioBuffer[0] = 'A';
-							aSioBuffer[1] = 'C';
-							aSioBuffer[2] = 0x10;
-							aSioBuffer[3] = 0x00;
-							aSioBuffer[4] = 0x01;
-							aSioBuffer[5] = 0x00;
-							aSioBuffer[6] = 0x11;
+							pPokey->aSioBuffer[0] = 'A';
+							pPokey->aSioBuffer[1] = 'C';
+							pPokey->aSioBuffer[2] = 0x10;
+							pPokey->aSioBuffer[3] = 0x00;
+							pPokey->aSioBuffer[4] = 0x01;
+							pPokey->aSioBuffer[5] = 0x00;
+							pPokey->aSioBuffer[6] = 0x11;
 						}
-						else if(sSectorSize == 256)
+						else if(pDrive->sSectorSize == 256)
 						{
-							aSioBuffer[0] = 'A';
-							aSioBuffer[1] = 'C';
-							aSioBuffer[2] = 0x30;
-							aSioBuffer[3] = 0x00;
-							aSioBuffer[4] = 0x01;
-							aSioBuffer[5] = 0x00;
-							aSioBuffer[6] = 0x31;
+							pPokey->aSioBuffer[0] = 'A';
+							pPokey->aSioBuffer[1] = 'C';
+							pPokey->aSioBuffer[2] = 0x30;
+							pPokey->aSioBuffer[3] = 0x00;
+							pPokey->aSioBuffer[4] = 0x01;
+							pPokey->aSioBuffer[5] = 0x00;
+							pPokey->aSioBuffer[6] = 0x31;
 						}
 
-						sSioInSize = 7;
+						pPokey->sSioInSize = 7;
 
-						if(pIoData->pDisk1[0] != 0)
+						if(pDrive->pImage && pDrive->pImage[0] != 0)
 						{
-							pIoData->llSerialInputDataReadyCycle =
-								llNow + SERIAL_INPUT_FIRST_DATA_READY_CYCLES;
-
-							AtariIoCycleTimedEventUpdate(pContext);
+							AtariIoScheduleTimedEvent(
+								pContext,
+								TIMED_EVENT_SERIAL_INPUT_DATA_READY,
+								llNow + SERIAL_INPUT_FIRST_DATA_READY_CYCLES);
 						}
 
 						break;
@@ -2010,58 +3681,57 @@ u8 *Pokey_SEROUT_SERIN(_6502_Context_t *pContext, u8 *pValue)
 					case 0x57: /* WRITE SECTOR */
 					case 0x50: /* PUT SECTOR */
 					case 0x56: /* VERIFY SECTOR */
-						sSectorIndex = aSioBuffer[2] + (aSioBuffer[3] << 8);
+						sSectorIndex = pPokey->aSioBuffer[2] + (pPokey->aSioBuffer[3] << 8);
 #ifdef VERBOSE_SIO
 						printf("SIO %s sector %d\n",
-							   aSioBuffer[1] == 0x57 ? "write" : aSioBuffer[1] == 0x50 ? "put"
+							   pPokey->aSioBuffer[1] == 0x57 ? "write" : pPokey->aSioBuffer[1] == 0x50 ? "put"
 																					   : "verify",
 							   sSectorIndex);
 #endif
 						if(sSectorIndex == 0)
 						{
-							aSioBuffer[0] = 'N';
+							pPokey->aSioBuffer[0] = 'N';
 							Pokey_SioQueueSerinResponse(pContext, 1);
 						}
 						else
 						{
-							Pokey_SioSectorBytesAndOffset(sSectorIndex, sSectorSize,
-														  &sBytesToRead, &lOffset);
-
-							if(lOffset + 16 >= pIoData->lDiskSize)
+							if(!Pokey_SioSector(pDrive, sSectorIndex, &sBytesToRead, &lOffset))
 							{
-								aSioBuffer[0] = 'N';
+								pPokey->aSioBuffer[0] = 'N';
 								Pokey_SioQueueSerinResponse(pContext, 1);
 							}
 							else
 							{
 								/* Enter data phase: ACK command, wait for data frame */
-								cSioOutPhase = 1;
-								sSioDataIndex = 0;
-								cSioPendingCmd = aSioBuffer[1];
-								sSioPendingSector = sSectorIndex;
-								sSioPendingBytes = sBytesToRead;
-
-								aSioBuffer[0] = 'A';
+								pPokey->cSioOutPhase = 1;
+								pPokey->sSioDataIndex = 0;
+								pPokey->cSioPendingCmd = Pokey_SioStockCommand(pIoData->cSioDriveModel, pPokey->aSioBuffer[1]);
+								pPokey->cSioPendingDevice = pPokey->aSioBuffer[0];
+								pPokey->sSioPendingSector = sSectorIndex;
+								pPokey->sSioPendingBytes = sBytesToRead;
+
+								pPokey->aSioBuffer[0] = 'A';
 								Pokey_SioQueueSerinResponse(pContext, 1);
 							}
 						}
 
 						break;
 
-					case 0x21: /* FORMAT */
+					case SIO_COMMAND_FORMAT:
 #ifdef VERBOSE_SIO
 						printf("SIO format\n");
 #endif
-						if(!pIoData->pDisk1 || pIoData->lDiskSize <= 16)
+						if(!pDrive->pImage || pDrive->lSize <= 16)
 						{
-							aSioBuffer[0] = 'N';
+							pPokey->aSioBuffer[0] = 'N';
 							Pokey_SioQueueSerinResponse(pContext, 1);
 						}
 						else
 						{
-							memset(pIoData->pDisk1 + 16, 0, pIoData->lDiskSize - 16);
-							aSioBuffer[0] = 'A';
-							aSioBuffer[1] = 'C';
+							memset(pDrive->pImage + 16, 0, pDrive->lSize - 16);
+							Pokey_SioImageWritten(pDrive, 16, pDrive->lSize - 16);
+							pPokey->aSioBuffer[0] = 'A';
+							pPokey->aSioBuffer[1] = 'C';
 							Pokey_SioQueueSerinResponse(pContext, 2);
 						}
 
@@ -2071,14 +3741,33 @@ u8 *Pokey_SEROUT_SERIN(_6502_Context_t *pContext, u8 *pValue)
 #ifdef VERBOSE_SIO
 						printf("SIO motor on\n");
 #endif
-						aSioBuffer[0] = 'A';
-						aSioBuffer[1] = 'C';
+						pPokey->aSioBuffer[0] = 'A';
+						pPokey->aSioBuffer[1] = 'C';
+						Pokey_SioQueueSerinResponse(pContext, 2);
+
+						break;
+
+					case SIO_COMMAND_GET_SPEED:
+						pPokey->aSioBuffer[0] = 'A';
+						pPokey->aSioBuffer[1] = 'C';
+						pPokey->aSioBuffer[2] = SIO_ULTRA_SPEED_DIVISOR;
+						pPokey->aSioBuffer[3] = AtariIo_SioChecksum(&pPokey->aSioBuffer[2], 1);
+						Pokey_SioQueueSerinResponse(pContext, 4);
+
+						break;
+
+					case SIO_COMMAND_HAPPY_CONFIG:
+						/* Nothing to configure: the speed follows POKEY. */
+						pPokey->aSioBuffer[0] = 'A';
+						pPokey->aSioBuffer[1] = 'C';
 						Pokey_SioQueueSerinResponse(pContext, 2);
 
 						break;
 
 					default:
-						printf("Unsupported SIO command $%02X!\n", aSioBuffer[1]);
+#ifdef VERBOSE_SIO
+						printf("Unsupported SIO command $%02X!\n", pPokey->aSioBuffer[1]);
+#endif
 
 						break;
 					}
@@ -2088,40 +3777,41 @@ u8 *Pokey_SEROUT_SERIN(_6502_Context_t *pContext, u8 *pValue)
 				{
 					u32 lIndex;
 
-					printf("Wrong SIO checksum (expected %02X): ",
-						   AtariIo_SioChecksum(aSioBuffer, 4));
+					printf("Wrong SIO checksum (expected %02X) or no drive: ",
+						   AtariIo_SioChecksum(pPokey->aSioBuffer, 4));
 
 					for(lIndex = 0; lIndex < 5; lIndex++)
 					{
-						printf("%02X ", aSioBuffer[lIndex]);
+						printf("%02X ", pPokey->aSioBuffer[lIndex]);
 					}
 
 					printf("\n");
 				}
 #endif
-				cSioOutIndex = 0;
+				pPokey->sSioOutIndex = 0;
 			}
 		}
 	}
-	else
+	else if(!(pIoData->pCassette && pIoData->bCassetteMotor))
 	{
-		RAM[IO_SEROUT_SERIN] = aSioBuffer[sSioInIndex++];
-		sSioInSize--;
+		/* With the tape running, its bytes are put in SERIN as they arrive. */
+		RAM[IO_SEROUT_SERIN] = pPokey->aSioBuffer[pPokey->sSioInIndex++];
+		pPokey->sSioInSize--;
 #ifdef VERBOSE_SIO
 		printf("             [%16llu] SERIN ", pContext->llCycleCounter);
-		printf("(%02X, %d bytes left)!\n", RAM[IO_SEROUT_SERIN], sSioInSize);
+		printf("(%02X, %d bytes left)!\n", RAM[IO_SEROUT_SERIN], pPokey->sSioInSize);
 #endif
-		if(sSioInSize > 0)
+		if(pPokey->sSioInSize > 0)
 		{
 			u64 llNow = PokeyMasterReferenceCycle(pContext);
-			pIoData->llSerialInputDataReadyCycle =
-				llNow + SERIAL_INPUT_DATA_READY_CYCLES;
-
-			AtariIoCycleTimedEventUpdate(pContext);
+			AtariIoScheduleTimedEvent(
+				pContext,
+				TIMED_EVENT_SERIAL_INPUT_DATA_READY,
+				llNow + Pokey_SioCycles(pContext, SERIAL_INPUT_DATA_READY_CYCLES));
 		}
 		else
 		{
-			sSioInIndex = 0;
+			pPokey->sSioInIndex = 0;
 		}
 	}
 
@@ -2213,6 +3903,7 @@ u8 *Pokey_SKCTL_SKSTAT(_6502_Context_t *pContext, u8 *pValue)
 		Pokey_Sync(pContext, pContext->llCycleCounter);
 		Pokey_PotPrepareSkctlWrite(pContext);
 		SRAM[IO_SKCTL_SKSTAT] = *pValue;
+		Pokey_LogRegisterWrite(pContext, IO_SKCTL_SKSTAT, *pValue);
 #ifdef VERBOSE_REGISTER
 		printf("             [%16llu]", pContext->llCycleCounter);
 		printf(" SKCTL: %02X\n", *pValue);
@@ -2220,7 +3911,17 @@ u8 *Pokey_SKCTL_SKSTAT(_6502_Context_t *pContext, u8 *pValue)
 	}
 	else
 	{
+		IoData_t *pIoData = (IoData_t *)pContext->pIoData;
+
 		Pokey_Sync(pContext, pContext->llCycleCounter);
+
+		/* Bit 4 follows the serial input line, here the tape's data. */
+		if(pIoData->pCassette)
+		{
+			u8 cLevel = pIoData->bCassetteMotor ? Cassette_Level(pIoData->pCassette, Pokey_CassetteTime(pContext)) : 1;
+
+			RAM[IO_SKCTL_SKSTAT] = (u8)((RAM[IO_SKCTL_SKSTAT] & ~0x10) | (cLevel << 4));
+		}
 	}
 
 	return &RAM[IO_SKCTL_SKSTAT];
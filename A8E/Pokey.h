@@ -40,6 +40,25 @@
 #define IO_IRQEN_IRQST 0xd20e
 #define IO_SKCTL_SKSTAT 0xd20f
 
+/* Audio output backends. */
+#define POKEY_AUDIO_SDL 0
+#define POKEY_AUDIO_NULL 1
+#define POKEY_AUDIO_FILE 2
+
+/* Disk drive models for SIO; each adds its high-speed command set. */
+#define POKEY_SIO_DRIVE_STOCK 0
+#define POKEY_SIO_DRIVE_ULTRA 1
+#define POKEY_SIO_DRIVE_XF551 2
+#define POKEY_SIO_DRIVE_HAPPY 3
+
+/* Drive activity for a frontend, e.g. its window title: the sector of a
+   read, or 0 for a status command. */
+typedef void (*PokeySioStatusCallback_t)(void *pUser, u16 sSector);
+
+/* Audio output synthesis modes. */
+#define POKEY_SYNTHESIS_BOX 0
+#define POKEY_SYNTHESIS_BLEP 1
+
 u8 *Pokey_AUDF1_POT0(_6502_Context_t *pContext, u8 *pValue);
 u8 *Pokey_AUDC1_POT1(_6502_Context_t *pContext, u8 *pValue);
 u8 *Pokey_AUDF2_POT2(_6502_Context_t *pContext, u8 *pValue);
@@ -59,13 +78,68 @@ u8 *Pokey_SKCTL_SKSTAT(_6502_Context_t *pContext, u8 *pValue);
 /* Returns the timer period in CPU cycles for timer 1/2/4. Returns 0 if disabled. */
 u64 Pokey_TimerPeriodCpuCycles(_6502_Context_t *pContext, u8 timer);
 
-void Pokey_Init(_6502_Context_t *pContext);
+/* Opens POKEY with its own audio backend. The null backend synthesizes
+   and discards, the file backend writes a 16-bit mono WAV to
+   pAudioFileName; both are paced by emulated time only, never by a device. */
+void Pokey_Init(_6502_Context_t *pContext, u8 cAudioBackend, const char *pAudioFileName);
 void Pokey_Close(_6502_Context_t *pContext);
 void Pokey_Sync(_6502_Context_t *pContext, u64 llCycleCounter);
 
+/* Selects POKEY_SYNTHESIS_BLEP (default) or the legacy POKEY_SYNTHESIS_BOX filter. */
+void Pokey_SetSynthesisMode(_6502_Context_t *pContext, u8 cMode);
+
+/* Moves audio synthesis to its own thread, fed by a cycle-stamped log of
+   POKEY register writes, or (bEnable = 0) back to the emulation thread. */
+void Pokey_SetSynthesisThread(_6502_Context_t *pContext, u8 bEnable);
+
+/* The chip state (channels, poly counters, AUDCTL and SKCTL) as a block
+   of Pokey_StateSize bytes, for machine snapshots taken while no SIO
+   transfer runs. Audio output goes on from where it is: Pokey_LoadState
+   only moves the chip to the restored cycle counter, and restarts a
+   running capture there. */
+u32 Pokey_StateSize(void);
+void Pokey_SaveState(_6502_Context_t *pContext, void *pState);
+void Pokey_LoadState(_6502_Context_t *pContext, const void *pState);
+
+/* Carries out the SIO request in the device control block at $0300 for
+   D1:-D8: directly against the disk image (with the SIOV patch on) or for
+   C: record reads against the tape (with fast cassette loading on).
+   Returns the SIO status, or 0 if nothing answers the device or it is not
+   a read, write, put, verify or status. The number of data bytes moved is
+   stored in *pBytes. */
+u8 Pokey_SioRequest(_6502_Context_t *pContext, u32 *pBytes);
+
+/* Selects the drive model (POKEY_SIO_DRIVE_x) of D1:-D8:. Serial byte timing
+   always follows the AUDF3/AUDF4 divisor the guest programs; the model
+   only decides which high-speed commands the drive answers. */
+void Pokey_SetSioDrive(_6502_Context_t *pContext, u8 cModel);
+
+/* Tells Callback about sector reads and status commands of D1:-D8:, at
+   most once per PAL frame of emulated time; the last one always gets
+   through. NULL (the default) reports nothing. */
+void Pokey_SetSioStatusCallback(_6502_Context_t *pContext, PokeySioStatusCallback_t Callback, void *pUser);
+
+/* Starts or stops the cassette motor (PIA CA2 low is on). Tape time and
+   the tape bytes arriving in SERIN only run while it is on. */
+void Pokey_SetCassetteMotor(_6502_Context_t *pContext, u8 bOn);
+
 void Pokey_PotStartScan(_6502_Context_t *pContext);
 void Pokey_PotUpdate(_6502_Context_t *pContext);
 
+/* Samples produced since Pokey_Init, whatever the backend. */
+u64 Pokey_AudioSamplesOut(_6502_Context_t *pContext);
+
+/* Starts (bEnable = 1) or stops recording every audio register write
+   (AUDFx/AUDCx/AUDCTL/STIMER/SKCTL) with its cycle stamp. Starting again
+   discards the previous capture; stopping keeps it for export. */
+void Pokey_SetCapture(_6502_Context_t *pContext, u8 bEnable);
+u32 Pokey_CaptureCount(_6502_Context_t *pContext);
+
+/* Export the capture as SAP type R (register state once per PAL frame) or
+   as a lossless stream of cycle-stamped writes. Return 1 on success. */
+int Pokey_SaveCaptureSap(_6502_Context_t *pContext, const char *pFileName);
+int Pokey_SaveCaptureStream(_6502_Context_t *pContext, const char *pFileName);
+
 /* Returns 1 if audio buffer is too full and emulation should wait, 0 otherwise. */
 int Pokey_ShouldThrottle(_6502_Context_t *pContext);
 
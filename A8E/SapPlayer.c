@@ -0,0 +1,557 @@
+/********************************************************************
+*
+*
+*
+* SAP Player
+*
+* (c) 2004 Sascha Springer
+*
+*
+*
+********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+
+#include "6502.h"
+#include "AtariIo.h"
+#include "Pokey.h"
+#include "SapPlayer.h"
+
+/********************************************************************
+*
+*
+* Definitionen
+*
+*
+********************************************************************/
+
+#define SAP_MAX_FILE_SIZE 0x20000
+#define SAP_MAX_LINE 256
+#define SAP_REGISTERS_PER_FRAME 9
+
+/* Routines are entered with this address minus one on the stack, so their
+   final RTS lands here. It lies in the POKEY page, which holds no code. */
+#define SAP_RETURN_ADDRESS 0xd2ff
+
+/* A routine still running after this long is taken to be hung. */
+#define SAP_CALL_CYCLE_LIMIT (ATARI_CPU_HZ_PAL * 10u)
+
+/********************************************************************
+*
+*
+* Funktionen
+*
+*
+********************************************************************/
+
+static void SapPlayer_CopyText(char *pDestination, const char *pValue)
+{
+	u32 lLength = 0;
+
+	if(*pValue == '"')
+	{
+		pValue++;
+	}
+
+	while(pValue[lLength] && pValue[lLength] != '"' && lLength < SAP_MAX_TEXT - 1)
+	{
+		pDestination[lLength] = pValue[lLength];
+		lLength++;
+	}
+
+	pDestination[lLength] = 0;
+}
+
+/* Parses "mm:ss.xxx" into milliseconds; returns 0 if malformed. */
+static u32 SapPlayer_ParseTime(const char *pValue)
+{
+	u32 lMinutes = 0;
+	u32 lSeconds = 0;
+	u32 lMilliseconds = 0;
+	u32 lScale = 100;
+
+	if(*pValue < '0' || *pValue > '9')
+	{
+		return 0;
+	}
+
+	while(*pValue >= '0' && *pValue <= '9')
+	{
+		lMinutes = lMinutes * 10 + (u32)(*pValue++ - '0');
+	}
+
+	if(*pValue++ != ':')
+	{
+		return 0;
+	}
+
+	while(*pValue >= '0' && *pValue <= '9')
+	{
+		lSeconds = lSeconds * 10 + (u32)(*pValue++ - '0');
+	}
+
+	if(*pValue == '.')
+	{
+		pValue++;
+		while(*pValue >= '0' && *pValue <= '9' && lScale)
+		{
+			lMilliseconds += (u32)(*pValue++ - '0') * lScale;
+			lScale /= 10;
+		}
+	}
+
+	return (lMinutes * 60u + lSeconds) * 1000u + lMilliseconds;
+}
+
+static void SapPlayer_ParseTag(SapFile_t *pSap, const char *pTag, const char *pValue, u8 *pTimeCount)
+{
+	if(!strcmp(pTag, "NAME"))
+	{
+		SapPlayer_CopyText(pSap->aName, pValue);
+	}
+	else if(!strcmp(pTag, "AUTHOR"))
+	{
+		SapPlayer_CopyText(pSap->aAuthor, pValue);
+	}
+	else if(!strcmp(pTag, "DATE"))
+	{
+		SapPlayer_CopyText(pSap->aDate, pValue);
+	}
+	else if(!strcmp(pTag, "TYPE"))
+	{
+		pSap->cType = (u8)pValue[0];
+	}
+	else if(!strcmp(pTag, "SONGS"))
+	{
+		pSap->cSongs = (u8)atoi(pValue);
+	}
+	else if(!strcmp(pTag, "DEFSONG"))
+	{
+		pSap->cDefSong = (u8)atoi(pValue);
+	}
+	else if(!strcmp(pTag, "FASTPLAY"))
+	{
+		pSap->sFastplay = (u16)atoi(pValue);
+	}
+	else if(!strcmp(pTag, "INIT"))
+	{
+		pSap->sInit = (u16)strtoul(pValue, NULL, 16);
+	}
+	else if(!strcmp(pTag, "MUSIC"))
+	{
+		pSap->sMusic = (u16)strtoul(pValue, NULL, 16);
+	}
+	else if(!strcmp(pTag, "PLAYER"))
+	{
+		pSap->sPlayer = (u16)strtoul(pValue, NULL, 16);
+	}
+	else if(!strcmp(pTag, "STEREO"))
+	{
+		pSap->bStereo = 1;
+	}
+	else if(!strcmp(pTag, "NTSC"))
+	{
+		pSap->bNtsc = 1;
+	}
+	else if(!strcmp(pTag, "TIME"))
+	{
+		if(*pTimeCount < SAP_MAX_SONGS)
+		{
+			pSap->aSongMilliseconds[(*pTimeCount)++] = SapPlayer_ParseTime(pValue);
+		}
+	}
+}
+
+/* The text header is a list of "TAG value" lines ended by $FF $FF; the
+   binary part follows. */
+static int SapPlayer_ParseHeader(SapFile_t *pSap, const u8 *pBuffer, u32 lSize, u32 *pOffset)
+{
+	char aLine[SAP_MAX_LINE];
+	u32 lOffset = 0;
+	u8 cTimeCount = 0;
+
+	if(lSize < 5 || memcmp(pBuffer, "SAP", 3) != 0)
+	{
+		return 0;
+	}
+
+	while(lOffset + 1 < lSize && !(pBuffer[lOffset] == 0xff && pBuffer[lOffset + 1] == 0xff))
+	{
+		u32 lLength = 0;
+		char *pValue;
+
+		while(lOffset < lSize && pBuffer[lOffset] != '\n')
+		{
+			if(pBuffer[lOffset] != '\r' && lLength < SAP_MAX_LINE - 1)
+			{
+				aLine[lLength++] = (char)pBuffer[lOffset];
+			}
+			lOffset++;
+		}
+		lOffset++;
+		aLine[lLength] = 0;
+
+		pValue = strchr(aLine, ' ');
+		if(pValue)
+		{
+			*pValue++ = 0;
+		}
+
+		SapPlayer_ParseTag(pSap, aLine, pValue ? pValue : "", &cTimeCount);
+	}
+
+	if(lOffset + 1 >= lSize)
+	{
+		return 0;
+	}
+
+	*pOffset = lOffset + 2;
+
+	return 1;
+}
+
+int Sap_Load(SapFile_t *pSap, const char *pFileName)
+{
+	FILE *pFile;
+	u8 *pBuffer;
+	u32 lSize;
+	u32 lOffset;
+
+	memset(pSap, 0, sizeof(SapFile_t));
+	pSap->cSongs = 1;
+
+	pFile = fopen(pFileName, "rb");
+	if(!pFile)
+	{
+		fprintf(stderr, "SAP: cannot open %s\n", pFileName);
+		return 0;
+	}
+
+	pBuffer = (u8 *)malloc(SAP_MAX_FILE_SIZE);
+	if(!pBuffer)
+	{
+		fclose(pFile);
+		fprintf(stderr, "SAP: out of memory loading %s\n", pFileName);
+		return 0;
+	}
+
+	lSize = (u32)fread(pBuffer, 1, SAP_MAX_FILE_SIZE, pFile);
+	fclose(pFile);
+
+	if(!SapPlayer_ParseHeader(pSap, pBuffer, lSize, &lOffset))
+	{
+		free(pBuffer);
+		fprintf(stderr, "SAP: bad header in %s\n", pFileName);
+		return 0;
+	}
+
+	if(pSap->cType != 'B' && pSap->cType != 'C' && pSap->cType != 'D' && pSap->cType != 'R')
+	{
+		free(pBuffer);
+		fprintf(stderr, "SAP: unsupported TYPE %c in %s\n", pSap->cType ? pSap->cType : '?', pFileName);
+		return 0;
+	}
+
+	if(pSap->cSongs == 0 || pSap->cSongs > SAP_MAX_SONGS)
+	{
+		pSap->cSongs = pSap->cSongs ? SAP_MAX_SONGS : 1;
+	}
+
+	if(pSap->cDefSong >= pSap->cSongs)
+	{
+		pSap->cDefSong = 0;
+	}
+
+	if(pSap->sFastplay == 0)
+	{
+		pSap->sFastplay = pSap->bNtsc ? 262 : LINES_PER_SCREEN_PAL;
+	}
+
+	pSap->lDataSize = lSize - lOffset;
+	pSap->pData = (u8 *)malloc(pSap->lDataSize ? pSap->lDataSize : 1);
+	if(!pSap->pData)
+	{
+		free(pBuffer);
+		fprintf(stderr, "SAP: out of memory loading %s\n", pFileName);
+		return 0;
+	}
+
+	memcpy(pSap->pData, &pBuffer[lOffset], pSap->lDataSize);
+	free(pBuffer);
+
+	return 1;
+}
+
+void Sap_Free(SapFile_t *pSap)
+{
+	free(pSap->pData);
+	pSap->pData = NULL;
+	pSap->lDataSize = 0;
+}
+
+/* Copies the binary load blocks (start, end, data; $FF $FF markers allowed
+   between blocks) into RAM. */
+static int SapPlayer_LoadBlocks(_6502_Context_t *pContext, const SapFile_t *pSap)
+{
+	const u8 *pData = pSap->pData;
+	u32 lOffset = 0;
+
+	while(lOffset < pSap->lDataSize)
+	{
+		u16 sStart;
+		u16 sEnd;
+		u32 lLength;
+
+		if(lOffset + 1 < pSap->lDataSize && pData[lOffset] == 0xff && pData[lOffset + 1] == 0xff)
+		{
+			lOffset += 2;
+			continue;
+		}
+
+		if(lOffset + 4 > pSap->lDataSize)
+		{
+			return 0;
+		}
+
+		sStart = (u16)(pData[lOffset] | (pData[lOffset + 1] << 8));
+		sEnd = (u16)(pData[lOffset + 2] | (pData[lOffset + 3] << 8));
+		lOffset += 4;
+
+		if(sEnd < sStart)
+		{
+			return 0;
+		}
+
+		lLength = (u32)(sEnd - sStart) + 1;
+		if(lOffset + lLength > pSap->lDataSize)
+		{
+			return 0;
+		}
+
+		memcpy(&RAM[sStart], &pData[lOffset], lLength);
+		lOffset += lLength;
+	}
+
+	return 1;
+}
+
+static void SapPlayer_PushReturn(_6502_Context_t *pContext)
+{
+	RAM[0x100 + CPU.sp--] = (u8)((SAP_RETURN_ADDRESS - 1) >> 8);
+	RAM[0x100 + CPU.sp--] = (u8)(SAP_RETURN_ADDRESS - 1);
+}
+
+/* Runs the routine at sAddress until its RTS. With bInterrupt set it is
+   entered like an interrupt on top of a running main program (type D), and
+   that program's registers are restored afterwards. */
+static int SapPlayer_Call(_6502_Context_t *pContext, u16 sAddress, u8 cA, u8 cX, u8 cY, u8 bInterrupt)
+{
+	_6502_Register_t tMain = CPU;
+	u64 llLimitCycle = pContext->llCycleCounter + SAP_CALL_CYCLE_LIMIT;
+
+	SapPlayer_PushReturn(pContext);
+	CPU.a = cA;
+	CPU.x = cX;
+	CPU.y = cY;
+	CPU.pc = sAddress;
+	if(bInterrupt)
+	{
+		PS.i = 1;
+	}
+
+	while(CPU.pc != SAP_RETURN_ADDRESS)
+	{
+		if(pContext->llCycleCounter >= llLimitCycle)
+		{
+			fprintf(stderr, "SAP: routine at $%04X did not return\n", sAddress);
+			return 0;
+		}
+
+		_6502_Run(pContext, pContext->llCycleCounter + 1);
+	}
+
+	if(bInterrupt)
+	{
+		CPU = tMain;
+	}
+
+	return 1;
+}
+
+/* Advances to llUntilCycle. While the CPU sits on the return address with
+   no interrupt to take, there is nothing to execute and time jumps from one
+   I/O event to the next. */
+static void SapPlayer_Idle(_6502_Context_t *pContext, u64 llUntilCycle)
+{
+	while(pContext->llCycleCounter < llUntilCycle)
+	{
+		if(CPU.pc != SAP_RETURN_ADDRESS || (pContext->cIrqPendingFlag && !PS.i))
+		{
+			_6502_Run(pContext, pContext->llCycleCounter + 1);
+			continue;
+		}
+
+		pContext->llCycleCounter = MAX(
+			pContext->llCycleCounter,
+			MIN(llUntilCycle, pContext->llIoCycleTimedEventCycle));
+
+		if(pContext->llCycleCounter >= pContext->llIoCycleTimedEventCycle)
+		{
+			pContext->IoCycleTimedEventFunction(pContext);
+		}
+	}
+}
+
+static void SapPlayer_WriteRegister(_6502_Context_t *pContext, u16 sAddress, u8 cValue)
+{
+	pContext->pAccessFunctionList[sAddress](pContext, &cValue);
+}
+
+static void SapPlayer_WriteRegisters(_6502_Context_t *pContext, const u8 *pFrame)
+{
+	u8 cRegister;
+
+	for(cRegister = 0; cRegister < SAP_REGISTERS_PER_FRAME; cRegister++)
+	{
+		SapPlayer_WriteRegister(pContext, IO_AUDF1_POT0 + cRegister, pFrame[cRegister]);
+	}
+}
+
+void Sap_Init(void)
+{
+	_6502_Init();
+}
+
+int Sap_RenderWav(const SapFile_t *pSap, u8 cSong, u32 lMilliseconds, const char *pWavFileName, u8 *pMemory)
+{
+	_6502_Context_t *pContext;
+	u64 llPeriodCycles = (u64)pSap->sFastplay * CYCLES_PER_LINE;
+	u64 llNextCycle;
+	u64 llEndCycle;
+	u32 lFrameOffset = 0;
+	int bOk = 1;
+
+	if(cSong >= pSap->cSongs)
+	{
+		fprintf(stderr, "SAP: song %u out of range (%u songs)\n", cSong, pSap->cSongs);
+		return 0;
+	}
+
+	if(lMilliseconds == 0)
+	{
+		lMilliseconds = pSap->aSongMilliseconds[cSong] ?
+							pSap->aSongMilliseconds[cSong] :
+							SAP_DEFAULT_MILLISECONDS;
+	}
+
+	pContext = _6502_Open();
+	if(!pContext)
+	{
+		return 0;
+	}
+
+	AtariIoOpenCore(pContext, POKEY_AUDIO_FILE, pWavFileName);
+
+	CPU.sp = 0xff;
+	PS.i = 1;
+
+	/* The OS leaves POKEY out of reset after boot; register dumps rely on it. */
+	SapPlayer_WriteRegister(pContext, IO_SKCTL_SKSTAT, 0x03);
+
+	llEndCycle = pContext->llCycleCounter +
+				 (u64)lMilliseconds * ATARI_CPU_HZ_PAL / 1000u;
+
+	switch(pSap->cType)
+	{
+	case 'B':
+		bOk = SapPlayer_LoadBlocks(pContext, pSap) &&
+			  SapPlayer_Call(pContext, pSap->sInit, cSong, 0, 0, 0);
+
+		break;
+
+	case 'C':
+		bOk = SapPlayer_LoadBlocks(pContext, pSap) &&
+			  SapPlayer_Call(pContext, pSap->sPlayer + 3, 0x70,
+							 (u8)pSap->sMusic, (u8)(pSap->sMusic >> 8), 0) &&
+			  SapPlayer_Call(pContext, pSap->sPlayer + 3, 0x00, cSong, 0, 0);
+
+		break;
+
+	case 'D':
+		/* INIT becomes the main program and may never return. */
+		bOk = SapPlayer_LoadBlocks(pContext, pSap);
+		SapPlayer_PushReturn(pContext);
+		CPU.a = cSong;
+		CPU.pc = pSap->sInit;
+
+		break;
+
+	default:
+		break;
+	}
+
+	if(!bOk)
+	{
+		fprintf(stderr, "SAP: cannot start song %u\n", cSong);
+	}
+
+	llNextCycle = pContext->llCycleCounter;
+
+	while(bOk && pContext->llCycleCounter < llEndCycle)
+	{
+		switch(pSap->cType)
+		{
+		case 'B':
+			bOk = SapPlayer_Call(pContext, pSap->sPlayer, 0, 0, 0, 0);
+
+			break;
+
+		case 'C':
+			bOk = SapPlayer_Call(pContext, pSap->sPlayer + 6, 0, 0, 0, 0);
+
+			break;
+
+		case 'D':
+			if(pSap->sPlayer)
+			{
+				bOk = SapPlayer_Call(pContext, pSap->sPlayer, 0, 0, 0, 1);
+			}
+
+			break;
+
+		case 'R':
+			if(lFrameOffset + SAP_REGISTERS_PER_FRAME > pSap->lDataSize)
+			{
+				llEndCycle = pContext->llCycleCounter;
+				break;
+			}
+
+			SapPlayer_WriteRegisters(pContext, &pSap->pData[lFrameOffset]);
+			lFrameOffset += SAP_REGISTERS_PER_FRAME;
+
+			break;
+		}
+
+		llNextCycle += llPeriodCycles;
+		SapPlayer_Idle(pContext, MIN(llNextCycle, llEndCycle));
+	}
+
+	Pokey_Sync(pContext, pContext->llCycleCounter);
+	if(bOk && Pokey_AudioSamplesOut(pContext) == 0)
+	{
+		bOk = 0;
+	}
+
+	if(pMemory)
+	{
+		memcpy(pMemory, RAM, 0x10000);
+	}
+
+	AtariIoClose(pContext);
+	_6502_Close(pContext);
+
+	return bOk;
+}
@@ -0,0 +1,68 @@
+/********************************************************************
+*
+*
+*
+* SAP Player
+*
+* (c) 2004 Sascha Springer
+*
+*
+*
+********************************************************************/
+
+#ifndef _SAPPLAYER_H_
+#define _SAPPLAYER_H_
+
+#include "6502.h"
+
+/********************************************************************
+*
+*
+* Definitionen
+*
+*
+********************************************************************/
+
+#define SAP_MAX_SONGS 32
+#define SAP_MAX_TEXT 128
+
+/* Length used when neither the caller nor a TIME tag gives one. */
+#define SAP_DEFAULT_MILLISECONDS (3u * 60u * 1000u)
+
+typedef struct
+{
+	u8 cType;
+	u16 sInit;
+	u16 sMusic;
+	u16 sPlayer;
+	u16 sFastplay;
+	u8 cSongs;
+	u8 cDefSong;
+	u8 bStereo;
+	u8 bNtsc;
+	u32 aSongMilliseconds[SAP_MAX_SONGS];
+
+	char aName[SAP_MAX_TEXT];
+	char aAuthor[SAP_MAX_TEXT];
+	char aDate[SAP_MAX_TEXT];
+
+	/* Everything after the text header: load blocks for types B, C and D,
+	   9-byte POKEY register frames for type R. */
+	u8 *pData;
+	u32 lDataSize;
+} SapFile_t;
+
+/* Call once before any other Sap_ function, from a single thread. */
+void Sap_Init(void);
+
+/* Returns 1 on success; errors are reported on stderr. */
+int Sap_Load(SapFile_t *pSap, const char *pFileName);
+void Sap_Free(SapFile_t *pSap);
+
+/* Renders one song to a 16-bit mono WAV file on a machine of its own, so
+   several renders may run on separate threads. lMilliseconds = 0 takes the
+   song's TIME tag. Unless pMemory is NULL, the machine's 64 KB of RAM are
+   copied there when the song ends. Returns 1 on success. */
+int Sap_RenderWav(const SapFile_t *pSap, u8 cSong, u32 lMilliseconds, const char *pWavFileName, u8 *pMemory);
+
+#endif
@@ -6,8 +6,7 @@
 #include "6502.h"
 #include "Antic.h"
 #include "AtariIo.h"
-
-SDL_Window *g_pSdlWindow = NULL;
+#include "Pokey.h"
 
 typedef struct
 {
@@ -38,7 +37,7 @@ static ProbeMachine_t ProbeMachine_Open(void)
 		return tMachine;
 	}
 
-	AtariIoOpen(tMachine.pContext, 0, NULL);
+	AtariIoOpen(tMachine.pContext, 0, NULL, POKEY_AUDIO_SDL, NULL);
 	tMachine.pIoData = (IoData_t *)tMachine.pContext->pIoData;
 
 	return tMachine;
@@ -145,7 +144,7 @@ static int TestPlayfieldFetchSchedulesCycle105Dma(void)
 
 	cValue = AtariIoTimingProbeFetchUnbufferedDisplayByte(pContext, 0x2000, 3);
 	REQUIRE(cValue == 0xa5, "cycle-105 fetch returned $%02X instead of $A5", cValue);
-	REQUIRE(pIoData->tDrawLineData.aScheduledPlayfieldDma[105] == 1,
+	REQUIRE(LINE_CYCLE_MASK_TEST(pIoData->tDrawLineData.aScheduledPlayfieldDma, 105),
 			"cycle-105 playfield DMA was not scheduled");
 
 	pIoData->llCycle = 105;
@@ -182,7 +181,7 @@ static int TestVirtualPlayfieldFetchUsesCpuBus(void)
 	REQUIRE(cValue == 0x5a,
 			"virtual playfield fetch returned $%02X instead of CPU bus value $5A",
 			cValue);
-	REQUIRE(pIoData->tDrawLineData.aScheduledPlayfieldDma[106] == 0,
+	REQUIRE(!LINE_CYCLE_MASK_TEST(pIoData->tDrawLineData.aScheduledPlayfieldDma, 106),
 			"virtual playfield fetch incorrectly scheduled DMA at cycle 106");
 
 	ProbeMachine_Close(&tMachine);
@@ -217,7 +216,7 @@ static int TestRefreshDropArtifactLatchesIntoLineBuffer(void)
 			cFirstRowValue);
 	REQUIRE(pIoData->tDrawLineData.aPlayfieldLineBuffer[0] == 0xff,
 			"refresh-drop artifact was not latched into line buffer");
-	REQUIRE(pIoData->tDrawLineData.aScheduledPlayfieldDma[106] == 0,
+	REQUIRE(!LINE_CYCLE_MASK_TEST(pIoData->tDrawLineData.aScheduledPlayfieldDma, 106),
 			"refresh-drop artifact incorrectly scheduled DMA at cycle 106");
 
 	pIoData->bFirstRowScanline = 0;
@@ -292,7 +291,7 @@ static int TestWsyncRestartDelaysForCycle105PlayfieldDma(void)
 			"CPU advanced before the cycle-105 stall completed");
 
 	pIoData->llCycle = 105;
-	pIoData->tDrawLineData.aScheduledPlayfieldDma[105] = 1;
+	LINE_CYCLE_MASK_SET(pIoData->tDrawLineData.aScheduledPlayfieldDma, 105);
 	AtariIoTimingProbeStepClock(pContext);
 	REQUIRE(pContext->llCycleCounter == 106,
 			"cycle-105 playfield DMA did not delay WSYNC restart by one cycle");
@@ -332,7 +331,7 @@ static int TestWsyncRestartDelaysForCycle106RefreshDma(void)
 			"WSYNC did not stall on the first post-write cycle");
 
 	pIoData->llCycle = 105;
-	pIoData->tDrawLineData.aScheduledPlayfieldDma[105] = 1;
+	LINE_CYCLE_MASK_SET(pIoData->tDrawLineData.aScheduledPlayfieldDma, 105);
 	pIoData->tDrawLineData.cRefreshDmaPending = 1;
 	AtariIoTimingProbeStepClock(pContext);
 	REQUIRE(pContext->llCycleCounter == 106,
@@ -7,8 +7,7 @@
 #include "Antic.h"
 #include "Gtia.h"
 #include "AtariIo.h"
-
-SDL_Window *g_pSdlWindow = NULL;
+#include "Pokey.h"
 
 void AtariIoDrawLine(_6502_Context_t *pContext);
 
@@ -41,7 +40,7 @@ static ProbeMachine_t ProbeMachine_Open(void)
 		return tMachine;
 	}
 
-	AtariIoOpen(tMachine.pContext, 0, NULL);
+	AtariIoOpen(tMachine.pContext, 0, NULL, POKEY_AUDIO_SDL, NULL);
 	tMachine.pIoData = (IoData_t *)tMachine.pContext->pIoData;
 
 	return tMachine;
@@ -151,7 +150,7 @@ static u32 ProbeMachine_ScheduledPlayfieldDmaCount(ProbeMachine_t *pMachine)
 
 	for(i = 0; i < CYCLES_PER_LINE; i++)
 	{
-		lCount += pMachine->pIoData->tDrawLineData.aScheduledPlayfieldDma[i];
+		lCount += (u32)LINE_CYCLE_MASK_TEST(pMachine->pIoData->tDrawLineData.aScheduledPlayfieldDma, i);
 	}
 
 	return lCount;
@@ -373,6 +372,203 @@ static int TestMode7FetchesCharacterDataOnOddRepeatedScanlines(void)
 	return 1;
 }
 
+static int TestPlayfieldDmaMatchesLineTemplate(void)
+{
+	static const struct
+	{
+		u8 cMode;
+		u8 bFirstRowScanline;
+	} aCases[] =
+		{
+			{0x02, 1},
+			{0x04, 0},
+			{0x0d, 1},
+			{0x0f, 1},
+	};
+	u32 i;
+	u32 w;
+
+	for(i = 0; i < sizeof(aCases) / sizeof(aCases[0]); i++)
+	{
+		ProbeMachine_t tMachine = ProbeMachine_Open();
+		_6502_Context_t *pContext = tMachine.pContext;
+		IoData_t *pIoData = tMachine.pIoData;
+
+		REQUIRE(pContext != NULL, "machine open failed");
+
+		ProbeMachine_ResetVideo(&tMachine);
+		ProbeMachine_PrepareModeLine(&tMachine, aCases[i].cMode, 8, 16, aCases[i].bFirstRowScanline);
+		SRAM[IO_CHBASE] = 0x20;
+
+		AtariIoDrawLine(pContext);
+
+		REQUIRE(
+			ProbeMachine_ScheduledPlayfieldDmaCount(&tMachine) != 0,
+			"mode %X scheduled no playfield DMA",
+			aCases[i].cMode);
+
+		for(w = 0; w < LINE_CYCLE_MASK_WORDS; w++)
+		{
+			REQUIRE(
+				pIoData->tDrawLineData.aScheduledPlayfieldDma[w] ==
+					pIoData->tDrawLineData.aPlayfieldDmaTemplate[w],
+				"mode %X (first row %u) DMA word %u was %016llX, template %016llX",
+				aCases[i].cMode,
+				(unsigned)aCases[i].bFirstRowScanline,
+				(unsigned)w,
+				(unsigned long long)pIoData->tDrawLineData.aScheduledPlayfieldDma[w],
+				(unsigned long long)pIoData->tDrawLineData.aPlayfieldDmaTemplate[w]);
+		}
+
+		ProbeMachine_Close(&tMachine);
+	}
+
+	return 1;
+}
+
+static int TestModeFGtiaPriorClassesSelectNibbleColors(void)
+{
+	static const struct
+	{
+		u8 cPrior;
+		u8 cData;
+		u8 cExpectedHigh;
+		u8 cExpectedLow;
+	} aCases[] =
+		{
+			{0x40, 0x5a, 0x85, 0x8a},
+			{0x80, 0x4a, 0x22, 0x80},
+			{0xc0, 0xd0, 0xd0, 0x80},
+	};
+	u32 i;
+
+	for(i = 0; i < sizeof(aCases) / sizeof(aCases[0]); i++)
+	{
+		ProbeMachine_t tMachine = ProbeMachine_Open();
+		_6502_Context_t *pContext = tMachine.pContext;
+		IoData_t *pIoData = tMachine.pIoData;
+
+		REQUIRE(pContext != NULL, "machine open failed");
+
+		ProbeMachine_ResetVideo(&tMachine);
+		ProbeMachine_PrepareModeLine(&tMachine, 0x0f, 8, 9, 0);
+
+		SRAM[IO_COLBK] = 0x80;
+		SRAM[IO_PRIOR] = aCases[i].cPrior;
+		pIoData->tDrawLineData.aPlayfieldLineBuffer[0] = aCases[i].cData;
+
+		AtariIoDrawLine(pContext);
+
+		REQUIRE(
+			ProbeMachine_PixelAt(&tMachine, 8, 96) == aCases[i].cExpectedHigh,
+			"PRIOR $%02X high nibble drew $%02X instead of $%02X",
+			aCases[i].cPrior,
+			ProbeMachine_PixelAt(&tMachine, 8, 96),
+			aCases[i].cExpectedHigh);
+		REQUIRE(
+			ProbeMachine_PixelAt(&tMachine, 8, 100) == aCases[i].cExpectedLow,
+			"PRIOR $%02X low nibble drew $%02X instead of $%02X",
+			aCases[i].cPrior,
+			ProbeMachine_PixelAt(&tMachine, 8, 100),
+			aCases[i].cExpectedLow);
+
+		ProbeMachine_Close(&tMachine);
+	}
+
+	return 1;
+}
+
+static int TestBitmapModesExpandPixelsLeftToRight(void)
+{
+	static const struct
+	{
+		u8 cMode;
+		u8 cData;
+		u8 aExpected[8];
+	} aCases[] =
+		{
+			{0x0b, 0x90, {0x22, 0x22, 0x00, 0x00, 0x00, 0x00, 0x22, 0x22}},
+			{0x0d, 0x1b, {0x00, 0x00, 0x22, 0x22, 0x0b, 0x0b, 0xa0, 0xa0}},
+			{0x0a, 0x60, {0x22, 0x22, 0x22, 0x22, 0x0b, 0x0b, 0x0b, 0x0b}},
+	};
+	u32 i;
+	u32 lX;
+
+	for(i = 0; i < sizeof(aCases) / sizeof(aCases[0]); i++)
+	{
+		ProbeMachine_t tMachine = ProbeMachine_Open();
+		_6502_Context_t *pContext = tMachine.pContext;
+		IoData_t *pIoData = tMachine.pIoData;
+
+		REQUIRE(pContext != NULL, "machine open failed");
+
+		ProbeMachine_ResetVideo(&tMachine);
+		ProbeMachine_PrepareModeLine(&tMachine, aCases[i].cMode, 8, 9, 0);
+
+		pIoData->tDrawLineData.aPlayfieldLineBuffer[0] = aCases[i].cData;
+
+		AtariIoDrawLine(pContext);
+
+		for(lX = 0; lX < 8; lX++)
+		{
+			REQUIRE(
+				ProbeMachine_PixelAt(&tMachine, 8, 96 + lX) == aCases[i].aExpected[lX],
+				"mode %X x%u drew $%02X instead of $%02X",
+				aCases[i].cMode,
+				(unsigned)(96 + lX),
+				ProbeMachine_PixelAt(&tMachine, 8, 96 + lX),
+				aCases[i].aExpected[lX]);
+		}
+
+		ProbeMachine_Close(&tMachine);
+	}
+
+	return 1;
+}
+
+static int TestPlayerPlayfieldCollisionLatchesOnRead(void)
+{
+	ProbeMachine_t tMachine = ProbeMachine_Open();
+	_6502_Context_t *pContext = tMachine.pContext;
+	IoData_t *pIoData = tMachine.pIoData;
+	u8 cValue = 0x00;
+
+	REQUIRE(pContext != NULL, "machine open failed");
+
+	ProbeMachine_ResetVideo(&tMachine);
+	ProbeMachine_PrepareModeLine(&tMachine, 0x0d, 8, 10, 1);
+
+	RAM[0x2000] = 0x55; /* four PF0 pixels at x96..x103 */
+	SRAM[IO_GRAFP0_P1PL] = 0x80;
+	SRAM[IO_HPOSP0_M0PF] = 0x30;
+	SRAM[IO_COLPM0_TRIG2] = 0x36;
+
+	pIoData->bInDrawLine = 1;
+	AtariIoDrawLine(pContext);
+
+	REQUIRE(
+		*Gtia_HPOSM0_P0PF(pContext, NULL) == 0x01,
+		"P0PF read $%02X after player 0 overlapped PF0; expected $01",
+		*Gtia_HPOSM0_P0PF(pContext, NULL));
+	REQUIRE(
+		*Gtia_HPOSP0_M0PF(pContext, NULL) == 0x00,
+		"M0PF read $%02X without any missile data",
+		*Gtia_HPOSP0_M0PF(pContext, NULL));
+
+	ProbeMachine_PrepareModeLine(&tMachine, 0x0d, 9, 10, 0);
+	AtariIoDrawLine(pContext);
+	pIoData->bInDrawLine = 0;
+	Gtia_HITCLR(pContext, &cValue);
+
+	REQUIRE(
+		*Gtia_HPOSM0_P0PF(pContext, NULL) == 0x00,
+		"P0PF read $%02X after HITCLR; collisions drawn before the write survived",
+		*Gtia_HPOSM0_P0PF(pContext, NULL));
+
+	ProbeMachine_Close(&tMachine);
+	return 1;
+}
+
 int main(int argc, char *argv[])
 {
 	int bOk = 1;
@@ -394,6 +590,10 @@ int main(int argc, char *argv[])
 	bOk &= TestMode5UsesOneKilobyteChbaseAlignment();
 	bOk &= TestMode5FetchesCharacterDataOnOddRepeatedScanlines();
 	bOk &= TestMode7FetchesCharacterDataOnOddRepeatedScanlines();
+	bOk &= TestPlayfieldDmaMatchesLineTemplate();
+	bOk &= TestModeFGtiaPriorClassesSelectNibbleColors();
+	bOk &= TestBitmapModesExpandPixelsLeftToRight();
+	bOk &= TestPlayerPlayfieldCollisionLatchesOnRead();
 
 	SDL_Quit();
 
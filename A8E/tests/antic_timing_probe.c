@@ -6,8 +6,7 @@
 #include "6502.h"
 #include "Antic.h"
 #include "AtariIo.h"
-
-SDL_Window *g_pSdlWindow = NULL;
+#include "Pokey.h"
 
 typedef struct
 {
@@ -38,7 +37,7 @@ static ProbeMachine_t ProbeMachine_Open(void)
 		return tMachine;
 	}
 
-	AtariIoOpen(tMachine.pContext, 0, NULL);
+	AtariIoOpen(tMachine.pContext, 0, NULL, POKEY_AUDIO_SDL, NULL);
 	tMachine.pIoData = (IoData_t *)tMachine.pContext->pIoData;
 
 	return tMachine;
@@ -678,6 +677,99 @@ static int TestDliDisableOnCycle8SuppressesCurrentLine(void)
 	return 1;
 }
 
+static int TestBlankingLineKeepsRefreshAndVcountTiming(void)
+{
+	ProbeMachine_t tMachine = ProbeMachine_Open();
+	_6502_Context_t *pContext = tMachine.pContext;
+	IoData_t *pIoData = tMachine.pIoData;
+	const u32 lCurrentDisplayLine = 260;
+	const u64 llLineStartCycle = 0x3000;
+	u32 lInstructions;
+	u64 llStolenCycles;
+
+	REQUIRE(pContext != NULL, "machine open failed");
+
+	ProbeMachine_ResetTiming(&tMachine);
+
+	memset(&pContext->pMemory[0x2000], 0xea, 0x100);
+	pContext->tCpu.pc = 0x2000;
+	pIoData->tVideoData.lCurrentDisplayLine = lCurrentDisplayLine;
+	pIoData->lNextDisplayListLine = LINES_PER_SCREEN_PAL;
+	pIoData->llDisplayListFetchCycle = llLineStartCycle;
+	pIoData->llCycle = llLineStartCycle;
+	pContext->llCycleCounter = llLineStartCycle;
+	AtariIoCycleTimedEventUpdate(pContext);
+	pContext->IoCycleTimedEventFunction(pContext);
+
+	/* NOP takes two cycles, everything else the CPU lost was refresh. */
+	lInstructions = pContext->tCpu.pc - 0x2000;
+	llStolenCycles = pContext->llCycleCounter - llLineStartCycle - lInstructions * 2;
+
+	REQUIRE(pIoData->tVideoData.lCurrentDisplayLine == lCurrentDisplayLine + 1,
+			"blanking line did not advance the scanline");
+	REQUIRE(pIoData->llCycle == llLineStartCycle + CYCLES_PER_LINE,
+			"beam ended at cycle %llu instead of the line end",
+			(unsigned long long)(pIoData->llCycle - llLineStartCycle));
+	REQUIRE(pContext->llCycleCounter >= llLineStartCycle + CYCLES_PER_LINE - 1,
+			"CPU stopped at cycle %llu before the line end",
+			(unsigned long long)(pContext->llCycleCounter - llLineStartCycle));
+	REQUIRE(llStolenCycles == 9,
+			"blanking line stole %llu cycles instead of 9 refresh cycles",
+			(unsigned long long)llStolenCycles);
+	REQUIRE(pContext->pMemory[IO_VCOUNT] == (u8)((lCurrentDisplayLine + 1) >> 1),
+			"VCOUNT was not updated on the blanking line");
+
+	ProbeMachine_Close(&tMachine);
+	return 1;
+}
+
+static int TestTimedEventQueuesTrackEarliestEvent(void)
+{
+	ProbeMachine_t tMachine = ProbeMachine_Open();
+	_6502_Context_t *pContext = tMachine.pContext;
+	IoData_t *pIoData = tMachine.pIoData;
+
+	REQUIRE(pContext != NULL, "machine open failed");
+
+	ProbeMachine_ResetTiming(&tMachine);
+
+	AtariIoScheduleTimedEvent(pContext, TIMED_EVENT_TIMER_4, 0x500);
+	AtariIoScheduleTimedEvent(pContext, TIMED_EVENT_TIMER_1, 0x300);
+	AtariIoScheduleTimedEvent(pContext, TIMED_EVENT_SERIAL_INPUT_DATA_READY, 0x400);
+	AtariIoScheduleTimedEvent(pContext, TIMED_EVENT_DLI, 0x50);
+	AtariIoScheduleTimedEvent(pContext, TIMED_EVENT_VBI, 0x20);
+	REQUIRE(pContext->llIoMasterTimedEventCycle == 0x300,
+			"master queue head is %llx instead of timer 1",
+			(unsigned long long)pContext->llIoMasterTimedEventCycle);
+	REQUIRE(pContext->llIoCycleTimedEventCycle == 0x300,
+			"CPU event cycle does not follow the master queue");
+	REQUIRE(pContext->llIoBeamTimedEventCycle == 0x20,
+			"beam queue head is %llx instead of the VBI",
+			(unsigned long long)pContext->llIoBeamTimedEventCycle);
+
+	AtariIoScheduleTimedEvent(pContext, TIMED_EVENT_TIMER_1, CYCLE_NEVER);
+	AtariIoScheduleTimedEvent(pContext, TIMED_EVENT_VBI, CYCLE_NEVER);
+	REQUIRE(pIoData->llTimer1Cycle == CYCLE_NEVER, "timer 1 cycle field not disarmed");
+	REQUIRE(pContext->llIoMasterTimedEventCycle == 0x400,
+			"master queue head is %llx after disarming timer 1",
+			(unsigned long long)pContext->llIoMasterTimedEventCycle);
+	REQUIRE(pContext->llIoBeamTimedEventCycle == 0x50,
+			"beam queue head is %llx after disarming the VBI",
+			(unsigned long long)pContext->llIoBeamTimedEventCycle);
+
+	AtariIoScheduleTimedEvent(pContext, TIMED_EVENT_TIMER_4, 0x100);
+	REQUIRE(pContext->llIoMasterTimedEventCycle == 0x100,
+			"moving timer 4 earlier did not reach the queue head");
+
+	AtariIoCancelTimedEvent(pContext, TIMED_EVENT_TIMER_4);
+	REQUIRE(pIoData->llTimer4Cycle == 0x100, "cancel changed the timer 4 cycle field");
+	REQUIRE(pContext->llIoMasterTimedEventCycle == 0x400,
+			"cancelled timer 4 is still at the queue head");
+
+	ProbeMachine_Close(&tMachine);
+	return 1;
+}
+
 int main(int argc, char *argv[])
 {
 	int lPassed = 1;
@@ -694,6 +786,8 @@ int main(int argc, char *argv[])
 	lPassed &= TestVscrolExitLineFollowsLiveVscrol();
 	lPassed &= TestVscrolExitDliDeadlineCycle5();
 	lPassed &= TestVcountUpdatesAtCycle111();
+	lPassed &= TestBlankingLineKeepsRefreshAndVcountTiming();
+	lPassed &= TestTimedEventQueuesTrackEarliestEvent();
 	lPassed &= TestJvbDliReplayBehavior();
 	lPassed &= TestDliEnableOnCycle7DelaysByOneCycle();
 	lPassed &= TestDliEnableOnCycle8IsTooLate();
@@ -0,0 +1,206 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL2/SDL.h>
+
+#include "6502.h"
+#include "AtariIo.h"
+#include "Pokey.h"
+
+typedef struct
+{
+	_6502_Context_t *pContext;
+	IoData_t *pIoData;
+} ProbeMachine_t;
+
+#define REQUIRE(condition, format, ...)                                  \
+	do                                                                   \
+	{                                                                    \
+		if(!(condition))                                                 \
+		{                                                                \
+			fprintf(stderr, "%s: " format "\n", __func__, ##__VA_ARGS__); \
+			return 0;                                                    \
+		}                                                                \
+	} while(0)
+
+#define PROBE_BAS_FILE_NAME "basic_loader_probe.bas"
+#define PROBE_CIOV 0xe456
+#define PROBE_LOMEM 0x0700
+#define PROBE_LBUFF 0x0580
+#define PROBE_DATA_SIZE 0x14u
+
+/* VNTP $0100, VNTD $0101, VVTP $0102, STMTAB $0104, STMCUR $0110,
+   STARP $0114, then the bytes 1 to $14. */
+static const u8 m_aProbeHeader[] = {
+	0x00, 0x00, 0x00, 0x01, 0x01, 0x01, 0x02, 0x01, 0x04, 0x01, 0x10, 0x01, 0x14, 0x01};
+
+static ProbeMachine_t ProbeMachine_Open(void)
+{
+	ProbeMachine_t tMachine;
+
+	memset(&tMachine, 0, sizeof(tMachine));
+
+	tMachine.pContext = _6502_Open();
+	if(tMachine.pContext == NULL)
+	{
+		fprintf(stderr, "ProbeMachine_Open: _6502_Open failed\n");
+		return tMachine;
+	}
+
+	AtariIoOpen(tMachine.pContext, 0, NULL, POKEY_AUDIO_NULL, NULL);
+	tMachine.pIoData = (IoData_t *)tMachine.pContext->pIoData;
+
+	/* What BASIC leaves before reading a line: LOMEM, and MEMTOP below
+	   its ROM. */
+	tMachine.pContext->pMemory[0x80] = PROBE_LOMEM & 0xff;
+	tMachine.pContext->pMemory[0x81] = PROBE_LOMEM >> 8;
+	tMachine.pContext->pMemory[0x2e5] = 0x1f;
+	tMachine.pContext->pMemory[0x2e6] = 0x9c;
+
+	return tMachine;
+}
+
+static void ProbeMachine_Close(ProbeMachine_t *pMachine)
+{
+	if(pMachine->pContext)
+	{
+		AtariIoClose(pMachine->pContext);
+		_6502_Close(pMachine->pContext);
+	}
+
+	memset(pMachine, 0, sizeof(*pMachine));
+}
+
+/* E: GET RECORD into LBUFF, JSR CIOV from sCaller; returns pc afterwards. */
+static u16 ProbeMachine_GetLine(ProbeMachine_t *pMachine, u16 sCaller)
+{
+	_6502_Context_t *pContext = pMachine->pContext;
+	u8 *pMemory = pContext->pMemory;
+
+	pMemory[0x0342] = 0x05;
+	pMemory[0x0344] = PROBE_LBUFF & 0xff;
+	pMemory[0x0345] = PROBE_LBUFF >> 8;
+	pMemory[0x0348] = 0xff;
+	pMemory[0x0349] = 0x00;
+
+	pContext->tCpu.x = 0;
+	pContext->tCpu.sp = 0xfd;
+	pMemory[0x1ff] = (u8)((sCaller + 2) >> 8);
+	pMemory[0x1fe] = (u8)((sCaller + 2) & 0xff);
+	pContext->tCpu.pc = PROBE_CIOV + 1;
+
+	if(!pContext->TrapFunction(pContext))
+	{
+		return 0;
+	}
+
+	return pContext->tCpu.pc;
+}
+
+static u16 Probe_Word(ProbeMachine_t *pMachine, u16 sAddress)
+{
+	return (u16)(pMachine->pContext->pMemory[sAddress] | (pMachine->pContext->pMemory[sAddress + 1] << 8));
+}
+
+static int Probe_WriteBas(const u8 *pHeader, u32 lDataSize)
+{
+	FILE *pFile = fopen(PROBE_BAS_FILE_NAME, "wb");
+	u32 i;
+
+	if(!pFile)
+	{
+		return 0;
+	}
+
+	fwrite(pHeader, 1, 14, pFile);
+	for(i = 0; i < lDataSize; i++)
+	{
+		fputc((int)(i + 1), pFile);
+	}
+
+	return fclose(pFile) == 0;
+}
+
+static int TestProgramInjectedAndRun(void)
+{
+	ProbeMachine_t tMachine = ProbeMachine_Open();
+	_6502_Context_t *pContext = tMachine.pContext;
+	u8 *pMemory;
+	u16 sCioTarget;
+	u32 i;
+
+	REQUIRE(pContext != NULL, "machine open failed");
+	pMemory = pContext->pMemory;
+	sCioTarget = Probe_Word(&tMachine, PROBE_CIOV + 1);
+
+	REQUIRE(Probe_WriteBas(m_aProbeHeader, PROBE_DATA_SIZE - 1), "cannot write BAS file");
+	REQUIRE(!AtariIoLoadBasic(pContext, PROBE_BAS_FILE_NAME, 1), "short program accepted");
+	REQUIRE(Probe_WriteBas(m_aProbeHeader, PROBE_DATA_SIZE), "cannot write BAS file");
+	REQUIRE(AtariIoLoadBasic(pContext, PROBE_BAS_FILE_NAME, 1), "program not accepted");
+	REQUIRE(pMemory[PROBE_CIOV] == 0x22, "CIOV not trapped");
+
+	/* Lines read by anything but BASIC, or with BASIC banked out, pass. */
+	REQUIRE(ProbeMachine_GetLine(&tMachine, 0x2000) == sCioTarget, "line outside BASIC not passed on");
+	pContext->pShadowMemory[0xd301] |= 0x02;
+	REQUIRE(ProbeMachine_GetLine(&tMachine, 0xb000) == sCioTarget, "line with BASIC off not passed on");
+	pContext->pShadowMemory[0xd301] &= ~0x02;
+	REQUIRE(tMachine.pIoData->pBasicProgram != NULL, "program dropped early");
+
+	REQUIRE(ProbeMachine_GetLine(&tMachine, 0xb000) == 0xb003 && pContext->tCpu.y == 0x01,
+			"first BASIC line not served");
+	REQUIRE(memcmp(&pMemory[PROBE_LBUFF], "RUN\x9b", 4) == 0 && Probe_Word(&tMachine, 0x0348) == 4,
+			"line is not RUN");
+
+	for(i = 0; i < PROBE_DATA_SIZE; i++)
+	{
+		REQUIRE(pMemory[PROBE_LOMEM + 0x100 + i] == i + 1, "program byte %lu wrong", i);
+	}
+
+	REQUIRE(Probe_Word(&tMachine, 0x82) == PROBE_LOMEM + 0x100 && Probe_Word(&tMachine, 0x88) == PROBE_LOMEM + 0x104 &&
+				Probe_Word(&tMachine, 0x8c) == PROBE_LOMEM + 0x114,
+			"pointers not relocated");
+	REQUIRE(Probe_Word(&tMachine, 0x8e) == PROBE_LOMEM + 0x114 && Probe_Word(&tMachine, 0x90) == PROBE_LOMEM + 0x114,
+			"RUNSTK/MEMTOP not at STARP");
+	REQUIRE(pMemory[PROBE_CIOV] != 0x22, "CIOV trap left in");
+
+	ProbeMachine_Close(&tMachine);
+	return 1;
+}
+
+static int TestProgramLoadedWithoutRun(void)
+{
+	ProbeMachine_t tMachine = ProbeMachine_Open();
+	_6502_Context_t *pContext = tMachine.pContext;
+	u16 sCioTarget;
+
+	REQUIRE(pContext != NULL, "machine open failed");
+	sCioTarget = Probe_Word(&tMachine, PROBE_CIOV + 1);
+
+	REQUIRE(AtariIoLoadBasic(pContext, PROBE_BAS_FILE_NAME, 0), "program not accepted");
+	REQUIRE(ProbeMachine_GetLine(&tMachine, 0xb000) == sCioTarget, "line not left to the OS");
+	REQUIRE(Probe_Word(&tMachine, 0x8c) == PROBE_LOMEM + 0x114 && pContext->pMemory[PROBE_LOMEM + 0x100] == 1,
+			"program not loaded");
+
+	ProbeMachine_Close(&tMachine);
+	return 1;
+}
+
+int main(int argc, char *argv[])
+{
+	int bOk;
+
+	_6502_Init();
+
+	bOk = TestProgramInjectedAndRun() && TestProgramLoadedWithoutRun();
+
+	remove(PROBE_BAS_FILE_NAME);
+
+	if(!bOk)
+	{
+		return 1;
+	}
+
+	printf("basic_loader_probe passed\n");
+	return 0;
+}
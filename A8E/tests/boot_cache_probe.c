@@ -0,0 +1,212 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL2/SDL.h>
+
+#include "6502.h"
+#include "AtariIo.h"
+#include "Pokey.h"
+
+typedef struct
+{
+	_6502_Context_t *pContext;
+	IoData_t *pIoData;
+} ProbeMachine_t;
+
+#define REQUIRE(condition, format, ...)                                  \
+	do                                                                   \
+	{                                                                    \
+		if(!(condition))                                                 \
+		{                                                                \
+			fprintf(stderr, "%s: " format "\n", __func__, ##__VA_ARGS__); \
+			return 0;                                                    \
+		}                                                                \
+	} while(0)
+
+#define PROBE_CACHE_DIRECTORY "."
+#define PROBE_SIOV 0xe459
+#define PROBE_PATTERN_ADDRESS 0x2000
+#define PROBE_PATTERN_SIZE 0x100u
+#define PROBE_BOOT_CYCLES 2000000u
+
+static char m_aSnapshotFileName[256];
+
+static ProbeMachine_t ProbeMachine_Open(u32 lMode)
+{
+	ProbeMachine_t tMachine;
+
+	memset(&tMachine, 0, sizeof(tMachine));
+
+	tMachine.pContext = _6502_Open();
+	if(tMachine.pContext == NULL)
+	{
+		fprintf(stderr, "ProbeMachine_Open: _6502_Open failed\n");
+		return tMachine;
+	}
+
+	AtariIoOpen(tMachine.pContext, lMode, NULL, POKEY_AUDIO_NULL, NULL);
+	tMachine.pIoData = (IoData_t *)tMachine.pContext->pIoData;
+	_6502_Reset(tMachine.pContext);
+
+	return tMachine;
+}
+
+static void ProbeMachine_Close(ProbeMachine_t *pMachine)
+{
+	if(pMachine->pContext)
+	{
+		AtariIoClose(pMachine->pContext);
+		_6502_Close(pMachine->pContext);
+	}
+
+	memset(pMachine, 0, sizeof(*pMachine));
+}
+
+/* Boots a machine as far as the first SIOV call: a RAM pattern, some
+   registers and cycles, then the OS jumping to SIOV. */
+static int ProbeMachine_BootToSiov(ProbeMachine_t *pMachine)
+{
+	_6502_Context_t *pContext = pMachine->pContext;
+	u32 i;
+
+	for(i = 0; i < PROBE_PATTERN_SIZE; i++)
+	{
+		pContext->pMemory[PROBE_PATTERN_ADDRESS + i] = (u8)(i * 7 + 3);
+	}
+
+	pContext->tCpu.a = 0x31;
+	pContext->tCpu.x = 0x42;
+	pContext->tCpu.y = 0x53;
+	pContext->tCpu.sp = 0xf7;
+	pContext->llCycleCounter += PROBE_BOOT_CYCLES;
+	pContext->tCpu.pc = PROBE_SIOV + 1;
+
+	return pContext->TrapFunction(pContext);
+}
+
+static int TestSnapshotWrittenAndRestored(void)
+{
+	ProbeMachine_t tMachine = ProbeMachine_Open(0);
+	_6502_Context_t *pContext = tMachine.pContext;
+	TimedEvent_t aEvents[TIMED_EVENT_COUNT];
+	void *pPokey;
+	u64 llCycle;
+	u16 sSioTarget;
+	FILE *pFile;
+	u32 i;
+
+	REQUIRE(pContext != NULL, "machine open failed");
+	sSioTarget = (u16)(pContext->pMemory[PROBE_SIOV + 1] | (pContext->pMemory[PROBE_SIOV + 2] << 8));
+
+	REQUIRE(!AtariIoSetBootCache(pContext, PROBE_CACHE_DIRECTORY), "restored without a snapshot");
+	REQUIRE(tMachine.pIoData->pBootCacheFileName != NULL, "snapshot not pending");
+	snprintf(m_aSnapshotFileName, sizeof(m_aSnapshotFileName), "%s", tMachine.pIoData->pBootCacheFileName);
+	REQUIRE(pContext->pMemory[PROBE_SIOV] == 0x22, "SIOV not trapped");
+
+	/* The snapshot has the machine as the trap found it. */
+	llCycle = pContext->llCycleCounter + PROBE_BOOT_CYCLES;
+	REQUIRE(ProbeMachine_BootToSiov(&tMachine), "SIOV trap not handled");
+	REQUIRE(pContext->tCpu.pc == sSioTarget, "SIOV call not passed on");
+	REQUIRE(tMachine.pIoData->pBootCacheFileName == NULL, "snapshot still pending");
+	REQUIRE(pContext->pMemory[PROBE_SIOV] != 0x22, "SIOV trap left in");
+	ProbeMachine_Close(&tMachine);
+
+	pFile = fopen(m_aSnapshotFileName, "rb");
+	REQUIRE(pFile != NULL, "snapshot %s not written", m_aSnapshotFileName);
+	fclose(pFile);
+
+	/* Another run, with the disk patch on, restores it. */
+	tMachine = ProbeMachine_Open(0);
+	pContext = tMachine.pContext;
+	REQUIRE(pContext != NULL, "machine open failed");
+	AtariIoSetSioPatch(pContext, 1);
+	memcpy(aEvents, tMachine.pIoData->aTimedEvents, sizeof(aEvents));
+	pPokey = tMachine.pIoData->pPokey;
+
+	REQUIRE(AtariIoSetBootCache(pContext, PROBE_CACHE_DIRECTORY), "snapshot not restored");
+	REQUIRE(tMachine.pIoData->pBootCacheFileName == NULL, "snapshot pending after restore");
+	REQUIRE(pContext->tCpu.pc == PROBE_SIOV && pContext->tCpu.a == 0x31 && pContext->tCpu.x == 0x42 &&
+				pContext->tCpu.y == 0x53 && pContext->tCpu.sp == 0xf7,
+			"registers not restored");
+	REQUIRE(pContext->llCycleCounter == llCycle, "cycle counter not restored");
+
+	for(i = 0; i < PROBE_PATTERN_SIZE; i++)
+	{
+		REQUIRE(pContext->pMemory[PROBE_PATTERN_ADDRESS + i] == (u8)(i * 7 + 3), "RAM byte $%04lX wrong",
+				PROBE_PATTERN_ADDRESS + i);
+	}
+
+	REQUIRE(pContext->pMemory[PROBE_SIOV] == 0x22, "this run's SIOV trap lost");
+	REQUIRE(tMachine.pIoData->bSioPatch && tMachine.pIoData->pPokey == pPokey, "run state not kept");
+
+	for(i = 0; i < TIMED_EVENT_COUNT; i++)
+	{
+		REQUIRE(tMachine.pIoData->aTimedEvents[i].pCycle == aEvents[i].pCycle &&
+					tMachine.pIoData->aTimedEvents[i].Handler == aEvents[i].Handler,
+				"timed event %lu not this run's", i);
+	}
+
+	_6502_Run(pContext, pContext->llCycleCounter + CYCLES_PER_LINE * LINES_PER_SCREEN_PAL);
+	REQUIRE(pContext->llCycleCounter >= llCycle + CYCLES_PER_LINE * LINES_PER_SCREEN_PAL, "restored machine does not run");
+	ProbeMachine_Close(&tMachine);
+
+	/* A cut snapshot is taken again. */
+	pFile = fopen(m_aSnapshotFileName, "wb");
+	REQUIRE(pFile != NULL, "cannot cut snapshot");
+	fputs("A8EBOOT1", pFile);
+	fclose(pFile);
+
+	tMachine = ProbeMachine_Open(0);
+	REQUIRE(tMachine.pContext != NULL, "machine open failed");
+	REQUIRE(!AtariIoSetBootCache(tMachine.pContext, PROBE_CACHE_DIRECTORY), "cut snapshot restored");
+	REQUIRE(tMachine.pIoData->pBootCacheFileName != NULL &&
+				strcmp(tMachine.pIoData->pBootCacheFileName, m_aSnapshotFileName) == 0,
+			"cut snapshot not taken again");
+	ProbeMachine_Close(&tMachine);
+
+	return 1;
+}
+
+/* Runs last: BASIC on stays on for every machine opened after it. */
+static int TestOtherBasicOptionKeptApart(void)
+{
+	ProbeMachine_t tMachine = ProbeMachine_Open(0);
+
+	REQUIRE(tMachine.pContext != NULL, "machine open failed");
+	REQUIRE(!AtariIoSetBootCache(tMachine.pContext, PROBE_CACHE_DIRECTORY), "restored without a snapshot");
+	REQUIRE(ProbeMachine_BootToSiov(&tMachine), "SIOV trap not handled");
+	ProbeMachine_Close(&tMachine);
+
+	tMachine = ProbeMachine_Open(1);
+	REQUIRE(tMachine.pContext != NULL, "machine open failed");
+	REQUIRE(!AtariIoSetBootCache(tMachine.pContext, PROBE_CACHE_DIRECTORY), "restored with BASIC on");
+	REQUIRE(tMachine.pIoData->pBootCacheFileName != NULL &&
+				strcmp(tMachine.pIoData->pBootCacheFileName, m_aSnapshotFileName) != 0,
+			"BASIC on shares the snapshot");
+	ProbeMachine_Close(&tMachine);
+
+	return 1;
+}
+
+int main(int argc, char *argv[])
+{
+	int bOk;
+
+	_6502_Init();
+
+	bOk = TestSnapshotWrittenAndRestored() && TestOtherBasicOptionKeptApart();
+
+	if(m_aSnapshotFileName[0])
+	{
+		remove(m_aSnapshotFileName);
+	}
+
+	if(!bOk)
+	{
+		return 1;
+	}
+
+	printf("boot_cache_probe passed\n");
+	return 0;
+}
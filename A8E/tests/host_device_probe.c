@@ -0,0 +1,338 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#define Probe_MakeDirectory(name) _mkdir(name)
+#define Probe_RemoveDirectory(name) _rmdir(name)
+#else
+#include <sys/stat.h>
+#include <unistd.h>
+#define Probe_MakeDirectory(name) mkdir(name, 0755)
+#define Probe_RemoveDirectory(name) rmdir(name)
+#endif
+
+#include <SDL2/SDL.h>
+
+#include "6502.h"
+#include "AtariIo.h"
+#include "Pokey.h"
+
+typedef struct
+{
+	_6502_Context_t *pContext;
+	IoData_t *pIoData;
+} ProbeMachine_t;
+
+#define REQUIRE(condition, format, ...)                                  \
+	do                                                                   \
+	{                                                                    \
+		if(!(condition))                                                 \
+		{                                                                \
+			fprintf(stderr, "%s: " format "\n", __func__, ##__VA_ARGS__); \
+			return 0;                                                    \
+		}                                                                \
+	} while(0)
+
+#define PROBE_DIRECTORY "host_device_probe.dir"
+#define PROBE_CIOV 0xe456
+#define PROBE_NAME 0x0600
+#define PROBE_BUFFER 0x2000
+#define PROBE_RETURN 0x3000
+
+#define PROBE_IOCB(pMachine, cIocb, offset) (pMachine)->pContext->pMemory[0x0340 + (cIocb) + (offset)]
+
+static ProbeMachine_t ProbeMachine_Open(void)
+{
+	ProbeMachine_t tMachine;
+	u8 cIocb;
+
+	memset(&tMachine, 0, sizeof(tMachine));
+
+	tMachine.pContext = _6502_Open();
+	if(tMachine.pContext == NULL)
+	{
+		fprintf(stderr, "ProbeMachine_Open: _6502_Open failed\n");
+		return tMachine;
+	}
+
+	AtariIoOpen(tMachine.pContext, 0, NULL, POKEY_AUDIO_NULL, NULL);
+	tMachine.pIoData = (IoData_t *)tMachine.pContext->pIoData;
+
+	/* IOCBs closed, as the OS leaves them. */
+	for(cIocb = 0; cIocb < 0x80; cIocb += 0x10)
+	{
+		PROBE_IOCB(&tMachine, cIocb, 0x00) = 0xff;
+	}
+
+	return tMachine;
+}
+
+static void ProbeMachine_Close(ProbeMachine_t *pMachine)
+{
+	if(pMachine->pContext)
+	{
+		AtariIoClose(pMachine->pContext);
+		_6502_Close(pMachine->pContext);
+	}
+
+	memset(pMachine, 0, sizeof(*pMachine));
+}
+
+/* JSR sEntry from PROBE_RETURN - 3, up to the trap opcode there. Returns 0
+   if the trap passed the call on, else the status left in Y. */
+static u8 ProbeMachine_Call(ProbeMachine_t *pMachine, u16 sEntry)
+{
+	_6502_Context_t *pContext = pMachine->pContext;
+
+	pContext->tCpu.sp = 0xfd;
+	pContext->pMemory[0x1ff] = (PROBE_RETURN - 1) >> 8;
+	pContext->pMemory[0x1fe] = (PROBE_RETURN - 1) & 0xff;
+	pContext->tCpu.pc = (u16)(sEntry + 1);
+
+	if(!pContext->TrapFunction(pContext) || pContext->tCpu.pc != PROBE_RETURN)
+	{
+		return 0;
+	}
+
+	return pContext->tCpu.y;
+}
+
+/* CIO call on cIocb with the name or buffer at sBuffer. */
+static u8 ProbeMachine_Cio(ProbeMachine_t *pMachine, u8 cIocb, u8 cCommand, u16 sBuffer, u16 sLength, u8 cAux1)
+{
+	PROBE_IOCB(pMachine, cIocb, 0x02) = cCommand;
+	PROBE_IOCB(pMachine, cIocb, 0x04) = (u8)(sBuffer & 0xff);
+	PROBE_IOCB(pMachine, cIocb, 0x05) = (u8)(sBuffer >> 8);
+	PROBE_IOCB(pMachine, cIocb, 0x08) = (u8)(sLength & 0xff);
+	PROBE_IOCB(pMachine, cIocb, 0x09) = (u8)(sLength >> 8);
+	PROBE_IOCB(pMachine, cIocb, 0x0a) = cAux1;
+	pMachine->pContext->tCpu.x = cIocb;
+
+	return ProbeMachine_Call(pMachine, PROBE_CIOV);
+}
+
+/* CIO call whose buffer is the name pName, ending in EOL. */
+static u8 ProbeMachine_CioName(ProbeMachine_t *pMachine, u8 cIocb, u8 cCommand, const char *pName, u8 cAux1)
+{
+	u32 lLength = (u32)strlen(pName);
+
+	memcpy(&pMachine->pContext->pMemory[PROBE_NAME], pName, lLength);
+	pMachine->pContext->pMemory[PROBE_NAME + lLength] = 0x9b;
+
+	return ProbeMachine_Cio(pMachine, cIocb, cCommand, PROBE_NAME, 0, cAux1);
+}
+
+static u16 ProbeMachine_Length(ProbeMachine_t *pMachine, u8 cIocb)
+{
+	return (u16)(PROBE_IOCB(pMachine, cIocb, 0x08) | (PROBE_IOCB(pMachine, cIocb, 0x09) << 8));
+}
+
+/* Returns the size of the host file, or -1; its first bytes go to pData. */
+static long Probe_ReadHostFile(const char *pName, u8 *pData, u32 lSize)
+{
+	char aPath[256];
+	FILE *pFile;
+	long lRead;
+
+	snprintf(aPath, sizeof(aPath), "%s/%s", PROBE_DIRECTORY, pName);
+	pFile = fopen(aPath, "rb");
+	if(!pFile)
+	{
+		return -1;
+	}
+
+	lRead = (long)fread(pData, 1, lSize, pFile);
+	fseek(pFile, 0, SEEK_END);
+	lRead = ftell(pFile);
+	fclose(pFile);
+
+	return lRead;
+}
+
+static int Probe_WriteHostFile(const char *pName, u32 lSize)
+{
+	char aPath[256];
+	FILE *pFile;
+	u32 i;
+
+	snprintf(aPath, sizeof(aPath), "%s/%s", PROBE_DIRECTORY, pName);
+	pFile = fopen(aPath, "wb");
+	if(!pFile)
+	{
+		return 0;
+	}
+
+	for(i = 0; i < lSize; i++)
+	{
+		fputc((int)(i & 0xff), pFile);
+	}
+
+	return fclose(pFile) == 0;
+}
+
+static void Probe_RemoveHostFile(const char *pName)
+{
+	char aPath[256];
+
+	snprintf(aPath, sizeof(aPath), "%s/%s", PROBE_DIRECTORY, pName);
+	remove(aPath);
+}
+
+static int TestHostFilesReadAndWrite(void)
+{
+	ProbeMachine_t tMachine = ProbeMachine_Open();
+	_6502_Context_t *pContext = tMachine.pContext;
+	u8 *pMemory;
+	u8 aData[16];
+	u16 sCioTarget;
+	u8 cRomByte;
+	u32 i;
+
+	REQUIRE(pContext != NULL, "machine open failed");
+	pMemory = pContext->pMemory;
+	sCioTarget = pMemory[PROBE_CIOV + 1] | (pMemory[PROBE_CIOV + 2] << 8);
+
+	REQUIRE(!AtariIoSetHostDirectory(pContext, PROBE_DIRECTORY "/missing"), "missing directory accepted");
+	REQUIRE(AtariIoSetHostDirectory(pContext, PROBE_DIRECTORY), "directory not accepted");
+	REQUIRE(pMemory[PROBE_CIOV] == 0x22 && pMemory[PROBE_CIOV + 1] == 0x22, "CIOV not trapped");
+
+	/* Other devices go on into the OS CIO. */
+	REQUIRE(ProbeMachine_CioName(&tMachine, 0x10, 0x03, "D:X", 4) == 0 && pContext->tCpu.pc == sCioTarget,
+			"D: open not passed on");
+
+	/* OPEN #1,8,0,"H:TEST.TXT": a record, a byte through ICPT, then bytes. */
+	REQUIRE(ProbeMachine_CioName(&tMachine, 0x10, 0x03, "H:TEST.TXT", 8) == 0x01, "open for writing failed");
+	REQUIRE(pMemory[0x0350] == 0xfe && pMemory[0x0353] == 0x01, "ICHID/ICSTA not set");
+	REQUIRE((pMemory[0x0356] | (pMemory[0x0357] << 8)) == PROBE_CIOV, "ICPT not the put byte vector");
+	REQUIRE(ProbeMachine_CioName(&tMachine, 0x10, 0x03, "H:TEST.TXT", 8) == 0x81, "IOCB opened twice");
+
+	memcpy(&pMemory[PROBE_BUFFER], "HELLO", 5);
+	REQUIRE(ProbeMachine_Cio(&tMachine, 0x10, 0x09, PROBE_BUFFER, 5, 0) == 0x01, "put record failed");
+
+	pContext->tCpu.a = 'X';
+	pContext->tCpu.x = 0x10;
+	REQUIRE(ProbeMachine_Call(&tMachine, PROBE_CIOV + 1) == 0x01, "put byte failed");
+
+	memcpy(&pMemory[PROBE_BUFFER], "ABC", 3);
+	REQUIRE(ProbeMachine_Cio(&tMachine, 0x10, 0x0b, PROBE_BUFFER, 3, 0) == 0x01, "put bytes failed");
+	REQUIRE(ProbeMachine_Cio(&tMachine, 0x10, 0x07, PROBE_BUFFER, 3, 0) == 0x83, "read from a write channel");
+	REQUIRE(ProbeMachine_Cio(&tMachine, 0x10, 0x0c, 0, 0, 0) == 0x01 && pMemory[0x0350] == 0xff, "close failed");
+
+	REQUIRE(Probe_ReadHostFile("TEST.TXT", aData, sizeof(aData)) == 10 && memcmp(aData, "HELLO\x9bXABC", 10) == 0,
+			"host file wrong");
+
+	/* Records: cut to the buffer, then the rest up to the end of file. */
+	REQUIRE(ProbeMachine_CioName(&tMachine, 0x20, 0x03, "h1:test.txt", 4) == 0x01, "open for reading failed");
+	REQUIRE(ProbeMachine_Cio(&tMachine, 0x20, 0x05, PROBE_BUFFER, 3, 0) == 0x89 &&
+				ProbeMachine_Length(&tMachine, 0x20) == 3 && memcmp(&pMemory[PROBE_BUFFER], "HEL", 3) == 0,
+			"long record not truncated");
+	REQUIRE(ProbeMachine_Cio(&tMachine, 0x20, 0x05, PROBE_BUFFER, 40, 0) == 0x01 &&
+				ProbeMachine_Length(&tMachine, 0x20) == 4 && memcmp(&pMemory[PROBE_BUFFER], "XABC", 4) == 0,
+			"last record wrong");
+	REQUIRE(ProbeMachine_Cio(&tMachine, 0x20, 0x05, PROBE_BUFFER, 40, 0) == 0x88, "no end of file");
+	REQUIRE(ProbeMachine_Cio(&tMachine, 0x20, 0x0b, PROBE_BUFFER, 1, 0) == 0x87, "write to a read channel");
+	REQUIRE(ProbeMachine_Cio(&tMachine, 0x20, 0x0c, 0, 0, 0) == 0x01, "close failed");
+
+	/* Bytes: host names match in any case, RAM is filled in place. */
+	REQUIRE(Probe_WriteHostFile("lower.dat", 300), "cannot write host file");
+	REQUIRE(ProbeMachine_CioName(&tMachine, 0x20, 0x03, "H:LOWER.DAT", 4) == 0x01, "lower case host file not found");
+	REQUIRE(ProbeMachine_Cio(&tMachine, 0x20, 0x07, PROBE_BUFFER, 256, 0) == 0x01 &&
+				ProbeMachine_Length(&tMachine, 0x20) == 256,
+			"first 256 bytes not read");
+	for(i = 0; i < 256; i++)
+	{
+		REQUIRE(pMemory[PROBE_BUFFER + i] == (u8)i, "byte %lu wrong", i);
+	}
+
+	/* Into ROM: through the access functions, which leave it alone. */
+	cRomByte = pMemory[0xe001];
+	REQUIRE(ProbeMachine_Cio(&tMachine, 0x20, 0x07, 0xe000, 2, 0) == 0x01 && pMemory[0xe001] == cRomByte,
+			"ROM written");
+	REQUIRE(ProbeMachine_Cio(&tMachine, 0x20, 0x07, PROBE_BUFFER, 256, 0) == 0x88 &&
+				ProbeMachine_Length(&tMachine, 0x20) == 42 && pMemory[PROBE_BUFFER] == 2,
+			"short read not end of file");
+	REQUIRE(ProbeMachine_Cio(&tMachine, 0x20, 0x0c, 0, 0, 0) == 0x01, "close failed");
+
+	REQUIRE(ProbeMachine_CioName(&tMachine, 0x30, 0x03, "H:NONE", 4) == 0xaa, "missing file opened");
+
+	ProbeMachine_Close(&tMachine);
+	return 1;
+}
+
+static int TestHostDirectoryRenameAndDelete(void)
+{
+	ProbeMachine_t tMachine = ProbeMachine_Open();
+	_6502_Context_t *pContext = tMachine.pContext;
+	u8 *pMemory;
+	u8 aData[16];
+	u8 cCiov;
+
+	REQUIRE(pContext != NULL, "machine open failed");
+	pMemory = pContext->pMemory;
+	cCiov = pMemory[PROBE_CIOV];
+
+	REQUIRE(AtariIoSetHostDirectory(pContext, PROBE_DIRECTORY), "directory not accepted");
+	/* Names H: cannot reach are left out. */
+	REQUIRE(Probe_WriteHostFile("Too_Long_Name.txt", 1) && Probe_WriteHostFile("NINECHARS", 1),
+			"cannot write host files");
+
+	REQUIRE(ProbeMachine_CioName(&tMachine, 0x10, 0x03, "H:*.*", 6) == 0x01, "directory open failed");
+	REQUIRE(ProbeMachine_Cio(&tMachine, 0x10, 0x05, PROBE_BUFFER, 40, 0) == 0x01 &&
+				memcmp(&pMemory[PROBE_BUFFER], "  LOWER   DAT 003\x9b", 18) == 0,
+			"first entry wrong");
+	REQUIRE(ProbeMachine_Cio(&tMachine, 0x10, 0x05, PROBE_BUFFER, 40, 0) == 0x01 &&
+				memcmp(&pMemory[PROBE_BUFFER], "  TEST    TXT 001\x9b", 18) == 0,
+			"second entry wrong");
+	REQUIRE(ProbeMachine_Cio(&tMachine, 0x10, 0x05, PROBE_BUFFER, 40, 0) == 0x01 &&
+				memcmp(&pMemory[PROBE_BUFFER], "995 FREE SECTORS\x9b", 17) == 0,
+			"footer wrong");
+	REQUIRE(ProbeMachine_Cio(&tMachine, 0x10, 0x05, PROBE_BUFFER, 40, 0) == 0x88, "listing does not end");
+	REQUIRE(ProbeMachine_Cio(&tMachine, 0x10, 0x0c, 0, 0, 0) == 0x01, "close failed");
+
+	/* XIO 32 and 33. */
+	REQUIRE(ProbeMachine_CioName(&tMachine, 0x10, 0x20, "H:TEST.TXT,LOWER.DAT", 0) == 0xae, "renamed over a file");
+	REQUIRE(ProbeMachine_CioName(&tMachine, 0x10, 0x20, "H:TEST.TXT,NEW.TXT", 0) == 0x01, "rename failed");
+	REQUIRE(Probe_ReadHostFile("NEW.TXT", aData, sizeof(aData)) == 10 && Probe_ReadHostFile("TEST.TXT", aData, 1) < 0,
+			"host file not renamed");
+	REQUIRE(ProbeMachine_CioName(&tMachine, 0x10, 0x21, "H:*.DAT", 0) == 0x01, "delete failed");
+	REQUIRE(Probe_ReadHostFile("lower.dat", aData, 1) < 0, "host file not deleted");
+	REQUIRE(ProbeMachine_CioName(&tMachine, 0x10, 0x21, "H:*.DAT", 0) == 0xaa, "deleted nothing");
+
+	/* The OS entry is put back. */
+	REQUIRE(AtariIoSetHostDirectory(pContext, NULL), "H: not removed");
+	REQUIRE(pMemory[PROBE_CIOV] == cCiov && pMemory[PROBE_CIOV + 1] != 0x22, "CIOV not restored");
+
+	Probe_RemoveHostFile("NEW.TXT");
+	Probe_RemoveHostFile("Too_Long_Name.txt");
+	Probe_RemoveHostFile("NINECHARS");
+	ProbeMachine_Close(&tMachine);
+	return 1;
+}
+
+int main(int argc, char *argv[])
+{
+	int bOk;
+
+	_6502_Init();
+
+	Probe_MakeDirectory(PROBE_DIRECTORY);
+
+	bOk = TestHostFilesReadAndWrite() && TestHostDirectoryRenameAndDelete();
+
+	Probe_RemoveHostFile("TEST.TXT");
+	Probe_RemoveHostFile("NEW.TXT");
+	Probe_RemoveHostFile("lower.dat");
+	Probe_RemoveHostFile("Too_Long_Name.txt");
+	Probe_RemoveHostFile("NINECHARS");
+	Probe_RemoveDirectory(PROBE_DIRECTORY);
+
+	if(!bOk)
+	{
+		return 1;
+	}
+
+	printf("host_device_probe passed\n");
+	return 0;
+}
@@ -0,0 +1,280 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL2/SDL.h>
+
+#include "6502.h"
+#include "AtariIo.h"
+#include "Pokey.h"
+
+typedef struct
+{
+	_6502_Context_t *pContext;
+	IoData_t *pIoData;
+} ProbeMachine_t;
+
+#define REQUIRE(condition, format, ...)                                  \
+	do                                                                   \
+	{                                                                    \
+		if(!(condition))                                                 \
+		{                                                                \
+			fprintf(stderr, "%s: " format "\n", __func__, ##__VA_ARGS__); \
+			return 0;                                                    \
+		}                                                                \
+	} while(0)
+
+#define PROBE_WAV_FILE_NAME "pokey_audio_probe.wav"
+#define PROBE_WAV_HEADER_SIZE 44
+#define PROBE_SAMPLE_RATE 48000u
+
+/* A tenth of a second of emulated time. */
+#define PROBE_RUN_CYCLES (ATARI_CPU_HZ_PAL / 10u)
+
+static ProbeMachine_t ProbeMachine_Open(u8 cBackend)
+{
+	ProbeMachine_t tMachine;
+
+	memset(&tMachine, 0, sizeof(tMachine));
+
+	tMachine.pContext = _6502_Open();
+	if(tMachine.pContext == NULL)
+	{
+		fprintf(stderr, "ProbeMachine_Open: _6502_Open failed\n");
+		return tMachine;
+	}
+
+	AtariIoOpen(tMachine.pContext, 0, NULL, cBackend, PROBE_WAV_FILE_NAME);
+	tMachine.pIoData = (IoData_t *)tMachine.pContext->pIoData;
+
+	return tMachine;
+}
+
+static void ProbeMachine_Close(ProbeMachine_t *pMachine)
+{
+	if(pMachine->pContext)
+	{
+		AtariIoClose(pMachine->pContext);
+		_6502_Close(pMachine->pContext);
+	}
+
+	memset(pMachine, 0, sizeof(*pMachine));
+}
+
+/* Plays a square wave on channel 1 for PROBE_RUN_CYCLES. */
+static void ProbeMachine_PlayTone(ProbeMachine_t *pMachine)
+{
+	_6502_Context_t *pContext = pMachine->pContext;
+	u8 cSkctl = 0x03;
+	u8 cAudctl = 0x00;
+	u8 cAudf = 0x40;
+	u8 cAudc = 0xaf;
+
+	Pokey_SKCTL_SKSTAT(pContext, &cSkctl);
+	Pokey_AUDCTL_ALLPOT(pContext, &cAudctl);
+	Pokey_AUDF1_POT0(pContext, &cAudf);
+	Pokey_AUDC1_POT1(pContext, &cAudc);
+
+	pContext->llCycleCounter += PROBE_RUN_CYCLES;
+	Pokey_Sync(pContext, pContext->llCycleCounter);
+}
+
+static u32 Probe_GetLe(const u8 *pBuffer, u32 lBytes)
+{
+	u32 lValue = 0;
+
+	while(lBytes--)
+	{
+		lValue = (lValue << 8) | pBuffer[lBytes];
+	}
+
+	return lValue;
+}
+
+static u8 *Probe_ReadFile(const char *pFileName, u32 *pSize)
+{
+	FILE *pFile = fopen(pFileName, "rb");
+	u8 *pBuffer;
+	long lSize;
+
+	*pSize = 0;
+	if(!pFile)
+	{
+		return NULL;
+	}
+
+	fseek(pFile, 0, SEEK_END);
+	lSize = ftell(pFile);
+	fseek(pFile, 0, SEEK_SET);
+
+	pBuffer = (u8 *)malloc(lSize > 0 ? (size_t)lSize : 1);
+	if(pBuffer && fread(pBuffer, 1, (size_t)lSize, pFile) == (size_t)lSize)
+	{
+		*pSize = (u32)lSize;
+	}
+	fclose(pFile);
+
+	return pBuffer;
+}
+
+static int TestFileBackendWritesEmulatedTimeWav(void)
+{
+	ProbeMachine_t tMachine = ProbeMachine_Open(POKEY_AUDIO_FILE);
+	u64 llSamples;
+	u8 *pFirst;
+	u8 *pSecond;
+	u32 lFirstSize;
+	u32 lSecondSize;
+	u32 lDataBytes;
+	u32 i;
+	int bToneHeard = 0;
+
+	REQUIRE(tMachine.pContext != NULL, "machine open failed");
+
+	ProbeMachine_PlayTone(&tMachine);
+	llSamples = Pokey_AudioSamplesOut(tMachine.pContext);
+	REQUIRE(llSamples + 1 >= PROBE_SAMPLE_RATE / 10u && llSamples <= PROBE_SAMPLE_RATE / 10u + 1,
+			"0.1s of emulated time produced %llu samples", (unsigned long long)llSamples);
+	REQUIRE(Pokey_ShouldThrottle(tMachine.pContext) == 0,
+			"file backend throttled the emulation");
+	ProbeMachine_Close(&tMachine);
+
+	pFirst = Probe_ReadFile(PROBE_WAV_FILE_NAME, &lFirstSize);
+	REQUIRE(pFirst != NULL && lFirstSize >= PROBE_WAV_HEADER_SIZE, "WAV file missing or truncated");
+	REQUIRE(memcmp(pFirst, "RIFF", 4) == 0 && memcmp(&pFirst[8], "WAVEfmt ", 8) == 0,
+			"WAV header tags wrong");
+	REQUIRE(Probe_GetLe(&pFirst[24], 4) == PROBE_SAMPLE_RATE, "WAV sample rate wrong");
+
+	lDataBytes = Probe_GetLe(&pFirst[40], 4);
+	REQUIRE(lDataBytes == (u32)llSamples * 2 && lFirstSize == PROBE_WAV_HEADER_SIZE + lDataBytes,
+			"WAV data size %lu does not match %llu samples", lDataBytes, (unsigned long long)llSamples);
+
+	for(i = PROBE_WAV_HEADER_SIZE + 2; i < lFirstSize; i += 2)
+	{
+		if(Probe_GetLe(&pFirst[i], 2) != Probe_GetLe(&pFirst[PROBE_WAV_HEADER_SIZE], 2))
+		{
+			bToneHeard = 1;
+			break;
+		}
+	}
+	REQUIRE(bToneHeard, "WAV data is flat");
+
+	/* Same emulated input, same bytes: usable as an audio regression. */
+	tMachine = ProbeMachine_Open(POKEY_AUDIO_FILE);
+	REQUIRE(tMachine.pContext != NULL, "machine reopen failed");
+	ProbeMachine_PlayTone(&tMachine);
+	ProbeMachine_Close(&tMachine);
+
+	pSecond = Probe_ReadFile(PROBE_WAV_FILE_NAME, &lSecondSize);
+	REQUIRE(pSecond != NULL && lSecondSize == lFirstSize && memcmp(pFirst, pSecond, lFirstSize) == 0,
+			"second run wrote a different WAV file");
+
+	free(pFirst);
+	free(pSecond);
+	remove(PROBE_WAV_FILE_NAME);
+	return 1;
+}
+
+static int TestNullBackendSynthesizesWithoutThrottling(void)
+{
+	ProbeMachine_t tMachine = ProbeMachine_Open(POKEY_AUDIO_NULL);
+	u64 llSamples;
+
+	REQUIRE(tMachine.pContext != NULL, "machine open failed");
+
+	ProbeMachine_PlayTone(&tMachine);
+	llSamples = Pokey_AudioSamplesOut(tMachine.pContext);
+	REQUIRE(llSamples + 1 >= PROBE_SAMPLE_RATE / 10u && llSamples <= PROBE_SAMPLE_RATE / 10u + 1,
+			"0.1s of emulated time produced %llu samples", (unsigned long long)llSamples);
+	REQUIRE(Pokey_ShouldThrottle(tMachine.pContext) == 0,
+			"null backend throttled the emulation");
+
+	ProbeMachine_Close(&tMachine);
+	return 1;
+}
+
+#define PROBE_CAPTURE_FILE_NAME "pokey_audio_probe.capture"
+#define PROBE_FRAME_CYCLES ((u64)CYCLES_PER_LINE * LINES_PER_SCREEN_PAL)
+
+static int TestCaptureExportsSapAndStream(void)
+{
+	ProbeMachine_t tMachine = ProbeMachine_Open(POKEY_AUDIO_NULL);
+	_6502_Context_t *pContext = tMachine.pContext;
+	u64 llStartCycle;
+	u8 cValue;
+	u8 *pFile;
+	u8 *pFrames;
+	u32 lSize;
+
+	REQUIRE(pContext != NULL, "machine open failed");
+
+	Pokey_SetCapture(pContext, 1);
+	llStartCycle = pContext->llCycleCounter;
+
+	/* Frame 0: AUDF1 = $10 then $20. Frame 2: AUDCTL = $01. */
+	pContext->llCycleCounter += 100;
+	cValue = 0x10;
+	Pokey_AUDF1_POT0(pContext, &cValue);
+	pContext->llCycleCounter += 50;
+	cValue = 0x20;
+	Pokey_AUDF1_POT0(pContext, &cValue);
+	pContext->llCycleCounter = llStartCycle + 2 * PROBE_FRAME_CYCLES + 7;
+	cValue = 0x01;
+	Pokey_AUDCTL_ALLPOT(pContext, &cValue);
+	pContext->llCycleCounter = llStartCycle + 3 * PROBE_FRAME_CYCLES;
+	Pokey_SetCapture(pContext, 0);
+
+	/* Stopped: later writes are not recorded. */
+	cValue = 0x30;
+	Pokey_AUDF1_POT0(pContext, &cValue);
+	REQUIRE(Pokey_CaptureCount(pContext) == 3, "captured %lu writes", Pokey_CaptureCount(pContext));
+
+	REQUIRE(Pokey_SaveCaptureStream(pContext, PROBE_CAPTURE_FILE_NAME), "stream export failed");
+	pFile = Probe_ReadFile(PROBE_CAPTURE_FILE_NAME, &lSize);
+	REQUIRE(pFile != NULL && lSize == 44 + 3 * 6, "stream is %lu bytes", lSize);
+	REQUIRE(memcmp(pFile, "A8EPOKEY", 8) == 0 && Probe_GetLe(&pFile[24], 4) == 3,
+			"stream header wrong");
+	REQUIRE(Probe_GetLe(&pFile[16], 4) == 3 * PROBE_FRAME_CYCLES, "stream length wrong");
+	REQUIRE(Probe_GetLe(&pFile[44], 4) == 100 && pFile[48] == 0x00 && pFile[49] == 0x10 &&
+				Probe_GetLe(&pFile[50], 4) == 50 && pFile[55] == 0x20 &&
+				pFile[60] == 0x08 && pFile[61] == 0x01,
+			"stream records wrong");
+	free(pFile);
+
+	REQUIRE(Pokey_SaveCaptureSap(pContext, PROBE_CAPTURE_FILE_NAME), "SAP export failed");
+	pFile = Probe_ReadFile(PROBE_CAPTURE_FILE_NAME, &lSize);
+	REQUIRE(pFile != NULL && lSize > 3 * 9, "SAP file missing");
+	REQUIRE(memcmp(pFile, "SAP\r\n", 5) == 0 && strstr((char *)pFile, "TYPE R\r\n") != NULL,
+			"SAP header wrong");
+
+	pFrames = &pFile[lSize - 3 * 9];
+	REQUIRE(pFrames[-2] == 0xff && pFrames[-1] == 0xff, "SAP frames not after $FF $FF");
+	REQUIRE(pFrames[0] == 0x20 && pFrames[9] == 0x20 && pFrames[18] == 0x20, "AUDF1 frames wrong");
+	REQUIRE(pFrames[8] == 0x00 && pFrames[17] == 0x00 && pFrames[26] == 0x01, "AUDCTL frames wrong");
+	free(pFile);
+
+	remove(PROBE_CAPTURE_FILE_NAME);
+	ProbeMachine_Close(&tMachine);
+	return 1;
+}
+
+int main(int argc, char *argv[])
+{
+	if(!TestFileBackendWritesEmulatedTimeWav())
+	{
+		return 1;
+	}
+
+	if(!TestNullBackendSynthesizesWithoutThrottling())
+	{
+		return 1;
+	}
+
+	if(!TestCaptureExportsSapAndStream())
+	{
+		return 1;
+	}
+
+	printf("pokey_audio_probe passed\n");
+	return 0;
+}
@@ -7,8 +7,6 @@
 #include "AtariIo.h"
 #include "Pokey.h"
 
-SDL_Window *g_pSdlWindow = NULL;
-
 typedef struct
 {
 	_6502_Context_t *pContext;
@@ -40,7 +38,7 @@ static ProbeMachine_t ProbeMachine_Open(void)
 		return tMachine;
 	}
 
-	AtariIoOpen(tMachine.pContext, 0, NULL);
+	AtariIoOpen(tMachine.pContext, 0, NULL, POKEY_AUDIO_SDL, NULL);
 	tMachine.pIoData = (IoData_t *)tMachine.pContext->pIoData;
 
 	return tMachine;
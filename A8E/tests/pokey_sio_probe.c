@@ -0,0 +1,633 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL2/SDL.h>
+
+#include "6502.h"
+#include "AtariIo.h"
+#include "Pia.h"
+#include "Pokey.h"
+
+typedef struct
+{
+	_6502_Context_t *pContext;
+	IoData_t *pIoData;
+} ProbeMachine_t;
+
+#define REQUIRE(condition, format, ...)                                  \
+	do                                                                   \
+	{                                                                    \
+		if(!(condition))                                                 \
+		{                                                                \
+			fprintf(stderr, "%s: " format "\n", __func__, ##__VA_ARGS__); \
+			return 0;                                                    \
+		}                                                                \
+	} while(0)
+
+/* 90K single density image: 720 sectors of 128 bytes. */
+#define PROBE_SECTOR_SIZE 128u
+#define PROBE_SECTORS 720u
+#define PROBE_DISK_SIZE (16u + PROBE_SECTORS * PROBE_SECTOR_SIZE)
+#define PROBE_D1_FILE_NAME "pokey_sio_probe_d1.atr"
+#define PROBE_D2_FILE_NAME "pokey_sio_probe_d2.atr"
+
+/* Writes an ATR whose sector n is filled with n + cBias. */
+static int Probe_WriteAtr(const char *pFileName, u8 cBias)
+{
+	FILE *pFile = fopen(pFileName, "wb");
+	u8 aHeader[16];
+	u8 aSector[PROBE_SECTOR_SIZE];
+	u32 i;
+
+	if(!pFile)
+	{
+		return 0;
+	}
+
+	memset(aHeader, 0, sizeof(aHeader));
+	aHeader[0] = 0x96;
+	aHeader[1] = 0x02;
+	aHeader[2] = (u8)((PROBE_SECTORS * PROBE_SECTOR_SIZE / 16) & 0xff);
+	aHeader[3] = (u8)((PROBE_SECTORS * PROBE_SECTOR_SIZE / 16) >> 8);
+	aHeader[4] = (u8)(PROBE_SECTOR_SIZE & 0xff);
+	aHeader[5] = (u8)(PROBE_SECTOR_SIZE >> 8);
+	fwrite(aHeader, 1, sizeof(aHeader), pFile);
+
+	for(i = 0; i < PROBE_SECTORS; i++)
+	{
+		memset(aSector, (u8)(i + 1 + cBias), sizeof(aSector));
+		fwrite(aSector, 1, sizeof(aSector), pFile);
+	}
+
+	return fclose(pFile) == 0;
+}
+
+/* Returns the first byte of sector sSector in the file, or -1. */
+static int Probe_ReadAtrByte(const char *pFileName, u16 sSector)
+{
+	FILE *pFile = fopen(pFileName, "rb");
+	int lValue = -1;
+
+	if(pFile)
+	{
+		fseek(pFile, 16 + (long)(sSector - 1) * PROBE_SECTOR_SIZE, SEEK_SET);
+		lValue = fgetc(pFile);
+		fclose(pFile);
+	}
+
+	return lValue;
+}
+
+static ProbeMachine_t ProbeMachine_Open(void)
+{
+	ProbeMachine_t tMachine;
+
+	memset(&tMachine, 0, sizeof(tMachine));
+
+	tMachine.pContext = _6502_Open();
+	if(tMachine.pContext == NULL)
+	{
+		fprintf(stderr, "ProbeMachine_Open: _6502_Open failed\n");
+		return tMachine;
+	}
+
+	AtariIoOpen(tMachine.pContext, 0, PROBE_D1_FILE_NAME, POKEY_AUDIO_NULL, NULL);
+	tMachine.pIoData = (IoData_t *)tMachine.pContext->pIoData;
+
+	return tMachine;
+}
+
+static void ProbeMachine_Close(ProbeMachine_t *pMachine)
+{
+	if(pMachine->pContext)
+	{
+		AtariIoClose(pMachine->pContext);
+		_6502_Close(pMachine->pContext);
+	}
+
+	memset(pMachine, 0, sizeof(*pMachine));
+}
+
+/* Programs the serial clock the way SIO does: channels 3+4 joined at 1.79 MHz. */
+static void ProbeMachine_SetDivisor(ProbeMachine_t *pMachine, u16 sDivisor)
+{
+	u8 cAudctl = 0x28;
+	u8 cAudf3 = (u8)(sDivisor & 0xff);
+	u8 cAudf4 = (u8)(sDivisor >> 8);
+
+	Pokey_AUDCTL_ALLPOT(pMachine->pContext, &cAudctl);
+	Pokey_AUDF3_POT4(pMachine->pContext, &cAudf3);
+	Pokey_AUDF4_POT6(pMachine->pContext, &cAudf4);
+}
+
+static u8 Probe_Checksum(const u8 *pBuffer, u32 lSize)
+{
+	u16 sSum = 0;
+
+	while(lSize--)
+	{
+		sSum += *pBuffer++;
+		sSum = (sSum & 0xff) + (sSum >> 8);
+	}
+
+	return (u8)sSum;
+}
+
+static void ProbeMachine_Read(ProbeMachine_t *pMachine, u8 *pAnswer, u32 lBytes)
+{
+	u32 i;
+
+	for(i = 0; i < lBytes; i++)
+	{
+		pAnswer[i] = *Pokey_SEROUT_SERIN(pMachine->pContext, NULL);
+	}
+}
+
+/* Sends a command frame to cDevice and reads lBytes of the drive's answer. */
+static void ProbeMachine_DeviceCommand(ProbeMachine_t *pMachine, u8 cDevice, u8 cCommand, u16 sAux,
+									   u8 *pAnswer, u32 lBytes)
+{
+	u8 aFrame[5];
+	u32 i;
+
+	aFrame[0] = cDevice;
+	aFrame[1] = cCommand;
+	aFrame[2] = (u8)(sAux & 0xff);
+	aFrame[3] = (u8)(sAux >> 8);
+	aFrame[4] = Probe_Checksum(aFrame, 4);
+
+	for(i = 0; i < 5; i++)
+	{
+		Pokey_SEROUT_SERIN(pMachine->pContext, &aFrame[i]);
+	}
+
+	ProbeMachine_Read(pMachine, pAnswer, lBytes);
+}
+
+static void ProbeMachine_Command(ProbeMachine_t *pMachine, u8 cCommand, u16 sAux, u8 *pAnswer, u32 lBytes)
+{
+	ProbeMachine_DeviceCommand(pMachine, 0x31, cCommand, sAux, pAnswer, lBytes);
+}
+
+/* PUT SECTOR of a sector filled with cValue; returns the final answer byte. */
+static u8 ProbeMachine_PutSector(ProbeMachine_t *pMachine, u16 sSector, u8 cValue)
+{
+	u8 aData[PROBE_SECTOR_SIZE + 1];
+	u8 aAnswer[2];
+	u32 i;
+
+	ProbeMachine_Command(pMachine, 0x50, sSector, aAnswer, 1);
+	if(aAnswer[0] != 'A')
+	{
+		return aAnswer[0];
+	}
+
+	memset(aData, cValue, PROBE_SECTOR_SIZE);
+	aData[PROBE_SECTOR_SIZE] = Probe_Checksum(aData, PROBE_SECTOR_SIZE);
+	for(i = 0; i < sizeof(aData); i++)
+	{
+		Pokey_SEROUT_SERIN(pMachine->pContext, &aData[i]);
+	}
+
+	ProbeMachine_Read(pMachine, aAnswer, 2);
+
+	return aAnswer[1];
+}
+
+static int TestSerialTimingFollowsDivisor(void)
+{
+	ProbeMachine_t tMachine = ProbeMachine_Open();
+	u8 aAnswer[7];
+	u64 llStock;
+	u64 llFast;
+
+	REQUIRE(tMachine.pContext != NULL, "machine open failed");
+
+	/* 19200 baud: the tuned constant as is. */
+	ProbeMachine_SetDivisor(&tMachine, 0x28);
+	ProbeMachine_Command(&tMachine, 0x53, 0, aAnswer, sizeof(aAnswer));
+	llStock = tMachine.pIoData->llSerialOutputNeedDataCycle - tMachine.pContext->llCycleCounter;
+
+	/* Divisor $0A: (10 + 7) / (40 + 7) of it. */
+	ProbeMachine_SetDivisor(&tMachine, 0x0a);
+	ProbeMachine_Command(&tMachine, 0x53, 0, aAnswer, sizeof(aAnswer));
+	llFast = tMachine.pIoData->llSerialOutputNeedDataCycle - tMachine.pContext->llCycleCounter;
+
+	REQUIRE(aAnswer[0] == 'A' && aAnswer[1] == 'C' && aAnswer[2] == 0x10, "status answered %02X %02X %02X",
+			aAnswer[0], aAnswer[1], aAnswer[2]);
+	REQUIRE(llStock == SERIAL_OUTPUT_DATA_NEEDED_CYCLES, "19200 baud byte took %llu cycles",
+			(unsigned long long)llStock);
+	REQUIRE(llFast == (u64)SERIAL_OUTPUT_DATA_NEEDED_CYCLES * 17 / 47, "divisor $0A byte took %llu cycles",
+			(unsigned long long)llFast);
+
+	ProbeMachine_Close(&tMachine);
+	return 1;
+}
+
+static int TestHighSpeedCommandSets(void)
+{
+	ProbeMachine_t tMachine = ProbeMachine_Open();
+	u8 aAnswer[4 + PROBE_SECTOR_SIZE];
+
+	REQUIRE(tMachine.pContext != NULL, "machine open failed");
+	ProbeMachine_SetDivisor(&tMachine, 0x28);
+
+	/* A stock drive ignores the US Doubler speed query. */
+	Pokey_SetSioDrive(tMachine.pContext, POKEY_SIO_DRIVE_STOCK);
+	ProbeMachine_Command(&tMachine, 0x3f, 0, aAnswer, 0);
+	REQUIRE(tMachine.pIoData->llSerialInputDataReadyCycle == CYCLE_NEVER, "stock drive answered '?'");
+
+	Pokey_SetSioDrive(tMachine.pContext, POKEY_SIO_DRIVE_ULTRA);
+	ProbeMachine_Command(&tMachine, 0x3f, 0, aAnswer, 4);
+	REQUIRE(aAnswer[0] == 'A' && aAnswer[1] == 'C' && aAnswer[2] == 0x0a && aAnswer[3] == 0x0a,
+			"'?' answered %02X %02X %02X %02X", aAnswer[0], aAnswer[1], aAnswer[2], aAnswer[3]);
+
+	/* XF551 read with bit 7 set and Happy lower-case read, both of sector 5. */
+	Pokey_SetSioDrive(tMachine.pContext, POKEY_SIO_DRIVE_XF551);
+	ProbeMachine_SetDivisor(&tMachine, 0x10);
+	ProbeMachine_Command(&tMachine, 0xd2, 5, aAnswer, 3 + PROBE_SECTOR_SIZE);
+	REQUIRE(aAnswer[0] == 'A' && aAnswer[1] == 'C' && aAnswer[2] == 5 && aAnswer[1 + PROBE_SECTOR_SIZE] == 5,
+			"XF551 read answered %02X %02X %02X", aAnswer[0], aAnswer[1], aAnswer[2]);
+
+	Pokey_SetSioDrive(tMachine.pContext, POKEY_SIO_DRIVE_HAPPY);
+	ProbeMachine_SetDivisor(&tMachine, 0x08);
+	ProbeMachine_Command(&tMachine, 0x72, 5, aAnswer, 3 + PROBE_SECTOR_SIZE);
+	REQUIRE(aAnswer[0] == 'A' && aAnswer[1] == 'C' && aAnswer[2] == 5 && aAnswer[1 + PROBE_SECTOR_SIZE] == 5,
+			"Happy read answered %02X %02X %02X", aAnswer[0], aAnswer[1], aAnswer[2]);
+
+	ProbeMachine_Close(&tMachine);
+	return 1;
+}
+
+static int TestDrivesRouteByDeviceId(void)
+{
+	ProbeMachine_t tMachine = ProbeMachine_Open();
+	u8 aAnswer[3 + PROBE_SECTOR_SIZE];
+
+	REQUIRE(tMachine.pContext != NULL, "machine open failed");
+	REQUIRE(tMachine.pIoData->aDrives[0].lSize == PROBE_DISK_SIZE &&
+				tMachine.pIoData->aDrives[0].sSectorSize == PROBE_SECTOR_SIZE,
+			"D1: mounted as %lu bytes of %u-byte sectors", tMachine.pIoData->aDrives[0].lSize,
+			tMachine.pIoData->aDrives[0].sSectorSize);
+	REQUIRE(AtariIoMountDisk(tMachine.pContext, 1, PROBE_D2_FILE_NAME, 0), "D2: mount failed");
+	ProbeMachine_SetDivisor(&tMachine, 0x28);
+
+	ProbeMachine_DeviceCommand(&tMachine, 0x32, 0x52, 7, aAnswer, sizeof(aAnswer));
+	REQUIRE(aAnswer[0] == 'A' && aAnswer[1] == 'C' && aAnswer[2] == 7 + 0x40,
+			"D2: read answered %02X %02X %02X", aAnswer[0], aAnswer[1], aAnswer[2]);
+
+	/* Nothing on D3:, so no drive answers. */
+	tMachine.pIoData->llSerialInputDataReadyCycle = CYCLE_NEVER;
+	ProbeMachine_DeviceCommand(&tMachine, 0x33, 0x52, 7, aAnswer, 0);
+	REQUIRE(tMachine.pIoData->llSerialInputDataReadyCycle == CYCLE_NEVER, "empty D3: answered");
+
+	/* Private mapping: writes are seen by reads but do not reach the file. */
+	REQUIRE(ProbeMachine_PutSector(&tMachine, 9, 0xaa) == 'C', "D1: put failed");
+	ProbeMachine_Command(&tMachine, 0x52, 9, aAnswer, sizeof(aAnswer));
+	REQUIRE(aAnswer[2] == 0xaa, "D1: read back %02X after put", aAnswer[2]);
+	REQUIRE(Probe_ReadAtrByte(PROBE_D1_FILE_NAME, 9) == 9, "private D1: write reached the file");
+
+	/* Write-through: the file changes. */
+	REQUIRE(AtariIoMountDisk(tMachine.pContext, 0, PROBE_D1_FILE_NAME, 1), "D1: remount failed");
+	REQUIRE(ProbeMachine_PutSector(&tMachine, 9, 0x55) == 'C', "D1: put failed");
+	REQUIRE(Probe_ReadAtrByte(PROBE_D1_FILE_NAME, 9) == 0x55, "write-through D1: write missing in the file");
+
+	ProbeMachine_Close(&tMachine);
+	return 1;
+}
+
+static int TestWriteBackCommitsOnClose(void)
+{
+	ProbeMachine_t tMachine = ProbeMachine_Open();
+	FILE *pTempFile;
+
+	REQUIRE(tMachine.pContext != NULL, "machine open failed");
+	ProbeMachine_SetDivisor(&tMachine, 0x28);
+
+	/* Long enough that nothing is committed before the close. */
+	AtariIoSetDiskCommitInterval(tMachine.pContext, 60000);
+	REQUIRE(AtariIoMountDisk(tMachine.pContext, 0, PROBE_D1_FILE_NAME, SIO_WRITE_BACK), "D1: mount failed");
+	REQUIRE(tMachine.pIoData->aDrives[0].pJournal != NULL, "D1: has no journal");
+
+	REQUIRE(ProbeMachine_PutSector(&tMachine, 11, 0x66) == 'C', "D1: put failed");
+	REQUIRE(ProbeMachine_PutSector(&tMachine, 12, 0x77) == 'C', "D1: put failed");
+	REQUIRE(Probe_ReadAtrByte(PROBE_D1_FILE_NAME, 11) == 11, "write reached the file synchronously");
+
+	ProbeMachine_Close(&tMachine);
+
+	REQUIRE(Probe_ReadAtrByte(PROBE_D1_FILE_NAME, 11) == 0x66 && Probe_ReadAtrByte(PROBE_D1_FILE_NAME, 12) == 0x77,
+			"queued writes were not committed on close");
+	REQUIRE(Probe_ReadAtrByte(PROBE_D1_FILE_NAME, 13) == 13, "untouched sector changed");
+
+	pTempFile = fopen(PROBE_D1_FILE_NAME ".tmp", "rb");
+	REQUIRE(pTempFile == NULL, "temporary file left behind");
+
+	return 1;
+}
+
+#define PROBE_XEX_FILE_NAME "pokey_sio_probe.xex"
+
+/* $2000-$2002 with INITAD $2000, then $3000-$3001 with RUNAD $3000. */
+static int TestMachinesKeepTheirOwnSio(void)
+{
+	ProbeMachine_t tFirst = ProbeMachine_Open();
+	ProbeMachine_t tSecond = ProbeMachine_Open();
+	u8 aFrame[5] = {0x31, 0x52, 11, 0, 0};
+	u8 aFirst[3 + PROBE_SECTOR_SIZE];
+	u8 aSecond[3 + PROBE_SECTOR_SIZE];
+	u32 i;
+
+	REQUIRE(tFirst.pContext != NULL && tSecond.pContext != NULL, "machine open failed");
+	ProbeMachine_SetDivisor(&tFirst, 0x28);
+	ProbeMachine_SetDivisor(&tSecond, 0x28);
+
+	/* The second machine reads sector 7 while the first is mid-frame. */
+	aFrame[4] = Probe_Checksum(aFrame, 4);
+	for(i = 0; i < 3; i++)
+	{
+		Pokey_SEROUT_SERIN(tFirst.pContext, &aFrame[i]);
+	}
+
+	ProbeMachine_Command(&tSecond, 0x52, 7, aSecond, 2);
+
+	for(; i < 5; i++)
+	{
+		Pokey_SEROUT_SERIN(tFirst.pContext, &aFrame[i]);
+	}
+
+	ProbeMachine_Read(&tFirst, aFirst, sizeof(aFirst));
+	ProbeMachine_Read(&tSecond, aSecond + 2, sizeof(aSecond) - 2);
+
+	REQUIRE(aFirst[0] == 'A' && aFirst[1] == 'C' && aFirst[2] == 11 && aFirst[1 + PROBE_SECTOR_SIZE] == 11,
+			"first machine read %02X %02X %02X", aFirst[0], aFirst[1], aFirst[2]);
+	REQUIRE(aSecond[0] == 'A' && aSecond[1] == 'C' && aSecond[2] == 7 && aSecond[1 + PROBE_SECTOR_SIZE] == 7,
+			"second machine read %02X %02X %02X", aSecond[0], aSecond[1], aSecond[2]);
+
+	ProbeMachine_Close(&tSecond);
+	ProbeMachine_Close(&tFirst);
+	return 1;
+}
+
+static u32 m_lStatusReports;
+static u16 m_sStatusSector;
+
+static void Probe_SioStatus(void *pUser, u16 sSector)
+{
+	(*(u32 *)pUser)++;
+	m_sStatusSector = sSector;
+}
+
+static int TestStatusReportsThrottled(void)
+{
+	ProbeMachine_t tMachine = ProbeMachine_Open();
+	u8 aAnswer[3 + PROBE_SECTOR_SIZE];
+
+	REQUIRE(tMachine.pContext != NULL, "machine open failed");
+	ProbeMachine_SetDivisor(&tMachine, 0x28);
+
+	/* No callback: nothing to report to. */
+	ProbeMachine_Command(&tMachine, 0x52, 2, aAnswer, sizeof(aAnswer));
+
+	Pokey_SetSioStatusCallback(tMachine.pContext, Probe_SioStatus, &m_lStatusReports);
+	tMachine.pContext->llCycleCounter += CYCLES_PER_LINE * LINES_PER_SCREEN_PAL;
+	ProbeMachine_Command(&tMachine, 0x52, 3, aAnswer, sizeof(aAnswer));
+	REQUIRE(m_lStatusReports == 1 && m_sStatusSector == 3, "read of sector 3 not reported");
+
+	/* Within the frame the rest wait; the last one goes out after it. */
+	ProbeMachine_Command(&tMachine, 0x52, 4, aAnswer, sizeof(aAnswer));
+	ProbeMachine_Command(&tMachine, 0x53, 0, aAnswer, 7);
+	REQUIRE(m_lStatusReports == 1, "%lu reports within a frame", m_lStatusReports);
+
+	tMachine.pContext->llCycleCounter += CYCLES_PER_LINE * LINES_PER_SCREEN_PAL;
+	Pokey_Sync(tMachine.pContext, tMachine.pContext->llCycleCounter);
+	REQUIRE(m_lStatusReports == 2 && m_sStatusSector == 0, "status command not reported after the frame");
+
+	Pokey_Sync(tMachine.pContext, tMachine.pContext->llCycleCounter + CYCLES_PER_LINE * LINES_PER_SCREEN_PAL);
+	REQUIRE(m_lStatusReports == 2, "report repeated");
+
+	ProbeMachine_Close(&tMachine);
+	return 1;
+}
+
+static const u8 m_aProbeXex[] = {
+	0xff, 0xff, 0x00, 0x20, 0x02, 0x20, 0x01, 0x02, 0x03,
+	0xe2, 0x02, 0xe3, 0x02, 0x00, 0x20,
+	0x00, 0x30, 0x01, 0x30, 0x04, 0x05,
+	0xe0, 0x02, 0xe1, 0x02, 0x00, 0x30};
+
+static int TestXexLoadsWithoutSio(void)
+{
+	ProbeMachine_t tMachine = ProbeMachine_Open();
+	_6502_Context_t *pContext = tMachine.pContext;
+	FILE *pFile;
+	u16 sReturn;
+
+	REQUIRE(pContext != NULL, "machine open failed");
+
+	pFile = fopen(PROBE_XEX_FILE_NAME, "wb");
+	REQUIRE(pFile != NULL, "cannot write XEX file");
+	fwrite(m_aProbeXex, 1, sizeof(m_aProbeXex), pFile);
+	fclose(pFile);
+
+	AtariIoSetXexDirect(pContext, 1);
+	REQUIRE(AtariIoMountDisk(pContext, 0, PROBE_XEX_FILE_NAME, SIO_WRITE_MEMORY), "XEX mount failed");
+	remove(PROBE_XEX_FILE_NAME);
+
+	/* What the OS leaves after booting sector 1: the boot sector at $0700,
+	   then JSR (DOSINI) reaching the trap at $0707. */
+	memcpy(&pContext->pMemory[0x0700], tMachine.pIoData->aDrives[0].pImage + 16, 128);
+	REQUIRE(pContext->pMemory[0x0701] == 1 && pContext->pMemory[0x0707] == 0x22, "boot sector is not the trap loader");
+
+	pContext->tCpu.sp = 0xff;
+	pContext->tCpu.pc = 0x0708;
+	REQUIRE(pContext->TrapFunction(pContext), "entry trap not taken");
+	REQUIRE(pContext->pMemory[0x2000] == 1 && pContext->pMemory[0x2002] == 3, "first segment not loaded");
+	REQUIRE(pContext->pMemory[0x3000] == 0, "loaded past INITAD");
+	REQUIRE(pContext->tCpu.pc == 0x2000, "INITAD not called (pc $%04X)", pContext->tCpu.pc);
+
+	sReturn = pContext->pMemory[0x1fe] | (pContext->pMemory[0x1ff] << 8);
+	REQUIRE(pContext->tCpu.sp == 0xfd && sReturn + 1 == 0x0709, "INITAD returns to $%04X", sReturn + 1);
+
+	/* RTS from the INIT routine. */
+	pContext->tCpu.sp = 0xff;
+	pContext->tCpu.pc = 0x070a;
+	REQUIRE(pContext->TrapFunction(pContext), "return trap not taken");
+	REQUIRE(pContext->pMemory[0x3000] == 4 && pContext->pMemory[0x3001] == 5, "second segment not loaded");
+	REQUIRE(pContext->tCpu.pc == 0x3000, "RUNAD not jumped to (pc $%04X)", pContext->tCpu.pc);
+
+	ProbeMachine_Close(&tMachine);
+	return 1;
+}
+
+#define PROBE_CAS_FILE_NAME "pokey_sio_probe.cas"
+#define PROBE_CAS_RECORD_SIZE 132u
+#define PROBE_CAS_GAP_MILLISECONDS 100u
+#define PROBE_CAS_BIT_CYCLES ((ATARI_CPU_HZ_PAL + 300u) / 600u)
+#define PROBE_CAS_DATA_CYCLES ((u64)ATARI_CPU_HZ_PAL * PROBE_CAS_GAP_MILLISECONDS / 1000u)
+
+static void Probe_WriteCasChunk(FILE *pFile, const char *pType, u16 sLength, u16 sAux, const u8 *pData)
+{
+	u8 aHeader[8];
+
+	memcpy(aHeader, pType, 4);
+	aHeader[4] = (u8)(sLength & 0xff);
+	aHeader[5] = (u8)(sLength >> 8);
+	aHeader[6] = (u8)(sAux & 0xff);
+	aHeader[7] = (u8)(sAux >> 8);
+	fwrite(aHeader, 1, sizeof(aHeader), pFile);
+
+	if(sLength != 0)
+	{
+		fwrite(pData, 1, sLength, pFile);
+	}
+}
+
+/* 600 baud, two full records whose data bytes are all cFirst and cFirst + 1. */
+static int Probe_WriteCas(u8 cFirst)
+{
+	FILE *pFile = fopen(PROBE_CAS_FILE_NAME, "wb");
+	u8 aRecord[PROBE_CAS_RECORD_SIZE];
+	u32 i;
+
+	if(!pFile)
+	{
+		return 0;
+	}
+
+	Probe_WriteCasChunk(pFile, "FUJI", 0, 0, NULL);
+	Probe_WriteCasChunk(pFile, "baud", 0, 600, NULL);
+
+	for(i = 0; i < 2; i++)
+	{
+		aRecord[0] = 0x55;
+		aRecord[1] = 0x55;
+		aRecord[2] = 0xfc;
+		memset(&aRecord[3], (u8)(cFirst + i), 128);
+		aRecord[131] = Probe_Checksum(aRecord, 131);
+		Probe_WriteCasChunk(pFile, "data", PROBE_CAS_RECORD_SIZE, PROBE_CAS_GAP_MILLISECONDS, aRecord);
+	}
+
+	return fclose(pFile) == 0;
+}
+
+static u8 ProbeMachine_SerialInputLine(ProbeMachine_t *pMachine)
+{
+	return (*Pokey_SKCTL_SKSTAT(pMachine->pContext, NULL) >> 4) & 1;
+}
+
+/* OS cassette handler record read: 131 bytes into CASBUF ($03FD). */
+static u8 ProbeMachine_CassetteRead(ProbeMachine_t *pMachine, u32 *pBytes)
+{
+	u8 *pMemory = pMachine->pContext->pMemory;
+
+	pMemory[0x0300] = 0x60;
+	pMemory[0x0301] = 0;
+	pMemory[0x0302] = 0x52;
+	pMemory[0x0304] = 0xfd;
+	pMemory[0x0305] = 0x03;
+	pMemory[0x0308] = 131;
+	pMemory[0x0309] = 0;
+
+	return Pokey_SioRequest(pMachine->pContext, pBytes);
+}
+
+static int TestCassettePlaysAndLoadsFast(void)
+{
+	ProbeMachine_t tMachine = ProbeMachine_Open();
+	_6502_Context_t *pContext = tMachine.pContext;
+	u8 *pMemory;
+	u8 cMotor;
+	u64 llStart;
+	u32 lBytes;
+
+	REQUIRE(pContext != NULL, "machine open failed");
+	pMemory = pContext->pMemory;
+
+	REQUIRE(Probe_WriteCas(0x10), "cannot write CAS file");
+	REQUIRE(AtariIoMountCassette(pContext, PROBE_CAS_FILE_NAME), "CAS mount failed");
+	remove(PROBE_CAS_FILE_NAME);
+
+	/* Motor off: the line idles at mark and nothing arrives. */
+	REQUIRE(ProbeMachine_SerialInputLine(&tMachine) == 1, "line not idle with the motor off");
+	REQUIRE(tMachine.pIoData->llCassetteByteCycle == CYCLE_NEVER, "byte due with the motor off");
+
+	/* JMP * with interrupts masked, for the event dispatch below. */
+	pMemory[0x2000] = 0x4c;
+	pMemory[0x2001] = 0x00;
+	pMemory[0x2002] = 0x20;
+	pContext->tCpu.pc = 0x2000;
+
+	cMotor = 0x34;
+	Pia_PACTL(pContext, &cMotor);
+	llStart = pContext->llCycleCounter;
+	REQUIRE(tMachine.pIoData->llCassetteByteCycle == llStart + PROBE_CAS_DATA_CYCLES + 10 * PROBE_CAS_BIT_CYCLES,
+			"first byte due at +%llu", (unsigned long long)(tMachine.pIoData->llCassetteByteCycle - llStart));
+
+	/* The gap is mark, then the start bit and $55 LSB first. */
+	_6502_Run(pContext, llStart + PROBE_CAS_DATA_CYCLES - PROBE_CAS_BIT_CYCLES / 2);
+	REQUIRE(ProbeMachine_SerialInputLine(&tMachine) == 1, "gap is not mark");
+	_6502_Run(pContext, llStart + PROBE_CAS_DATA_CYCLES + PROBE_CAS_BIT_CYCLES / 2);
+	REQUIRE(ProbeMachine_SerialInputLine(&tMachine) == 0, "no start bit");
+	_6502_Run(pContext, llStart + PROBE_CAS_DATA_CYCLES + PROBE_CAS_BIT_CYCLES * 3 / 2);
+	REQUIRE(ProbeMachine_SerialInputLine(&tMachine) == 1, "data bit 0 of $55 not 1");
+	_6502_Run(pContext, llStart + PROBE_CAS_DATA_CYCLES + PROBE_CAS_BIT_CYCLES * 5 / 2);
+	REQUIRE(ProbeMachine_SerialInputLine(&tMachine) == 0, "data bit 1 of $55 not 0");
+
+	_6502_Run(pContext, llStart + PROBE_CAS_DATA_CYCLES + 21 * PROBE_CAS_BIT_CYCLES);
+	REQUIRE(pMemory[0xd20d] == 0x55 && !(pMemory[0xd20e] & IRQ_SERIAL_INPUT_DATA_READY),
+			"SERIN $%02X, IRQST $%02X after two bytes", pMemory[0xd20d], pMemory[0xd20e]);
+	REQUIRE(tMachine.pIoData->llCassetteByteCycle == llStart + PROBE_CAS_DATA_CYCLES + 30 * PROBE_CAS_BIT_CYCLES,
+			"third byte not next");
+
+	/* Motor off again: tape time stops. */
+	cMotor = 0x3c;
+	Pia_PACTL(pContext, &cMotor);
+	REQUIRE(tMachine.pIoData->llCassetteByteCycle == CYCLE_NEVER, "byte due with the motor stopped");
+
+	/* Without fast loading the OS plays the tape itself. */
+	REQUIRE(ProbeMachine_CassetteRead(&tMachine, &lBytes) == 0, "record served with fast loading off");
+
+	/* The record under way comes whole, then the next, then the end. */
+	AtariIoSetCassetteFast(pContext, 1);
+	REQUIRE(tMachine.pIoData->bSiovTrap, "SIOV trap not installed for C:");
+	REQUIRE(ProbeMachine_CassetteRead(&tMachine, &lBytes) == 0x01 && lBytes == 131, "first record not read");
+	REQUIRE(pMemory[0x03fd] == 0x55 && pMemory[0x03ff] == 0xfc && pMemory[0x0400] == 0x10 && pMemory[0x047f] == 0x10,
+			"first record wrong");
+	REQUIRE(ProbeMachine_CassetteRead(&tMachine, &lBytes) == 0x01 && pMemory[0x0400] == 0x11, "second record not read");
+	REQUIRE(ProbeMachine_CassetteRead(&tMachine, &lBytes) == 0x8a, "read past the end of the tape");
+
+	AtariIoSetCassetteFast(pContext, 0);
+	REQUIRE(!tMachine.pIoData->bSiovTrap, "SIOV trap left in");
+
+	ProbeMachine_Close(&tMachine);
+	return 1;
+}
+
+int main(int argc, char *argv[])
+{
+	int bOk;
+
+	_6502_Init();
+
+	if(!Probe_WriteAtr(PROBE_D1_FILE_NAME, 0) || !Probe_WriteAtr(PROBE_D2_FILE_NAME, 0x40))
+	{
+		fprintf(stderr, "cannot write ATR files\n");
+		return 1;
+	}
+
+	bOk = TestSerialTimingFollowsDivisor() && TestHighSpeedCommandSets() && TestDrivesRouteByDeviceId() &&
+		  TestMachinesKeepTheirOwnSio() && TestStatusReportsThrottled() && TestWriteBackCommitsOnClose() &&
+		  TestXexLoadsWithoutSio() && TestCassettePlaysAndLoadsFast();
+
+	remove(PROBE_D1_FILE_NAME);
+	remove(PROBE_D2_FILE_NAME);
+
+	if(!bOk)
+	{
+		return 1;
+	}
+
+	printf("pokey_sio_probe passed\n");
+	return 0;
+}
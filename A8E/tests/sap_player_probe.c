@@ -0,0 +1,251 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL2/SDL.h>
+
+#include "6502.h"
+#include "AtariIo.h"
+#include "SapPlayer.h"
+
+#define REQUIRE(condition, format, ...)                                  \
+	do                                                                   \
+	{                                                                    \
+		if(!(condition))                                                 \
+		{                                                                \
+			fprintf(stderr, "%s: " format "\n", __func__, ##__VA_ARGS__); \
+			return 0;                                                    \
+		}                                                                \
+	} while(0)
+
+#define PROBE_SAP_FILE_NAME "sap_player_probe.sap"
+#define PROBE_WAV_FILE_NAME "sap_player_probe.wav"
+#define PROBE_WAV_HEADER_SIZE 44
+#define PROBE_SAMPLE_RATE 48000u
+#define PROBE_R_FRAMES 25u
+
+/* 400 ms holds 20 PAL frames of 312 lines, with room to spare on both
+   sides for the cycles INIT takes. */
+#define PROBE_MILLISECONDS 400u
+#define PROBE_FRAMES 20u
+#define PROBE_SONG 1
+
+/* What the routines below leave in RAM. */
+#define PROBE_INIT_COUNT 0x2100
+#define PROBE_PLAYER_COUNT 0x2101
+#define PROBE_INIT_SONG 0x2102
+#define PROBE_INIT_MUSIC 0x2103
+#define PROBE_MAIN_COPY 0x2105
+#define PROBE_MUSIC 0x2345
+
+static const u8 m_aProgram[] = {
+	/* $2000 INIT (types B and D): song from A, SKCTL = 3, AUDCTL = 0, AUDC1 = $AF. */
+	0x00, 0x20, 0x15, 0x20,
+	0x8d, 0x02, 0x21, 0xee, 0x00, 0x21, 0xa9, 0x03, 0x8d, 0x0f, 0xd2, 0xa9, 0x00, 0x8d, 0x08, 0xd2,
+	0xa9, 0xaf, 0x8d, 0x01, 0xd2, 0x60,
+	0xff, 0xff,
+	/* $2020 PLAYER: INC $2101, AUDF1 = $2101. */
+	0x20, 0x20, 0x29, 0x20,
+	0xee, 0x01, 0x21, 0xad, 0x01, 0x21, 0x8d, 0x00, 0xd2, 0x60,
+	/* $2030 type C player: +3 init, +6 play. */
+	0x30, 0x20, 0x38, 0x20,
+	0x60, 0xea, 0xea, 0x4c, 0x40, 0x20, 0x4c, 0x20, 0x20,
+	/* $2040 type C init: A = $70 stores the music address from X/Y,
+	   A = 0 takes the song from X and goes on with INIT. */
+	0x40, 0x20, 0x50, 0x20,
+	0xc9, 0x70, 0xd0, 0x07, 0x8e, 0x03, 0x21, 0x8c, 0x04, 0x21, 0x60, 0x8e, 0x02, 0x21, 0x4c, 0x03,
+	0x20,
+	/* $2060 type D main program: JSR INIT, then copy the PLAYER count
+	   to $2105 forever. */
+	0x60, 0x20, 0x6b, 0x20,
+	0x20, 0x00, 0x20, 0xad, 0x01, 0x21, 0x8d, 0x05, 0x21, 0x4c, 0x63, 0x20};
+
+static int Probe_WriteSap(const char *pHeader, const u8 *pData, u32 lSize)
+{
+	FILE *pFile = fopen(PROBE_SAP_FILE_NAME, "wb");
+
+	if(!pFile)
+	{
+		return 0;
+	}
+
+	fputs(pHeader, pFile);
+	fputc(0xff, pFile);
+	fputc(0xff, pFile);
+	fwrite(pData, 1, lSize, pFile);
+	fclose(pFile);
+
+	return 1;
+}
+
+/* Returns the number of samples in the probe WAV, or -1 if flat or missing. */
+static long Probe_WavSamples(void)
+{
+	FILE *pFile = fopen(PROBE_WAV_FILE_NAME, "rb");
+	u8 aHeader[PROBE_WAV_HEADER_SIZE];
+	u8 aFirst[2];
+	u8 aSample[2];
+	long lSamples = 0;
+	int bToneHeard = 0;
+
+	if(!pFile)
+	{
+		return -1;
+	}
+
+	if(fread(aHeader, 1, sizeof(aHeader), pFile) != sizeof(aHeader) ||
+	   fread(aFirst, 1, 2, pFile) != 2)
+	{
+		fclose(pFile);
+		return -1;
+	}
+
+	lSamples = 1;
+	while(fread(aSample, 1, 2, pFile) == 2)
+	{
+		bToneHeard |= memcmp(aSample, aFirst, 2) != 0;
+		lSamples++;
+	}
+	fclose(pFile);
+
+	return bToneHeard ? lSamples : -1;
+}
+
+static int Probe_Render(const char *pHeader, u8 *pMemory)
+{
+	SapFile_t tSap;
+	int bOk;
+
+	if(!Probe_WriteSap(pHeader, m_aProgram, sizeof(m_aProgram)) || !Sap_Load(&tSap, PROBE_SAP_FILE_NAME))
+	{
+		return 0;
+	}
+
+	bOk = Sap_RenderWav(&tSap, PROBE_SONG, PROBE_MILLISECONDS, PROBE_WAV_FILE_NAME, pMemory);
+	Sap_Free(&tSap);
+
+	return bOk;
+}
+
+static int TestTypeBCallsInitAndPlayer(void)
+{
+	static u8 aMemory[0x10000];
+	SapFile_t tSap;
+	long lSamples;
+
+	REQUIRE(Probe_WriteSap("SAP\r\nNAME \"Probe\"\r\nTYPE B\r\nSONGS 2\r\nINIT 2000\r\nPLAYER 2020\r\n"
+						   "TIME 00:00.500\r\nTIME 00:00.400\r\n",
+						   m_aProgram, sizeof(m_aProgram)),
+			"cannot write SAP file");
+	REQUIRE(Sap_Load(&tSap, PROBE_SAP_FILE_NAME), "SAP file did not load");
+	REQUIRE(tSap.cType == 'B' && tSap.sInit == 0x2000 && tSap.sPlayer == 0x2020 && tSap.cSongs == 2,
+			"header parsed as type %c init $%04X player $%04X", tSap.cType, tSap.sInit, tSap.sPlayer);
+	REQUIRE(tSap.sFastplay == LINES_PER_SCREEN_PAL && tSap.aSongMilliseconds[0] == 500 &&
+				tSap.aSongMilliseconds[PROBE_SONG] == PROBE_MILLISECONDS,
+			"fastplay %u time %lu", tSap.sFastplay, tSap.aSongMilliseconds[PROBE_SONG]);
+	REQUIRE(strcmp(tSap.aName, "Probe") == 0, "name parsed as '%s'", tSap.aName);
+
+	/* The song's TIME tag gives the length. */
+	REQUIRE(Sap_RenderWav(&tSap, PROBE_SONG, 0, PROBE_WAV_FILE_NAME, aMemory), "render failed");
+	Sap_Free(&tSap);
+
+	lSamples = Probe_WavSamples();
+	REQUIRE(lSamples + 1 >= (long)(PROBE_SAMPLE_RATE * PROBE_MILLISECONDS / 1000u) &&
+				lSamples <= (long)(PROBE_SAMPLE_RATE * PROBE_MILLISECONDS / 1000u) + 1,
+			"%u ms of song produced %ld samples", PROBE_MILLISECONDS, lSamples);
+
+	REQUIRE(aMemory[PROBE_INIT_COUNT] == 1 && aMemory[PROBE_INIT_SONG] == PROBE_SONG,
+			"INIT ran %u times, last for song %u", aMemory[PROBE_INIT_COUNT], aMemory[PROBE_INIT_SONG]);
+	REQUIRE(aMemory[PROBE_PLAYER_COUNT] == PROBE_FRAMES, "PLAYER ran %u times in %u frames",
+			aMemory[PROBE_PLAYER_COUNT], PROBE_FRAMES);
+
+	return 1;
+}
+
+static int TestTypeCInitsMusicThenSong(void)
+{
+	static u8 aMemory[0x10000];
+
+	REQUIRE(Probe_Render("SAP\r\nTYPE C\r\nSONGS 2\r\nMUSIC 2345\r\nPLAYER 2030\r\n", aMemory),
+			"render failed");
+	REQUIRE(Probe_WavSamples() > 0, "no tone");
+
+	REQUIRE(aMemory[PROBE_INIT_MUSIC] == (u8)PROBE_MUSIC && aMemory[PROBE_INIT_MUSIC + 1] == PROBE_MUSIC >> 8,
+			"music address passed as $%02X%02X", aMemory[PROBE_INIT_MUSIC + 1], aMemory[PROBE_INIT_MUSIC]);
+	REQUIRE(aMemory[PROBE_INIT_COUNT] == 1 && aMemory[PROBE_INIT_SONG] == PROBE_SONG,
+			"song init ran %u times, last for song %u", aMemory[PROBE_INIT_COUNT], aMemory[PROBE_INIT_SONG]);
+	REQUIRE(aMemory[PROBE_PLAYER_COUNT] == PROBE_FRAMES, "player+6 ran %u times in %u frames",
+			aMemory[PROBE_PLAYER_COUNT], PROBE_FRAMES);
+
+	return 1;
+}
+
+static int TestTypeDInterruptsMainProgram(void)
+{
+	static u8 aMemory[0x10000];
+
+	REQUIRE(Probe_Render("SAP\r\nTYPE D\r\nSONGS 2\r\nINIT 2060\r\nPLAYER 2020\r\n", aMemory),
+			"render failed");
+	REQUIRE(Probe_WavSamples() > 0, "no tone");
+
+	REQUIRE(aMemory[PROBE_INIT_COUNT] == 1 && aMemory[PROBE_INIT_SONG] == PROBE_SONG,
+			"INIT ran %u times, last for song %u", aMemory[PROBE_INIT_COUNT], aMemory[PROBE_INIT_SONG]);
+	REQUIRE(aMemory[PROBE_PLAYER_COUNT] == PROBE_FRAMES, "PLAYER ran %u times in %u frames",
+			aMemory[PROBE_PLAYER_COUNT], PROBE_FRAMES);
+
+	/* The main program goes on after every PLAYER call. */
+	REQUIRE(aMemory[PROBE_MAIN_COPY] == PROBE_FRAMES, "main program saw %u of %u frames",
+			aMemory[PROBE_MAIN_COPY], PROBE_FRAMES);
+
+	return 1;
+}
+
+static int TestTypeRStopsAfterLastFrame(void)
+{
+	u8 aFrames[PROBE_R_FRAMES * 9];
+	SapFile_t tSap;
+	long lSamples;
+	long lExpected;
+	u32 i;
+
+	memset(aFrames, 0, sizeof(aFrames));
+	for(i = 0; i < PROBE_R_FRAMES; i++)
+	{
+		aFrames[i * 9 + 0] = (u8)(0x20 + i);
+		aFrames[i * 9 + 1] = 0xaf;
+	}
+
+	REQUIRE(Probe_WriteSap("SAP\r\nTYPE R\r\n", aFrames, sizeof(aFrames)), "cannot write SAP file");
+	REQUIRE(Sap_Load(&tSap, PROBE_SAP_FILE_NAME), "SAP file did not load");
+	REQUIRE(Sap_RenderWav(&tSap, 0, 10000, PROBE_WAV_FILE_NAME, NULL), "render failed");
+	Sap_Free(&tSap);
+
+	lExpected = (long)((u64)PROBE_R_FRAMES * LINES_PER_SCREEN_PAL * CYCLES_PER_LINE *
+					   PROBE_SAMPLE_RATE / ATARI_CPU_HZ_PAL);
+	lSamples = Probe_WavSamples();
+	REQUIRE(lSamples + 1 >= lExpected && lSamples <= lExpected + 1,
+			"%u frames produced %ld samples, expected %ld", PROBE_R_FRAMES, lSamples, lExpected);
+
+	return 1;
+}
+
+int main(int argc, char *argv[])
+{
+	int bOk;
+
+	Sap_Init();
+
+	bOk = TestTypeBCallsInitAndPlayer() && TestTypeCInitsMusicThenSong() && TestTypeDInterruptsMainProgram() &&
+		  TestTypeRStopsAfterLastFrame();
+
+	remove(PROBE_SAP_FILE_NAME);
+	remove(PROBE_WAV_FILE_NAME);
+
+	if(!bOk)
+	{
+		return 1;
+	}
+
+	printf("sap_player_probe passed\n");
+	return 0;
+}